@@ -44,6 +44,14 @@ typedef struct
     gboolean match;
 } ComponentEventInfo;
 
+/* An entry of an entity_events hash: the key points to guid and the
+ * value to info, so each entity takes a single allocation. */
+typedef struct
+{
+    GncGUID guid;
+    EventInfo info;
+} EntityEventEntry;
+
 typedef struct
 {
     GNCComponentRefreshHandler refresh_handler;
@@ -67,6 +75,15 @@ static GList *components = NULL;
 static ComponentEventInfo changes = { NULL, NULL, FALSE };
 static ComponentEventInfo changes_backup = { NULL, NULL, FALSE };
 
+/* The components watching each entity: GncGUID --> GList of component
+ * ids.  Refreshes look the changed entities up here instead of
+ * comparing the changes with the watches of every component. */
+static GHashTable *entity_watchers = NULL;
+
+/* Bumped whenever a component's entity watches change, so a refresh
+ * can tell whether a refresh handler changed them. */
+static guint watch_serial = 0;
+
 
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = GNC_MOD_GUI;
@@ -140,17 +157,14 @@ destroy_mask_hash (GHashTable *hash)
 static gboolean
 destroy_event_hash_helper (gpointer key, gpointer value, gpointer user_data)
 {
-    GncGUID *guid = key;
-    EventInfo *ei = value;
-
-    guid_free (guid);
-    g_free (ei);
+    /* key points to the start of its EntityEventEntry */
+    g_free (key);
 
     return TRUE;
 }
 
 /* clear a hash table of the form GncGUID --> EventInfo, where
- * both keys and values are g_malloced */
+ * keys and values are parts of g_malloced EntityEventEntrys */
 static void
 clear_event_hash (GHashTable *hash)
 {
@@ -199,8 +213,7 @@ add_event (ComponentEventInfo *cei, const GncGUID *entity,
         if (g_hash_table_lookup_extended (hash, entity, &key, &value))
         {
             g_hash_table_remove (hash, entity);
-            guid_free (key);
-            g_free (value);
+            g_free (key);
         }
     }
     else
@@ -210,15 +223,13 @@ add_event (ComponentEventInfo *cei, const GncGUID *entity,
         ei = g_hash_table_lookup (hash, entity);
         if (ei == NULL)
         {
-            GncGUID *key;
-
-            key = guid_malloc ();
-            *key = *entity;
+            EntityEventEntry *entry = g_new (EntityEventEntry, 1);
 
-            ei = g_new (EventInfo, 1);
-            ei->event_mask = 0;
+            entry->guid = *entity;
+            entry->info.event_mask = 0;
+            ei = &entry->info;
 
-            g_hash_table_insert (hash, key, ei);
+            g_hash_table_insert (hash, &entry->guid, ei);
         }
 
         if (or_in)
@@ -252,6 +263,57 @@ add_event_type (ComponentEventInfo *cei, QofIdTypeConst entity_type,
         *mask = event_mask;
 }
 
+static void
+watch_index_add (const GncGUID *entity, gint component_id)
+{
+    gpointer key, value;
+    GList *ids = NULL;
+
+    if (g_hash_table_lookup_extended (entity_watchers, entity, &key, &value))
+    {
+        ids = value;
+        if (g_list_find (ids, GINT_TO_POINTER (component_id)))
+            return;
+    }
+    else
+    {
+        key = guid_malloc ();
+        *(GncGUID *) key = *entity;
+    }
+
+    ids = g_list_prepend (ids, GINT_TO_POINTER (component_id));
+    g_hash_table_insert (entity_watchers, key, ids);
+}
+
+static void
+watch_index_remove (const GncGUID *entity, gint component_id)
+{
+    gpointer key, value;
+    GList *ids;
+
+    if (!g_hash_table_lookup_extended (entity_watchers, entity, &key, &value))
+        return;
+
+    ids = g_list_remove (value, GINT_TO_POINTER (component_id));
+    if (ids)
+    {
+        g_hash_table_insert (entity_watchers, key, ids);
+        return;
+    }
+
+    g_hash_table_remove (entity_watchers, entity);
+    guid_free (key);
+}
+
+static gboolean
+destroy_watch_index_helper (gpointer key, gpointer value, gpointer user_data)
+{
+    guid_free (key);
+    g_list_free (value);
+
+    return TRUE;
+}
+
 static void
 gnc_cm_event_handler (QofInstance *entity,
                       QofEventId event_type,
@@ -298,6 +360,8 @@ gnc_component_manager_init (void)
     changes_backup.event_masks = g_hash_table_new (g_str_hash, g_str_equal);
     changes_backup.entity_events = guid_hash_table_new ();
 
+    entity_watchers = guid_hash_table_new ();
+
     handler_id = qof_event_register_handler (gnc_cm_event_handler, NULL);
 }
 
@@ -322,6 +386,11 @@ gnc_component_manager_shutdown (void)
     destroy_event_hash (changes_backup.entity_events);
     changes_backup.entity_events = NULL;
 
+    g_hash_table_foreach_remove (entity_watchers, destroy_watch_index_helper,
+                                 NULL);
+    g_hash_table_destroy (entity_watchers);
+    entity_watchers = NULL;
+
     qof_event_unregister_handler (handler_id);
 }
 
@@ -464,6 +533,12 @@ gnc_gui_component_watch_entity (gint component_id,
     }
 
     add_event (&ci->watch_info, entity, event_mask, FALSE);
+
+    watch_serial++;
+    if (event_mask)
+        watch_index_add (entity, component_id);
+    else
+        watch_index_remove (entity, component_id);
 }
 
 void
@@ -492,6 +567,12 @@ gnc_gui_get_entity_events (GHashTable *changes, const GncGUID *entity)
     return g_hash_table_lookup (changes, entity);
 }
 
+static void
+unwatch_helper (gpointer key, gpointer value, gpointer user_data)
+{
+    watch_index_remove (key, GPOINTER_TO_INT (user_data));
+}
+
 void
 gnc_gui_component_clear_watches (gint component_id)
 {
@@ -504,7 +585,10 @@ gnc_gui_component_clear_watches (gint component_id)
         return;
     }
 
+    g_hash_table_foreach (ci->watch_info.entity_events, unwatch_helper,
+                          GINT_TO_POINTER (component_id));
     clear_event_info (&ci->watch_info);
+    watch_serial++;
 }
 
 void
@@ -610,6 +694,18 @@ match_type_helper (gpointer key, gpointer value, gpointer user_data)
         cei->match = TRUE;
 }
 
+static gboolean
+type_changes_match (ComponentEventInfo *cei, ComponentEventInfo *changes)
+{
+    if (cei == NULL)
+        return FALSE;
+
+    cei->match = FALSE;
+    g_hash_table_foreach (changes->event_masks, match_type_helper, cei);
+
+    return cei->match;
+}
+
 static void
 match_helper (gpointer key, gpointer value, gpointer user_data)
 {
@@ -626,8 +722,9 @@ match_helper (gpointer key, gpointer value, gpointer user_data)
         cei->match = TRUE;
 }
 
+/* Compare the entity watches of one component with the changes */
 static gboolean
-changes_match (ComponentEventInfo *cei, ComponentEventInfo *changes)
+entity_changes_match (ComponentEventInfo *cei, ComponentEventInfo *changes)
 {
     ComponentEventInfo *big_cei;
     GHashTable *smalltable;
@@ -635,12 +732,6 @@ changes_match (ComponentEventInfo *cei, ComponentEventInfo *changes)
     if (cei == NULL)
         return FALSE;
 
-    /* check types first, for efficiency */
-    cei->match = FALSE;
-    g_hash_table_foreach (changes->event_masks, match_type_helper, cei);
-    if (cei->match)
-        return TRUE;
-
     if (g_hash_table_size (cei->entity_events) <=
             g_hash_table_size (changes->entity_events))
     {
@@ -660,9 +751,36 @@ changes_match (ComponentEventInfo *cei, ComponentEventInfo *changes)
     return big_cei->match;
 }
 
+/* Collect the ids of the components watching one of the changed
+ * entities for one of its events. */
+static void
+match_watchers_helper (gpointer key, gpointer value, gpointer user_data)
+{
+    GncGUID *guid = key;
+    EventInfo *ei_1 = value;
+    GHashTable *matched = user_data;
+    GList *node;
+
+    for (node = g_hash_table_lookup (entity_watchers, guid); node;
+            node = node->next)
+    {
+        ComponentInfo *ci = find_component (GPOINTER_TO_INT (node->data));
+        EventInfo *ei_2;
+
+        if (!ci)
+            continue;
+
+        ei_2 = g_hash_table_lookup (ci->watch_info.entity_events, guid);
+        if (ei_2 && (ei_1->event_mask & ei_2->event_mask))
+            g_hash_table_insert (matched, node->data, node->data);
+    }
+}
+
 static void
 gnc_gui_refresh_internal (gboolean force)
 {
+    GHashTable *matched = NULL;
+    guint matched_serial = 0;
     GList *list;
     GList *node;
 
@@ -689,6 +807,14 @@ gnc_gui_refresh_internal (gboolean force)
 
     list = find_component_ids_by_class (NULL);
 
+    if (!force)
+    {
+        matched = g_hash_table_new (g_direct_hash, g_direct_equal);
+        g_hash_table_foreach (changes_backup.entity_events,
+                              match_watchers_helper, matched);
+        matched_serial = watch_serial;
+    }
+
     for (node = list; node; node = node->next)
     {
         ComponentInfo *ci = find_component (GPOINTER_TO_INT (node->data));
@@ -714,7 +840,12 @@ gnc_gui_refresh_internal (gboolean force)
                 ci->refresh_handler (NULL, ci->user_data);
             }
         }
-        else if (changes_match (&ci->watch_info, &changes_backup))
+        /* A refresh handler earlier in this pass may have changed the
+         * watches, and then the component has to be compared again. */
+        else if ((watch_serial == matched_serial ?
+                  g_hash_table_lookup (matched, node->data) != NULL :
+                  entity_changes_match (&ci->watch_info, &changes_backup)) ||
+                 type_changes_match (&ci->watch_info, &changes_backup))
         {
             if (ci->refresh_handler)
             {
@@ -736,6 +867,8 @@ gnc_gui_refresh_internal (gboolean force)
     got_events = FALSE;
 
     g_list_free (list);
+    if (matched)
+        g_hash_table_destroy (matched);
 
     gnc_resume_gui_refresh ();
 }
@@ -32,6 +32,10 @@ static QofLogModule log_module = G_LOG_DOMAIN;
 
 /* Keys used for core preferences */
 #define GNC_PREF_FILE_COMPRESSION    "file-compression"
+#define GNC_PREF_FILE_COMPRESSION_THREADS "file-compression-threads"
+#define GNC_PREF_FILE_COMPRESSION_LEVEL   "file-compression-level"
+#define GNC_PREF_FILE_JOURNAL        "file-journal"
+#define GNC_PREF_FILE_BINARY_CACHE   "file-binary-cache"
 #define GNC_PREF_RETAIN_TYPE_NEVER   "retain-type-never"
 #define GNC_PREF_RETAIN_TYPE_DAYS    "retain-type-days"
 #define GNC_PREF_RETAIN_TYPE_FOREVER "retain-type-forever"
@@ -78,6 +82,46 @@ file_compression_changed_cb(gpointer gsettings, gchar *key, gpointer user_data)
     }
 }
 
+static void
+file_compression_threads_changed_cb(gpointer gsettings, gchar *key, gpointer user_data)
+{
+    if (gnc_prefs_is_set_up())
+    {
+        gint threads = gnc_prefs_get_int(GNC_PREFS_GROUP_GENERAL, GNC_PREF_FILE_COMPRESSION_THREADS);
+        gnc_prefs_set_file_compression_threads (threads);
+    }
+}
+
+static void
+file_compression_level_changed_cb(gpointer gsettings, gchar *key, gpointer user_data)
+{
+    if (gnc_prefs_is_set_up())
+    {
+        gint level = gnc_prefs_get_int(GNC_PREFS_GROUP_GENERAL, GNC_PREF_FILE_COMPRESSION_LEVEL);
+        gnc_prefs_set_file_compression_level (level);
+    }
+}
+
+static void
+file_journal_changed_cb(gpointer gsettings, gchar *key, gpointer user_data)
+{
+    if (gnc_prefs_is_set_up())
+    {
+        gboolean journaled = gnc_prefs_get_bool(GNC_PREFS_GROUP_GENERAL, GNC_PREF_FILE_JOURNAL);
+        gnc_prefs_set_file_save_journaled (journaled);
+    }
+}
+
+static void
+file_binary_cache_changed_cb(gpointer gsettings, gchar *key, gpointer user_data)
+{
+    if (gnc_prefs_is_set_up())
+    {
+        gboolean cached = gnc_prefs_get_bool(GNC_PREFS_GROUP_GENERAL, GNC_PREF_FILE_BINARY_CACHE);
+        gnc_prefs_set_file_binary_cache (cached);
+    }
+}
+
 
 void gnc_prefs_init (void)
 {
@@ -89,6 +133,10 @@ void gnc_prefs_init (void)
     file_retain_changed_cb (NULL, NULL, NULL);
     file_retain_type_changed_cb (NULL, NULL, NULL);
     file_compression_changed_cb (NULL, NULL, NULL);
+    file_compression_threads_changed_cb (NULL, NULL, NULL);
+    file_compression_level_changed_cb (NULL, NULL, NULL);
+    file_journal_changed_cb (NULL, NULL, NULL);
+    file_binary_cache_changed_cb (NULL, NULL, NULL);
 
     /* Check for invalid retain_type (days)/retain_days (0) combo.
      * This can happen either because a user changed the preferences
@@ -122,5 +170,13 @@ void gnc_prefs_init (void)
                            file_retain_type_changed_cb, NULL);
     gnc_prefs_register_cb (GNC_PREFS_GROUP_GENERAL, GNC_PREF_FILE_COMPRESSION,
                            file_compression_changed_cb, NULL);
+    gnc_prefs_register_cb (GNC_PREFS_GROUP_GENERAL, GNC_PREF_FILE_COMPRESSION_THREADS,
+                           file_compression_threads_changed_cb, NULL);
+    gnc_prefs_register_cb (GNC_PREFS_GROUP_GENERAL, GNC_PREF_FILE_COMPRESSION_LEVEL,
+                           file_compression_level_changed_cb, NULL);
+    gnc_prefs_register_cb (GNC_PREFS_GROUP_GENERAL, GNC_PREF_FILE_JOURNAL,
+                           file_journal_changed_cb, NULL);
+    gnc_prefs_register_cb (GNC_PREFS_GROUP_GENERAL, GNC_PREF_FILE_BINARY_CACHE,
+                           file_binary_cache_changed_cb, NULL);
 
 }
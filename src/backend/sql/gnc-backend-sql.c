@@ -221,6 +221,7 @@ gnc_sql_load( GncSqlBackend* be, /*@ dependent @*/ QofBook *book, QofBackendLoad
     ENTER( "be=%p, book=%p", be, book );
 
     be->loading = TRUE;
+    qof_book_begin_bulk_load( book );
 
     if ( loadType == LOAD_TYPE_INITIAL_LOAD )
     {
@@ -263,6 +264,7 @@ gnc_sql_load( GncSqlBackend* be, /*@ dependent @*/ QofBook *book, QofBackendLoad
         gnc_sql_transaction_load_all_tx( be );
     }
 
+    qof_book_end_bulk_load( book );
     be->loading = FALSE;
 
     /* Mark the sessoion as clean -- though it should never be marked
@@ -2607,30 +2609,58 @@ execute_statement_get_count( GncSqlBackend* be, GncSqlStatement* stmt )
     return count;
 }
 
+/* The GUIDs are converted this many at a time */
+#define GUID_LIST_CHUNK 256
+
+void
+gnc_sql_append_guids_to_sql( GString* sql, const GncGUID* guids, gsize n )
+{
+    gchar buf[GUID_LIST_CHUNK * (GUID_ENCODING_LENGTH + 1)];
+    gsize done, chunk, i;
+
+    g_return_if_fail( sql != NULL );
+
+    for ( done = 0; done < n; done += chunk )
+    {
+        chunk = MIN( n - done, GUID_LIST_CHUNK );
+        (void)guid_to_string_buff_n( guids + done, chunk, buf );
+        for ( i = 0; i < chunk; i++ )
+        {
+            if ( done + i > 0 )
+            {
+                (void)g_string_append_c( sql, ',' );
+            }
+            (void)g_string_append_c( sql, '\'' );
+            (void)g_string_append_len( sql, buf + i * (GUID_ENCODING_LENGTH + 1),
+                                       GUID_ENCODING_LENGTH );
+            (void)g_string_append_c( sql, '\'' );
+        }
+    }
+}
+
 guint
 gnc_sql_append_guid_list_to_sql( GString* sql, GList* list, guint maxCount )
 {
-    gchar guid_buf[GUID_ENCODING_LENGTH+1];
-    gboolean first_guid = TRUE;
-    guint count;
+    GncGUID guids[GUID_LIST_CHUNK];
+    guint count = 0;
+    guint n;
 
     g_return_val_if_fail( sql != NULL, 0 );
 
     if ( list == NULL ) return 0;
 
-    for ( count = 0; list != NULL && count < maxCount; list = list->next, count++ )
+    while ( list != NULL && count < maxCount )
     {
-        QofInstance* inst = QOF_INSTANCE(list->data);
-        (void)guid_to_string_buff( qof_instance_get_guid( inst ), guid_buf );
-
-        if ( !first_guid )
+        for ( n = 0; list != NULL && count < maxCount && n < GUID_LIST_CHUNK;
+                list = list->next, count++, n++ )
+        {
+            guids[n] = *qof_instance_get_guid( QOF_INSTANCE(list->data) );
+        }
+        if ( count > n )
         {
             (void)g_string_append( sql, "," );
         }
-        (void)g_string_append( sql, "'" );
-        (void)g_string_append( sql, guid_buf );
-        (void)g_string_append( sql, "'" );
-        first_guid = FALSE;
+        gnc_sql_append_guids_to_sql( sql, guids, n );
     }
 
     return count;
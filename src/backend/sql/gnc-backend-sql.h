@@ -640,6 +640,16 @@ void gnc_sql_add_objectref_guid_col_info_to_list( const GncSqlBackend* be,
  */
 guint gnc_sql_append_guid_list_to_sql( GString* str, GList* list, guint maxCount );
 
+/**
+ * Appends the quoted ascii strings for an array of GUIDs, separated by
+ * commas, to the end of an SQL string.
+ *
+ * @param str SQL string
+ * @param guids Array of GUIDs
+ * @param n Number of GUIDs in the array
+ */
+void gnc_sql_append_guids_to_sql( GString* str, const GncGUID* guids, gsize n );
+
 /**
  * Appends column names for a subtable to the end of a GList.
  *
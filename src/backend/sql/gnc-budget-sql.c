@@ -263,6 +263,8 @@ save_budget_amounts( GncSqlBackend* be, GncBudget* budget )
     GList* node;
     budget_amount_info_t info;
     guint num_periods;
+    gnc_numeric* values;
+    gboolean* is_set;
     gboolean is_ok = TRUE;;
 
     g_return_val_if_fail( be != NULL, FALSE );
@@ -273,15 +275,18 @@ save_budget_amounts( GncSqlBackend* be, GncBudget* budget )
 
     info.budget = budget;
     num_periods = gnc_budget_get_num_periods( budget );
+    values = g_new( gnc_numeric, num_periods );
+    is_set = g_new( gboolean, num_periods );
     descendants = gnc_account_get_descendants( gnc_book_get_root_account( be->book ) );
     for ( node = descendants; node != NULL && is_ok; node = g_list_next(node) )
     {
         guint i;
 
         info.account = GNC_ACCOUNT(node->data);
+        gnc_budget_get_account_values( budget, info.account, values, is_set );
         for ( i = 0; i < num_periods && is_ok; i++ )
         {
-            if ( gnc_budget_is_account_period_value_set( budget, info.account, i ) )
+            if ( is_set[i] )
             {
                 info.period_num = i;
                 is_ok = gnc_sql_do_db_operation( be, OP_DB_INSERT, AMOUNTS_TABLE, "", &info,
@@ -290,6 +295,8 @@ save_budget_amounts( GncSqlBackend* be, GncBudget* budget )
         }
     }
     g_list_free( descendants );
+    g_free( values );
+    g_free( is_set );
 
     return is_ok;
 }
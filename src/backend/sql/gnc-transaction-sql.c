@@ -907,6 +907,8 @@ convert_query_term_to_sql( const GncSqlBackend* be, const gchar* fieldName, QofQ
     {
         query_guid_t guid_data = (query_guid_t)pPredData;
         GList* guid_entry;
+        GncGUID* guids;
+        guint n_guids = 0;
 
         g_string_append( sql, "(" );
         g_string_append( sql, fieldName );
@@ -927,14 +929,13 @@ convert_query_term_to_sql( const GncSqlBackend* be, const gchar* fieldName, QofQ
             PERR( "Unexpected GncGUID match type: %d\n", guid_data->options );
         }
 
+        guids = g_new( GncGUID, g_list_length( guid_data->guids ) );
         for ( guid_entry = guid_data->guids; guid_entry != NULL; guid_entry = guid_entry->next )
         {
-            gchar guid_buf[GUID_ENCODING_LENGTH+1];
-
-            if ( guid_entry != guid_data->guids ) g_string_append( sql, "," );
-            (void)guid_to_string_buff( guid_entry->data, guid_buf );
-            g_string_append_printf( sql, "'%s'", guid_buf );
+            guids[n_guids++] = *(GncGUID*)guid_entry->data;
         }
+        gnc_sql_append_guids_to_sql( sql, guids, n_guids );
+        g_free( guids );
         g_string_append( sql, "))" );
 
     }
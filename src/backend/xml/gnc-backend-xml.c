@@ -69,11 +69,14 @@ typedef int ssize_t;
 #include "qof.h"
 #include "TransLog.h"
 #include "gnc-engine.h"
+#include "Transaction.h"
+#include "SX-book.h"
 
 #include "gnc-uri-utils.h"
 
 #include "io-gncxml.h"
 #include "io-gncxml-v2.h"
+#include "io-gncxml-cache.h"
 #include "gnc-backend-xml.h"
 #include "gnc-prefs.h"
 
@@ -343,6 +346,9 @@ xml_session_begin(QofBackend *be_start, QofSession *session,
     xaccLogSetBaseName (be->fullpath);
     PINFO ("logpath=%s", be->fullpath ? be->fullpath : "(null)");
 
+    be->journalfile = g_strconcat(be->fullpath, GNC_JOURNALFILE_EXT, NULL);
+    be->cachefile = g_strconcat(be->fullpath, GNC_CACHEFILE_EXT, NULL);
+
     /* And let's see if we can get a lock on it. */
     be->lockfile = g_strconcat(be->fullpath, ".LCK", NULL);
 
@@ -425,6 +431,13 @@ xml_session_end(QofBackend *be_start)
 
     g_free (be->linkfile);
     be->linkfile = NULL;
+
+    g_free (be->journalfile);
+    be->journalfile = NULL;
+    g_free (be->cachefile);
+    be->cachefile = NULL;
+    be->snapshot_size = -1;
+    g_hash_table_remove_all (be->journal_pending);
     LEAVE (" ");
 }
 
@@ -434,6 +447,8 @@ xml_destroy_backend(QofBackend *be)
     /* Stop transaction logging */
     xaccLogSetBaseName (NULL);
 
+    g_hash_table_destroy (((FileBackend *)be)->journal_pending);
+
     qof_backend_destroy(be);
     g_free(be);
 }
@@ -691,6 +706,7 @@ gnc_xml_be_write_to_file(FileBackend *fbe,
     QofBackend *be = &fbe->be;
     char *tmp_name;
     struct stat statbuf;
+    GncGUID snapshot;
     int rc;
     QofBackendError be_err;
 
@@ -729,7 +745,10 @@ gnc_xml_be_write_to_file(FileBackend *fbe,
         }
     }
 
-    if (gnc_book_write_to_xml_file_v2(book, tmp_name, gnc_prefs_get_file_save_compressed()))
+    /* A new id for each data file written, which ties the journal to it */
+    guid_new (&snapshot);
+    if (gnc_book_write_snapshot_to_xml_file_v2(book, tmp_name,
+            gnc_prefs_get_file_save_compressed(), &snapshot))
     {
         /* Record the file's permissions before g_unlinking it */
         rc = g_stat(datafile, &statbuf);
@@ -881,7 +900,8 @@ gnc_xml_be_remove_old_files(FileBackend *be)
         if ( !(g_str_has_suffix(dent, ".LNK") ||
                 g_str_has_suffix(dent, ".xac") /* old data file extension */ ||
                 g_str_has_suffix(dent, GNC_DATAFILE_EXT) ||
-                g_str_has_suffix(dent, GNC_LOGFILE_EXT)) )
+                g_str_has_suffix(dent, GNC_LOGFILE_EXT) ||
+                g_str_has_suffix(dent, GNC_JOURNALFILE_EXT)) )
             continue;
 
         name = g_build_filename(be->dirname, dent, (gchar*)NULL);
@@ -921,6 +941,7 @@ gnc_xml_be_remove_old_files(FileBackend *be)
          * <fullpath/to/datafile><anything>.gnucash
          * <fullpath/to/datafile><anything>.xac
          * <fullpath/to/datafile><anything>.log
+         * <fullpath/to/datafile><anything>.journal
          *
          * To be a file generated by GnuCash, the <anything> part should consist
          * of 1 dot followed by 14 digits (0 to 9). Let's test this with a
@@ -932,8 +953,9 @@ gnc_xml_be_remove_old_files(FileBackend *be)
              * be safe */
             regex_t pattern;
             gchar *stamp_start = name + strlen(be->fullpath);
-            gchar *expression = g_strdup_printf ("^\\.[[:digit:]]{14}(\\%s|\\%s|\\.xac)$",
-                                                 GNC_DATAFILE_EXT, GNC_LOGFILE_EXT);
+            gchar *expression = g_strdup_printf ("^\\.[[:digit:]]{14}(\\%s|\\%s|\\%s|\\.xac)$",
+                                                 GNC_DATAFILE_EXT, GNC_LOGFILE_EXT,
+                                                 GNC_JOURNALFILE_EXT);
             gboolean got_date_stamp = FALSE;
 
             if (regcomp(&pattern, expression, REG_EXTENDED | REG_ICASE) != 0)
@@ -951,7 +973,7 @@ gnc_xml_be_remove_old_files(FileBackend *be)
             }
         }
 
-        /* The file is a backup or log file. Check the user's retention preference
+        /* The file is a backup, log or set aside journal file. Check the user's retention preference
          * to determine if we should keep it or not
          */
         if (gnc_prefs_get_file_retention_policy() == XML_RETAIN_NONE)
@@ -984,6 +1006,270 @@ gnc_xml_be_remove_old_files(FileBackend *be)
     g_dir_close (dir);
 }
 
+/* ================================================================= */
+/* The journal.  When the journal preference is set, a save appends the
+ * transactions changed since the last save to a journal next to the
+ * data file instead of rewriting the data file (see io-gncxml-v2.h),
+ * and loading replays the journal on top of the data file.  Any other
+ * kind of change, or a journal grown past GNC_JOURNAL_COMPACT_SIZE or
+ * half the size of the data file, makes the next save write the data
+ * file in full, which compacts the journal away.  So does loading a
+ * book that the journal changed. */
+
+/* Replaying a journal at each load gets slower as it grows */
+#define GNC_JOURNAL_COMPACT_SIZE (4 * 1024 * 1024)
+
+/* Lots and scheduled transaction templates are saved along with their
+ * accounts and transactions, which the journal doesn't hold. */
+static gboolean
+xml_journal_can_hold_split (Split *split, Account *template_root)
+{
+    Account *acc = xaccSplitGetAccount (split);
+
+    if (xaccSplitGetLot (split))
+        return FALSE;
+    return !(acc && template_root && gnc_account_get_root (acc) == template_root);
+}
+
+static gboolean
+xml_journal_can_hold_trans (Transaction *trans)
+{
+    Account *template_root;
+    GList *node;
+
+    if (xaccTransGetReadOnly (trans))
+        return FALSE;
+
+    template_root = gnc_book_get_template_root (qof_instance_get_book (trans));
+    for (node = xaccTransGetSplitList (trans); node; node = node->next)
+    {
+        if (!xml_journal_can_hold_split (node->data, template_root))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* Note a committed change for the next save */
+static void
+xml_journal_note_commit (FileBackend *fbe, QofInstance *inst)
+{
+    Transaction *trans;
+    const GncGUID *guid;
+
+    if (fbe->journal_compact)
+        return;
+
+    if (GNC_IS_TRANSACTION (inst))
+    {
+        trans = GNC_TRANSACTION (inst);
+    }
+    else if (GNC_IS_SPLIT (inst))
+    {
+        trans = xaccSplitGetParent (GNC_SPLIT (inst));
+        if (!trans)
+        {
+            fbe->journal_compact = TRUE;
+            return;
+        }
+    }
+    else
+    {
+        /* Unchanged instances are committed all the time */
+        if (qof_instance_get_dirty_flag (inst) ||
+                qof_instance_get_destroying (inst))
+            fbe->journal_compact = TRUE;
+        return;
+    }
+
+    if (!xml_journal_can_hold_trans (trans))
+    {
+        fbe->journal_compact = TRUE;
+        return;
+    }
+
+    guid = xaccTransGetGUID (trans);
+    if (!g_hash_table_lookup (fbe->journal_pending, guid))
+    {
+        GncGUID *key = guid_copy (guid);
+        g_hash_table_insert (fbe->journal_pending, key, key);
+    }
+}
+
+/* Keep a journal that can't be replayed, under a name that the
+ * retention policy will eventually clean up. */
+static void
+gnc_xml_be_set_journal_aside (FileBackend *be)
+{
+    char *timestamp;
+    char *aside;
+
+    /* Without the lock, it's somebody else's journal */
+    if (!be->lockfile)
+        return;
+
+    timestamp = gnc_date_timestamp ();
+    aside = g_strconcat (be->fullpath, ".", timestamp, GNC_JOURNALFILE_EXT, NULL);
+    g_free (timestamp);
+
+    if (g_rename (be->journalfile, aside) != 0)
+    {
+        PWARN ("unable to rename journal %s to %s: %s", be->journalfile, aside,
+               g_strerror(errno) ? g_strerror(errno) : "");
+    }
+    g_free (aside);
+}
+
+/* Replay the journal, if any, on top of the data file just loaded.
+ * Returns FALSE if the next save must write the data file in full.
+ * changed is set if the journal was replayed or set aside, so that the
+ * book no longer matches the files on disk. */
+static gboolean
+gnc_xml_be_replay_journal (FileBackend *be, QofBook *book, gboolean *changed)
+{
+    struct stat statbuf;
+    gboolean torn, has_journal;
+    guint n_batches;
+
+    *changed = FALSE;
+    be->snapshot_size = -1;
+    has_journal = g_file_test (be->journalfile, G_FILE_TEST_EXISTS);
+
+    /* The data file was written in full after the journal was started,
+     * so it already holds whatever the journal does. */
+    if (g_stat (be->fullpath, &statbuf) != 0
+            || !gnc_xml_read_snapshot_id (be->fullpath, &be->snapshot_id)
+            || (has_journal && !gnc_xml_journal_matches (be->journalfile,
+                    &be->snapshot_id)))
+    {
+        if (has_journal)
+        {
+            PWARN ("Journal %s doesn't belong to %s, not replaying it",
+                   be->journalfile, be->fullpath);
+            gnc_xml_be_set_journal_aside (be);
+            *changed = TRUE;
+        }
+        return FALSE;
+    }
+    be->snapshot_size = statbuf.st_size;
+
+    if (!has_journal)
+        return TRUE;
+
+    if (!gnc_xml_journal_replay (book, be->journalfile, &torn, &n_batches))
+    {
+        PERR ("Journal %s is damaged, replayed it only up to the damage",
+              be->journalfile);
+        gnc_xml_be_set_journal_aside (be);
+        *changed = TRUE;
+        return FALSE;
+    }
+    *changed = (n_batches > 0);
+
+    /* A save that never finished left a batch at the end; don't append
+     * behind it. */
+    if (torn)
+    {
+        PWARN ("Journal %s ends in an unfinished save, skipped it",
+               be->journalfile);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Save by appending to the journal.  Returns FALSE if the data file
+ * must be written in full instead. */
+static gboolean
+gnc_xml_be_write_to_journal (FileBackend *be, QofBook *book)
+{
+    struct stat statbuf;
+    GncGUID snapshot;
+    GList *guids;
+    gboolean success;
+
+    if (be->journal_compact || be->snapshot_size < 0)
+        return FALSE;
+
+    /* The data file must still be the one the journal extends, and the
+     * journal the one started for it; the data file is written in full
+     * when the journal went missing, as it may have held earlier saves. */
+    if (!gnc_xml_read_snapshot_id (be->fullpath, &snapshot)
+            || !guid_equal (&snapshot, &be->snapshot_id)
+            || g_stat (be->journalfile, &statbuf) != 0
+            || !gnc_xml_journal_matches (be->journalfile, &be->snapshot_id))
+        return FALSE;
+
+    if (statbuf.st_size > MIN (GNC_JOURNAL_COMPACT_SIZE,
+                               be->snapshot_size / 2))
+    {
+        PINFO ("compacting journal %s", be->journalfile);
+        return FALSE;
+    }
+
+    guids = g_hash_table_get_keys (be->journal_pending);
+    success = (guids == NULL
+               || gnc_xml_journal_append (book, be->journalfile, guids));
+    g_list_free (guids);
+
+    if (!success)
+    {
+        PWARN ("unable to append to journal %s: %s", be->journalfile,
+               g_strerror(errno) ? g_strerror(errno) : "");
+        return FALSE;
+    }
+
+    g_hash_table_remove_all (be->journal_pending);
+    qof_book_mark_session_saved (book);
+    return TRUE;
+}
+
+/* The data file was just written in full: start an empty journal for
+ * it, or get rid of the old one if journaling is off. */
+static void
+gnc_xml_be_start_journal (FileBackend *be)
+{
+    struct stat statbuf;
+
+    g_hash_table_remove_all (be->journal_pending);
+    be->journal_compact = FALSE;
+    be->snapshot_size = -1;
+
+    if (g_stat (be->fullpath, &statbuf) == 0
+            && gnc_xml_read_snapshot_id (be->fullpath, &be->snapshot_id)
+            && (!gnc_prefs_get_file_save_journaled ()
+                || gnc_xml_journal_create (be->journalfile,
+                                           &be->snapshot_id)))
+    {
+        be->snapshot_size = statbuf.st_size;
+        if (gnc_prefs_get_file_save_journaled ())
+            return;
+    }
+
+    if (g_unlink (be->journalfile) != 0 && errno != ENOENT)
+    {
+        PWARN ("unable to unlink journal %s: %s", be->journalfile,
+               g_strerror(errno) ? g_strerror(errno) : "");
+    }
+}
+
+/* The data file was just written in full: write the binary cache of its
+ * transactions next to it, or get rid of the old one if caching is off. */
+static void
+gnc_xml_be_write_cache (FileBackend *be, QofBook *book)
+{
+    GncGUID snapshot;
+
+    if (gnc_prefs_get_file_binary_cache ()
+            && gnc_xml_read_snapshot_id (be->fullpath, &snapshot)
+            && gnc_xml_cache_write (book, be->cachefile, &snapshot))
+        return;
+
+    if (g_unlink (be->cachefile) != 0 && errno != ENOENT)
+    {
+        PWARN ("unable to unlink cache %s: %s", be->cachefile,
+               g_strerror(errno) ? g_strerror(errno) : "");
+    }
+}
+
 static void
 xml_sync_all(QofBackend* be, QofBook *book)
 {
@@ -1006,11 +1292,34 @@ xml_sync_all(QofBackend* be, QofBook *book)
         return;
     }
 
-    gnc_xml_be_write_to_file (fbe, book, fbe->fullpath, TRUE);
+    if (gnc_prefs_get_file_save_journaled () &&
+            gnc_xml_be_write_to_journal (fbe, book))
+    {
+        LEAVE ("book=%p, journaled", book);
+        return;
+    }
+
+    if (gnc_xml_be_write_to_file (fbe, book, fbe->fullpath, TRUE))
+    {
+        gnc_xml_be_start_journal (fbe);
+        gnc_xml_be_write_cache (fbe, book);
+    }
     gnc_xml_be_remove_old_files (fbe);
     LEAVE ("book=%p", book);
 }
 
+/* Write the data file in full whether or not a journal could take the
+ * changes, compacting the journal.  Normal saves compact it too once it
+ * grows too large, see gnc_xml_be_write_to_journal(). */
+static void
+xml_safe_sync_all(QofBackend* be, QofBook *book)
+{
+    FileBackend *fbe = (FileBackend *) be;
+
+    fbe->journal_compact = TRUE;
+    xml_sync_all (be, book);
+}
+
 /* ================================================================= */
 /* Routines to deal with the creation of multiple books.
  * The core design assumption here is that the book
@@ -1092,6 +1401,8 @@ xml_commit_edit (QofBackend *be, QofInstance *inst)
         qof_collection_mark_dirty(qof_instance_get_collection(inst));
         qof_book_mark_session_dirty(qof_instance_get_book(inst));
     }
+    if (!(qof_instance_get_infant(inst) && qof_instance_get_destroying(inst)))
+        xml_journal_note_commit ((FileBackend *) be, inst);
 #if BORKEN_FOR_NOW
     FileBackend *fbe = (FileBackend *) be;
     QofBook *book = gp;
@@ -1124,6 +1435,7 @@ gnc_xml_be_load_from_file (QofBackend *bend, QofBook *book, QofBackendLoadType l
 {
     QofBackendError error;
     gboolean rc;
+    gboolean journal_ok = FALSE, journal_changed = FALSE;
     FileBackend *be = (FileBackend *) bend;
 
     if (loadType != LOAD_TYPE_INITIAL_LOAD) return;
@@ -1131,6 +1443,9 @@ gnc_xml_be_load_from_file (QofBackend *bend, QofBook *book, QofBackendLoadType l
     error = ERR_BACKEND_NO_ERR;
     be->book = book;
 
+    /* Don't track the loading's own commits for the journal */
+    be->journal_compact = TRUE;
+
     switch (gnc_xml_be_determine_file_type(be->fullpath))
     {
     case GNC_BOOK_XML2_FILE:
@@ -1140,6 +1455,9 @@ gnc_xml_be_load_from_file (QofBackend *bend, QofBook *book, QofBackendLoadType l
             PWARN( "Syntax error in Xml File %s", be->fullpath );
             error = ERR_FILEIO_PARSE_ERROR;
         }
+        else
+            journal_ok = gnc_xml_be_replay_journal (be, book,
+                                                    &journal_changed);
         break;
 
     case GNC_BOOK_XML2_FILE_NO_ENCODING:
@@ -1185,8 +1503,17 @@ gnc_xml_be_load_from_file (QofBackend *bend, QofBook *book, QofBackendLoadType l
         qof_backend_set_error(bend, error);
     }
 
-    /* We just got done loading, it can't possibly be dirty !! */
+    /* Nothing the loading committed needs saving again */
+    g_hash_table_remove_all (be->journal_pending);
+    be->journal_compact = !journal_ok || journal_changed;
+
+    /* We just got done loading, it can't possibly be dirty !!  Unless
+     * the journal changed the book: then the data file has to take the
+     * changes in full before a journal that was replayed only in part,
+     * or set aside, is lost. */
     qof_book_mark_session_saved (book);
+    if (journal_changed)
+        qof_book_mark_session_dirty (book);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -1246,6 +1573,7 @@ gnc_backend_new(void)
     be->process_events = NULL;
 
     be->sync = xml_sync_all;
+    be->safe_sync = xml_safe_sync_all;
     be->load_config = NULL;
     be->get_config = NULL;
 
@@ -1255,10 +1583,18 @@ gnc_backend_new(void)
     gnc_be->fullpath = NULL;
     gnc_be->lockfile = NULL;
     gnc_be->linkfile = NULL;
+    gnc_be->journalfile = NULL;
+    gnc_be->cachefile = NULL;
     gnc_be->lockfd = -1;
 
     gnc_be->book = NULL;
 
+    gnc_be->snapshot_size = -1;
+    gnc_be->journal_pending = g_hash_table_new_full (guid_hash_to_guint,
+                              guid_g_hash_table_equal,
+                              (GDestroyNotify) guid_free, NULL);
+    gnc_be->journal_compact = FALSE;
+
     return be;
 }
 
@@ -61,9 +61,19 @@ struct FileBackend_struct
     char *fullpath;  /* Fully qualified path to book */
     char *lockfile;
     char *linkfile;
+    char *journalfile;
+    char *cachefile;
     int lockfd;
 
     QofBook *book;  /* The primary, main open book */
+
+    /* The data file as last read or written in full, which the journal
+     * extends: the id it was marked with and its size; snapshot_size is
+     * -1 if there is no such file. */
+    GncGUID snapshot_id;
+    gint64 snapshot_size;
+    GHashTable *journal_pending;  /* GUIDs of transactions changed since */
+    gboolean journal_compact;     /* A change the journal can't hold */
 };
 
 typedef struct FileBackend_struct FileBackend;
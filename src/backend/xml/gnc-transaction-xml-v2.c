@@ -35,6 +35,7 @@
 #include "sixtp-utils.h"
 #include "sixtp-dom-parsers.h"
 #include "sixtp-dom-generators.h"
+#include "sixtp-stream-generators.h"
 
 #include "gnc-xml.h"
 
@@ -207,6 +208,93 @@ gnc_transaction_dom_tree_create(Transaction *trn)
     return ret;
 }
 
+/* The same elements as gnc_transaction_dom_tree_create(), written
+ * straight to the stream. */
+
+static void
+split_to_stream(sixtp_stream *s, const gchar *tag, Split *spl)
+{
+    const gchar *str;
+    Timespec ts;
+    gnc_numeric num;
+    GNCLot *lot;
+    char tmp[2];
+
+    sixtp_stream_open(s, tag);
+
+    guid_to_stream(s, "split:id", xaccSplitGetGUID(spl));
+
+    str = xaccSplitGetMemo(spl);
+    if (str && *str)
+        text_child_to_stream(s, "split:memo", str);
+
+    str = xaccSplitGetAction(spl);
+    if (str && *str)
+        text_child_to_stream(s, "split:action", str);
+
+    tmp[0] = xaccSplitGetReconcile(spl);
+    tmp[1] = '\0';
+    text_child_to_stream(s, "split:reconciled-state", tmp);
+
+    ts = xaccSplitRetDateReconciledTS(spl);
+    if (ts.tv_sec != 0 || ts.tv_nsec != 0)
+        timespec_to_stream(s, "split:reconcile-date", &ts);
+
+    num = xaccSplitGetValue(spl);
+    gnc_numeric_to_stream(s, "split:value", &num);
+    num = xaccSplitGetAmount(spl);
+    gnc_numeric_to_stream(s, "split:quantity", &num);
+
+    guid_to_stream(s, "split:account",
+                   xaccAccountGetGUID(xaccSplitGetAccount(spl)));
+
+    lot = xaccSplitGetLot(spl);
+    if (lot)
+        guid_to_stream(s, "split:lot", gnc_lot_get_guid(lot));
+
+    kvp_frame_to_stream(s, "split:slots",
+                        qof_instance_get_slots(QOF_INSTANCE(spl)));
+
+    sixtp_stream_close(s, tag);
+}
+
+void
+gnc_transaction_to_stream(sixtp_stream *s, Transaction *trn)
+{
+    const gchar *str;
+    Timespec ts;
+    GList *n;
+
+    sixtp_stream_open(s, "gnc:transaction");
+    sixtp_stream_attr(s, "version", transaction_version_string);
+
+    guid_to_stream(s, "trn:id", xaccTransGetGUID(trn));
+    commodity_ref_to_stream(s, "trn:currency", xaccTransGetCurrency(trn));
+
+    str = xaccTransGetNum(trn);
+    if (str && *str)
+        text_child_to_stream(s, "trn:num", str);
+
+    ts = xaccTransRetDatePostedTS(trn);
+    timespec_to_stream(s, "trn:date-posted", &ts);
+    ts = xaccTransRetDateEnteredTS(trn);
+    timespec_to_stream(s, "trn:date-entered", &ts);
+
+    str = xaccTransGetDescription(trn);
+    if (str)
+        text_child_to_stream(s, "trn:description", str);
+
+    kvp_frame_to_stream(s, "trn:slots",
+                        qof_instance_get_slots(QOF_INSTANCE(trn)));
+
+    sixtp_stream_open(s, "trn:splits");
+    for (n = xaccTransGetSplitList(trn); n; n = n->next)
+        split_to_stream(s, "trn:split", n->data);
+    sixtp_stream_close(s, "trn:splits");
+
+    sixtp_stream_close(s, "gnc:transaction");
+}
+
 /***********************************************************************/
 
 struct split_pdata
@@ -31,6 +31,7 @@
 #include "gnc-budget.h"
 #include "gnc-xml-helper.h"
 #include "sixtp.h"
+#include "sixtp-stream-generators.h"
 
 xmlNodePtr gnc_account_dom_tree_create(Account *act, gboolean exporting,
                                        gboolean allow_incompat);
@@ -59,6 +60,7 @@ xmlNodePtr gnc_budget_dom_tree_create( GncBudget *bgt );
 sixtp* gnc_budget_sixtp_parser_create(void);
 
 xmlNodePtr gnc_transaction_dom_tree_create(Transaction *txn);
+void gnc_transaction_to_stream(sixtp_stream *s, Transaction *txn);
 sixtp* gnc_transaction_sixtp_parser_create(void);
 
 sixtp* gnc_template_transaction_sixtp_parser_create(void);
@@ -0,0 +1,1085 @@
+/********************************************************************\
+ * io-gncxml-cache.c -- binary cache of the transactions in an XML  *
+ *                      data file                                   *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#include <zlib.h>
+
+#include "gnc-engine.h"
+#include "gnc-lot.h"
+#include "qofinstance-p.h"
+#include "Account.h"
+#include "SplitP.h"
+#include "Transaction.h"
+#include "TransactionP.h"
+
+#include "io-gncxml-cache.h"
+
+static QofLogModule log_module = GNC_MOD_IO;
+
+/* The layout of a cache file:
+ *
+ *   CacheHeader
+ *   CacheTrans[n_transactions]
+ *   CacheSplit[n_splits]        each transaction's splits in a row
+ *   heap                        NUL-terminated strings and encoded
+ *                               frames, see cache_write_kvp_frame()
+ *
+ * Numbers are in the byte order of the machine that wrote the cache, and
+ * the records are laid out as the structs below; a cache written by a
+ * build that lays them out differently is simply not opened.  Strings
+ * and frames are referred to by their offset in the heap.  The checksum
+ * covers everything after the header. */
+
+#define CACHE_MAGIC      "GNCCACHE"
+#define CACHE_VERSION    3
+#define CACHE_BYTE_ORDER 0x01020304
+
+/* Offset of a string or frame that isn't there: an empty string, or a
+ * frame without slots. */
+#define CACHE_NONE       G_MAXUINT32
+
+typedef struct
+{
+    gchar magic[8];
+    guint32 version;
+    guint32 byte_order;
+    guint32 trans_size;
+    guint32 split_size;
+    guchar snapshot[GUID_DATA_SIZE];
+    guint32 n_transactions;
+    guint32 n_splits;
+    guint64 heap_size;
+    guint32 checksum;
+    guint32 reserved;
+} CacheHeader;
+
+typedef struct
+{
+    gint64 date_posted_sec;
+    gint64 date_posted_nsec;
+    gint64 date_entered_sec;
+    gint64 date_entered_nsec;
+    guint32 first_split;
+    guint32 n_splits;
+    guint32 currency_space;
+    guint32 currency_id;
+    guint32 num;
+    guint32 description;
+    guint32 slots;
+    guint32 reserved;
+    guchar guid[GUID_DATA_SIZE];
+} CacheTrans;
+
+typedef struct
+{
+    gint64 value_num;
+    gint64 value_denom;
+    gint64 amount_num;
+    gint64 amount_denom;
+    gint64 date_reconciled_sec;
+    gint64 date_reconciled_nsec;
+    guint32 memo;
+    guint32 action;
+    guint32 slots;
+    gchar reconcile;
+    gchar reserved[3];
+    guchar guid[GUID_DATA_SIZE];
+    guchar account[GUID_DATA_SIZE];
+    guchar lot[GUID_DATA_SIZE];
+} CacheSplit;
+
+/* The records follow each other without padding, and are read in place. */
+G_STATIC_ASSERT (sizeof (CacheHeader) % 8 == 0);
+G_STATIC_ASSERT (sizeof (CacheTrans) % 8 == 0);
+G_STATIC_ASSERT (sizeof (CacheSplit) % 8 == 0);
+
+struct gnc_xml_cache
+{
+    GMappedFile *file;
+    const CacheHeader *header;
+    const CacheTrans *transactions;
+    const CacheSplit *splits;
+    const gchar *heap;
+};
+
+static guint32
+cache_checksum(guint32 crc, const guchar *data, guint64 len)
+{
+    while (len > 0)
+    {
+        uInt n = (uInt) MIN(len, G_GUINT64_CONSTANT(1) << 30);
+
+        crc = crc32(crc, data, n);
+        data += n;
+        len -= n;
+    }
+    return crc;
+}
+
+/***********************************************************************/
+
+/* One of the sections of the file being written, at its own place in
+ * it.  The transactions' section also ends up writing the header. */
+typedef struct
+{
+    FILE *out;
+    guint64 size;
+    guint32 crc;
+} CacheSection;
+
+/* The records are written straight to the file as the book is walked:
+ * the counts are known beforehand, so each section is written through
+ * its own stream starting where it belongs.  Only the strings already
+ * in the heap and the frame being encoded are kept in memory. */
+typedef struct
+{
+    CacheSection transactions;
+    CacheSection splits;
+    CacheSection heap;
+    GHashTable *string_offsets;   /* the heap's strings, to share them */
+    GByteArray *frame;            /* the frame being encoded */
+    guint32 n_transactions;
+    guint32 n_splits;
+    gboolean ok;
+} CacheWriter;
+
+static void
+cache_section_write(CacheWriter *w, CacheSection *section,
+                    gconstpointer data, gsize len)
+{
+    if (!w->ok || len == 0)
+        return;
+    if (fwrite(data, 1, len, section->out) != len)
+    {
+        w->ok = FALSE;
+        return;
+    }
+    section->crc = cache_checksum(section->crc, data, len);
+    section->size += len;
+}
+
+/* Append to the heap, returning where it went. */
+static guint32
+cache_heap_write(CacheWriter *w, gconstpointer data, gsize len)
+{
+    guint64 offset = w->heap.size;
+
+    if (offset + len >= CACHE_NONE)
+    {
+        w->ok = FALSE;
+        return CACHE_NONE;
+    }
+    cache_section_write(w, &w->heap, data, len);
+    return (guint32) offset;
+}
+
+static guint32
+cache_write_string(CacheWriter *w, const gchar *str)
+{
+    gpointer offset;
+    guint32 pos;
+
+    if (!str || !*str)
+        return CACHE_NONE;
+
+    if (g_hash_table_lookup_extended(w->string_offsets, str, NULL, &offset))
+        return GPOINTER_TO_UINT(offset);
+
+    pos = cache_heap_write(w, str, strlen(str) + 1);
+    if (pos != CACHE_NONE)
+        g_hash_table_insert(w->string_offsets, g_strdup(str),
+                            GUINT_TO_POINTER(pos));
+    return pos;
+}
+
+/* The types the XML backend saves; it drops slots of any other. */
+static gboolean
+cache_kvp_value_is_saved(const KvpValue *val)
+{
+    switch (kvp_value_get_type(val))
+    {
+    case KVP_TYPE_GINT64:
+    case KVP_TYPE_DOUBLE:
+    case KVP_TYPE_NUMERIC:
+    case KVP_TYPE_STRING:
+    case KVP_TYPE_GUID:
+    case KVP_TYPE_TIMESPEC:
+    case KVP_TYPE_GDATE:
+    case KVP_TYPE_BINARY:
+    case KVP_TYPE_GLIST:
+    case KVP_TYPE_FRAME:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+static void cache_write_kvp_frame(CacheWriter *w, KvpFrame *frame);
+
+/* A value is its type in one byte followed by the value itself:
+ * numbers as they are, strings as an offset in the heap, lists as a
+ * count followed by the values, frames as cache_write_kvp_frame()
+ * writes them.  The strings go to the heap right away, the value to
+ * w->frame. */
+static void
+cache_write_kvp_value(CacheWriter *w, const KvpValue *val)
+{
+    guint8 type = kvp_value_get_type(val);
+
+    g_byte_array_append(w->frame, &type, sizeof type);
+    switch (type)
+    {
+    case KVP_TYPE_GINT64:
+    {
+        gint64 i = kvp_value_get_gint64(val);
+        g_byte_array_append(w->frame, (const guint8 *) &i, sizeof i);
+    }
+    break;
+    case KVP_TYPE_DOUBLE:
+    {
+        double d = kvp_value_get_double(val);
+        g_byte_array_append(w->frame, (const guint8 *) &d, sizeof d);
+    }
+    break;
+    case KVP_TYPE_NUMERIC:
+    {
+        gnc_numeric n = kvp_value_get_numeric(val);
+        gint64 num = n.num, denom = n.denom;
+
+        g_byte_array_append(w->frame, (const guint8 *) &num, sizeof num);
+        g_byte_array_append(w->frame, (const guint8 *) &denom, sizeof denom);
+    }
+    break;
+    case KVP_TYPE_STRING:
+    {
+        guint32 str = cache_write_string(w, kvp_value_get_string(val));
+        g_byte_array_append(w->frame, (const guint8 *) &str, sizeof str);
+    }
+    break;
+    case KVP_TYPE_GUID:
+    {
+        const GncGUID *guid = kvp_value_get_guid(val);
+
+        if (!guid)
+            guid = guid_null();
+        g_byte_array_append(w->frame, guid->data, GUID_DATA_SIZE);
+    }
+    break;
+    case KVP_TYPE_TIMESPEC:
+    {
+        Timespec ts = kvp_value_get_timespec(val);
+        gint64 sec = ts.tv_sec, nsec = ts.tv_nsec;
+
+        g_byte_array_append(w->frame, (const guint8 *) &sec, sizeof sec);
+        g_byte_array_append(w->frame, (const guint8 *) &nsec, sizeof nsec);
+    }
+    break;
+    case KVP_TYPE_GDATE:
+    {
+        GDate date = kvp_value_get_gdate(val);
+        guint32 julian = g_date_valid(&date) ? g_date_get_julian(&date) : 0;
+
+        g_byte_array_append(w->frame, (const guint8 *) &julian,
+                            sizeof julian);
+    }
+    break;
+    case KVP_TYPE_BINARY:
+    {
+        guint64 size = 0;
+        void *data = kvp_value_get_binary(val, &size);
+
+        if (!data)
+            size = 0;
+        g_byte_array_append(w->frame, (const guint8 *) &size, sizeof size);
+        if (size > 0)
+            g_byte_array_append(w->frame, data, size);
+    }
+    break;
+    case KVP_TYPE_GLIST:
+    {
+        GList *node;
+        guint32 n = 0;
+
+        for (node = kvp_value_get_glist(val); node; node = node->next)
+            if (cache_kvp_value_is_saved(node->data))
+                n++;
+        g_byte_array_append(w->frame, (const guint8 *) &n, sizeof n);
+        for (node = kvp_value_get_glist(val); node; node = node->next)
+            if (cache_kvp_value_is_saved(node->data))
+                cache_write_kvp_value(w, node->data);
+    }
+    break;
+    case KVP_TYPE_FRAME:
+        cache_write_kvp_frame(w, kvp_value_get_frame(val));
+        break;
+    default:
+        break;
+    }
+}
+
+static void
+cache_collect_kvp_key(const gchar *key, KvpValue *value, gpointer data)
+{
+    GList **keys = data;
+
+    if (cache_kvp_value_is_saved(value))
+        *keys = g_list_prepend(*keys, (gpointer) key);
+}
+
+/* A frame is its slot count followed by each slot's key, as an offset
+ * in the heap, and value. */
+static void
+cache_write_kvp_frame(CacheWriter *w, KvpFrame *frame)
+{
+    GList *keys = NULL, *iter;
+    guint32 n;
+
+    if (frame)
+        kvp_frame_for_each_slot(frame, cache_collect_kvp_key, &keys);
+    keys = g_list_sort(keys, (GCompareFunc) strcmp);
+
+    n = g_list_length(keys);
+    g_byte_array_append(w->frame, (const guint8 *) &n, sizeof n);
+    for (iter = keys; iter; iter = iter->next)
+    {
+        guint32 key = cache_write_string(w, iter->data);
+
+        g_byte_array_append(w->frame, (const guint8 *) &key, sizeof key);
+        cache_write_kvp_value(w, kvp_frame_get_slot(frame, iter->data));
+    }
+    g_list_free(keys);
+}
+
+/* The frame is encoded aside and only then added to the heap, after
+ * the strings it refers to. */
+static guint32
+cache_write_slots(CacheWriter *w, QofInstance *inst)
+{
+    KvpFrame *frame = qof_instance_get_slots(inst);
+
+    if (!frame || kvp_frame_get_slot_count(frame) == 0)
+        return CACHE_NONE;
+
+    g_byte_array_set_size(w->frame, 0);
+    cache_write_kvp_frame(w, frame);
+    return cache_heap_write(w, w->frame->data, w->frame->len);
+}
+
+static void
+cache_write_split(CacheWriter *w, Split *split)
+{
+    CacheSplit rec;
+    Account *account = xaccSplitGetAccount(split);
+    GNCLot *lot = xaccSplitGetLot(split);
+    gnc_numeric num;
+    Timespec ts;
+
+    memset(&rec, 0, sizeof rec);
+    memcpy(rec.guid, xaccSplitGetGUID(split)->data, GUID_DATA_SIZE);
+    memcpy(rec.account, account ? xaccAccountGetGUID(account)->data
+           : guid_null()->data, GUID_DATA_SIZE);
+    memcpy(rec.lot, lot ? gnc_lot_get_guid(lot)->data : guid_null()->data,
+           GUID_DATA_SIZE);
+
+    rec.memo = cache_write_string(w, xaccSplitGetMemo(split));
+    rec.action = cache_write_string(w, xaccSplitGetAction(split));
+    rec.reconcile = xaccSplitGetReconcile(split);
+
+    ts = xaccSplitRetDateReconciledTS(split);
+    rec.date_reconciled_sec = ts.tv_sec;
+    rec.date_reconciled_nsec = ts.tv_nsec;
+
+    num = xaccSplitGetValue(split);
+    rec.value_num = num.num;
+    rec.value_denom = num.denom;
+    num = xaccSplitGetAmount(split);
+    rec.amount_num = num.num;
+    rec.amount_denom = num.denom;
+
+    rec.slots = cache_write_slots(w, QOF_INSTANCE(split));
+
+    cache_section_write(w, &w->splits, &rec, sizeof rec);
+    w->n_splits++;
+}
+
+static int
+cache_write_transaction(Transaction *trn, gpointer data)
+{
+    CacheWriter *w = data;
+    CacheTrans rec;
+    gnc_commodity *currency = xaccTransGetCurrency(trn);
+    GList *node;
+    Timespec ts;
+
+    memset(&rec, 0, sizeof rec);
+    memcpy(rec.guid, xaccTransGetGUID(trn)->data, GUID_DATA_SIZE);
+
+    if (currency)
+    {
+        rec.currency_space =
+            cache_write_string(w, gnc_commodity_get_namespace(currency));
+        rec.currency_id =
+            cache_write_string(w, gnc_commodity_get_mnemonic(currency));
+    }
+    else
+    {
+        rec.currency_space = CACHE_NONE;
+        rec.currency_id = CACHE_NONE;
+    }
+    rec.num = cache_write_string(w, xaccTransGetNum(trn));
+    rec.description = cache_write_string(w, xaccTransGetDescription(trn));
+
+    ts = xaccTransRetDatePostedTS(trn);
+    rec.date_posted_sec = ts.tv_sec;
+    rec.date_posted_nsec = ts.tv_nsec;
+    ts = xaccTransRetDateEnteredTS(trn);
+    rec.date_entered_sec = ts.tv_sec;
+    rec.date_entered_nsec = ts.tv_nsec;
+
+    rec.slots = cache_write_slots(w, QOF_INSTANCE(trn));
+
+    rec.first_split = w->n_splits;
+    for (node = xaccTransGetSplitList(trn); node; node = node->next)
+    {
+        cache_write_split(w, node->data);
+        rec.n_splits++;
+    }
+
+    cache_section_write(w, &w->transactions, &rec, sizeof rec);
+    w->n_transactions++;
+
+    return w->ok ? 0 : -1;
+}
+
+static int
+cache_count_transaction(Transaction *trn, gpointer data)
+{
+    CacheWriter *w = data;
+
+    w->n_transactions++;
+    w->n_splits += g_list_length(xaccTransGetSplitList(trn));
+    return 0;
+}
+
+static gboolean
+cache_section_open(CacheSection *section, const char *filename,
+                   long offset)
+{
+    section->size = 0;
+    section->crc = crc32(0L, Z_NULL, 0);
+    section->out = g_fopen(filename, "r+b");
+    return section->out && fseek(section->out, offset, SEEK_SET) == 0;
+}
+
+static gboolean
+cache_section_close(CacheSection *section)
+{
+    gboolean ok = section->out && fclose(section->out) == 0;
+
+    section->out = NULL;
+    return ok;
+}
+
+gboolean
+gnc_xml_cache_write(QofBook *book, const char *filename,
+                    const GncGUID *snapshot)
+{
+    CacheWriter w;
+    CacheHeader header;
+    Account *root;
+    guint64 trans_len, splits_len;
+    guint32 n_transactions, n_splits;
+    gchar *tmpname;
+    gint fd;
+    gboolean success = FALSE;
+
+    g_return_val_if_fail(book, FALSE);
+    g_return_val_if_fail(filename, FALSE);
+    g_return_val_if_fail(snapshot, FALSE);
+
+    memset(&w, 0, sizeof w);
+    w.ok = TRUE;
+
+    /* Template transactions are read from their own element, with the
+     * template accounts, which the cache doesn't stand in for. */
+    if (xaccAccountTreeForEachTransaction(gnc_book_get_template_root(book),
+                                          cache_count_transaction, &w) != 0
+            || w.n_transactions > 0)
+    {
+        PINFO("book has template transactions, not writing a cache");
+        return FALSE;
+    }
+
+    root = gnc_book_get_root_account(book);
+    xaccAccountTreeForEachTransaction(root, cache_count_transaction, &w);
+    n_transactions = w.n_transactions;
+    n_splits = w.n_splits;
+    trans_len = (guint64) n_transactions * sizeof(CacheTrans);
+    splits_len = (guint64) n_splits * sizeof(CacheSplit);
+    /* The sections are placed with fseek() */
+    if (n_transactions >= CACHE_NONE || n_splits >= CACHE_NONE
+            || sizeof header + trans_len + splits_len >= G_MAXLONG)
+    {
+        PWARN("book too large for a cache");
+        return FALSE;
+    }
+    w.n_transactions = 0;
+    w.n_splits = 0;
+
+    /* Written aside and renamed into place, so a reader never maps a
+     * cache that is only half there. */
+    tmpname = g_strconcat(filename, ".XXXXXX", NULL);
+    fd = g_mkstemp(tmpname);
+    if (fd == -1)
+    {
+        PWARN("unable to create a cache for %s: %s", filename,
+              g_strerror(errno));
+        g_free(tmpname);
+        return FALSE;
+    }
+    close(fd);
+
+    w.string_offsets = g_hash_table_new_full(g_str_hash, g_str_equal,
+                       g_free, NULL);
+    w.frame = g_byte_array_new();
+    if (!cache_section_open(&w.transactions, tmpname, sizeof header)
+            || !cache_section_open(&w.splits, tmpname,
+                                   sizeof header + trans_len)
+            || !cache_section_open(&w.heap, tmpname,
+                                   sizeof header + trans_len + splits_len))
+        w.ok = FALSE;
+
+    if (w.ok)
+        xaccAccountTreeForEachTransaction(root, cache_write_transaction, &w);
+    if (w.ok && (w.n_transactions != n_transactions
+                 || w.n_splits != n_splits))
+    {
+        PERR("transactions changed while writing the cache");
+        w.ok = FALSE;
+    }
+
+    if (w.ok)
+    {
+        memset(&header, 0, sizeof header);
+        memcpy(header.magic, CACHE_MAGIC, sizeof header.magic);
+        header.version = CACHE_VERSION;
+        header.byte_order = CACHE_BYTE_ORDER;
+        header.trans_size = sizeof(CacheTrans);
+        header.split_size = sizeof(CacheSplit);
+        memcpy(header.snapshot, snapshot->data, GUID_DATA_SIZE);
+        header.n_transactions = n_transactions;
+        header.n_splits = n_splits;
+        header.heap_size = w.heap.size;
+        header.checksum =
+            crc32_combine(crc32_combine(w.transactions.crc, w.splits.crc,
+                                        w.splits.size),
+                          w.heap.crc, w.heap.size);
+
+        if (fseek(w.transactions.out, 0, SEEK_SET) != 0
+                || fwrite(&header, sizeof header, 1, w.transactions.out) != 1)
+            w.ok = FALSE;
+    }
+
+    if (!cache_section_close(&w.transactions))
+        w.ok = FALSE;
+    if (!cache_section_close(&w.splits))
+        w.ok = FALSE;
+    if (!cache_section_close(&w.heap))
+        w.ok = FALSE;
+
+    if (!w.ok)
+        PWARN("unable to write cache %s", filename);
+    else if (g_rename(tmpname, filename) != 0)
+        PWARN("unable to rename %s to %s: %s", tmpname, filename,
+              g_strerror(errno));
+    else
+        success = TRUE;
+
+    if (!success)
+        g_unlink(tmpname);
+    g_free(tmpname);
+    g_byte_array_free(w.frame, TRUE);
+    g_hash_table_destroy(w.string_offsets);
+    return success;
+}
+
+/***********************************************************************/
+
+GncXmlCache *
+gnc_xml_cache_open(const char *filename, const GncGUID *snapshot)
+{
+    GncXmlCache *cache;
+    GMappedFile *file;
+    GError *error = NULL;
+    const CacheHeader *header;
+    const guchar *contents;
+    guint64 length, trans_len, splits_len;
+    guint32 crc;
+
+    g_return_val_if_fail(filename, NULL);
+    g_return_val_if_fail(snapshot, NULL);
+
+    file = g_mapped_file_new(filename, FALSE, &error);
+    if (!file)
+    {
+        if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            PWARN("unable to map cache %s: %s", filename, error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    contents = (const guchar *) g_mapped_file_get_contents(file);
+    length = g_mapped_file_get_length(file);
+    header = (const CacheHeader *) contents;
+
+    if (length < sizeof(CacheHeader)
+            || memcmp(header->magic, CACHE_MAGIC, sizeof header->magic) != 0
+            || header->version != CACHE_VERSION
+            || header->byte_order != CACHE_BYTE_ORDER
+            || header->trans_size != sizeof(CacheTrans)
+            || header->split_size != sizeof(CacheSplit))
+    {
+        PINFO("%s is not a cache this build can read", filename);
+        goto bail;
+    }
+
+    if (memcmp(header->snapshot, snapshot->data, GUID_DATA_SIZE) != 0)
+    {
+        PINFO("cache %s was written for another data file", filename);
+        goto bail;
+    }
+
+    trans_len = (guint64) header->n_transactions * sizeof(CacheTrans);
+    splits_len = (guint64) header->n_splits * sizeof(CacheSplit);
+    if (header->heap_size >= CACHE_NONE
+            || length != sizeof(CacheHeader) + trans_len + splits_len
+            + header->heap_size)
+    {
+        PWARN("cache %s is truncated", filename);
+        goto bail;
+    }
+
+    crc = cache_checksum(crc32(0L, Z_NULL, 0), contents + sizeof(CacheHeader),
+                         length - sizeof(CacheHeader));
+    if (crc != header->checksum)
+    {
+        PWARN("cache %s is damaged", filename);
+        goto bail;
+    }
+
+    cache = g_new0(GncXmlCache, 1);
+    cache->file = file;
+    cache->header = header;
+    cache->transactions =
+        (const CacheTrans *) (contents + sizeof(CacheHeader));
+    cache->splits = (const CacheSplit *) ((const guchar *) cache->transactions
+                                          + trans_len);
+    cache->heap = (const gchar *) cache->splits + splits_len;
+    return cache;
+
+bail:
+    g_mapped_file_unref(file);
+    return NULL;
+}
+
+guint
+gnc_xml_cache_get_n_transactions(const GncXmlCache *cache)
+{
+    g_return_val_if_fail(cache, 0);
+
+    return cache->header->n_transactions;
+}
+
+gboolean
+gnc_xml_cache_get_transaction_guid(const GncXmlCache *cache, guint index,
+                                   GncGUID *guid)
+{
+    g_return_val_if_fail(cache, FALSE);
+    g_return_val_if_fail(guid, FALSE);
+
+    if (index >= cache->header->n_transactions)
+        return FALSE;
+    memcpy(guid->data, cache->transactions[index].guid, GUID_DATA_SIZE);
+    return TRUE;
+}
+
+void
+gnc_xml_cache_close(GncXmlCache *cache)
+{
+    if (!cache)
+        return;
+
+    g_mapped_file_unref(cache->file);
+    g_free(cache);
+}
+
+/* Look up a string in the heap, which has to end inside it.  *str is
+ * NULL for CACHE_NONE. */
+static gboolean
+cache_get_string(const GncXmlCache *cache, guint32 offset, const gchar **str)
+{
+    if (offset == CACHE_NONE)
+    {
+        *str = NULL;
+        return TRUE;
+    }
+    if (offset >= cache->header->heap_size
+            || !memchr(cache->heap + offset, '\0',
+                       cache->header->heap_size - offset))
+        return FALSE;
+    *str = cache->heap + offset;
+    return TRUE;
+}
+
+typedef struct
+{
+    const GncXmlCache *cache;
+    const guchar *pos;
+    const guchar *end;
+} CacheReader;
+
+static gboolean
+cache_read(CacheReader *r, gpointer dest, gsize len)
+{
+    if ((gsize) (r->end - r->pos) < len)
+        return FALSE;
+    memcpy(dest, r->pos, len);
+    r->pos += len;
+    return TRUE;
+}
+
+static gboolean cache_read_kvp_frame(CacheReader *r, KvpFrame *frame);
+
+static KvpValue *
+cache_read_kvp_value(CacheReader *r)
+{
+    guint8 type;
+
+    if (!cache_read(r, &type, sizeof type))
+        return NULL;
+
+    switch (type)
+    {
+    case KVP_TYPE_GINT64:
+    {
+        gint64 i;
+        if (cache_read(r, &i, sizeof i))
+            return kvp_value_new_gint64(i);
+    }
+    break;
+    case KVP_TYPE_DOUBLE:
+    {
+        double d;
+        if (cache_read(r, &d, sizeof d))
+            return kvp_value_new_double(d);
+    }
+    break;
+    case KVP_TYPE_NUMERIC:
+    {
+        gint64 num, denom;
+        if (cache_read(r, &num, sizeof num)
+                && cache_read(r, &denom, sizeof denom))
+            return kvp_value_new_numeric(gnc_numeric_create(num, denom));
+    }
+    break;
+    case KVP_TYPE_STRING:
+    {
+        guint32 offset;
+        const gchar *str;
+
+        if (cache_read(r, &offset, sizeof offset)
+                && cache_get_string(r->cache, offset, &str))
+            return kvp_value_new_string(str ? str : "");
+    }
+    break;
+    case KVP_TYPE_GUID:
+    {
+        GncGUID guid;
+        if (cache_read(r, guid.data, GUID_DATA_SIZE))
+            return kvp_value_new_guid(&guid);
+    }
+    break;
+    case KVP_TYPE_TIMESPEC:
+    {
+        gint64 sec, nsec;
+        Timespec ts;
+
+        if (cache_read(r, &sec, sizeof sec) && cache_read(r, &nsec, sizeof nsec))
+        {
+            ts.tv_sec = sec;
+            ts.tv_nsec = nsec;
+            return kvp_value_new_timespec(ts);
+        }
+    }
+    break;
+    case KVP_TYPE_GDATE:
+    {
+        guint32 julian;
+        GDate date;
+
+        if (cache_read(r, &julian, sizeof julian))
+        {
+            g_date_clear(&date, 1);
+            if (g_date_valid_julian(julian))
+                g_date_set_julian(&date, julian);
+            return kvp_value_new_gdate(date);
+        }
+    }
+    break;
+    case KVP_TYPE_BINARY:
+    {
+        guint64 size;
+
+        if (cache_read(r, &size, sizeof size)
+                && size <= (guint64) (r->end - r->pos))
+        {
+            KvpValue *val = kvp_value_new_binary(r->pos, size);
+            r->pos += size;
+            return val;
+        }
+    }
+    break;
+    case KVP_TYPE_GLIST:
+    {
+        guint32 n;
+        GList *list = NULL;
+
+        if (!cache_read(r, &n, sizeof n))
+            break;
+        for (; n > 0; n--)
+        {
+            KvpValue *val = cache_read_kvp_value(r);
+
+            if (!val)
+            {
+                g_list_free_full(list, (GDestroyNotify) kvp_value_delete);
+                return NULL;
+            }
+            list = g_list_prepend(list, val);
+        }
+        return kvp_value_new_glist_nc(g_list_reverse(list));
+    }
+    case KVP_TYPE_FRAME:
+    {
+        KvpFrame *frame = kvp_frame_new();
+
+        if (cache_read_kvp_frame(r, frame))
+            return kvp_value_new_frame_nc(frame);
+        kvp_frame_delete(frame);
+    }
+    break;
+    default:
+        break;
+    }
+    return NULL;
+}
+
+static gboolean
+cache_read_kvp_frame(CacheReader *r, KvpFrame *frame)
+{
+    guint32 n;
+
+    if (!cache_read(r, &n, sizeof n))
+        return FALSE;
+
+    for (; n > 0; n--)
+    {
+        guint32 offset;
+        const gchar *key;
+        KvpValue *val;
+
+        if (!cache_read(r, &offset, sizeof offset)
+                || !cache_get_string(r->cache, offset, &key))
+            return FALSE;
+        val = cache_read_kvp_value(r);
+        if (!val)
+            return FALSE;
+        kvp_frame_set_slot_nc(frame, key ? key : "", val);
+    }
+    return TRUE;
+}
+
+static gboolean
+cache_read_slots(const GncXmlCache *cache, guint32 offset, QofInstance *inst)
+{
+    CacheReader r;
+
+    if (offset == CACHE_NONE)
+        return TRUE;
+    if (offset >= cache->header->heap_size)
+        return FALSE;
+
+    r.cache = cache;
+    r.pos = (const guchar *) cache->heap + offset;
+    r.end = (const guchar *) cache->heap + cache->header->heap_size;
+    return cache_read_kvp_frame(&r, qof_instance_get_slots(inst));
+}
+
+/* Mirrors dom_tree_to_split(), in the order of its handlers. */
+static Split *
+cache_read_split(const GncXmlCache *cache, const CacheSplit *rec,
+                 QofBook *book)
+{
+    Split *split;
+    GncGUID guid;
+    const gchar *memo, *action;
+
+    if (!cache_get_string(cache, rec->memo, &memo)
+            || !cache_get_string(cache, rec->action, &action))
+        return NULL;
+
+    split = xaccMallocSplit(book);
+    g_return_val_if_fail(split, NULL);
+
+    memcpy(guid.data, rec->guid, GUID_DATA_SIZE);
+    xaccSplitSetGUID(split, &guid);
+    if (memo)
+        xaccSplitSetMemo(split, memo);
+    if (action)
+        xaccSplitSetAction(split, action);
+    xaccSplitSetReconcile(split, rec->reconcile);
+    if (rec->date_reconciled_sec || rec->date_reconciled_nsec)
+    {
+        Timespec ts;
+
+        ts.tv_sec = rec->date_reconciled_sec;
+        ts.tv_nsec = rec->date_reconciled_nsec;
+        xaccSplitSetDateReconciledTS(split, &ts);
+    }
+    xaccSplitSetValue(split, gnc_numeric_create(rec->value_num,
+                      rec->value_denom));
+    xaccSplitSetAmount(split, gnc_numeric_create(rec->amount_num,
+                       rec->amount_denom));
+
+    memcpy(guid.data, rec->account, GUID_DATA_SIZE);
+    xaccAccountInsertSplit(xaccAccountLookup(&guid, book), split);
+
+    memcpy(guid.data, rec->lot, GUID_DATA_SIZE);
+    if (!guid_equal(&guid, guid_null()))
+    {
+        GNCLot *lot = gnc_lot_lookup(&guid, book);
+
+        if (lot)
+            gnc_lot_add_split(lot, split);
+        else
+            PWARN("split in a lot that isn't in the book");
+    }
+
+    if (!cache_read_slots(cache, rec->slots, QOF_INSTANCE(split)))
+    {
+        xaccSplitDestroy(split);
+        return NULL;
+    }
+    return split;
+}
+
+Transaction *
+gnc_xml_cache_get_transaction(GncXmlCache *cache, guint index, QofBook *book)
+{
+    const CacheTrans *rec;
+    Transaction *trn;
+    GncGUID guid;
+    Timespec ts;
+    const gchar *space, *id, *num, *description;
+    gboolean successful = TRUE;
+    guint i;
+
+    g_return_val_if_fail(cache, NULL);
+    g_return_val_if_fail(book, NULL);
+    g_return_val_if_fail(index < cache->header->n_transactions, NULL);
+
+    rec = &cache->transactions[index];
+    if (rec->first_split > cache->header->n_splits
+            || rec->n_splits > cache->header->n_splits - rec->first_split
+            || !cache_get_string(cache, rec->currency_space, &space)
+            || !cache_get_string(cache, rec->currency_id, &id)
+            || !cache_get_string(cache, rec->num, &num)
+            || !cache_get_string(cache, rec->description, &description))
+    {
+        PERR("damaged transaction record %u", index);
+        return NULL;
+    }
+
+    trn = xaccMallocTransaction(book);
+    g_return_val_if_fail(trn, NULL);
+    xaccTransBeginEdit(trn);
+
+    memcpy(guid.data, rec->guid, GUID_DATA_SIZE);
+    xaccTransSetGUID(trn, &guid);
+
+    if (space && id)
+    {
+        gnc_commodity *currency =
+            gnc_commodity_table_lookup(gnc_commodity_table_get_table(book),
+                                       space, id);
+        if (currency)
+            xaccTransSetCurrency(trn, currency);
+        else
+            PWARN("unable to find currency %s::%s", space, id);
+    }
+    if (num)
+        xaccTransSetNum(trn, num);
+
+    ts.tv_sec = rec->date_posted_sec;
+    ts.tv_nsec = rec->date_posted_nsec;
+    xaccTransSetDatePostedTS(trn, &ts);
+    ts.tv_sec = rec->date_entered_sec;
+    ts.tv_nsec = rec->date_entered_nsec;
+    xaccTransSetDateEnteredTS(trn, &ts);
+
+    if (description)
+        xaccTransSetDescription(trn, description);
+
+    successful = cache_read_slots(cache, rec->slots, QOF_INSTANCE(trn));
+
+    for (i = 0; successful && i < rec->n_splits; i++)
+    {
+        Split *split = cache_read_split(cache,
+                                        &cache->splits[rec->first_split + i],
+                                        book);
+        if (split)
+            xaccTransAppendSplit(trn, split);
+        else
+            successful = FALSE;
+    }
+
+    xaccTransCommitEdit(trn);
+
+    if (!successful)
+    {
+        PERR("damaged transaction record %u", index);
+        xaccTransBeginEdit(trn);
+        xaccTransDestroy(trn);
+        xaccTransCommitEdit(trn);
+        trn = NULL;
+    }
+    return trn;
+}
@@ -0,0 +1,83 @@
+/********************************************************************\
+ * io-gncxml-cache.h -- binary cache of the transactions in an XML  *
+ *                      data file                                   *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+/**
+ * @file io-gncxml-cache.h
+ * @brief Binary cache of the transactions in an XML data file
+ *
+ * The cache sits next to a data file and holds the same transactions
+ * as the gnc:transaction elements of its book, in the same order, as
+ * fixed-width records with their strings and slots in a heap.  It is
+ * read through a memory mapping and each transaction is only built when
+ * asked for.  Loading still reads the transactions' XML to find where
+ * each element ends, but doesn't parse it: an element whose id is that
+ * of the record at its place is replaced by the record's transaction.
+ * At the first one that isn't, the cache is dropped and the XML parsed
+ * after all, so a cache can only ever make loading faster.
+ *
+ * Template transactions are read with the template accounts from their
+ * own element, which the cache doesn't stand in for, so a book that has
+ * any gets no cache.
+ *
+ * A cache names the snapshot id of the data file it was written for,
+ * see gnc_xml_read_snapshot_id(), and carries a checksum of its
+ * contents; one that doesn't match is never opened.
+ */
+
+#ifndef IO_GNCXML_CACHE_H
+#define IO_GNCXML_CACHE_H
+
+#include <glib.h>
+
+#include "gnc-engine.h"
+#include "Transaction.h"
+
+typedef struct gnc_xml_cache GncXmlCache;
+
+/** Write the transactions of the book to a cache for the data file with
+ * the given snapshot id, replacing any cache already there.  The records
+ * go straight to the file as the book is walked.  Returns FALSE if the
+ * book can't be cached or the cache couldn't be written. */
+gboolean gnc_xml_cache_write(QofBook *book, const char *filename,
+                             const GncGUID *snapshot);
+
+/** Open the cache if it was written for the data file with the given
+ * snapshot id and is intact.  Returns NULL otherwise. */
+GncXmlCache *gnc_xml_cache_open(const char *filename,
+                                const GncGUID *snapshot);
+
+guint gnc_xml_cache_get_n_transactions(const GncXmlCache *cache);
+
+/** The id of the transaction at @a index, without building it. */
+gboolean gnc_xml_cache_get_transaction_guid(const GncXmlCache *cache,
+        guint index, GncGUID *guid);
+
+/** Build the transaction at @a index in the book, as
+ * dom_tree_to_transaction() would from its XML.  The accounts and lots
+ * its splits belong to must already be loaded. */
+Transaction *gnc_xml_cache_get_transaction(GncXmlCache *cache, guint index,
+                                           QofBook *book);
+
+void gnc_xml_cache_close(GncXmlCache *cache);
+
+#endif /* IO_GNCXML_CACHE_H */
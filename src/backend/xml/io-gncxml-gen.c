@@ -24,7 +24,10 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "io-gncxml-gen.h"
+#include "sixtp-parsers.h"
 
 gboolean
 gnc_xml_parse_file(sixtp *top_parser, const char *filename,
@@ -37,6 +40,7 @@ gnc_xml_parse_file(sixtp *top_parser, const char *filename,
     gpdata.cb = callback;
     gpdata.parsedata = parsedata;
     gpdata.bookdata = bookdata;
+    gpdata.splitdata = NULL;
 
     return sixtp_parse_file(top_parser, filename,
                             NULL, &gpdata, &parse_result);
@@ -53,7 +57,613 @@ gnc_xml_parse_fd(sixtp *top_parser, FILE *fd,
     gpdata.cb = callback;
     gpdata.parsedata = parsedata;
     gpdata.bookdata = bookdata;
+    gpdata.splitdata = NULL;
 
     return sixtp_parse_fd(top_parser, fd,
                           NULL, &gpdata, &parse_result);
 }
+
+/* ================================================================ */
+/* Split parsing.
+
+   The splitter thread reads fd and copies it to the main parser a
+   block at a time, except that each split element is cut out and
+   replaced by an empty <gnc:split-chunk/>.  The cut out text becomes a
+   SplitChunk, queued in document order and handed to the worker pool,
+   which parses it into a DOM tree.  When the main parser reaches a
+   placeholder it takes the chunk at the head of the queue, waits for
+   its tree if need be and runs the real end handler on it.  Chunks of
+   elements with a take hook skip the workers: the main parser offers
+   their text to the hook and only parses them itself if it declines.
+*/
+
+static gboolean
+split_chunk_end_handler(gpointer data_for_children,
+                        GSList* data_from_children, GSList* sibling_data,
+                        gpointer parent_data, gpointer global_data,
+                        gpointer *result, const gchar *tag);
+
+sixtp *
+gnc_xml_split_chunk_parser_create(void)
+{
+    return sixtp_set_any(sixtp_new(), FALSE,
+                         SIXTP_END_HANDLER_ID, split_chunk_end_handler,
+                         SIXTP_NO_MORE_HANDLERS);
+}
+
+#ifdef HAVE_GLIB_2_32
+
+static QofLogModule log_module = GNC_MOD_IO;
+
+#define SPLIT_READ_SIZE   (64 * 1024)
+/* How many chunks the splitter may run ahead of the main parser. */
+#define SPLIT_MAX_PENDING 4096
+/* How many blocks of text it may run ahead of it; a document that
+ * isn't split at all would otherwise be read into memory whole. */
+#define SPLIT_MAX_BLOCKS  64
+
+typedef struct
+{
+    const gxpf_split_tag *split;
+    gchar *text;
+    gsize len;
+    xmlNodePtr tree;
+    gboolean done;
+    gboolean offered;       /* to be offered to split->take first */
+} SplitChunk;
+
+typedef struct
+{
+    FILE *in;
+    const gxpf_split_tag *split_tags;
+    sixtp *chunk_parser;
+    GThreadPool *pool;
+
+    GMutex lock;
+    GCond cond;
+    GQueue chunks;          /* SplitChunk*, not yet taken by the parser */
+    GQueue blocks;          /* GString*, an empty one ends the document */
+    gboolean stopped;
+    gboolean declined;      /* a take hook declined an element */
+
+    GString *block;         /* the block being read by libxml2 */
+    gsize block_pos;
+} SplitPipeline;
+
+typedef struct
+{
+    GString *buf;           /* text read and not yet passed on */
+    gsize pos;              /* where scanning resumes in buf */
+    gsize out_start;        /* start of the text in buf not yet passed on */
+    GString *out;           /* text for the main parser not yet queued */
+    GPtrArray *parents;     /* names of the open elements */
+    const gxpf_split_tag *split;  /* the element being cut out, if any */
+    guint depth;            /* elements open inside it */
+    gboolean splitting;
+} SplitScan;
+
+static void
+split_chunk_free(SplitChunk *chunk)
+{
+    if (chunk->tree)
+        xmlFreeNode(chunk->tree);
+    g_free(chunk->text);
+    g_free(chunk);
+}
+
+static gboolean
+split_chunk_dom_end_handler(gpointer data_for_children,
+                            GSList* data_from_children, GSList* sibling_data,
+                            gpointer parent_data, gpointer global_data,
+                            gpointer *result, const gchar *tag)
+{
+    SplitChunk *chunk = global_data;
+
+    if (parent_data || !tag)
+        return TRUE;
+
+    chunk->tree = data_for_children;
+    return TRUE;
+}
+
+static void
+split_parse_chunk(gpointer data, gpointer user_data)
+{
+    SplitChunk *chunk = data;
+    SplitPipeline *pl = user_data;
+    gpointer parse_result = NULL;
+    gboolean stopped;
+
+    g_mutex_lock(&pl->lock);
+    stopped = pl->stopped;
+    g_mutex_unlock(&pl->lock);
+
+    if (!stopped &&
+        !sixtp_parse_buffer(pl->chunk_parser, chunk->text, chunk->len,
+                            NULL, chunk, &parse_result) && chunk->tree)
+    {
+        xmlFreeNode(chunk->tree);
+        chunk->tree = NULL;
+    }
+    g_free(chunk->text);
+    chunk->text = NULL;
+
+    g_mutex_lock(&pl->lock);
+    chunk->done = TRUE;
+    g_cond_broadcast(&pl->cond);
+    g_mutex_unlock(&pl->lock);
+}
+
+static gboolean
+split_chunk_end_handler(gpointer data_for_children,
+                        GSList* data_from_children, GSList* sibling_data,
+                        gpointer parent_data, gpointer global_data,
+                        gpointer *result, const gchar *tag)
+{
+    gxpf_data *gdata = global_data;
+    SplitPipeline *pl = gdata->splitdata;
+    SplitChunk *chunk;
+    sixtp_end_handler end_handler;
+    xmlNodePtr tree;
+
+    g_return_val_if_fail(pl, FALSE);
+
+    g_mutex_lock(&pl->lock);
+    while (!(chunk = g_queue_peek_head(&pl->chunks)) || !chunk->done)
+        g_cond_wait(&pl->cond, &pl->lock);
+    g_queue_pop_head(&pl->chunks);
+    g_cond_broadcast(&pl->cond);
+    g_mutex_unlock(&pl->lock);
+
+    if (chunk->offered)
+    {
+        if (chunk->split->take(chunk->text, chunk->len, gdata->parsedata))
+        {
+            split_chunk_free(chunk);
+            return TRUE;
+        }
+        g_mutex_lock(&pl->lock);
+        pl->declined = TRUE;
+        g_mutex_unlock(&pl->lock);
+        split_parse_chunk(chunk, pl);
+    }
+
+    /* The end handler owns the tree from here on. */
+    tree = chunk->tree;
+    chunk->tree = NULL;
+    tag = chunk->split->tag;
+    end_handler = chunk->split->parser->end_handler;
+    split_chunk_free(chunk);
+
+    if (!tree)
+    {
+        PERR("failed to parse <%s>", tag);
+        return FALSE;
+    }
+    return end_handler(tree, NULL, sibling_data, parent_data, global_data,
+                       result, tag);
+}
+
+/* Chunks are parsed as documents of their own, which libxml2 reads as
+ * UTF-8, so only split documents that are UTF-8 themselves. */
+static gboolean
+split_is_utf8(const gchar *str, gsize len)
+{
+    const gchar *end = str + len;
+    const gchar *decl_end, *enc;
+    gchar quote;
+
+    if (len >= 3 && memcmp(str, "\xef\xbb\xbf", 3) == 0)
+        str += 3;
+    if (end - str < 5 || strncmp(str, "<?xml", 5) != 0)
+        return str < end && *str == '<';
+
+    decl_end = g_strstr_len(str, end - str, "?>");
+    if (!decl_end)
+        return FALSE;
+    enc = g_strstr_len(str, decl_end - str, "encoding");
+    if (!enc)
+        return TRUE;
+    for (enc += 8; enc < decl_end && *enc != '"' && *enc != '\''; enc++);
+    if (decl_end - enc < 7)
+        return FALSE;
+    quote = *enc++;
+    return ((g_ascii_strncasecmp(enc, "utf-8", 5) == 0 && enc[5] == quote) ||
+            (g_ascii_strncasecmp(enc, "utf8", 4) == 0 && enc[4] == quote));
+}
+
+/* Find the '>' closing the tag whose name starts at p. */
+static const gchar *
+split_tag_end(const gchar *p, const gchar *end)
+{
+    gchar quote = 0;
+
+    for (; p < end; p++)
+    {
+        if (quote)
+        {
+            if (*p == quote)
+                quote = 0;
+        }
+        else if (*p == '"' || *p == '\'')
+            quote = *p;
+        else if (*p == '>')
+            return p;
+    }
+    return NULL;
+}
+
+static const gxpf_split_tag *
+split_lookup(SplitPipeline *pl, SplitScan *s, const gchar *name, gsize len)
+{
+    const gchar *parent;
+    const gxpf_split_tag *split;
+
+    if (s->parents->len == 0)
+        return NULL;
+    parent = g_ptr_array_index(s->parents, s->parents->len - 1);
+    for (split = pl->split_tags; split->tag; split++)
+        if (strncmp(split->tag, name, len) == 0 && split->tag[len] == '\0' &&
+            g_strcmp0(split->parent, parent) == 0)
+            return split;
+    return NULL;
+}
+
+static gboolean
+split_stopped(SplitPipeline *pl)
+{
+    gboolean stopped;
+
+    g_mutex_lock(&pl->lock);
+    stopped = pl->stopped;
+    g_mutex_unlock(&pl->lock);
+    return stopped;
+}
+
+/* Queue a block for the main parser, waiting while it is too far
+ * behind. */
+static void
+split_push_block(SplitPipeline *pl, GString *block)
+{
+    g_mutex_lock(&pl->lock);
+    while (pl->blocks.length >= SPLIT_MAX_BLOCKS && !pl->stopped)
+        g_cond_wait(&pl->cond, &pl->lock);
+    if (pl->stopped)
+    {
+        g_string_free(block, TRUE);
+    }
+    else
+    {
+        g_queue_push_tail(&pl->blocks, block);
+        g_cond_broadcast(&pl->cond);
+    }
+    g_mutex_unlock(&pl->lock);
+}
+
+static void
+split_flush(SplitPipeline *pl, SplitScan *s)
+{
+    if (s->out->len == 0)
+        return;
+    split_push_block(pl, s->out);
+    s->out = g_string_sized_new(SPLIT_READ_SIZE);
+}
+
+/* Cut buf[out_start, pos) out as a chunk and leave a placeholder for
+ * it.  The chunk is queued before the placeholder can reach the main
+ * parser, and the text already scanned is flushed before waiting for
+ * the parser to catch up, so that it can.  A chunk to be offered to a
+ * take hook keeps its text for the main parser instead of going to the
+ * workers. */
+static void
+split_end_chunk(SplitPipeline *pl, SplitScan *s)
+{
+    SplitChunk *chunk;
+    gboolean offered;
+
+    chunk = g_new0(SplitChunk, 1);
+    chunk->split = s->split;
+    chunk->len = s->pos - s->out_start;
+    chunk->text = g_strndup(s->buf->str + s->out_start, chunk->len);
+    s->out_start = s->pos;
+    s->split = NULL;
+
+    g_mutex_lock(&pl->lock);
+    if (pl->chunks.length >= SPLIT_MAX_PENDING)
+    {
+        g_mutex_unlock(&pl->lock);
+        split_flush(pl, s);
+        g_mutex_lock(&pl->lock);
+        while (pl->chunks.length >= SPLIT_MAX_PENDING && !pl->stopped)
+            g_cond_wait(&pl->cond, &pl->lock);
+    }
+    if (pl->stopped)
+    {
+        g_mutex_unlock(&pl->lock);
+        split_chunk_free(chunk);
+        return;
+    }
+    offered = chunk->split->take && !pl->declined;
+    chunk->offered = offered;
+    chunk->done = offered;
+    g_queue_push_tail(&pl->chunks, chunk);
+    g_cond_broadcast(&pl->cond);
+    g_mutex_unlock(&pl->lock);
+
+    if (!offered)
+        g_thread_pool_push(pl->pool, chunk, NULL);
+    g_string_append(s->out, "<" GNC_XML_SPLIT_CHUNK_TAG "/>");
+}
+
+/* Scan buf from pos, stopping at the first markup that isn't all there
+ * yet.  Outside split elements only the element names are tracked;
+ * inside one only the nesting depth. */
+static void
+split_scan(SplitPipeline *pl, SplitScan *s)
+{
+    while (s->pos < s->buf->len)
+    {
+        const gchar *str = s->buf->str;
+        const gchar *stop = str + s->buf->len;
+        const gchar *lt, *p, *gt, *name;
+        gsize name_len;
+        gboolean closing, empty;
+
+        lt = memchr(str + s->pos, '<', stop - (str + s->pos));
+        if (!lt)
+        {
+            s->pos = s->buf->len;
+            return;
+        }
+        /* Enough to tell "<![CDATA[" apart. */
+        if (stop - lt < 12)
+        {
+            s->pos = lt - str;
+            return;
+        }
+
+        p = lt + 1;
+        if (*p == '!' || *p == '?')
+        {
+            const gchar *close = ">";
+
+            if (*p == '?')
+                close = "?>";
+            else if (strncmp(p, "!--", 3) == 0)
+                close = "-->";
+            else if (strncmp(p, "![CDATA[", 8) == 0)
+                close = "]]>";
+            gt = g_strstr_len(p, stop - p, close);
+            if (!gt)
+            {
+                s->pos = lt - str;
+                return;
+            }
+            s->pos = gt - str + strlen(close);
+            continue;
+        }
+
+        gt = split_tag_end(p, stop);
+        if (!gt)
+        {
+            s->pos = lt - str;
+            return;
+        }
+        s->pos = gt - str + 1;
+
+        closing = (*p == '/');
+        name = closing ? p + 1 : p;
+        for (name_len = 0; name + name_len < gt; name_len++)
+            if (g_ascii_isspace(name[name_len]) || name[name_len] == '/')
+                break;
+        empty = !closing && gt[-1] == '/';
+
+        if (s->split)
+        {
+            if (closing && --s->depth == 0)
+                split_end_chunk(pl, s);
+            else if (!closing && !empty)
+                s->depth++;
+        }
+        else if (closing)
+        {
+            if (s->parents->len > 0)
+                g_ptr_array_remove_index(s->parents, s->parents->len - 1);
+        }
+        else if ((s->split = split_lookup(pl, s, name, name_len)) != NULL)
+        {
+            g_string_append_len(s->out, str + s->out_start,
+                                (lt - str) - s->out_start);
+            s->out_start = lt - str;
+            s->depth = 1;
+            if (empty)
+                split_end_chunk(pl, s);
+        }
+        else if (!empty)
+            g_ptr_array_add(s->parents, g_strndup(name, name_len));
+    }
+}
+
+static gpointer
+split_thread_func(gpointer data)
+{
+    SplitPipeline *pl = data;
+    SplitScan s;
+    gboolean first = TRUE;
+    gsize nread;
+
+    memset(&s, 0, sizeof(s));
+    s.buf = g_string_sized_new(2 * SPLIT_READ_SIZE);
+    s.out = g_string_sized_new(SPLIT_READ_SIZE);
+    s.parents = g_ptr_array_new_with_free_func(g_free);
+
+    do
+    {
+        gsize old_len = s.buf->len;
+
+        g_string_set_size(s.buf, old_len + SPLIT_READ_SIZE);
+        nread = fread(s.buf->str + old_len, 1, SPLIT_READ_SIZE, pl->in);
+        g_string_truncate(s.buf, old_len + nread);
+
+        if (first)
+        {
+            s.splitting = split_is_utf8(s.buf->str, s.buf->len);
+            if (!s.splitting)
+                PINFO("not splitting a document that isn't UTF-8");
+            first = FALSE;
+        }
+        if (s.splitting)
+            split_scan(pl, &s);
+        else
+            s.pos = s.buf->len;
+
+        if (!s.split)
+        {
+            g_string_append_len(s.out, s.buf->str + s.out_start,
+                                s.pos - s.out_start);
+            s.out_start = s.pos;
+        }
+        g_string_erase(s.buf, 0, s.out_start);
+        s.pos -= s.out_start;
+        s.out_start = 0;
+
+        if (s.out->len >= SPLIT_READ_SIZE)
+            split_flush(pl, &s);
+    }
+    while (nread > 0 && !split_stopped(pl));
+
+    /* Anything left over, such as an element that never closed, goes to
+     * the main parser as it is, which will then report the error. */
+    g_string_append_len(s.out, s.buf->str, s.buf->len);
+    split_flush(pl, &s);
+    split_push_block(pl, s.out);
+
+    g_string_free(s.buf, TRUE);
+    g_ptr_array_free(s.parents, TRUE);
+    return NULL;
+}
+
+static int
+split_read(void *context, char *buffer, int len)
+{
+    SplitPipeline *pl = context;
+    gsize n;
+
+    if (!pl->block)
+    {
+        g_mutex_lock(&pl->lock);
+        while (!(pl->block = g_queue_pop_head(&pl->blocks)))
+            g_cond_wait(&pl->cond, &pl->lock);
+        g_cond_broadcast(&pl->cond);
+        g_mutex_unlock(&pl->lock);
+        pl->block_pos = 0;
+    }
+    /* An empty block ends the document; keep it so that later reads
+     * see the end too. */
+    n = MIN((gsize)len, pl->block->len - pl->block_pos);
+    memcpy(buffer, pl->block->str + pl->block_pos, n);
+    pl->block_pos += n;
+    if (n > 0 && pl->block_pos == pl->block->len)
+    {
+        g_string_free(pl->block, TRUE);
+        pl->block = NULL;
+    }
+    return n;
+}
+
+gboolean
+gnc_xml_parse_fd_split(sixtp *top_parser, FILE *fd,
+                       const gxpf_split_tag *split_tags,
+                       gxpf_callback callback, gpointer parsedata,
+                       gpointer bookdata)
+{
+    gpointer parse_result = NULL;
+    gxpf_data gpdata;
+    SplitPipeline pl;
+    const gxpf_split_tag *split;
+    sixtp *dom_parser;
+    GThread *splitter;
+    SplitChunk *chunk;
+    GString *block;
+    gint n_workers;
+    gboolean ret;
+
+#ifdef HAVE_GLIB_2_36
+    n_workers = g_get_num_processors();
+#else
+    n_workers = 4;
+#endif
+    if (n_workers < 2 || !split_tags || !split_tags->tag)
+        return gnc_xml_parse_fd(top_parser, fd, callback, parsedata,
+                                bookdata);
+
+    /* libxml2 wants its globals set up before other threads use it. */
+    xmlInitParser();
+
+    memset(&pl, 0, sizeof(pl));
+    pl.in = fd;
+    pl.split_tags = split_tags;
+    g_mutex_init(&pl.lock);
+    g_cond_init(&pl.cond);
+    g_queue_init(&pl.chunks);
+    g_queue_init(&pl.blocks);
+
+    pl.chunk_parser = sixtp_new();
+    dom_parser = sixtp_dom_parser_new(split_chunk_dom_end_handler, NULL, NULL);
+    for (split = split_tags; split->tag; split++)
+        sixtp_add_sub_parser(pl.chunk_parser, split->tag, dom_parser);
+    pl.pool = g_thread_pool_new(split_parse_chunk, &pl, n_workers, FALSE, NULL);
+    splitter = g_thread_new("xml-splitter", split_thread_func, &pl);
+
+    gpdata.cb = callback;
+    gpdata.parsedata = parsedata;
+    gpdata.bookdata = bookdata;
+    gpdata.splitdata = &pl;
+
+    ret = sixtp_parse_io(top_parser, split_read, &pl,
+                         NULL, &gpdata, &parse_result);
+
+    /* On an error the parser stops early; let the splitter and the
+     * workers drop whatever they still have. */
+    g_mutex_lock(&pl.lock);
+    pl.stopped = TRUE;
+    g_cond_broadcast(&pl.cond);
+    g_mutex_unlock(&pl.lock);
+    g_thread_join(splitter);
+    g_thread_pool_free(pl.pool, FALSE, TRUE);
+
+    while ((chunk = g_queue_pop_head(&pl.chunks)) != NULL)
+        split_chunk_free(chunk);
+    if (pl.block)
+        g_string_free(pl.block, TRUE);
+    while ((block = g_queue_pop_head(&pl.blocks)) != NULL)
+        g_string_free(block, TRUE);
+    sixtp_destroy(pl.chunk_parser);
+    g_cond_clear(&pl.cond);
+    g_mutex_clear(&pl.lock);
+
+    return ret;
+}
+
+#else /* ! HAVE_GLIB_2_32 */
+
+static gboolean
+split_chunk_end_handler(gpointer data_for_children,
+                        GSList* data_from_children, GSList* sibling_data,
+                        gpointer parent_data, gpointer global_data,
+                        gpointer *result, const gchar *tag)
+{
+    /* Nothing is split, so no placeholder is ever seen. */
+    return FALSE;
+}
+
+gboolean
+gnc_xml_parse_fd_split(sixtp *top_parser, FILE *fd,
+                       const gxpf_split_tag *split_tags,
+                       gxpf_callback callback, gpointer parsedata,
+                       gpointer bookdata)
+{
+    return gnc_xml_parse_fd(top_parser, fd, callback, parsedata, bookdata);
+}
+
+#endif /* HAVE_GLIB_2_32 */
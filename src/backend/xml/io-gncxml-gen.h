@@ -36,10 +36,40 @@ struct gxpf_data_struct
     gxpf_callback cb;
     gpointer parsedata;
     gpointer bookdata;
+    gpointer splitdata;
 };
 
 typedef struct gxpf_data_struct gxpf_data;
 
+/** Offered the text of an element gnc_xml_parse_fd_split() cut out,
+ *  with the parsedata of the parse.  Returns TRUE if it dealt with the
+ *  element itself, which is then not parsed at all. */
+typedef gboolean (*gxpf_split_take)(const gchar *text, gsize len,
+                                    gpointer parsedata);
+
+/** An element gnc_xml_parse_fd_split() may cut out of the document.
+ *  It is only split when it is a direct child of an element named
+ *  parent.  parser is a sixtp_dom_parser_new() parser for tag; its end
+ *  handler is given the element's DOM tree and must free it.  If take
+ *  is set each element is first offered to it, on the calling thread and
+ *  in document order, and only parsed if it declines; once it has
+ *  declined the elements after it are parsed on the workers again. */
+typedef struct
+{
+    const gchar *parent;
+    const gchar *tag;
+    sixtp *parser;
+    gxpf_split_take take;
+} gxpf_split_tag;
+
+/** The element gnc_xml_parse_fd_split() leaves in the place of each
+ *  element it cuts out.  Register the parser returned by
+ *  gnc_xml_split_chunk_parser_create() under this tag beside each
+ *  parser listed as a gxpf_split_tag parent. */
+#define GNC_XML_SPLIT_CHUNK_TAG "gnc:split-chunk"
+
+sixtp *gnc_xml_split_chunk_parser_create(void);
+
 gboolean
 gnc_xml_parse_file(sixtp *top_parser, const char *filename,
                    gxpf_callback callback, gpointer parsedata,
@@ -50,4 +80,16 @@ gnc_xml_parse_fd(sixtp *top_parser, FILE *fd,
                  gxpf_callback callback, gpointer parsedata,
                  gpointer bookdata);
 
+/** Parse fd like gnc_xml_parse_fd(), but turn the elements listed in
+ *  split_tags (terminated by an entry with a NULL tag) into DOM trees on
+ *  a pool of worker threads.  A splitter thread reads ahead and cuts
+ *  them out of the document; the end handlers still run one at a time
+ *  on the calling thread, in document order, so they see the same book
+ *  state as they would with gnc_xml_parse_fd(). */
+gboolean
+gnc_xml_parse_fd_split(sixtp *top_parser, FILE *fd,
+                       const gxpf_split_tag *split_tags,
+                       gxpf_callback callback, gpointer parsedata,
+                       gpointer bookdata);
+
 #endif /* IO_GNCXML_GEN_H */
@@ -24,6 +24,7 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <string.h>
 #ifdef HAVE_UNISTD_H
 # include <unistd.h>
@@ -48,6 +49,7 @@
 #include "sixtp-utils.h"
 #include "gnc-xml.h"
 #include "io-utils.h"
+#include "gnc-prefs.h"
 #ifdef G_OS_WIN32
 # include <io.h>
 # define close _close
@@ -80,6 +82,8 @@ typedef struct
     gchar *filename;
     gchar *perms;
     gboolean compress;
+    gint level;
+    gint threads;
 } gz_thread_params_t;
 
 /* Callback structure */
@@ -91,6 +95,7 @@ struct file_backend
     const char    * tag;
     sixtp         * parser;
     FILE          * out;
+    sixtp_stream  * stream;
     QofBook       * book;
 };
 
@@ -103,6 +108,7 @@ extern const gchar *gnc_v2_book_version_string;        /* see gnc-book-xml-v2 */
 static FILE *try_gz_open (const char *filename, const char *perms, gboolean use_gzip,
                           gboolean compress);
 static gboolean is_gzipped_file(const gchar *name);
+static gzFile gz_open_for_read(const gchar *name);
 static gboolean wait_for_gzip(FILE *file);
 
 void
@@ -607,6 +613,60 @@ book_callback(const char *tag, gpointer globaldata, gpointer data)
     return TRUE;
 }
 
+/* The id of the transaction whose XML is text: its trn:id comes before
+ * anything else in it that has an id. */
+static gboolean
+find_transaction_id(const gchar *text, gsize len, GncGUID *guid)
+{
+    const gchar *end = text + len, *p, *q;
+    gchar buf[GUID_ENCODING_LENGTH + 1];
+
+    p = g_strstr_len(text, len, "<trn:id");
+    if (!p || !(p = memchr(p, '>', end - p)))
+        return FALSE;
+    for (p++; p < end && g_ascii_isspace(*p); p++);
+    for (q = p; q < end && *q != '<' && !g_ascii_isspace(*q); q++);
+    if (q - p != GUID_ENCODING_LENGTH)
+        return FALSE;
+    memcpy(buf, p, GUID_ENCODING_LENGTH);
+    buf[GUID_ENCODING_LENGTH] = '\0';
+    return string_to_guid(buf, guid);
+}
+
+/* Offered each gnc:transaction element of the book while there is a
+ * cache.  The cache holds the transactions in the order of their
+ * elements, so the element is taken from the cache if its id is that of
+ * the record at its place.  At the first one that isn't, the cache is
+ * dropped and the element, and all after it, parsed instead. */
+static gboolean
+take_cached_transaction(const gchar *text, gsize len, gpointer parsedata)
+{
+    sixtp_gdv2 *gd = parsedata;
+    guint index = gd->cached_elements;
+    GncGUID guid, cached_guid;
+    Transaction *trn = NULL;
+
+    if (!gd->cache)
+        return FALSE;
+
+    if (find_transaction_id(text, len, &guid)
+            && gnc_xml_cache_get_transaction_guid(gd->cache, index,
+                    &cached_guid)
+            && guid_equal(&guid, &cached_guid))
+        trn = gnc_xml_cache_get_transaction(gd->cache, index, gd->book);
+    if (!trn)
+    {
+        PWARN("transaction %u of the file isn't the cache's, dropping it",
+              index);
+        gnc_xml_cache_close(gd->cache);
+        gd->cache = NULL;
+        return FALSE;
+    }
+
+    gd->cached_elements++;
+    return add_transaction_local(gd, trn);
+}
+
 static gboolean
 generic_callback(const char *tag, gpointer globaldata, gpointer data)
 {
@@ -690,6 +750,20 @@ gnc_sixtp_gdv2_new (
     return gd;
 }
 
+/* The binary cache of the data file's transactions, if it is turned on
+ * and was written for the data file as it is now, which the snapshot id
+ * the data file was written with tells. */
+static GncXmlCache *
+open_cache(FileBackend *fbe)
+{
+    GncGUID snapshot;
+
+    if (!gnc_prefs_get_file_binary_cache() || !fbe->cachefile
+            || !gnc_xml_read_snapshot_id(fbe->fullpath, &snapshot))
+        return NULL;
+    return gnc_xml_cache_open(fbe->cachefile, &snapshot);
+}
+
 static gboolean
 qof_session_load_from_xml_file_v2_full(
     FileBackend *fbe, QofBook *book,
@@ -707,6 +781,8 @@ qof_session_load_from_xml_file_v2_full(
     char *v2type = NULL;
 
     gd = gnc_sixtp_gdv2_new(book, FALSE, file_rw_feedback, be->percentage);
+    if (!push_handler && type == GNC_BOOK_XML2_FILE)
+        gd->cache = open_cache(fbe);
 
     top_parser = sixtp_new();
     main_parser = sixtp_new();
@@ -740,6 +816,7 @@ qof_session_load_from_xml_file_v2_full(
                 TRANSACTION_TAG, gnc_transaction_sixtp_parser_create(),
                 SCHEDXACTION_TAG, gnc_schedXaction_sixtp_parser_create(),
                 TEMPLATE_TRANSACTION_TAG, gnc_template_transaction_sixtp_parser_create(),
+                GNC_XML_SPLIT_CHUNK_TAG, gnc_xml_split_chunk_parser_create(),
                 NULL, NULL))
     {
         goto bail;
@@ -757,6 +834,7 @@ qof_session_load_from_xml_file_v2_full(
                 TRANSACTION_TAG, gnc_transaction_sixtp_parser_create(),
                 SCHEDXACTION_TAG, gnc_schedXaction_sixtp_parser_create(),
                 TEMPLATE_TRANSACTION_TAG, gnc_template_transaction_sixtp_parser_create(),
+                GNC_XML_SPLIT_CHUNK_TAG, gnc_xml_split_chunk_parser_create(),
                 NULL, NULL))
     {
         goto bail;
@@ -771,6 +849,7 @@ qof_session_load_from_xml_file_v2_full(
     /* stop logging while we load */
     xaccLogDisable ();
     xaccDisableDataScrubbing();
+    qof_book_begin_bulk_load (book);
 
     if (push_handler)
     {
@@ -780,6 +859,7 @@ qof_session_load_from_xml_file_v2_full(
         gpdata.cb = generic_callback;
         gpdata.parsedata = gd;
         gpdata.bookdata = book;
+        gpdata.splitdata = NULL;
 
         retval = sixtp_parse_push(top_parser, push_handler, push_user_data,
                                   NULL, &gpdata, &parse_result);
@@ -793,6 +873,7 @@ qof_session_load_from_xml_file_v2_full(
 	 * info.
 	 */
 	gchar *filename = fbe->fullpath;
+	gboolean cached = (gd->cache != NULL);
 	FILE *file;
 	gboolean is_compressed = is_gzipped_file(filename);
 	file = try_gz_open(filename, "r", is_compressed, FALSE);
@@ -803,17 +884,50 @@ qof_session_load_from_xml_file_v2_full(
 	}
 	else
 	{
-	    retval = gnc_xml_parse_fd(top_parser, file,
-				      generic_callback, gd, book);
+	    /* Accounts and transactions make up most of a book, so they
+	     * are turned into DOM trees in parallel.  The XML of
+	     * transactions that come from the cache is still read, but
+	     * not parsed. */
+	    sixtp *account_parser = gnc_account_sixtp_parser_create();
+	    sixtp *transaction_parser = gnc_transaction_sixtp_parser_create();
+	    gxpf_split_take take = cached ? take_cached_transaction : NULL;
+	    gxpf_split_tag split_tags[] =
+	    {
+		{ BOOK_TAG, ACCOUNT_TAG, account_parser, NULL },
+		{ BOOK_TAG, TRANSACTION_TAG, transaction_parser, take },
+		{ GNC_V2_STRING, ACCOUNT_TAG, account_parser, NULL },
+		{ GNC_V2_STRING, TRANSACTION_TAG, transaction_parser, take },
+		{ NULL, NULL, NULL, NULL },
+	    };
+
+	    retval = gnc_xml_parse_fd_split(top_parser, file, split_tags,
+					    generic_callback, gd, book);
+	    sixtp_destroy(account_parser);
+	    sixtp_destroy(transaction_parser);
 	    fclose(file);
-	    if (is_compressed)
-		wait_for_gzip(file);
+	    /* A bad CRC only shows once the whole file was read */
+	    if (is_compressed && !wait_for_gzip(file))
+		retval = FALSE;
+	}
+
+	/* A cache that had to be dropped, or holds transactions the file
+	 * doesn't, is of no use to the next load either. */
+	if (cached && (!gd->cache
+		       || (gd->cached_elements > 0 && gd->cached_elements
+			   < gnc_xml_cache_get_n_transactions(gd->cache))))
+	{
+	    PWARN("removing the cache %s, which doesn't match the file",
+		  fbe->cachefile);
+	    if (g_unlink(fbe->cachefile) != 0)
+		PWARN("unable to unlink cache %s: %s", fbe->cachefile,
+		      g_strerror(errno));
 	}
     }
 
     if (!retval)
     {
         sixtp_destroy(top_parser);
+        qof_book_end_bulk_load (book);
         xaccLogEnable ();
         xaccEnableDataScrubbing();
         goto bail;
@@ -822,6 +936,7 @@ qof_session_load_from_xml_file_v2_full(
 
     /* destroy the parser */
     sixtp_destroy (top_parser);
+    gnc_xml_cache_close(gd->cache);
     g_free(gd);
 
     xaccEnableDataScrubbing();
@@ -851,12 +966,16 @@ qof_session_load_from_xml_file_v2_full(
                                    (AccountCb) xaccAccountCommitEdit,
                                    NULL);
 
+    /* sort and balance the accounts, now that all splits are in */
+    qof_book_end_bulk_load (book);
+
     /* start logging again */
     xaccLogEnable ();
 
     return TRUE;
 
 bail:
+    gnc_xml_cache_close(gd->cache);
     g_free(gd);
     return FALSE;
 }
@@ -1170,18 +1289,16 @@ write_pricedb(FILE *out, QofBook *book, sixtp_gdv2 *gd)
     return TRUE;
 }
 
+/* Transactions are most of a book, so they are streamed out rather
+ * than built as DOM trees and dumped. */
 static int
 xml_add_trn_data(Transaction *t, gpointer data)
 {
     struct file_backend *be_data = data;
-    xmlNodePtr node;
-
-    node = gnc_transaction_dom_tree_create(t);
 
-    xmlElemDump(be_data->out, NULL, node);
-    xmlFreeNode(node);
+    gnc_transaction_to_stream(be_data->stream, t);
 
-    if (ferror(be_data->out) || fprintf(be_data->out, "\n") < 0)
+    if (ferror(be_data->out))
         return -1;
 
     be_data->gd->counter.transactions_loaded++;
@@ -1193,13 +1310,16 @@ static gboolean
 write_transactions(FILE *out, QofBook *book, sixtp_gdv2 *gd)
 {
     struct file_backend be_data;
+    gboolean ok;
 
     be_data.out = out;
+    be_data.stream = sixtp_stream_new(out);
     be_data.gd = gd;
-    return 0 ==
-           xaccAccountTreeForEachTransaction(gnc_book_get_root_account(book),
-                   xml_add_trn_data,
-                   (gpointer) &be_data);
+    ok = 0 ==
+         xaccAccountTreeForEachTransaction(gnc_book_get_root_account(book),
+                 xml_add_trn_data,
+                 (gpointer) &be_data);
+    return sixtp_stream_destroy(be_data.stream) && ok;
 }
 
 static gboolean
@@ -1214,11 +1334,17 @@ write_template_transaction_data( FILE *out, QofBook *book, sixtp_gdv2 *gd )
     ra = gnc_book_get_template_root(book);
     if ( gnc_account_n_descendants(ra) > 0 )
     {
+        gboolean ok;
+
         if (fprintf(out, "<%s>\n", TEMPLATE_TRANSACTION_TAG) < 0
-                || !write_account_tree(out, ra, gd)
-                || xaccAccountTreeForEachTransaction(ra, xml_add_trn_data, (gpointer)&be_data)
-                || fprintf(out, "</%s>\n", TEMPLATE_TRANSACTION_TAG) < 0)
+                || !write_account_tree(out, ra, gd))
+            return FALSE;
 
+        be_data.stream = sixtp_stream_new(out);
+        ok = !xaccAccountTreeForEachTransaction(ra, xml_add_trn_data,
+                                                (gpointer)&be_data);
+        if (!sixtp_stream_destroy(be_data.stream) || !ok
+                || fprintf(out, "</%s>\n", TEMPLATE_TRANSACTION_TAG) < 0)
             return FALSE;
     }
 
@@ -1328,8 +1454,23 @@ write_v2_header (FILE *out)
     return TRUE;
 }
 
-gboolean
-gnc_book_write_to_xml_filehandle_v2(QofBook *book, FILE *out)
+/* The snapshot id follows the header in a comment, so that readers
+ * which don't know about it skip it. */
+#define SNAPSHOT_COMMENT "<!-- gnc:snapshot "
+/* How far into the file the snapshot id may be looked for */
+#define SNAPSHOT_SEARCH_LEN 8192
+
+static gboolean
+write_snapshot_id (FILE *out, const GncGUID *snapshot)
+{
+    gchar guidstr[GUID_ENCODING_LENGTH + 1];
+
+    guid_to_string_buff(snapshot, guidstr);
+    return fprintf(out, SNAPSHOT_COMMENT "%s -->\n", guidstr) >= 0;
+}
+
+static gboolean
+write_book_to_filehandle(QofBook *book, FILE *out, const GncGUID *snapshot)
 {
     QofBackend *be;
     sixtp_gdv2 *gd;
@@ -1338,6 +1479,7 @@ gnc_book_write_to_xml_filehandle_v2(QofBook *book, FILE *out)
     if (!out) return FALSE;
 
     if (!write_v2_header(out)
+            || (snapshot && !write_snapshot_id(out, snapshot))
             || !write_counts(out, "book", 1, NULL))
         return FALSE;
 
@@ -1362,6 +1504,12 @@ gnc_book_write_to_xml_filehandle_v2(QofBook *book, FILE *out)
     return success;
 }
 
+gboolean
+gnc_book_write_to_xml_filehandle_v2(QofBook *book, FILE *out)
+{
+    return write_book_to_filehandle(book, out, NULL);
+}
+
 /*
  * This function is called by the "export" code.
  */
@@ -1401,6 +1549,280 @@ gnc_book_write_accounts_to_xml_filehandle_v2(QofBackend *be, QofBook *book, FILE
 
 #define BUFLEN 4096
 
+#ifdef HAVE_GLIB_2_32
+/* Parallel compression in the style of pigz: the input is cut into blocks
+ * which are deflated independently on a thread pool, each one primed with
+ * the last 32 KiB of the input before it as a preset dictionary, so the
+ * ratio stays close to that of a single stream.  The blocks end on a sync
+ * flush, the last one on a finish, and their concatenation is a plain raw
+ * deflate stream which is wrapped in one ordinary gzip member. */
+#define GZ_BLOCK_SIZE (128 * 1024)
+#define GZ_DICT_SIZE  (32 * 1024)
+
+typedef struct
+{
+    guchar *in;           /* dictionary followed by the block's input */
+    gsize dict_len;
+    gsize in_len;         /* excluding the dictionary */
+    gboolean last;
+    guchar *out;
+    gsize out_len;
+    guint32 crc;
+    gboolean ok;
+    gboolean done;
+} gz_block_t;
+
+typedef struct
+{
+    gint level;
+    GMutex mutex;
+    GCond cond;
+    GQueue blocks;        /* submitted blocks, in input order */
+} gz_compress_t;
+
+static void
+gz_block_free(gz_block_t *block)
+{
+    g_free(block->in);
+    g_free(block->out);
+    g_free(block);
+}
+
+/* Thread pool worker: deflate one block and mark it done. */
+static void
+gz_deflate_block(gz_block_t *block, gz_compress_t *gz)
+{
+    z_stream strm;
+    gsize out_size;
+    gint flush = block->last ? Z_FINISH : Z_SYNC_FLUSH;
+    gint ret;
+
+    block->crc = crc32(crc32(0L, Z_NULL, 0), block->in + block->dict_len,
+                       block->in_len);
+
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, gz->level, Z_DEFLATED, -MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) == Z_OK)
+    {
+        if (block->dict_len)
+            deflateSetDictionary(&strm, block->in, block->dict_len);
+
+        /* deflateBound() leaves no room for the flush marker */
+        out_size = deflateBound(&strm, block->in_len) + 16;
+        block->out = g_malloc(out_size);
+        strm.next_in = block->in + block->dict_len;
+        strm.avail_in = block->in_len;
+        strm.next_out = block->out;
+        strm.avail_out = out_size;
+
+        while (TRUE)
+        {
+            ret = deflate(&strm, flush);
+            if (ret == Z_STREAM_ERROR)
+                break;
+            if (block->last ? ret == Z_STREAM_END : strm.avail_out != 0)
+            {
+                block->ok = TRUE;
+                break;
+            }
+            out_size *= 2;
+            block->out = g_realloc(block->out, out_size);
+            strm.next_out = block->out + strm.total_out;
+            strm.avail_out = out_size - strm.total_out;
+        }
+        block->out_len = strm.total_out;
+        deflateEnd(&strm);
+    }
+
+    /* The input is not needed any more; the next block has its own copy
+     * of the dictionary. */
+    g_free(block->in);
+    block->in = NULL;
+
+    g_mutex_lock(&gz->mutex);
+    block->done = TRUE;
+    g_cond_broadcast(&gz->cond);
+    g_mutex_unlock(&gz->mutex);
+}
+
+/* Fill a new block from fd, taking its dictionary from the end of prev.
+ * Returns NULL on a read error. */
+static gz_block_t *
+gz_read_block(gint fd, gz_block_t *prev)
+{
+    gz_block_t *block = g_new0(gz_block_t, 1);
+    gssize bytes;
+
+    block->in = g_malloc(GZ_DICT_SIZE + GZ_BLOCK_SIZE);
+    if (prev)
+    {
+        /* Only full blocks have a successor */
+        block->dict_len = GZ_DICT_SIZE;
+        memcpy(block->in, prev->in + prev->dict_len + prev->in_len - GZ_DICT_SIZE,
+               GZ_DICT_SIZE);
+    }
+
+    while (block->in_len < GZ_BLOCK_SIZE)
+    {
+        bytes = read(fd, block->in + block->dict_len + block->in_len,
+                     GZ_BLOCK_SIZE - block->in_len);
+        if (bytes > 0)
+            block->in_len += bytes;
+        else if (bytes == 0)
+            break;
+        else if (errno != EINTR)
+        {
+            g_warning("Could not read from pipe. The error is '%s' (errno %d)",
+                      g_strerror(errno) ? g_strerror(errno) : "", errno);
+            gz_block_free(block);
+            return NULL;
+        }
+    }
+    return block;
+}
+
+/* Write finished blocks to out in input order until no more than keep
+ * blocks are outstanding, accumulating the gzip trailer as we go. */
+static gboolean
+gz_write_blocks(gz_compress_t *gz, FILE *out, guint keep,
+                guint32 *crc, guint32 *isize)
+{
+    gz_block_t *block;
+    gboolean ok = TRUE;
+
+    g_mutex_lock(&gz->mutex);
+    while (ok && (block = g_queue_peek_head(&gz->blocks)) != NULL)
+    {
+        if (!block->done)
+        {
+            if (g_queue_get_length(&gz->blocks) <= keep)
+                break;
+            g_cond_wait(&gz->cond, &gz->mutex);
+            continue;
+        }
+        g_queue_pop_head(&gz->blocks);
+        g_mutex_unlock(&gz->mutex);
+
+        ok = block->ok
+             && fwrite(block->out, 1, block->out_len, out) == block->out_len;
+        *crc = crc32_combine(*crc, block->crc, block->in_len);
+        *isize += block->in_len;
+        gz_block_free(block);
+
+        g_mutex_lock(&gz->mutex);
+    }
+    g_mutex_unlock(&gz->mutex);
+    return ok;
+}
+
+/* Compress params->fd into params->filename using params->threads
+ * threads.  Returns TRUE on success. */
+static gboolean
+gz_parallel_compress(gz_thread_params_t *params)
+{
+    /* Deflate, no flags, no mtime, unknown OS */
+    guchar header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 255 };
+    guchar trailer[8];
+    guint32 crc = crc32(0L, Z_NULL, 0), isize = 0;
+    gz_compress_t gz;
+    gz_block_t *block, *next;
+    GThreadPool *pool;
+    FILE *out;
+    gboolean ok;
+    gint i;
+
+    out = g_fopen(params->filename, "wb");
+    if (out == NULL)
+    {
+        g_warning("Could not open the compressed file '%s'. The error is '%s' (errno %d)",
+                  params->filename, g_strerror(errno) ? g_strerror(errno) : "",
+                  errno);
+        return FALSE;
+    }
+    if (params->level == Z_BEST_COMPRESSION)
+        header[8] = 2;
+    else if (params->level == Z_BEST_SPEED)
+        header[8] = 4;
+    ok = fwrite(header, 1, sizeof(header), out) == sizeof(header);
+
+    gz.level = params->level;
+    g_mutex_init(&gz.mutex);
+    g_cond_init(&gz.cond);
+    g_queue_init(&gz.blocks);
+    pool = g_thread_pool_new((GFunc) gz_deflate_block, &gz, params->threads,
+                             TRUE, NULL);
+
+    block = NULL;
+    if (ok)
+    {
+        block = gz_read_block(params->fd, NULL);
+        ok = (block != NULL);
+    }
+    while (block)
+    {
+        /* A short block is the last one; a full one is unless more input
+         * follows it. */
+        next = NULL;
+        if (block->in_len == GZ_BLOCK_SIZE)
+        {
+            next = gz_read_block(params->fd, block);
+            if (next == NULL)
+            {
+                gz_block_free(block);
+                ok = FALSE;
+                break;
+            }
+            if (next->in_len == 0)
+            {
+                gz_block_free(next);
+                next = NULL;
+            }
+        }
+        block->last = (next == NULL);
+
+        g_queue_push_tail(&gz.blocks, block);
+        g_thread_pool_push(pool, block, NULL);
+
+        /* Bound the memory held by blocks waiting to be written */
+        ok = gz_write_blocks(&gz, out, 2 * params->threads, &crc, &isize);
+        if (!ok)
+        {
+            if (next)
+                gz_block_free(next);
+            break;
+        }
+        block = next;
+    }
+    if (ok)
+        ok = gz_write_blocks(&gz, out, 0, &crc, &isize);
+
+    g_thread_pool_free(pool, FALSE, TRUE);
+    while ((block = g_queue_pop_head(&gz.blocks)) != NULL)
+        gz_block_free(block);
+    g_mutex_clear(&gz.mutex);
+    g_cond_clear(&gz.cond);
+
+    if (ok)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            trailer[i] = (crc >> (8 * i)) & 0xff;
+            trailer[4 + i] = (isize >> (8 * i)) & 0xff;
+        }
+        ok = fwrite(trailer, 1, sizeof(trailer), out) == sizeof(trailer);
+    }
+    if (!ok)
+        g_warning("Could not write the compressed file '%s'", params->filename);
+
+    if (fclose(out) != 0)
+    {
+        g_warning("Could not close the compressed file '%s'", params->filename);
+        ok = FALSE;
+    }
+    return ok;
+}
+#endif /* HAVE_GLIB_2_32 */
+
 /* Compress or decompress function that is to be run in a separate thread.
  * Returns 1 on success or 0 otherwise, stuffed into a pointer type. */
 static gpointer
@@ -1412,6 +1834,14 @@ gz_thread_func(gz_thread_params_t *params)
     gzFile file;
     gint success = 1;
 
+#ifdef HAVE_GLIB_2_32
+    if (params->compress && params->threads > 1)
+    {
+        success = gz_parallel_compress(params) ? 1 : 0;
+        goto cleanup_gz_thread_func;
+    }
+#endif
+
 #ifdef G_OS_WIN32
     {
         gchar *conv_name = g_win32_locale_filename_from_utf8(params->filename);
@@ -1447,6 +1877,10 @@ gz_thread_func(gz_thread_params_t *params)
 
     if (params->compress)
     {
+        if (gzsetparams(file, params->level, Z_DEFAULT_STRATEGY) != Z_OK)
+            g_warning("Could not set the compression level of '%s'",
+                      params->filename);
+
         while (success)
         {
             bytes = read(params->fd, buffer, BUFLEN);
@@ -1557,6 +1991,15 @@ try_gz_open (const char *filename, const char *perms, gboolean use_gzip,
         params->filename = g_strdup(filename);
         params->perms = g_strdup(perms);
         params->compress = compress;
+        params->level = CLAMP(gnc_prefs_get_file_compression_level(),
+                              Z_BEST_SPEED, Z_BEST_COMPRESSION);
+        params->threads = gnc_prefs_get_file_compression_threads();
+        if (params->threads <= 0)
+#ifdef HAVE_GLIB_2_36
+            params->threads = g_get_num_processors();
+#else
+            params->threads = 1;
+#endif
 
 #ifndef HAVE_GLIB_2_32
         thread = g_thread_create((GThreadFunc) gz_thread_func, params,
@@ -1615,11 +2058,9 @@ wait_for_gzip(FILE *file)
     return retval;
 }
 
-gboolean
-gnc_book_write_to_xml_file_v2(
-    QofBook *book,
-    const char *filename,
-    gboolean compress)
+static gboolean
+write_book_to_file(QofBook *book, const char *filename, gboolean compress,
+                   const GncGUID *snapshot)
 {
     FILE *out;
     gboolean success = TRUE;
@@ -1628,7 +2069,7 @@ gnc_book_write_to_xml_file_v2(
 
     /* Try to write as much as possible */
     if (!out
-            || !gnc_book_write_to_xml_filehandle_v2(book, out)
+            || !write_book_to_filehandle(book, out, snapshot)
             || !write_emacs_trailer(out))
         success = FALSE;
 
@@ -1644,6 +2085,54 @@ gnc_book_write_to_xml_file_v2(
     return success;
 }
 
+gboolean
+gnc_book_write_to_xml_file_v2(
+    QofBook *book,
+    const char *filename,
+    gboolean compress)
+{
+    return write_book_to_file(book, filename, compress, NULL);
+}
+
+gboolean
+gnc_book_write_snapshot_to_xml_file_v2(QofBook *book, const char *filename,
+                                       gboolean compress,
+                                       const GncGUID *snapshot)
+{
+    g_return_val_if_fail(snapshot, FALSE);
+    return write_book_to_file(book, filename, compress, snapshot);
+}
+
+gboolean
+gnc_xml_read_snapshot_id(const char *filename, GncGUID *snapshot)
+{
+    gchar chunk[SNAPSHOT_SEARCH_LEN + 1];
+    gchar *comment, *guidstr;
+    gzFile file;
+    gint num_read;
+
+    g_return_val_if_fail(snapshot, FALSE);
+
+    /* gzread() reads a file that isn't compressed as it is */
+    file = gz_open_for_read(filename);
+    if (file == NULL)
+        return FALSE;
+    num_read = gzread(file, chunk, SNAPSHOT_SEARCH_LEN);
+    gzclose(file);
+    if (num_read < 1)
+        return FALSE;
+    chunk[num_read] = '\0';
+
+    comment = strstr(chunk, SNAPSHOT_COMMENT);
+    if (!comment)
+        return FALSE;
+    guidstr = comment + strlen(SNAPSHOT_COMMENT);
+    if (strlen(guidstr) < GUID_ENCODING_LENGTH)
+        return FALSE;
+    guidstr[GUID_ENCODING_LENGTH] = '\0';
+    return string_to_guid(guidstr, snapshot);
+}
+
 /*
  * Have to pass in the backend as this routine needs the temporary
  * backend for file export, not the real backend which could be
@@ -1681,6 +2170,299 @@ gnc_book_write_accounts_to_xml_file_v2(
     return success;
 }
 
+/***********************************************************************/
+/* The journal.  After a header line with the snapshot id of the data
+ * file it belongs to, it holds batches of records, one line each:
+ *
+ *   trn <guid> <length>   followed by <length> bytes of a
+ *                         <gnc:transaction> element and a newline
+ *   del <guid>            the transaction was deleted
+ *   end <count>           closes a batch of <count> records
+ *
+ * Only complete batches are replayed, so a save cut short leaves the
+ * journal as it was before it. */
+
+#define JOURNAL_HEADER "GnuCash journal 2 %s\n"
+
+typedef struct
+{
+    GncGUID guid;
+    const gchar *guid_str;      /* in the journal's contents */
+    const gchar *xml;           /* NULL for a deletion */
+    gsize len;
+} journal_record;
+
+/* Decode the ids of a batch of records all at once */
+static gboolean
+journal_decode_guids(GList *batch)
+{
+    guint count = g_list_length(batch), i;
+    const gchar **strings = g_new(const gchar *, count);
+    GncGUID *guids = g_new(GncGUID, count);
+    gboolean success;
+    GList *n;
+
+    for (n = batch, i = 0; n; n = n->next, i++)
+        strings[i] = ((journal_record *)n->data)->guid_str;
+    success = string_to_guid_n(strings, count, guids);
+    for (n = batch, i = 0; n; n = n->next, i++)
+        ((journal_record *)n->data)->guid = guids[i];
+    g_free(strings);
+    g_free(guids);
+    return success;
+}
+
+/* Point the record at its id in line, the second of tokens */
+static void
+journal_record_set_guid_str(journal_record *rec, gchar *line, gchar **tokens)
+{
+    gchar *guid_str = line + strlen(tokens[0]) + 1;
+
+    guid_str[strlen(tokens[1])] = '\0';
+    rec->guid_str = guid_str;
+}
+
+gboolean
+gnc_xml_journal_create(const char *filename, const GncGUID *snapshot)
+{
+    gchar guidstr[GUID_ENCODING_LENGTH + 1];
+    FILE *out;
+    gboolean success;
+
+    g_return_val_if_fail(snapshot, FALSE);
+
+    out = g_fopen(filename, "wb");
+    if (!out)
+        return FALSE;
+
+    guid_to_string_buff(snapshot, guidstr);
+    success = fprintf(out, JOURNAL_HEADER, guidstr) >= 0;
+    if (fclose(out))
+        success = FALSE;
+    return success;
+}
+
+gboolean
+gnc_xml_journal_matches(const char *filename, const GncGUID *snapshot)
+{
+    gchar guidstr[GUID_ENCODING_LENGTH + 1];
+    gchar *header, *line;
+    gsize len;
+    FILE *in;
+    gboolean matches = FALSE;
+
+    g_return_val_if_fail(snapshot, FALSE);
+
+    in = g_fopen(filename, "rb");
+    if (!in)
+        return FALSE;
+
+    guid_to_string_buff(snapshot, guidstr);
+    header = g_strdup_printf(JOURNAL_HEADER, guidstr);
+    len = strlen(header);
+    line = g_malloc(len);
+    if (fread(line, 1, len, in) == len)
+        matches = (memcmp(line, header, len) == 0);
+    fclose(in);
+
+    g_free(line);
+    g_free(header);
+    return matches;
+}
+
+gboolean
+gnc_xml_journal_append(QofBook *book, const char *filename, GList *guids)
+{
+    gchar guidstr[GUID_ENCODING_LENGTH + 1];
+    Transaction *trans;
+    xmlBufferPtr buf;
+    xmlNodePtr node;
+    GList *n;
+    FILE *out;
+    gboolean success = TRUE;
+    gint count = 0;
+
+    out = g_fopen(filename, "ab");
+    if (!out)
+        return FALSE;
+
+    for (n = guids; n && success; n = n->next)
+    {
+        guid_to_string_buff(n->data, guidstr);
+        trans = xaccTransLookup(n->data, book);
+        if (trans && !qof_instance_get_destroying(trans))
+        {
+            node = gnc_transaction_dom_tree_create(trans);
+            buf = xmlBufferCreate();
+            xmlNodeDump(buf, NULL, node, 0, 0);
+            success = fprintf(out, "trn %s %d\n", guidstr,
+                              xmlBufferLength(buf)) >= 0
+                      && fwrite(xmlBufferContent(buf), 1, xmlBufferLength(buf),
+                                out) == (size_t) xmlBufferLength(buf)
+                      && fputc('\n', out) != EOF;
+            xmlBufferFree(buf);
+            xmlFreeNode(node);
+        }
+        else
+        {
+            success = fprintf(out, "del %s\n", guidstr) >= 0;
+        }
+        count++;
+    }
+
+    if (success)
+        success = fprintf(out, "end %d\n", count) >= 0;
+    if (fclose(out))
+        success = FALSE;
+    return success;
+}
+
+static void
+journal_remove_transaction(QofBook *book, const GncGUID *guid)
+{
+    Transaction *trans = xaccTransLookup(guid, book);
+
+    if (!trans)
+        return;
+
+    /* The record replaces the transaction whatever its state */
+    xaccTransClearReadOnly(trans);
+    xaccTransBeginEdit(trans);
+    xaccTransDestroy(trans);
+    xaccTransCommitEdit(trans);
+}
+
+static gboolean
+journal_apply_record(QofBook *book, journal_record *rec)
+{
+    gnc_commodity_table *table;
+    Transaction *trans;
+    xmlDocPtr doc;
+
+    journal_remove_transaction(book, &rec->guid);
+    if (!rec->xml)
+        return TRUE;
+
+    /* The record has no namespace declarations; the element names keep
+     * their prefixes regardless, which is what the dom parsers expect. */
+    doc = xmlReadMemory(rec->xml, rec->len, NULL, NULL,
+                        XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+    if (!doc)
+        return FALSE;
+
+    trans = dom_tree_to_transaction(xmlDocGetRootElement(doc), book);
+    xmlFreeDoc(doc);
+    if (!trans)
+        return FALSE;
+
+    /* As add_transaction_local() does for the data file */
+    table = gnc_commodity_table_get_table(book);
+    xaccTransBeginEdit(trans);
+    clear_up_transaction_commodity(table, trans,
+                                   xaccTransGetCurrency,
+                                   xaccTransSetCurrency);
+    xaccTransScrubCurrency(trans);
+    xaccTransCommitEdit(trans);
+    return TRUE;
+}
+
+gboolean
+gnc_xml_journal_replay(QofBook *book, const char *filename, gboolean *torn,
+                       guint *n_batches)
+{
+    gchar *contents, *p, *end, *eol, *tail, *line;
+    gchar **tokens;
+    journal_record *rec;
+    GList *batch = NULL, *n;
+    guint64 number;
+    gsize length;
+    gboolean success = TRUE;
+
+    g_return_val_if_fail(torn && n_batches, FALSE);
+    *torn = FALSE;
+    *n_batches = 0;
+
+    if (!g_file_get_contents(filename, &contents, &length, NULL))
+        return FALSE;
+
+    end = contents + length;
+    p = memchr(contents, '\n', length);
+    p = p ? p + 1 : end;
+
+    while (success && p < end)
+    {
+        eol = memchr(p, '\n', end - p);
+        if (!eol)
+        {
+            *torn = TRUE;
+            break;
+        }
+        *eol = '\0';
+        line = p;
+        tokens = g_strsplit(line, " ", -1);
+        p = eol + 1;
+
+        if (g_strv_length(tokens) < 2)
+        {
+            success = FALSE;
+        }
+        else if (g_strcmp0(tokens[0], "trn") == 0 && tokens[2] && !tokens[3])
+        {
+            rec = g_new0(journal_record, 1);
+            batch = g_list_prepend(batch, rec);
+            number = g_ascii_strtoull(tokens[2], &tail, 10);
+            journal_record_set_guid_str(rec, line, tokens);
+            success = *tail == '\0';
+            if (success && (guint64)(end - p) <= number)
+                *torn = TRUE;
+            else if (success && p[number] == '\n')
+            {
+                rec->xml = p;
+                rec->len = number;
+                p += number + 1;
+            }
+            else
+                success = FALSE;
+        }
+        else if (g_strcmp0(tokens[0], "del") == 0 && !tokens[2])
+        {
+            rec = g_new0(journal_record, 1);
+            batch = g_list_prepend(batch, rec);
+            journal_record_set_guid_str(rec, line, tokens);
+        }
+        else if (g_strcmp0(tokens[0], "end") == 0 && !tokens[2])
+        {
+            number = g_ascii_strtoull(tokens[1], &tail, 10);
+            success = (*tail == '\0' && number == g_list_length(batch));
+            batch = g_list_reverse(batch);
+            success = success && journal_decode_guids(batch);
+            /* A batch applied in part changes the book all the same */
+            if (success)
+                (*n_batches)++;
+            for (n = batch; n && success; n = n->next)
+                success = journal_apply_record(book, n->data);
+            g_list_free_full(batch, g_free);
+            batch = NULL;
+        }
+        else
+        {
+            success = FALSE;
+        }
+        g_strfreev(tokens);
+
+        if (*torn)
+            break;
+    }
+
+    /* Records with no end marker are from a save that never finished */
+    if (success && batch)
+        *torn = TRUE;
+
+    g_list_free_full(batch, g_free);
+    g_free(contents);
+    return success;
+}
+
 /***********************************************************************/
 static gboolean
 is_gzipped_file(const gchar *name)
@@ -1708,29 +2490,36 @@ is_gzipped_file(const gchar *name)
     return FALSE;
 }
 
+static gzFile
+gz_open_for_read(const gchar *name)
+{
+    gzFile file = NULL;
+
+#ifdef G_OS_WIN32
+    gchar *conv_name = g_win32_locale_filename_from_utf8(name);
+    if (!conv_name)
+        g_warning("Could not convert '%s' to system codepage", name);
+    else
+    {
+        file = gzopen(conv_name, "rb");
+        g_free(conv_name);
+    }
+#else
+    file = gzopen(name, "r");
+#endif
+    return file;
+}
+
 QofBookFileType
 gnc_is_xml_data_file_v2(const gchar *name, gboolean *with_encoding)
 {
     if (is_gzipped_file(name))
     {
-        gzFile file = NULL;
+        gzFile file;
         char first_chunk[256];
         int num_read;
 
-#ifdef G_OS_WIN32
-        {
-            gchar *conv_name = g_win32_locale_filename_from_utf8(name);
-            if (!conv_name)
-                g_warning("Could not convert '%s' to system codepage", name);
-            else
-            {
-                file = gzopen(conv_name, "rb");
-                g_free(conv_name);
-            }
-        }
-#else
-        file = gzopen(name, "r");
-#endif
+        file = gz_open_for_read(name);
         if (file == NULL)
             return GNC_BOOK_NOT_OURS;
 
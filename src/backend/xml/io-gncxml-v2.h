@@ -35,6 +35,7 @@
 
 #include "gnc-engine.h"
 #include "gnc-backend-xml.h"
+#include "io-gncxml-cache.h"
 
 #include "sixtp.h"
 
@@ -71,6 +72,8 @@ struct sixtp_gdv2
     countCallbackFn countCallback;
     QofBePercentageFunc gui_display_fn;
     gboolean exporting;
+    GncXmlCache *cache;         /* Where the transactions come from, if set */
+    guint cached_elements;      /* gnc:transaction elements replaced */
 };
 
 /**
@@ -134,11 +137,52 @@ gboolean qof_session_load_from_xml_file_v2(FileBackend *, QofBook *, QofBookFile
 gboolean gnc_book_write_to_xml_filehandle_v2(QofBook *book, FILE *fh);
 gboolean gnc_book_write_to_xml_file_v2(QofBook *book, const char *filename, gboolean compress);
 
+/** Write the book as gnc_book_write_to_xml_file_v2() does, marking the
+ * file with @a snapshot, an id which its journal is tied to. */
+gboolean gnc_book_write_snapshot_to_xml_file_v2(QofBook *book,
+        const char *filename, gboolean compress, const GncGUID *snapshot);
+
+/** Read the id a data file was marked with when it was written.
+ * Returns FALSE if it has none. */
+gboolean gnc_xml_read_snapshot_id(const char *filename, GncGUID *snapshot);
+
 /** write just the commodities and accounts to a file */
 gboolean gnc_book_write_accounts_to_xml_filehandle_v2(QofBackend *be, QofBook *book, FILE *fh);
 gboolean gnc_book_write_accounts_to_xml_file_v2(QofBackend * be, QofBook *book,
         const char *filename);
 
+/** @name Journal
+ * A journal sits next to a data file and holds the transactions saved
+ * since the data file was last written in full, so that saving a few
+ * changes does not rewrite the whole book.
+ * @{ */
+
+/** Start an empty journal for the data file marked with @a snapshot,
+ * replacing any journal already there. */
+gboolean gnc_xml_journal_create(const char *filename,
+                                const GncGUID *snapshot);
+
+/** Whether the journal was started for the data file marked with @a
+ * snapshot, i.e. whether it may be replayed on top of it.  Copying or
+ * touching the data file keeps the id. */
+gboolean gnc_xml_journal_matches(const char *filename,
+                                 const GncGUID *snapshot);
+
+/** Append one batch to the journal: each transaction in @a guids that
+ * is still in the book is written out in full, the others are recorded
+ * as deleted. */
+gboolean gnc_xml_journal_append(QofBook *book, const char *filename,
+                                GList *guids);
+
+/** Apply the complete batches in the journal to the book.  @a torn is
+ * set if the journal ends in a batch that was never finished, which is
+ * skipped, and @a n_batches to the number of batches applied, in whole
+ * or in part.  Returns FALSE if the journal is damaged, in which case
+ * the batches before the damage have been applied. */
+gboolean gnc_xml_journal_replay(QofBook *book, const char *filename,
+                                gboolean *torn, guint *n_batches);
+/** @} */
+
 /** The is_gncxml_file() routine checks to see if the first few
  * chars of the file look like gnc-xml data.
  */
@@ -261,7 +261,7 @@ add_text_to_node(xmlNodePtr node, gchar *type, gchar *val)
 
 
 static void
-add_kvp_slot(gpointer key, gpointer value, gpointer data);
+add_kvp_frame_slots(const kvp_frame *frame, xmlNodePtr node);
 
 static void
 add_kvp_value_node(xmlNodePtr node, gchar *tag, kvp_value* val)
@@ -356,11 +356,10 @@ add_kvp_value_node(xmlNodePtr node, gchar *tag, kvp_value* val)
         xmlSetProp(val_node, BAD_CAST "type", BAD_CAST "frame");
 
         frame = kvp_value_get_frame (val);
-        if (!frame || !kvp_frame_get_hash (frame))
+        if (!frame)
             break;
 
-        g_hash_table_foreach_sorted(kvp_frame_get_hash(frame),
-                                    add_kvp_slot, val_node, (GCompareFunc)strcmp);
+        add_kvp_frame_slots(frame, val_node);
     }
     break;
     default:
@@ -369,17 +368,37 @@ add_kvp_value_node(xmlNodePtr node, gchar *tag, kvp_value* val)
 }
 
 static void
-add_kvp_slot(gpointer key, gpointer value, gpointer data)
+add_kvp_slot(const gchar *key, kvp_value *value, xmlNodePtr node)
 {
     xmlNodePtr slot_node;
-    xmlNodePtr node = (xmlNodePtr)data;
-    gchar *newkey = g_strdup ((gchar*)key);
+    gchar *newkey = g_strdup (key);
     slot_node = xmlNewChild(node, NULL, BAD_CAST "slot", NULL);
 
     xmlNewTextChild(slot_node, NULL, BAD_CAST "slot:key",
 		    checked_char_cast (newkey));
     g_free (newkey);
-    add_kvp_value_node(slot_node, "slot:value", (kvp_value*)value);
+    add_kvp_value_node(slot_node, "slot:value", value);
+}
+
+static void
+collect_kvp_key(const gchar *key, kvp_value *value, gpointer data)
+{
+    GList **keys = data;
+    *keys = g_list_prepend(*keys, (gpointer)key);
+}
+
+/* The slots are written sorted by key so that saving the same data
+ * always gives the same file. */
+static void
+add_kvp_frame_slots(const kvp_frame *frame, xmlNodePtr node)
+{
+    GList *keys = NULL, *iter;
+
+    kvp_frame_for_each_slot((kvp_frame*)frame, collect_kvp_key, &keys);
+    keys = g_list_sort(keys, (GCompareFunc)strcmp);
+    for (iter = keys; iter; iter = iter->next)
+        add_kvp_slot(iter->data, kvp_frame_get_slot(frame, iter->data), node);
+    g_list_free(keys);
 }
 
 xmlNodePtr
@@ -392,20 +411,14 @@ kvp_frame_to_dom_tree(const char *tag, const kvp_frame *frame)
         return NULL;
     }
 
-    if (!kvp_frame_get_hash(frame))
-    {
-        return NULL;
-    }
-
-    if (g_hash_table_size(kvp_frame_get_hash(frame)) == 0)
+    if (kvp_frame_get_slot_count(frame) == 0)
     {
         return NULL;
     }
 
     ret = xmlNewNode(NULL, BAD_CAST tag);
 
-    g_hash_table_foreach_sorted(kvp_frame_get_hash(frame),
-                                add_kvp_slot, ret, (GCompareFunc)strcmp);
+    add_kvp_frame_slots(frame, ret);
 
     return ret;
 }
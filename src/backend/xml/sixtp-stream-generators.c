@@ -0,0 +1,561 @@
+/********************************************************************
+ * sixtp-stream-generators.c                                        *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+ ********************************************************************/
+
+#include "config.h"
+#include <glib.h>
+#include <string.h>
+
+#include <gnc-date.h>
+
+#include "sixtp-stream-generators.h"
+#include "sixtp-dom-generators.h"
+
+#define STREAM_BUFFER_SIZE (256 * 1024)
+
+/* xmlElemDump() indents two spaces a level, up to 30 levels. */
+#define STREAM_INDENT      "  "
+#define STREAM_MAX_INDENT  30
+
+typedef enum
+{
+    ELEMENT_OPEN,      /* "<tag" written, nothing inside yet */
+    ELEMENT_CHILDREN,  /* holds elements, one per indented line */
+    ELEMENT_TEXT,      /* holds text, written inline */
+} element_state;
+
+struct sixtp_stream
+{
+    FILE *out;
+    gchar *buf;
+    gsize len;
+    gboolean failed;
+
+    guint8 *states;    /* element_state of each open element */
+    guint depth;
+    guint states_size;
+};
+
+sixtp_stream *
+sixtp_stream_new(FILE *out)
+{
+    sixtp_stream *s;
+
+    g_return_val_if_fail(out, NULL);
+
+    s = g_new0(sixtp_stream, 1);
+    s->out = out;
+    s->buf = g_malloc(STREAM_BUFFER_SIZE);
+    s->states_size = 16;
+    s->states = g_new(guint8, s->states_size);
+    return s;
+}
+
+gboolean
+sixtp_stream_flush(sixtp_stream *s)
+{
+    g_return_val_if_fail(s, FALSE);
+
+    if (s->len > 0 && !s->failed &&
+        fwrite(s->buf, 1, s->len, s->out) != s->len)
+        s->failed = TRUE;
+    s->len = 0;
+    return !s->failed && !ferror(s->out);
+}
+
+gboolean
+sixtp_stream_destroy(sixtp_stream *s)
+{
+    gboolean ok;
+
+    g_return_val_if_fail(s, FALSE);
+
+    ok = sixtp_stream_flush(s);
+    g_free(s->states);
+    g_free(s->buf);
+    g_free(s);
+    return ok;
+}
+
+/* Make room for n more bytes in the buffer and return where they go. */
+static inline gchar *
+stream_reserve(sixtp_stream *s, gsize n)
+{
+    if (STREAM_BUFFER_SIZE - s->len < n)
+        sixtp_stream_flush(s);
+    return s->buf + s->len;
+}
+
+static void
+stream_write(sixtp_stream *s, const gchar *data, gsize n)
+{
+    if (n >= STREAM_BUFFER_SIZE)
+    {
+        sixtp_stream_flush(s);
+        if (!s->failed && fwrite(data, 1, n, s->out) != n)
+            s->failed = TRUE;
+        return;
+    }
+    memcpy(stream_reserve(s, n), data, n);
+    s->len += n;
+}
+
+#define stream_puts(s, str) stream_write((s), (str), strlen(str))
+
+/* Escape text as xmlEscapeContent() does. */
+static void
+stream_write_escaped(sixtp_stream *s, const gchar *text)
+{
+    while (*text)
+    {
+        gsize run = strcspn(text, "<>&\r");
+
+        stream_write(s, text, run);
+        text += run;
+        switch (*text)
+        {
+        case '<':
+            stream_write(s, "&lt;", 4);
+            break;
+        case '>':
+            stream_write(s, "&gt;", 4);
+            break;
+        case '&':
+            stream_write(s, "&amp;", 5);
+            break;
+        case '\r':
+            stream_write(s, "&#13;", 5);
+            break;
+        default:
+            return;
+        }
+        text++;
+    }
+}
+
+static void
+stream_indent(sixtp_stream *s, guint level)
+{
+    guint i;
+
+    for (i = 0; i < MIN(level, STREAM_MAX_INDENT); i++)
+        stream_write(s, STREAM_INDENT, 2);
+}
+
+void
+sixtp_stream_open(sixtp_stream *s, const char *tag)
+{
+    g_return_if_fail(s && tag);
+
+    if (s->depth > 0 && s->states[s->depth - 1] == ELEMENT_OPEN)
+    {
+        stream_write(s, ">\n", 2);
+        s->states[s->depth - 1] = ELEMENT_CHILDREN;
+    }
+    if (s->depth == s->states_size)
+    {
+        s->states_size *= 2;
+        s->states = g_renew(guint8, s->states, s->states_size);
+    }
+    stream_indent(s, s->depth);
+    stream_write(s, "<", 1);
+    stream_puts(s, tag);
+    s->states[s->depth++] = ELEMENT_OPEN;
+}
+
+/* Attribute values are escaped as xmlAttrSerializeTxtContent() does
+ * for ASCII; the v2 format only writes ASCII ones. */
+void
+sixtp_stream_attr(sixtp_stream *s, const char *name, const char *value)
+{
+    g_return_if_fail(s && name && value);
+    g_return_if_fail(s->depth > 0 && s->states[s->depth - 1] == ELEMENT_OPEN);
+
+    stream_write(s, " ", 1);
+    stream_puts(s, name);
+    stream_write(s, "=\"", 2);
+    for (; *value; value++)
+    {
+        switch (*value)
+        {
+        case '<':
+            stream_write(s, "&lt;", 4);
+            break;
+        case '>':
+            stream_write(s, "&gt;", 4);
+            break;
+        case '&':
+            stream_write(s, "&amp;", 5);
+            break;
+        case '"':
+            stream_write(s, "&quot;", 6);
+            break;
+        case '\n':
+            stream_write(s, "&#10;", 5);
+            break;
+        case '\r':
+            stream_write(s, "&#13;", 5);
+            break;
+        case '\t':
+            stream_write(s, "&#9;", 4);
+            break;
+        default:
+            stream_write(s, value, 1);
+        }
+    }
+    stream_write(s, "\"", 1);
+}
+
+/* Switch the open element over to holding text. */
+static void
+stream_begin_text(sixtp_stream *s)
+{
+    if (s->states[s->depth - 1] == ELEMENT_OPEN)
+    {
+        stream_write(s, ">", 1);
+        s->states[s->depth - 1] = ELEMENT_TEXT;
+    }
+}
+
+void
+sixtp_stream_text(sixtp_stream *s, const char *text)
+{
+    g_return_if_fail(s && text);
+    g_return_if_fail(s->depth > 0 &&
+                     s->states[s->depth - 1] != ELEMENT_CHILDREN);
+
+    stream_begin_text(s);
+    stream_write_escaped(s, text);
+}
+
+void
+sixtp_stream_close(sixtp_stream *s, const char *tag)
+{
+    g_return_if_fail(s && tag && s->depth > 0);
+
+    switch (s->states[--s->depth])
+    {
+    case ELEMENT_OPEN:
+        stream_write(s, "/>\n", 3);
+        return;
+    case ELEMENT_CHILDREN:
+        stream_indent(s, s->depth);
+        break;
+    case ELEMENT_TEXT:
+        break;
+    }
+    stream_write(s, "</", 2);
+    stream_puts(s, tag);
+    stream_write(s, ">\n", 2);
+}
+
+/* Text that needs no escaping, formatted in place. */
+static void
+stream_number(sixtp_stream *s, gint64 val)
+{
+    gchar digits[20];
+    guint64 u = val < 0 ? -(guint64)val : (guint64)val;
+    gchar *p;
+    int n = 0;
+
+    do
+    {
+        digits[n++] = '0' + u % 10;
+        u /= 10;
+    }
+    while (u);
+
+    p = stream_reserve(s, n + 1);
+    if (val < 0)
+        *p++ = '-';
+    while (n)
+        *p++ = digits[--n];
+    s->len = p - s->buf;
+}
+
+/* ================================================================ */
+
+void
+text_child_to_stream(sixtp_stream *s, const char *tag, const char *text)
+{
+    sixtp_stream_open(s, tag);
+    if (text)
+        sixtp_stream_text(s, text);
+    sixtp_stream_close(s, tag);
+}
+
+void
+guid_to_stream(sixtp_stream *s, const char *tag, const GncGUID *gid)
+{
+    gchar *p;
+
+    g_return_if_fail(gid);
+
+    sixtp_stream_open(s, tag);
+    sixtp_stream_attr(s, "type", "guid");
+    stream_begin_text(s);
+    p = stream_reserve(s, GUID_ENCODING_LENGTH + 1);
+    guid_to_string_buff(gid, p);
+    s->len += GUID_ENCODING_LENGTH;
+    sixtp_stream_close(s, tag);
+}
+
+void
+commodity_ref_to_stream(sixtp_stream *s, const char *tag,
+                        const gnc_commodity *c)
+{
+    g_return_if_fail(c);
+
+    if (!gnc_commodity_get_namespace(c) || !gnc_commodity_get_mnemonic(c))
+        return;
+
+    sixtp_stream_open(s, tag);
+    text_child_to_stream(s, "cmdty:space",
+                         gnc_commodity_get_namespace_compat(c));
+    text_child_to_stream(s, "cmdty:id", gnc_commodity_get_mnemonic(c));
+    sixtp_stream_close(s, tag);
+}
+
+void
+timespec_to_stream(sixtp_stream *s, const char *tag, const Timespec *spec)
+{
+    gchar *date_str;
+
+    g_return_if_fail(spec);
+
+    date_str = timespec_sec_to_string(spec);
+    if (!date_str)
+        return;
+
+    sixtp_stream_open(s, tag);
+    text_child_to_stream(s, "ts:date", date_str);
+    if (spec->tv_nsec > 0)
+    {
+        sixtp_stream_open(s, "ts:ns");
+        stream_begin_text(s);
+        stream_number(s, spec->tv_nsec);
+        sixtp_stream_close(s, "ts:ns");
+    }
+    sixtp_stream_close(s, tag);
+    g_free(date_str);
+}
+
+void
+gdate_to_stream(sixtp_stream *s, const char *tag, const GDate *date)
+{
+    gchar date_str[512];
+
+    g_return_if_fail(date);
+
+    g_date_strftime(date_str, sizeof(date_str), "%Y-%m-%d", date);
+    sixtp_stream_open(s, tag);
+    text_child_to_stream(s, "gdate", date_str);
+    sixtp_stream_close(s, tag);
+}
+
+static void
+stream_numeric_text(sixtp_stream *s, gnc_numeric num)
+{
+    stream_begin_text(s);
+    stream_number(s, num.num);
+    stream_write(s, "/", 1);
+    stream_number(s, num.denom);
+}
+
+void
+gnc_numeric_to_stream(sixtp_stream *s, const char *tag,
+                      const gnc_numeric *num)
+{
+    g_return_if_fail(num);
+
+    sixtp_stream_open(s, tag);
+    stream_numeric_text(s, *num);
+    sixtp_stream_close(s, tag);
+}
+
+/* The kvp writers follow add_kvp_value_node() in sixtp-dom-generators.c,
+ * which sets typed values with xmlNodeSetContent(), so empty text there
+ * gives an empty element. */
+static void
+kvp_frame_slots_to_stream(sixtp_stream *s, const kvp_frame *frame);
+
+static void
+kvp_typed_text_to_stream(sixtp_stream *s, const char *tag, const char *type,
+                         const char *text)
+{
+    sixtp_stream_open(s, tag);
+    sixtp_stream_attr(s, "type", type);
+    if (text && *text)
+        sixtp_stream_text(s, text);
+    sixtp_stream_close(s, tag);
+}
+
+static void
+kvp_value_to_stream(sixtp_stream *s, const char *tag, kvp_value *val)
+{
+    switch (kvp_value_get_type(val))
+    {
+    case KVP_TYPE_GINT64:
+        sixtp_stream_open(s, tag);
+        sixtp_stream_attr(s, "type", "integer");
+        stream_begin_text(s);
+        stream_number(s, kvp_value_get_gint64(val));
+        sixtp_stream_close(s, tag);
+        break;
+    case KVP_TYPE_DOUBLE:
+    {
+        gchar *str = double_to_string(kvp_value_get_double(val));
+        kvp_typed_text_to_stream(s, tag, "double", str);
+        g_free(str);
+    }
+    break;
+    case KVP_TYPE_NUMERIC:
+        sixtp_stream_open(s, tag);
+        sixtp_stream_attr(s, "type", "numeric");
+        stream_numeric_text(s, kvp_value_get_numeric(val));
+        sixtp_stream_close(s, tag);
+        break;
+    case KVP_TYPE_STRING:
+    {
+        const gchar *str = kvp_value_get_string(val);
+
+        sixtp_stream_open(s, tag);
+        sixtp_stream_attr(s, "type", "string");
+        if (str)
+            sixtp_stream_text(s, str);
+        sixtp_stream_close(s, tag);
+    }
+    break;
+    case KVP_TYPE_GUID:
+    {
+        gchar guid_str[GUID_ENCODING_LENGTH + 1];
+
+        guid_to_string_buff(kvp_value_get_guid(val), guid_str);
+        kvp_typed_text_to_stream(s, tag, "guid", guid_str);
+    }
+    break;
+    case KVP_TYPE_TIMESPEC:
+    {
+        Timespec ts = kvp_value_get_timespec(val);
+        gchar *date_str = timespec_sec_to_string(&ts);
+
+        if (!date_str)
+            break;
+        sixtp_stream_open(s, tag);
+        sixtp_stream_attr(s, "type", "timespec");
+        text_child_to_stream(s, "ts:date", date_str);
+        if (ts.tv_nsec > 0)
+        {
+            sixtp_stream_open(s, "ts:ns");
+            stream_begin_text(s);
+            stream_number(s, ts.tv_nsec);
+            sixtp_stream_close(s, "ts:ns");
+        }
+        sixtp_stream_close(s, tag);
+        g_free(date_str);
+    }
+    break;
+    case KVP_TYPE_GDATE:
+    {
+        GDate d = kvp_value_get_gdate(val);
+        gchar date_str[512];
+
+        g_date_strftime(date_str, sizeof(date_str), "%Y-%m-%d", &d);
+        sixtp_stream_open(s, tag);
+        sixtp_stream_attr(s, "type", "gdate");
+        text_child_to_stream(s, "gdate", date_str);
+        sixtp_stream_close(s, tag);
+    }
+    break;
+    case KVP_TYPE_BINARY:
+    {
+        guint64 size;
+        void *binary_data = kvp_value_get_binary(val, &size);
+        gchar *str = binary_data ? binary_to_string(binary_data, size) : NULL;
+
+        kvp_typed_text_to_stream(s, tag, "binary", str);
+        g_free(str);
+    }
+    break;
+    case KVP_TYPE_GLIST:
+    {
+        GList *cursor;
+
+        sixtp_stream_open(s, tag);
+        sixtp_stream_attr(s, "type", "list");
+        for (cursor = kvp_value_get_glist(val); cursor; cursor = cursor->next)
+            kvp_value_to_stream(s, "slot:value", (kvp_value*)cursor->data);
+        sixtp_stream_close(s, tag);
+    }
+    break;
+    case KVP_TYPE_FRAME:
+    {
+        kvp_frame *frame = kvp_value_get_frame(val);
+
+        sixtp_stream_open(s, tag);
+        sixtp_stream_attr(s, "type", "frame");
+        if (frame)
+            kvp_frame_slots_to_stream(s, frame);
+        sixtp_stream_close(s, tag);
+    }
+    break;
+    default:
+        sixtp_stream_open(s, tag);
+        sixtp_stream_close(s, tag);
+        break;
+    }
+}
+
+static void
+collect_kvp_key(const gchar *key, kvp_value *value, gpointer data)
+{
+    GList **keys = data;
+    *keys = g_list_prepend(*keys, (gpointer)key);
+}
+
+static void
+kvp_frame_slots_to_stream(sixtp_stream *s, const kvp_frame *frame)
+{
+    GList *keys = NULL, *iter;
+
+    kvp_frame_for_each_slot((kvp_frame*)frame, collect_kvp_key, &keys);
+    keys = g_list_sort(keys, (GCompareFunc)strcmp);
+    for (iter = keys; iter; iter = iter->next)
+    {
+        sixtp_stream_open(s, "slot");
+        text_child_to_stream(s, "slot:key", iter->data);
+        kvp_value_to_stream(s, "slot:value",
+                            kvp_frame_get_slot(frame, iter->data));
+        sixtp_stream_close(s, "slot");
+    }
+    g_list_free(keys);
+}
+
+void
+kvp_frame_to_stream(sixtp_stream *s, const char *tag, const kvp_frame *frame)
+{
+    if (!frame || kvp_frame_get_slot_count(frame) == 0)
+        return;
+
+    sixtp_stream_open(s, tag);
+    kvp_frame_slots_to_stream(s, frame);
+    sixtp_stream_close(s, tag);
+}
@@ -0,0 +1,68 @@
+/********************************************************************
+ * sixtp-stream-generators.h                                        *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+ ********************************************************************/
+
+#ifndef SIXTP_STREAM_GENERATORS_H
+#define SIXTP_STREAM_GENERATORS_H
+
+#include <glib.h>
+#include <stdio.h>
+
+#include "gnc-commodity.h"
+#include "qof.h"
+
+/* A sixtp_stream writes XML straight into a large buffer instead of
+ * building a DOM tree.  Its output is byte for byte what xmlElemDump()
+ * prints for the tree the matching *_to_dom_tree() generator would
+ * build, followed by a newline, so the two can be mixed in one file.
+ *
+ * Elements hold either text or child elements, never both, as is true
+ * of everything the v2 format writes.
+ */
+typedef struct sixtp_stream sixtp_stream;
+
+sixtp_stream *sixtp_stream_new(FILE *out);
+/* Write out the buffer.  Returns FALSE if any write so far failed. */
+gboolean sixtp_stream_flush(sixtp_stream *s);
+/* Flush and free the stream, returning what sixtp_stream_flush() did. */
+gboolean sixtp_stream_destroy(sixtp_stream *s);
+
+/* Start an element; it is left open for attributes. */
+void sixtp_stream_open(sixtp_stream *s, const char *tag);
+void sixtp_stream_attr(sixtp_stream *s, const char *name, const char *value);
+/* Add text to the open element, escaping it.  Like xmlNewTextChild(),
+ * empty text still gives <tag></tag> rather than <tag/>. */
+void sixtp_stream_text(sixtp_stream *s, const char *text);
+void sixtp_stream_close(sixtp_stream *s, const char *tag);
+
+/* <tag>text</tag>, the same as xmlNewTextChild(). */
+void text_child_to_stream(sixtp_stream *s, const char *tag, const char *text);
+void guid_to_stream(sixtp_stream *s, const char *tag, const GncGUID *gid);
+void commodity_ref_to_stream(sixtp_stream *s, const char *tag,
+                             const gnc_commodity *c);
+void timespec_to_stream(sixtp_stream *s, const char *tag, const Timespec *spec);
+void gdate_to_stream(sixtp_stream *s, const char *tag, const GDate *date);
+void gnc_numeric_to_stream(sixtp_stream *s, const char *tag,
+                           const gnc_numeric *num);
+void kvp_frame_to_stream(sixtp_stream *s, const char *tag,
+                         const kvp_frame *frame);
+
+#endif /* SIXTP_STREAM_GENERATORS_H */
@@ -295,6 +295,8 @@ sixtp_destroy(sixtp *sp)
     GHashTable *corpses;
     g_return_if_fail(sp);
     corpses = g_hash_table_new(g_direct_hash, g_direct_equal);
+    /* sp may be among its own children, as DOM parsers are */
+    g_hash_table_insert(corpses, sp, (gpointer) 1);
     sixtp_destroy_node(sp, corpses);
     g_hash_table_destroy(corpses);
 }
@@ -778,10 +780,22 @@ sixtp_parse_fd(sixtp *sixtp,
                gpointer data_for_top_level,
                gpointer global_data,
                gpointer *parse_result)
+{
+    return sixtp_parse_io(sixtp, sixtp_parser_read, fd, data_for_top_level,
+                          global_data, parse_result);
+}
+
+gboolean
+sixtp_parse_io(sixtp *sixtp,
+               xmlInputReadCallback read_func,
+               gpointer read_data,
+               gpointer data_for_top_level,
+               gpointer global_data,
+               gpointer *parse_result)
 {
     gboolean ret;
-    xmlParserCtxtPtr context = xmlCreateIOParserCtxt( NULL, NULL, 
-                                                     sixtp_parser_read, NULL /*no close */, fd, 
+    xmlParserCtxtPtr context = xmlCreateIOParserCtxt( NULL, NULL,
+                                                     read_func, NULL /*no close */, read_data,
                                                      XML_CHAR_ENCODING_NONE);
     ret = sixtp_parse_file_common(sixtp, context, data_for_top_level,
                                   global_data, parse_result);
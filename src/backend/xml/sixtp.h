@@ -188,6 +188,9 @@ gboolean sixtp_parse_file(sixtp *sixtp, const char *filename,
 gboolean sixtp_parse_fd(sixtp *sixtp, FILE *fd,
                         gpointer data_for_top_level, gpointer global_data,
                         gpointer *parse_result);
+gboolean sixtp_parse_io(sixtp *sixtp, xmlInputReadCallback read_func,
+                        gpointer read_data, gpointer data_for_top_level,
+                        gpointer global_data, gpointer *parse_result);
 gboolean sixtp_parse_buffer(sixtp *sixtp, char *bufp, int bufsz,
                             gpointer data_for_top_level, gpointer global_data,
                             gpointer *parse_result);
@@ -27,6 +27,7 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <sys/types.h>
@@ -42,6 +43,8 @@
 #include "../sixtp-dom-parsers.h"
 #include <TransLog.h>
 #include "../io-gncxml-gen.h"
+#include "../io-gncxml-v2.h"
+#include "../io-gncxml-cache.h"
 
 #include <test-stuff.h>
 #include <test-engine-stuff.h>
@@ -336,6 +339,50 @@ really_get_rid_of_transaction(Transaction *trn)
     xaccTransCommitEdit(trn);
 }
 
+static gchar *
+read_whole_file(FILE *f, long *len)
+{
+    gchar *buf;
+
+    fflush(f);
+    *len = ftell(f);
+    buf = g_malloc(*len + 1);
+    rewind(f);
+    *len = fread(buf, 1, *len, f);
+    return buf;
+}
+
+/* Streaming a transaction must give exactly what dumping its DOM tree
+ * does. */
+static gboolean
+stream_and_dom_tree_equal(Transaction *trn, xmlNodePtr node)
+{
+    FILE *dom_file = tmpfile();
+    FILE *stream_file = tmpfile();
+    sixtp_stream *stream;
+    gchar *dom_text, *stream_text;
+    long dom_len, stream_len;
+    gboolean equal;
+
+    xmlElemDump(dom_file, NULL, node);
+    fprintf(dom_file, "\n");
+
+    stream = sixtp_stream_new(stream_file);
+    gnc_transaction_to_stream(stream, trn);
+    sixtp_stream_destroy(stream);
+
+    dom_text = read_whole_file(dom_file, &dom_len);
+    stream_text = read_whole_file(stream_file, &stream_len);
+    equal = (dom_len == stream_len &&
+             memcmp(dom_text, stream_text, dom_len) == 0);
+
+    g_free(dom_text);
+    g_free(stream_text);
+    fclose(dom_file);
+    fclose(stream_file);
+    return equal;
+}
+
 struct tran_data_struct
 {
     Transaction *trn;
@@ -440,6 +487,10 @@ test_transaction(void)
             success_args("transaction_xml", __FILE__, __LINE__, "%d", i );
         }
 
+        do_test_args(stream_and_dom_tree_equal(ran_trn, test_node),
+                     "gnc_transaction_to_stream", __FILE__, __LINE__,
+                     "%d", i);
+
         filename1 = g_strdup_printf("test_file_XXXXXX");
 
         fd = g_mkstemp(filename1);
@@ -498,6 +549,222 @@ test_transaction(void)
     }
 }
 
+/* A random transaction whose splits are in accounts of the book, as a
+ * journal is replayed against those. */
+static Transaction *
+get_journal_transaction(void)
+{
+    Transaction *trn = get_random_transaction(book);
+    gnc_commodity *com = get_random_commodity(book);
+    GList *list, *node;
+
+    if (!trn)
+        return NULL;
+
+    list = g_list_copy(xaccTransGetSplitList(trn));
+    for (node = list; node; node = node->next)
+    {
+        Split *s = node->data;
+        Account *a = xaccMallocAccount(book);
+
+        xaccAccountBeginEdit(a);
+        xaccAccountSetCommodity(a, com);
+        xaccAccountSetCommoditySCU(a, xaccSplitGetAmount(s).denom);
+        xaccAccountInsertSplit(a, s);
+        xaccAccountCommitEdit(a);
+    }
+    g_list_free(list);
+    return trn;
+}
+
+static void
+set_description(Transaction *trn, const char *desc)
+{
+    xaccTransBeginEdit(trn);
+    xaccTransSetDescription(trn, desc);
+    xaccTransCommitEdit(trn);
+}
+
+static void
+test_journal(void)
+{
+    Transaction *changed, *deleted;
+    GncGUID changed_guid, deleted_guid, snapshot, other_snapshot;
+    GList *guids;
+    gchar *filename, *contents;
+    gsize length;
+    gboolean torn;
+    guint n_batches;
+    int fd;
+
+    changed = get_journal_transaction();
+    deleted = get_journal_transaction();
+    if (!changed || !deleted)
+    {
+        failure_args("journal", __FILE__, __LINE__,
+                     "get_random_transaction returned NULL");
+        return;
+    }
+    changed_guid = *xaccTransGetGUID(changed);
+    deleted_guid = *xaccTransGetGUID(deleted);
+
+    filename = g_strdup("test_journal_XXXXXX");
+    fd = g_mkstemp(filename);
+    close(fd);
+
+    guid_new(&snapshot);
+    guid_new(&other_snapshot);
+    do_test(gnc_xml_journal_create(filename, &snapshot),
+            "gnc_xml_journal_create");
+    do_test(gnc_xml_journal_matches(filename, &snapshot),
+            "journal matches its data file");
+    do_test(!gnc_xml_journal_matches(filename, &other_snapshot),
+            "journal doesn't match another data file");
+
+    set_description(changed, "journaled");
+    guids = g_list_prepend(NULL, &deleted_guid);
+    guids = g_list_prepend(guids, &changed_guid);
+    do_test(gnc_xml_journal_append(book, filename, guids),
+            "append changed transactions");
+    g_list_free(guids);
+
+    really_get_rid_of_transaction(deleted);
+    guids = g_list_prepend(NULL, &deleted_guid);
+    do_test(gnc_xml_journal_append(book, filename, guids),
+            "append a deleted transaction");
+    g_list_free(guids);
+
+    /* A batch cut short by a crash must be skipped */
+    set_description(changed, "unfinished");
+    guids = g_list_prepend(NULL, &changed_guid);
+    do_test(gnc_xml_journal_append(book, filename, guids),
+            "append an unfinished batch");
+    g_list_free(guids);
+    if (g_file_get_contents(filename, &contents, &length, NULL))
+    {
+        g_file_set_contents(filename, contents, length - 4, NULL);
+        g_free(contents);
+    }
+
+    set_description(changed, "reverted");
+    do_test(gnc_xml_journal_replay(book, filename, &torn, &n_batches),
+            "gnc_xml_journal_replay");
+    do_test(torn, "unfinished batch noticed");
+    do_test(n_batches == 2, "finished batches counted");
+
+    /* The replay replaced the transaction */
+    changed = xaccTransLookup(&changed_guid, book);
+    do_test(changed != NULL
+            && g_strcmp0(xaccTransGetDescription(changed), "journaled") == 0,
+            "changed transaction replayed");
+    do_test(xaccTransLookup(&deleted_guid, book) == NULL,
+            "deleted transaction replayed");
+
+    if (changed)
+        really_get_rid_of_transaction(changed);
+    g_unlink(filename);
+    g_free(filename);
+}
+
+/* A transaction written to the cache comes back out of it unchanged.  It
+ * gets a book of its own, since the cache holds every transaction in the
+ * book's account tree. */
+static void
+test_cache(void)
+{
+    QofBook *cache_book = qof_book_new();
+    Account *root = gnc_book_get_root_account(cache_book);
+    gnc_commodity *com = get_random_commodity(cache_book);
+    Transaction *trn, *cached;
+    GncXmlCache *cache;
+    GncGUID guid, snapshot, other_snapshot, cached_guid;
+    xmlNodePtr test_node;
+    GList *list, *node;
+    gchar *filename, *contents;
+    gchar *msg;
+    gsize length;
+    int fd;
+
+    trn = get_random_transaction(cache_book);
+    if (!trn)
+    {
+        failure_args("cache", __FILE__, __LINE__,
+                     "get_random_transaction returned NULL");
+        qof_book_destroy(cache_book);
+        return;
+    }
+
+    list = g_list_copy(xaccTransGetSplitList(trn));
+    for (node = list; node; node = node->next)
+    {
+        Split *s = node->data;
+        Account *a = xaccMallocAccount(cache_book);
+
+        xaccAccountBeginEdit(a);
+        xaccAccountSetCommodity(a, com);
+        xaccAccountSetCommoditySCU(a, xaccSplitGetAmount(s).denom);
+        gnc_account_append_child(root, a);
+        xaccAccountInsertSplit(a, s);
+        xaccAccountCommitEdit(a);
+    }
+    g_list_free(list);
+
+    guid = *xaccTransGetGUID(trn);
+    test_node = gnc_transaction_dom_tree_create(trn);
+
+    filename = g_strdup("test_cache_XXXXXX");
+    fd = g_mkstemp(filename);
+    close(fd);
+
+    guid_new(&snapshot);
+    guid_new(&other_snapshot);
+    do_test(gnc_xml_cache_write(cache_book, filename, &snapshot),
+            "gnc_xml_cache_write");
+    do_test(gnc_xml_cache_open(filename, &other_snapshot) == NULL,
+            "cache doesn't open for another data file");
+
+    really_get_rid_of_transaction(trn);
+    cache = gnc_xml_cache_open(filename, &snapshot);
+    do_test(cache != NULL, "gnc_xml_cache_open");
+    if (cache)
+    {
+        do_test(gnc_xml_cache_get_n_transactions(cache) == 1,
+                "cache holds the transaction");
+        do_test(gnc_xml_cache_get_transaction_guid(cache, 0, &cached_guid)
+                && guid_equal(&cached_guid, &guid)
+                && !gnc_xml_cache_get_transaction_guid(cache, 1,
+                        &cached_guid),
+                "gnc_xml_cache_get_transaction_guid");
+        cached = gnc_xml_cache_get_transaction(cache, 0, cache_book);
+        do_test(cached != NULL
+                && guid_equal(xaccTransGetGUID(cached), &guid),
+                "gnc_xml_cache_get_transaction");
+        if (cached)
+        {
+            msg = node_and_transaction_equal(test_node, cached);
+            do_test_args(msg == NULL, "cached transaction",
+                         __FILE__, __LINE__, msg);
+            really_get_rid_of_transaction(cached);
+        }
+        gnc_xml_cache_close(cache);
+    }
+
+    /* The checksum keeps a damaged cache from being used */
+    if (g_file_get_contents(filename, &contents, &length, NULL))
+    {
+        contents[length - 1] ^= 0xff;
+        g_file_set_contents(filename, contents, length, NULL);
+        g_free(contents);
+    }
+    do_test(gnc_xml_cache_open(filename, &snapshot) == NULL,
+            "damaged cache isn't opened");
+
+    xmlFreeNode(test_node);
+    g_unlink(filename);
+    g_free(filename);
+    qof_book_destroy(cache_book);
+}
+
 static gboolean
 test_real_transaction(const char *tag, gpointer global_data, gpointer data)
 {
@@ -531,6 +798,8 @@ main (int argc, char ** argv)
     else
     {
         test_transaction();
+        test_journal();
+        test_cache();
     }
 
     print_test_results();
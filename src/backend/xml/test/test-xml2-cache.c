@@ -0,0 +1,364 @@
+/***************************************************************************
+ *            test-xml2-cache.c
+ *
+ *  Test loading version-2 gnucash XML files through the binary cache of
+ *  their transactions.
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <cashobjects.h>
+#include <TransLog.h>
+#include <gnc-engine.h>
+#include <gnc-prefs.h>
+#include <gnc-uri-utils.h>
+#include "../io-gncxml-v2.h"
+
+#include <test-stuff.h>
+
+#define GNC_LIB_NAME "gncmod-backend-xml"
+#define FILENAME     "test-xml2-cache.xac"
+#define CACHE        FILENAME GNC_CACHEFILE_EXT
+#define N_TRANS      20
+
+/* FILENAME in the current directory, for the session */
+static gchar *book_path = NULL;
+
+/* Remove the data file and everything the backend put next to it */
+static void
+remove_files(void)
+{
+    GDir *dir = g_dir_open(".", 0, NULL);
+    const gchar *entry;
+
+    if (!dir)
+        return;
+    while ((entry = g_dir_read_name(dir)) != NULL)
+        if (g_str_has_prefix(entry, FILENAME))
+            g_unlink(entry);
+    g_dir_close(dir);
+}
+
+/* The books are only read, so several sessions may have the file open */
+static QofSession *
+open_session(gboolean create, gboolean cached)
+{
+    QofSession *session = qof_session_new();
+
+    gnc_prefs_set_file_binary_cache(cached);
+    qof_session_begin(session, book_path, TRUE, create, TRUE);
+    if (!create)
+        qof_session_load(session, NULL);
+    return session;
+}
+
+static void
+close_session(QofSession *session)
+{
+    qof_session_end(session);
+    qof_session_destroy(session);
+}
+
+static guint
+count_transactions(QofSession *session)
+{
+    return qof_collection_count(
+               qof_book_get_collection(qof_session_get_book(session),
+                                       GNC_ID_TRANS));
+}
+
+static Account *
+make_account(QofBook *book, Account *parent, gnc_commodity *currency,
+             const char *name)
+{
+    Account *acc = xaccMallocAccount(book);
+
+    xaccAccountBeginEdit(acc);
+    xaccAccountSetName(acc, name);
+    xaccAccountSetType(acc, ACCT_TYPE_BANK);
+    xaccAccountSetCommodity(acc, currency);
+    gnc_account_append_child(parent, acc);
+    xaccAccountCommitEdit(acc);
+    return acc;
+}
+
+static Split *
+make_split(QofBook *book, Transaction *trans, Account *acc, gint64 amount)
+{
+    Split *split = xaccMallocSplit(book);
+    gnc_numeric value = gnc_numeric_create(amount, 100);
+
+    xaccSplitSetParent(split, trans);
+    xaccSplitSetAccount(split, acc);
+    xaccSplitSetAmount(split, value);
+    xaccSplitSetValue(split, value);
+    return split;
+}
+
+/* A transaction with something in each field the cache holds */
+static void
+make_transaction(QofBook *book, Account *from, Account *to, int i)
+{
+    gnc_commodity *currency = xaccAccountGetCommodity(from);
+    Transaction *trans = xaccMallocTransaction(book);
+    time64 now = gnc_time(NULL);
+    gchar *str;
+    Split *split;
+
+    xaccTransBeginEdit(trans);
+    xaccTransSetCurrency(trans, currency);
+    xaccTransSetDatePostedSecs(trans, now - i * 86400);
+    str = g_strdup_printf("transaction %d", i);
+    xaccTransSetDescription(trans, str);
+    g_free(str);
+    str = g_strdup_printf("%d", i);
+    xaccTransSetNum(trans, str);
+    g_free(str);
+    if (i % 2)
+        xaccTransSetNotes(trans, "notes");
+
+    split = make_split(book, trans, from, -100 * (i + 1));
+    xaccSplitSetMemo(split, "memo");
+    xaccSplitSetAction(split, "action");
+    if (i % 3 == 0)
+    {
+        xaccSplitSetReconcile(split, YREC);
+        xaccSplitSetDateReconciledSecs(split, now);
+    }
+    make_split(book, trans, to, 100 * (i + 1));
+    xaccTransCommitEdit(trans);
+}
+
+static void
+fill_book(QofBook *book)
+{
+    gnc_commodity *currency =
+        gnc_commodity_table_lookup(gnc_commodity_table_get_table(book),
+                                   GNC_COMMODITY_NS_CURRENCY, "USD");
+    Account *root = gnc_book_get_root_account(book);
+    Account *from = make_account(book, root, currency, "from");
+    Account *to = make_account(book, root, currency, "to");
+    int i;
+
+    for (i = 0; i < N_TRANS; i++)
+        make_transaction(book, from, to, i);
+}
+
+static void
+compare_transaction(QofInstance *inst, gpointer data)
+{
+    Transaction *ta = (Transaction *) inst, *tb;
+    QofBook *book = data;
+    GList *node;
+
+    tb = xaccTransLookup(xaccTransGetGUID(ta), book);
+    if (!tb)
+    {
+        failure_args("cached transaction", __FILE__, __LINE__,
+                     "%s missing", xaccTransGetDescription(ta));
+        return;
+    }
+    if (!xaccTransEqual(ta, tb, TRUE, TRUE, FALSE, FALSE))
+    {
+        failure_args("cached transaction", __FILE__, __LINE__,
+                     "%s differs", xaccTransGetDescription(ta));
+        return;
+    }
+    for (node = xaccTransGetSplitList(ta); node; node = node->next)
+    {
+        Split *sb = xaccSplitLookup(xaccSplitGetGUID(node->data), book);
+
+        if (!sb || !guid_equal(
+                    xaccAccountGetGUID(xaccSplitGetAccount(node->data)),
+                    xaccAccountGetGUID(xaccSplitGetAccount(sb))))
+        {
+            failure_args("cached split", __FILE__, __LINE__,
+                         "split of %s in the wrong account",
+                         xaccTransGetDescription(ta));
+            return;
+        }
+    }
+    success("cached transaction");
+}
+
+/* Load with whatever cache there is, which mustn't keep the book from
+ * loading whole */
+static void
+check_cached_load(const char *what, gboolean dropped)
+{
+    QofSession *session = open_session(FALSE, TRUE);
+
+    do_test_args(qof_session_get_error(session) == ERR_BACKEND_NO_ERR
+                 && count_transactions(session) == N_TRANS,
+                 "load with a cache", __FILE__, __LINE__, "%s", what);
+    close_session(session);
+    do_test_args(g_file_test(CACHE, G_FILE_TEST_EXISTS) != dropped,
+                 "cache dropped", __FILE__, __LINE__, "%s", what);
+}
+
+/* Caches that are intact but for other transactions than the file's are
+ * dropped, and the XML parsed instead */
+static void
+test_mismatch(void)
+{
+    QofSession *session;
+    QofBook *book;
+    Account *from, *to;
+    Transaction *trans;
+    GncGUID snapshot, other;
+
+    do_test(gnc_xml_read_snapshot_id(FILENAME, &snapshot),
+            "data file has a snapshot id");
+
+    session = open_session(FALSE, FALSE);
+    book = qof_session_get_book(session);
+    from = gnc_account_lookup_by_name(gnc_book_get_root_account(book),
+                                      "from");
+    to = gnc_account_lookup_by_name(gnc_book_get_root_account(book), "to");
+    trans = xaccSplitGetParent(xaccAccountGetSplitList(from)->data);
+    xaccTransBeginEdit(trans);
+    xaccTransDestroy(trans);
+    xaccTransCommitEdit(trans);
+
+    do_test(gnc_xml_cache_write(book, CACHE, &snapshot),
+            "write a cache short of a transaction");
+    check_cached_load("short cache", TRUE);
+
+    /* As many transactions as the file, but not the same */
+    make_transaction(book, from, to, N_TRANS);
+    do_test(gnc_xml_cache_write(book, CACHE, &snapshot),
+            "write a cache with another transaction");
+    check_cached_load("cache with another transaction", TRUE);
+
+    /* A cache for another snapshot of the file isn't even opened */
+    guid_new(&other);
+    do_test(gnc_xml_cache_write(book, CACHE, &other),
+            "write a cache for another snapshot");
+    check_cached_load("cache for another snapshot", FALSE);
+
+    close_session(session);
+    g_unlink(CACHE);
+}
+
+/* The cache doesn't hold template transactions, so books that have
+ * them get none */
+static void
+test_template(void)
+{
+    QofSession *session;
+    QofBook *book;
+    gnc_commodity *currency;
+    Transaction *trans;
+    Account *acc;
+    guint n_trans;
+
+    session = open_session(FALSE, TRUE);
+    book = qof_session_get_book(session);
+    currency = gnc_commodity_table_lookup(gnc_commodity_table_get_table(book),
+                                          GNC_COMMODITY_NS_CURRENCY, "USD");
+    acc = make_account(book, gnc_book_get_template_root(book), currency,
+                       "template");
+    trans = xaccMallocTransaction(book);
+    xaccTransBeginEdit(trans);
+    xaccTransSetCurrency(trans, currency);
+    xaccTransSetDescription(trans, "template");
+    make_split(book, trans, acc, 100);
+    xaccTransCommitEdit(trans);
+    n_trans = count_transactions(session);
+    qof_session_save(session, NULL);
+    close_session(session);
+    do_test(!g_file_test(CACHE, G_FILE_TEST_EXISTS),
+            "no cache for a book with template transactions");
+
+    session = open_session(FALSE, TRUE);
+    do_test(qof_session_get_error(session) == ERR_BACKEND_NO_ERR
+            && count_transactions(session) == n_trans,
+            "load a book with template transactions");
+    close_session(session);
+}
+
+static void
+test_cache(void)
+{
+    QofSession *session, *cached;
+
+    remove_files();
+
+    session = open_session(TRUE, TRUE);
+    fill_book(qof_session_get_book(session));
+    qof_session_save(session, NULL);
+    close_session(session);
+    do_test(g_file_test(CACHE, G_FILE_TEST_EXISTS), "cache written");
+
+    /* The transactions built from the cache are those parsed from the
+     * XML */
+    session = open_session(FALSE, FALSE);
+    cached = open_session(FALSE, TRUE);
+    do_test(qof_session_get_error(session) == ERR_BACKEND_NO_ERR,
+            "load from the XML");
+    do_test(qof_session_get_error(cached) == ERR_BACKEND_NO_ERR,
+            "load from the cache");
+    do_test(count_transactions(session) == N_TRANS
+            && count_transactions(cached) == N_TRANS,
+            "all transactions loaded");
+    qof_collection_foreach(
+        qof_book_get_collection(qof_session_get_book(session), GNC_ID_TRANS),
+        compare_transaction, qof_session_get_book(cached));
+    do_test(!qof_book_session_not_saved(qof_session_get_book(cached)),
+            "book loaded from the cache is clean");
+    close_session(cached);
+    close_session(session);
+    do_test(g_file_test(CACHE, G_FILE_TEST_EXISTS),
+            "cache that matches the file kept");
+
+    test_mismatch();
+    test_template();
+
+    remove_files();
+}
+
+int
+main (int argc, char ** argv)
+{
+    gchar *cwd;
+
+    qof_init();
+    cashobjects_register();
+    do_test(qof_load_backend_library ("../.libs/", GNC_LIB_NAME),
+            " loading gnc-backend-xml GModule failed");
+    xaccLogDisable();
+    /* The cache is only written with the data file */
+    gnc_prefs_set_file_save_journaled(FALSE);
+
+    cwd = g_get_current_dir();
+    book_path = g_build_filename(cwd, FILENAME, NULL);
+    g_free(cwd);
+
+    test_cache();
+
+    g_free(book_path);
+
+    print_test_results();
+    qof_close();
+    exit(get_rv());
+}
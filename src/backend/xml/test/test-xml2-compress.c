@@ -0,0 +1,207 @@
+/***************************************************************************
+ *            test-xml2-compress.c
+ *
+ *  Test the parallel compression of version-2 gnucash XML files.
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <zlib.h>
+
+#include <cashobjects.h>
+#include <TransLog.h>
+#include <gnc-engine.h>
+#include <gnc-prefs.h>
+#include "../io-gncxml-v2.h"
+
+#include <test-stuff.h>
+#include <test-engine-stuff.h>
+
+#define GNC_LIB_NAME "gncmod-backend-xml"
+/* The writer wants a book with a backend, which a session opened on
+ * this file gives it; the file itself is never written. */
+#define BOOK_FILE    "test-xml2-compress-book.xac"
+
+/* The size of the blocks the compressor deflates in parallel */
+#define BLOCK_SIZE (128 * 1024)
+#define THREADS    4
+
+static gchar *
+read_gzip(const char *filename, gsize *len)
+{
+    GString *out = g_string_new(NULL);
+    gchar buffer[4096];
+    gzFile file;
+    gint bytes;
+
+    file = gzopen(filename, "rb");
+    if (!file)
+    {
+        g_string_free(out, TRUE);
+        return NULL;
+    }
+    while ((bytes = gzread(file, buffer, sizeof(buffer))) > 0)
+        g_string_append_len(out, buffer, bytes);
+    if (gzclose(file) != Z_OK || bytes < 0)
+    {
+        g_string_free(out, TRUE);
+        return NULL;
+    }
+    *len = out->len;
+    return g_string_free(out, FALSE);
+}
+
+static guint32
+get_le32(const guchar *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32)p[3] << 24);
+}
+
+/* Load the file through the backend, which reads it through gunzip */
+static gboolean
+load_file(const char *filename, guint *n_trans)
+{
+    QofSession *session = qof_session_new();
+    gboolean ok;
+
+    qof_session_begin(session, filename, TRUE, FALSE, TRUE);
+    qof_session_load(session, NULL);
+    ok = (qof_session_get_error(session) == ERR_BACKEND_NO_ERR);
+    if (n_trans)
+        *n_trans = qof_collection_count(
+                       qof_book_get_collection(qof_session_get_book(session),
+                                               GNC_ID_TRANS));
+    qof_session_end(session);
+    qof_session_destroy(session);
+    return ok;
+}
+
+static void
+test_compress_book(QofBook *book, const char *what, gboolean small)
+{
+    const char *plain = "test-xml2-compress.xac";
+    const char *gz = "test-xml2-compress-gz.xac";
+    gchar *expected = NULL, *contents = NULL, *gz_contents = NULL;
+    gsize expected_len, len, gz_len;
+    guint n_trans;
+
+    do_test_args(gnc_book_write_to_xml_file_v2(book, plain, FALSE),
+                 "write uncompressed", __FILE__, __LINE__, "%s", what);
+    do_test_args(gnc_book_write_to_xml_file_v2(book, gz, TRUE),
+                 "write compressed", __FILE__, __LINE__, "%s", what);
+    if (!g_file_get_contents(plain, &expected, &expected_len, NULL) ||
+            !g_file_get_contents(gz, &gz_contents, &gz_len, NULL) ||
+            gz_len < 18)
+    {
+        failure_args("read files", __FILE__, __LINE__, "%s", what);
+        goto cleanup;
+    }
+    if (small)
+        do_test_args(expected_len < BLOCK_SIZE, "small file", __FILE__,
+                     __LINE__, "%s is %d bytes", what, (int)expected_len);
+    else
+        do_test_args(expected_len > THREADS * BLOCK_SIZE, "large file",
+                     __FILE__, __LINE__, "%s is %d bytes", what,
+                     (int)expected_len);
+
+    /* The trailer has to match the content */
+    do_test_args(get_le32((guchar*)gz_contents + gz_len - 8) ==
+                 crc32(crc32(0L, Z_NULL, 0), (guchar*)expected, expected_len),
+                 "gzip crc", __FILE__, __LINE__, "%s", what);
+    do_test_args(get_le32((guchar*)gz_contents + gz_len - 4) ==
+                 (guint32)expected_len,
+                 "gzip size", __FILE__, __LINE__, "%s", what);
+
+    contents = read_gzip(gz, &len);
+    do_test_args(contents && len == expected_len &&
+                 memcmp(contents, expected, len) == 0,
+                 "gunzip content", __FILE__, __LINE__, "%s", what);
+
+    do_test_args(load_file(gz, &n_trans) &&
+                 n_trans == qof_collection_count(
+                     qof_book_get_collection(book, GNC_ID_TRANS)),
+                 "load compressed", __FILE__, __LINE__, "%s", what);
+
+    /* A file whose CRC doesn't match mustn't load */
+    gz_contents[gz_len - 8] ^= 0xff;
+    if (g_file_set_contents(gz, gz_contents, gz_len, NULL))
+        do_test_args(!load_file(gz, NULL), "load with a bad crc",
+                     __FILE__, __LINE__, "%s", what);
+
+cleanup:
+    g_free(expected);
+    g_free(contents);
+    g_free(gz_contents);
+    g_unlink(plain);
+    g_unlink(gz);
+}
+
+/* A session for a new book */
+static QofSession *
+new_session(void)
+{
+    QofSession *session = qof_session_new();
+
+    qof_session_begin(session, BOOK_FILE, TRUE, TRUE, TRUE);
+    do_test(qof_session_get_error(session) == ERR_BACKEND_NO_ERR,
+            "session begin");
+    return session;
+}
+
+static void
+end_session(QofSession *session)
+{
+    qof_session_end(session);
+    qof_session_destroy(session);
+}
+
+int
+main (int argc, char ** argv)
+{
+    QofSession *session;
+    QofBook *book;
+
+    qof_init();
+    cashobjects_register();
+    do_test(qof_load_backend_library ("../.libs/", GNC_LIB_NAME),
+            " loading gnc-backend-xml GModule failed");
+    xaccLogDisable();
+    gnc_prefs_set_file_compression_threads(THREADS);
+
+    /* Less than one block */
+    session = new_session();
+    test_compress_book(qof_session_get_book(session), "an empty book", TRUE);
+    end_session(session);
+
+    /* Several blocks for each thread */
+    session = new_session();
+    book = qof_session_get_book(session);
+    get_random_account_tree(book);
+    get_random_pricedb(book);
+    add_random_transactions_to_book(book, 2000);
+    test_compress_book(book, "a random book", FALSE);
+    end_session(session);
+
+    print_test_results();
+    qof_close();
+    exit(get_rv());
+}
@@ -0,0 +1,280 @@
+/***************************************************************************
+ *            test-xml2-journal.c
+ *
+ *  Test saving version-2 gnucash XML files through the journal.
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <utime.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <cashobjects.h>
+#include <TransLog.h>
+#include <gnc-engine.h>
+#include <gnc-prefs.h>
+#include <gnc-uri-utils.h>
+#include "../io-gncxml-v2.h"
+
+#include <test-stuff.h>
+
+#define GNC_LIB_NAME "gncmod-backend-xml"
+#define FILENAME     "test-xml2-journal.xac"
+#define JOURNAL      FILENAME GNC_JOURNALFILE_EXT
+
+/* FILENAME in the current directory, for the session */
+static gchar *book_path = NULL;
+
+/* Remove the data file and everything the backend put next to it */
+static void
+remove_files(void)
+{
+    GDir *dir = g_dir_open(".", 0, NULL);
+    const gchar *entry;
+
+    if (!dir)
+        return;
+    while ((entry = g_dir_read_name(dir)) != NULL)
+        if (g_str_has_prefix(entry, FILENAME))
+            g_unlink(entry);
+    g_dir_close(dir);
+}
+
+static gboolean
+aside_journal_exists(void)
+{
+    GDir *dir = g_dir_open(".", 0, NULL);
+    const gchar *entry;
+    gboolean found = FALSE;
+
+    if (!dir)
+        return FALSE;
+    while ((entry = g_dir_read_name(dir)) != NULL)
+        if (g_str_has_prefix(entry, FILENAME ".")
+                && g_str_has_suffix(entry, GNC_JOURNALFILE_EXT)
+                && g_strcmp0(entry, JOURNAL) != 0)
+            found = TRUE;
+    g_dir_close(dir);
+    return found;
+}
+
+static gint64
+file_size(const char *filename)
+{
+    struct stat statbuf;
+
+    if (g_stat(filename, &statbuf) != 0)
+        return -1;
+    return statbuf.st_size;
+}
+
+static QofSession *
+open_session(gboolean create)
+{
+    QofSession *session = qof_session_new();
+
+    qof_session_begin(session, book_path, FALSE, create, TRUE);
+    if (!create)
+        qof_session_load(session, NULL);
+    do_test_args(qof_session_get_error(session) == ERR_BACKEND_NO_ERR,
+                 "open session", __FILE__, __LINE__, "error %d",
+                 qof_session_get_error(session));
+    return session;
+}
+
+static void
+close_session(QofSession *session)
+{
+    qof_session_end(session);
+    qof_session_destroy(session);
+}
+
+static Account *
+make_account(QofBook *book, gnc_commodity *currency, const char *name)
+{
+    Account *acc = xaccMallocAccount(book);
+
+    xaccAccountBeginEdit(acc);
+    xaccAccountSetName(acc, name);
+    xaccAccountSetType(acc, ACCT_TYPE_BANK);
+    xaccAccountSetCommodity(acc, currency);
+    gnc_account_append_child(gnc_book_get_root_account(book), acc);
+    xaccAccountCommitEdit(acc);
+    return acc;
+}
+
+static Transaction *
+make_transaction(QofBook *book)
+{
+    gnc_commodity *currency =
+        gnc_commodity_table_lookup(gnc_commodity_table_get_table(book),
+                                   GNC_COMMODITY_NS_CURRENCY, "USD");
+    Account *from = make_account(book, currency, "from");
+    Account *to = make_account(book, currency, "to");
+    gnc_numeric amount = gnc_numeric_create(100, 1);
+    Transaction *trans = xaccMallocTransaction(book);
+    Split *split;
+
+    xaccTransBeginEdit(trans);
+    xaccTransSetCurrency(trans, currency);
+    xaccTransSetDatePostedSecs(trans, gnc_time(NULL));
+    xaccTransSetDescription(trans, "saved in full");
+
+    split = xaccMallocSplit(book);
+    xaccSplitSetParent(split, trans);
+    xaccSplitSetAccount(split, from);
+    xaccSplitSetAmount(split, gnc_numeric_neg(amount));
+    xaccSplitSetValue(split, gnc_numeric_neg(amount));
+
+    split = xaccMallocSplit(book);
+    xaccSplitSetParent(split, trans);
+    xaccSplitSetAccount(split, to);
+    xaccSplitSetAmount(split, amount);
+    xaccSplitSetValue(split, amount);
+    xaccTransCommitEdit(trans);
+    return trans;
+}
+
+static const char *
+get_description(QofSession *session, const GncGUID *guid)
+{
+    Transaction *trans = xaccTransLookup(guid, qof_session_get_book(session));
+
+    return trans ? xaccTransGetDescription(trans) : NULL;
+}
+
+static void
+set_description(QofSession *session, const GncGUID *guid, const char *desc)
+{
+    Transaction *trans = xaccTransLookup(guid, qof_session_get_book(session));
+
+    xaccTransBeginEdit(trans);
+    xaccTransSetDescription(trans, desc);
+    xaccTransCommitEdit(trans);
+}
+
+/* Copying, syncing or touching the data file must not part it from its
+ * journal. */
+static void
+touch_data_file(void)
+{
+    struct stat statbuf;
+    struct utimbuf times;
+
+    if (g_stat(FILENAME, &statbuf) != 0)
+        return;
+    times.actime = statbuf.st_atime;
+    times.modtime = statbuf.st_mtime + 100;
+    g_utime(FILENAME, &times);
+}
+
+static void
+test_journal(void)
+{
+    QofSession *session;
+    GncGUID guid, snapshot, snapshot2;
+    gint64 header_size, size;
+
+    remove_files();
+
+    /* The first save writes the data file in full */
+    session = open_session(TRUE);
+    guid = *xaccTransGetGUID(make_transaction(qof_session_get_book(session)));
+    qof_session_save(session, NULL);
+    do_test(gnc_xml_read_snapshot_id(FILENAME, &snapshot),
+            "data file has a snapshot id");
+    do_test(gnc_is_xml_data_file_v2(FILENAME, NULL) == GNC_BOOK_XML2_FILE,
+            "data file with a snapshot id is still recognized");
+    do_test(gnc_xml_journal_matches(JOURNAL, &snapshot),
+            "journal started for the data file");
+    header_size = file_size(JOURNAL);
+
+    /* The next one only appends to the journal */
+    set_description(session, &guid, "journaled");
+    qof_session_save(session, NULL);
+    do_test(file_size(JOURNAL) > header_size, "change saved in the journal");
+    do_test(gnc_xml_read_snapshot_id(FILENAME, &snapshot2)
+            && guid_equal(&snapshot, &snapshot2),
+            "data file not written again");
+    close_session(session);
+
+    /* Loading replays the journal, even on a touched data file, and has
+     * the next save compact it */
+    touch_data_file();
+    session = open_session(FALSE);
+    do_test(g_strcmp0(get_description(session, &guid), "journaled") == 0,
+            "journal replayed");
+    do_test(!aside_journal_exists(), "journal not set aside");
+    do_test(qof_book_session_not_saved(qof_session_get_book(session)),
+            "book changed by the journal is dirty");
+    qof_session_save(session, NULL);
+    do_test(gnc_xml_read_snapshot_id(FILENAME, &snapshot2)
+            && !guid_equal(&snapshot, &snapshot2),
+            "data file written in full");
+    size = file_size(JOURNAL);
+    do_test(size > 0 && size <= header_size, "journal compacted");
+    close_session(session);
+
+    session = open_session(FALSE);
+    do_test(g_strcmp0(get_description(session, &guid), "journaled") == 0,
+            "compacted change kept");
+    do_test(!qof_book_session_not_saved(qof_session_get_book(session)),
+            "book with an empty journal is clean");
+    close_session(session);
+
+    /* A journal for another data file is set aside, and the book left
+     * dirty so that it gets saved in full */
+    guid_new(&snapshot);
+    gnc_xml_journal_create(JOURNAL, &snapshot);
+    session = open_session(FALSE);
+    do_test(aside_journal_exists(), "foreign journal set aside");
+    do_test(qof_book_session_not_saved(qof_session_get_book(session)),
+            "book with a foreign journal is dirty");
+    close_session(session);
+
+    remove_files();
+}
+
+int
+main (int argc, char ** argv)
+{
+    gchar *cwd;
+
+    qof_init();
+    cashobjects_register();
+    do_test(qof_load_backend_library ("../.libs/", GNC_LIB_NAME),
+            " loading gnc-backend-xml GModule failed");
+    xaccLogDisable();
+    gnc_prefs_set_file_save_journaled(TRUE);
+
+    cwd = g_get_current_dir();
+    book_path = g_build_filename(cwd, FILENAME, NULL);
+    g_free(cwd);
+
+    test_journal();
+
+    g_free(book_path);
+
+    print_test_results();
+    qof_close();
+    exit(get_rv());
+}
@@ -32,6 +32,10 @@ static gchar *namespace_regexp    = NULL;
 static gboolean is_debugging      = FALSE;
 static gboolean extras_enabled    = FALSE;
 static gboolean use_compression   = TRUE; // This is also the default in the prefs backend
+static gint compression_threads   = 1;    // This is also the default in the prefs backend
+static gint compression_level     = 6;    // This is also the default in the prefs backend
+static gboolean use_journal       = FALSE; // This is also the default in the prefs backend
+static gboolean use_binary_cache  = FALSE; // This is also the default in the prefs backend
 static gint file_retention_policy = 1;    // 1 = "days", the default in the prefs backend
 static gint file_retention_days   = 30;   // This is also the default in the prefs backend
 
@@ -92,6 +96,54 @@ gnc_prefs_set_file_save_compressed(gboolean compressed)
     use_compression = compressed;
 }
 
+gint
+gnc_prefs_get_file_compression_threads(void)
+{
+    return compression_threads;
+}
+
+void
+gnc_prefs_set_file_compression_threads(gint threads)
+{
+    compression_threads = threads;
+}
+
+gint
+gnc_prefs_get_file_compression_level(void)
+{
+    return compression_level;
+}
+
+void
+gnc_prefs_set_file_compression_level(gint level)
+{
+    compression_level = level;
+}
+
+gboolean
+gnc_prefs_get_file_save_journaled(void)
+{
+    return use_journal;
+}
+
+void
+gnc_prefs_set_file_save_journaled(gboolean journaled)
+{
+    use_journal = journaled;
+}
+
+gboolean
+gnc_prefs_get_file_binary_cache(void)
+{
+    return use_binary_cache;
+}
+
+void
+gnc_prefs_set_file_binary_cache(gboolean cached)
+{
+    use_binary_cache = cached;
+}
+
 gint
 gnc_prefs_get_file_retention_policy(void)
 {
@@ -106,6 +106,24 @@ void gnc_prefs_set_extra(gboolean enabled);
 gboolean gnc_prefs_get_file_save_compressed(void);
 void gnc_prefs_set_file_save_compressed(gboolean compressed);
 
+/* How many threads compress a data file; 0 means one per processor. */
+gint gnc_prefs_get_file_compression_threads(void);
+void gnc_prefs_set_file_compression_threads(gint threads);
+
+/* The gzip level, 1 (fastest) to 9 (smallest), data files are saved with. */
+gint gnc_prefs_get_file_compression_level(void);
+void gnc_prefs_set_file_compression_level(gint level);
+
+/* Whether saves append the changed transactions to a journal next to
+ * the data file instead of rewriting it. */
+gboolean gnc_prefs_get_file_save_journaled(void);
+void gnc_prefs_set_file_save_journaled(gboolean journaled);
+
+/* Whether saves also write the transactions to a binary cache next to
+ * the data file, which loading then reads instead of their XML. */
+gboolean gnc_prefs_get_file_binary_cache(void);
+void gnc_prefs_set_file_binary_cache(gboolean cached);
+
 gint gnc_prefs_get_file_retention_policy(void);
 void gnc_prefs_set_file_retention_policy(gint policy);
 
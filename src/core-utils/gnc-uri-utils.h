@@ -41,6 +41,8 @@
 
 #define GNC_DATAFILE_EXT ".gnucash"
 #define GNC_LOGFILE_EXT  ".log"
+#define GNC_JOURNALFILE_EXT ".journal"
+#define GNC_CACHEFILE_EXT ".cache"
 
 /** Converts a uri in separate components.
  *
@@ -38,7 +38,9 @@
 #include "gnc-glib-utils.h"
 #include "gnc-lot.h"
 #include "gnc-pricedb.h"
+#include "gnc-pricedb-p.h"
 #include "qofinstance-p.h"
+#include "qofquerycore-p.h"
 
 static QofLogModule log_module = GNC_MOD_ACCOUNT;
 
@@ -233,6 +235,362 @@ mark_account (Account *acc)
     qof_instance_set_dirty(&acc->inst);
 }
 
+/********************************************************************\
+ * The split index.  priv->split_index holds the nodes of priv->splits
+ * in xaccSplitOrder, so a split can be placed with a binary search
+ * and then linked into the list next to its neighbour.
+\********************************************************************/
+
+static gint
+split_node_order (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    return xaccSplitOrder (((const GList*)a)->data, ((const GList*)b)->data);
+}
+
+/* For sorting a GPtrArray of split nodes */
+static gint
+split_node_ptr_order (gconstpointer a, gconstpointer b)
+{
+    return split_node_order (*(GList* const*)a, *(GList* const*)b, NULL);
+}
+
+/* How the split lists have been put back in order, for
+ * gnc_account_get_split_sort_counts */
+static guint split_full_sorts = 0;
+static guint split_merges = 0;
+static guint split_repositions = 0;
+
+/* Forget the cached subtree balances of the account and all of its
+ * ancestors, as a balance somewhere below them has changed. */
+static void
+account_invalidate_subtree_balances (AccountPrivate *priv)
+{
+    while (priv)
+    {
+        if (priv->subtree_balances)
+            g_hash_table_remove_all (priv->subtree_balances);
+        priv = priv->parent ? GET_PRIVATE(priv->parent) : NULL;
+    }
+}
+
+/* Note that the running balances are stale from position pos in the
+ * split list on.  A negative pos means all of them are. */
+static void
+account_set_balance_dirty_from (AccountPrivate *priv, gint pos)
+{
+    account_invalidate_subtree_balances (priv);
+    if (pos < 0)
+        priv->balance_dirty_pos = -1;
+    else if (!priv->balance_dirty)
+        priv->balance_dirty_pos = pos;
+    else if (priv->balance_dirty_pos > pos)
+        priv->balance_dirty_pos = pos;
+    priv->balance_dirty = TRUE;
+}
+
+/* Link a detached list node into priv->splits and the index.  If sorted
+ * is FALSE the node goes to the front, as the list used to be prepended
+ * to while the account was open for editing. */
+static GSequenceIter *
+account_link_split_node (AccountPrivate *priv, GList *node, gboolean sorted)
+{
+    GSequenceIter *iter;
+
+    if (sorted)
+        iter = g_sequence_insert_sorted (priv->split_index, node,
+                                         split_node_order, NULL);
+    else
+        iter = g_sequence_prepend (priv->split_index, node);
+
+    if (g_sequence_iter_is_begin (iter))
+    {
+        node->prev = NULL;
+        node->next = priv->splits;
+        if (priv->splits)
+            priv->splits->prev = node;
+        priv->splits = node;
+    }
+    else
+    {
+        GList *prev = g_sequence_get (g_sequence_iter_prev (iter));
+        node->prev = prev;
+        node->next = prev->next;
+        if (prev->next)
+            prev->next->prev = node;
+        prev->next = node;
+    }
+    g_hash_table_insert (priv->split_iters, node->data, iter);
+    return iter;
+}
+
+/* Take the split's node out of priv->splits and the index, returning
+ * it still allocated so that it can be linked in again.  If pos isn't
+ * NULL it is set to the position the split had. */
+static GList *
+account_unlink_split_node (AccountPrivate *priv, Split *s, gint *pos)
+{
+    GSequenceIter *iter;
+    GList *node;
+
+    iter = g_hash_table_lookup (priv->split_iters, s);
+    if (!iter)
+        return NULL;
+
+    if (pos)
+        *pos = g_sequence_iter_get_position (iter);
+    node = g_sequence_get (iter);
+    g_sequence_remove (iter);
+    g_hash_table_remove (priv->split_iters, s);
+    priv->splits = g_list_remove_link (priv->splits, node);
+    return node;
+}
+
+static void
+account_clear_splits (AccountPrivate *priv)
+{
+    g_sequence_remove_range (g_sequence_get_begin_iter (priv->split_index),
+                             g_sequence_get_end_iter (priv->split_index));
+    g_hash_table_remove_all (priv->split_iters);
+    g_hash_table_remove_all (priv->moved_splits);
+    g_list_free (priv->splits);
+    priv->splits = NULL;
+    g_array_set_size (priv->posted_dates, 0);
+}
+
+/* Rebuild priv->splits from the index after the index was sorted. */
+static void
+account_relink_split_nodes (AccountPrivate *priv)
+{
+    GSequenceIter *iter;
+    GList *prev = NULL;
+
+    priv->splits = NULL;
+    for (iter = g_sequence_get_begin_iter (priv->split_index);
+            !g_sequence_iter_is_end (iter);
+            iter = g_sequence_iter_next (iter))
+    {
+        GList *node = g_sequence_get (iter);
+        node->prev = prev;
+        node->next = NULL;
+        if (prev)
+            prev->next = node;
+        else
+            priv->splits = node;
+        prev = node;
+    }
+}
+
+/* Move only the splits in priv->moved_splits to their proper place.
+ * They're all taken out first so that the binary searches only ever
+ * look at splits which are known to be in order.  Returns the first
+ * position in the list that was disturbed, or -1 if none was. */
+static gint
+account_reposition_moved_splits (AccountPrivate *priv)
+{
+    GHashTableIter hiter;
+    gpointer key;
+    GList *detached = NULL, *lp;
+    gint first = G_MAXINT, pos;
+
+    g_hash_table_iter_init (&hiter, priv->moved_splits);
+    while (g_hash_table_iter_next (&hiter, &key, NULL))
+    {
+        GList *node = account_unlink_split_node (priv, key, &pos);
+        if (!node)
+            continue;
+        detached = g_list_prepend (detached, node);
+        first = MIN (first, pos);
+    }
+
+    for (lp = detached; lp; lp = lp->next)
+    {
+        GSequenceIter *iter = account_link_split_node (priv, lp->data, TRUE);
+        first = MIN (first, g_sequence_iter_get_position (iter));
+    }
+    g_list_free (detached);
+    return first == G_MAXINT ? -1 : first;
+}
+
+/* Take the moved splits out of the index, sort them by themselves and
+ * merge them back into the rest, which is still in order, with a
+ * single walk over the index.  Returns the position of the first split
+ * that moved, or -1 if none did. */
+static gint
+account_merge_moved_splits (AccountPrivate *priv)
+{
+    GHashTableIter hiter;
+    gpointer key;
+    GPtrArray *pending;
+    GSequenceIter *iter;
+    gint first = G_MAXINT;
+    guint i;
+
+    pending = g_ptr_array_sized_new (g_hash_table_size (priv->moved_splits));
+    g_hash_table_iter_init (&hiter, priv->moved_splits);
+    while (g_hash_table_iter_next (&hiter, &key, NULL))
+    {
+        iter = g_hash_table_lookup (priv->split_iters, key);
+        if (!iter)
+            continue;
+        first = MIN (first, g_sequence_iter_get_position (iter));
+        g_ptr_array_add (pending, g_sequence_get (iter));
+        g_sequence_remove (iter);
+    }
+    g_ptr_array_sort (pending, split_node_ptr_order);
+
+    iter = g_sequence_get_begin_iter (priv->split_index);
+    for (i = 0; i < pending->len; i++)
+    {
+        GList *node = g_ptr_array_index (pending, i);
+        GSequenceIter *new_iter;
+
+        while (!g_sequence_iter_is_end (iter) &&
+                split_node_order (g_sequence_get (iter), node, NULL) <= 0)
+            iter = g_sequence_iter_next (iter);
+        new_iter = g_sequence_insert_before (iter, node);
+        g_hash_table_insert (priv->split_iters, node->data, new_iter);
+        if (i == 0)
+            first = MIN (first, g_sequence_iter_get_position (new_iter));
+    }
+    g_ptr_array_free (pending, TRUE);
+
+    account_relink_split_nodes (priv);
+    return first == G_MAXINT ? -1 : first;
+}
+
+/********************************************************************\
+ * The name and code indexes.  Each book keeps two hash tables, from
+ * account name and from account code to the list of accounts of the
+ * book carrying it, so that the lookup functions don't have to walk
+ * the account tree.  Empty names and codes are not indexed.
+\********************************************************************/
+
+#define ACCOUNT_NAME_INDEX "gnc-account-name-index"
+#define ACCOUNT_CODE_INDEX "gnc-account-code-index"
+
+static void
+account_index_destroy (QofBook *book, gpointer key, gpointer index)
+{
+    /* The accounts are freed after the book's finalizers have run, so
+     * make sure they don't find the index any more. */
+    qof_book_set_data (book, key, NULL);
+    g_hash_table_destroy (index);
+}
+
+static void
+account_index_add (Account *acc, const char *key, const char *value)
+{
+    QofBook *book;
+    GHashTable *index;
+    GList *accounts;
+
+    if (!value || !*value)
+        return;
+    book = qof_instance_get_book (acc);
+    if (!book || qof_book_shutting_down (book))
+        return;
+
+    index = qof_book_get_data (book, key);
+    if (!index)
+    {
+        index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                       (GDestroyNotify) g_list_free);
+        qof_book_set_data_fin (book, key, index, account_index_destroy);
+    }
+    accounts = g_hash_table_lookup (index, value);
+    if (accounts)
+        accounts = g_list_append (accounts, acc);
+    else
+        g_hash_table_insert (index, g_strdup (value),
+                             g_list_prepend (NULL, acc));
+}
+
+static void
+account_index_remove (Account *acc, const char *key, const char *value)
+{
+    QofBook *book;
+    GHashTable *index;
+    gpointer orig_key, accounts;
+
+    if (!value || !*value)
+        return;
+    book = qof_instance_get_book (acc);
+    if (!book || qof_book_shutting_down (book))
+        return;
+    index = qof_book_get_data (book, key);
+    if (!index || !g_hash_table_lookup_extended (index, value,
+            &orig_key, &accounts))
+        return;
+
+    /* Take the list out of the table so that it doesn't get freed when
+     * its head is replaced. */
+    g_hash_table_steal (index, value);
+    accounts = g_list_remove (accounts, acc);
+    if (accounts)
+        g_hash_table_insert (index, orig_key, accounts);
+    else
+        g_free (orig_key);
+}
+
+static void
+account_index_add_all (Account *acc)
+{
+    AccountPrivate *priv = GET_PRIVATE(acc);
+    account_index_add (acc, ACCOUNT_NAME_INDEX, priv->accountName);
+    account_index_add (acc, ACCOUNT_CODE_INDEX, priv->accountCode);
+}
+
+static void
+account_index_remove_all (Account *acc)
+{
+    AccountPrivate *priv = GET_PRIVATE(acc);
+    account_index_remove (acc, ACCOUNT_NAME_INDEX, priv->accountName);
+    account_index_remove (acc, ACCOUNT_CODE_INDEX, priv->accountCode);
+}
+
+/* Get the accounts of the book of acc indexed under value.  Returns
+ * FALSE if the index can't be used, because the value isn't indexed
+ * or the book hasn't got an index yet. */
+static gboolean
+account_index_lookup (const Account *acc, const char *key, const char *value,
+                      GList **accounts)
+{
+    GHashTable *index;
+
+    if (!value || !*value)
+        return FALSE;
+    index = qof_book_get_data (qof_instance_get_book (acc), key);
+    if (!index)
+        return FALSE;
+    *accounts = g_hash_table_lookup (index, value);
+    return TRUE;
+}
+
+/* Find the descendant of parent indexed under value.  Returns FALSE if
+ * the tree has to be walked instead: when the index can't be used, or
+ * when there is more than one such descendant and only the walk knows
+ * which of them comes first. */
+static gboolean
+account_index_find (const Account *parent, const char *key,
+                    const char *value, Account **found)
+{
+    GList *accounts, *node;
+
+    *found = NULL;
+    if (!account_index_lookup (parent, key, value, &accounts))
+        return FALSE;
+    for (node = accounts; node; node = node->next)
+    {
+        Account *acc = node->data;
+        if (acc == parent || !xaccAccountHasAncestor (acc, parent))
+            continue;
+        if (*found)
+            return FALSE;
+        *found = acc;
+    }
+    return TRUE;
+}
+
 /********************************************************************\
 \********************************************************************/
 
@@ -270,9 +628,15 @@ gnc_account_init(Account* acc)
     priv->starting_cleared_balance = gnc_numeric_zero();
     priv->starting_reconciled_balance = gnc_numeric_zero();
     priv->balance_dirty = FALSE;
+    priv->balance_dirty_pos = -1;
+    priv->posted_dates = g_array_new (FALSE, FALSE, sizeof (time64));
 
     priv->splits = NULL;
+    priv->split_index = g_sequence_new (NULL);
+    priv->split_iters = g_hash_table_new (g_direct_hash, g_direct_equal);
+    priv->moved_splits = g_hash_table_new (g_direct_hash, g_direct_equal);
     priv->sort_dirty = FALSE;
+    priv->sort_all = FALSE;
 }
 
 static void
@@ -284,6 +648,19 @@ gnc_account_dispose (GObject *acctp)
 static void
 gnc_account_finalize(GObject* acctp)
 {
+    AccountPrivate *priv = GET_PRIVATE(acctp);
+
+    /* The sequence doesn't own its data, those are the nodes of
+     * priv->splits. */
+    g_sequence_free (priv->split_index);
+    g_hash_table_destroy (priv->split_iters);
+    g_hash_table_destroy (priv->moved_splits);
+    g_list_free (priv->splits);
+    priv->splits = NULL;
+    g_array_free (priv->posted_dates, TRUE);
+    if (priv->subtree_balances)
+        g_hash_table_destroy (priv->subtree_balances);
+
     G_OBJECT_CLASS(gnc_account_parent_class)->finalize(acctp);
 }
 
@@ -1134,6 +1511,7 @@ xaccCloneAccount(const Account *from, QofBook *book)
     priv->accountName = CACHE_INSERT(from_priv->accountName);
     priv->accountCode = CACHE_INSERT(from_priv->accountCode);
     priv->description = CACHE_INSERT(from_priv->description);
+    account_index_add_all (ret);
 
     kvp_frame_delete(ret->inst.kvp_data);
     ret->inst.kvp_data = kvp_frame_copy(from->inst.kvp_data);
@@ -1197,6 +1575,12 @@ xaccFreeAccount (Account *acc)
     priv = GET_PRIVATE(acc);
     qof_event_gen (&acc->inst, QOF_EVENT_DESTROY, NULL);
 
+    if (priv->subtree_balances)
+    {
+        g_hash_table_destroy (priv->subtree_balances);
+        priv->subtree_balances = NULL;
+    }
+
     if (priv->children)
     {
         PERR (" instead of calling xaccFreeAccount(), please call \n"
@@ -1246,6 +1630,7 @@ xaccFreeAccount (Account *acc)
 */
     }
 
+    account_index_remove_all (acc);
     CACHE_REPLACE(priv->accountName, NULL);
     CACHE_REPLACE(priv->accountCode, NULL);
     CACHE_REPLACE(priv->description, NULL);
@@ -1266,6 +1651,7 @@ xaccFreeAccount (Account *acc)
 
     priv->balance_dirty = FALSE;
     priv->sort_dirty = FALSE;
+    priv->sort_all = FALSE;
 
     /* qof_instance_release (&acc->inst); */
     g_object_unref(acc);
@@ -1357,8 +1743,7 @@ xaccAccountCommitEdit (Account *acc)
         }
         else
         {
-            g_list_free(priv->splits);
-            priv->splits = NULL;
+            account_clear_splits (priv);
         }
 
         /* It turns out there's a case where this assertion does not hold:
@@ -1696,6 +2081,43 @@ gnc_account_set_sort_dirty (Account *acc)
 
     priv = GET_PRIVATE(acc);
     priv->sort_dirty = TRUE;
+    priv->sort_all = TRUE;
+}
+
+void
+gnc_account_set_split_sort_dirty (Account *acc, Split *s)
+{
+    AccountPrivate *priv;
+    Transaction *trans;
+    GList *node;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    g_return_if_fail(GNC_IS_SPLIT(s));
+
+    if (qof_instance_get_destroying(acc))
+        return;
+
+    priv = GET_PRIVATE(acc);
+    priv->sort_dirty = TRUE;
+    if (priv->sort_all)
+        return;
+
+    /* The sort key includes the transaction's fields, so the other
+     * splits of the transaction in this account may have moved too. */
+    trans = xaccSplitGetParent (s);
+    if (!trans)
+    {
+        g_hash_table_insert (priv->moved_splits, s, s);
+        return;
+    }
+    for (node = xaccTransGetSplitList (trans); node; node = node->next)
+    {
+        Split *split = node->data;
+        if (xaccSplitGetAccount (split) == acc)
+            g_hash_table_insert (priv->moved_splits, split, split);
+    }
+    /* s might not be in the transaction's list any more */
+    g_hash_table_insert (priv->moved_splits, s, s);
 }
 
 void
@@ -1709,7 +2131,34 @@ gnc_account_set_balance_dirty (Account *acc)
         return;
 
     priv = GET_PRIVATE(acc);
-    priv->balance_dirty = TRUE;
+    account_set_balance_dirty_from (priv, -1);
+}
+
+void
+gnc_account_set_split_balance_dirty (Account *acc, Split *s)
+{
+    AccountPrivate *priv;
+    GSequenceIter *iter;
+    gint pos;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    g_return_if_fail(GNC_IS_SPLIT(s));
+
+    if (qof_instance_get_destroying(acc))
+        return;
+
+    priv = GET_PRIVATE(acc);
+    /* No need to look for s if everything is dirty already */
+    if (priv->balance_dirty && priv->balance_dirty_pos < 0)
+    {
+        pos = -1;
+    }
+    else
+    {
+        iter = g_hash_table_lookup (priv->split_iters, s);
+        pos = iter ? g_sequence_iter_get_position (iter) : -1;
+    }
+    account_set_balance_dirty_from (priv, pos);
 }
 
 /********************************************************************\
@@ -1719,24 +2168,43 @@ gboolean
 gnc_account_insert_split (Account *acc, Split *s)
 {
     AccountPrivate *priv;
+    GSequenceIter *iter;
     GList *node;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
     g_return_val_if_fail(GNC_IS_SPLIT(s), FALSE);
 
     priv = GET_PRIVATE(acc);
-    node = g_list_find(priv->splits, s);
-    if (node)
+    if (g_hash_table_lookup (priv->split_iters, s))
         return FALSE;
 
-    if (qof_instance_get_editlevel(acc) == 0)
+    node = g_list_alloc ();
+    node->data = s;
+
+    /* While the book is being loaded just collect the splits; they are
+     * sorted and balanced once in account_bulk_load_end and nobody is
+     * listening for the events. */
+    if (qof_book_is_bulk_loading (qof_instance_get_book (acc)))
+    {
+        account_link_split_node (priv, node, FALSE);
+        priv->sort_dirty = TRUE;
+        priv->sort_all = TRUE;
+        account_set_balance_dirty_from (priv, -1);
+        return TRUE;
+    }
+
+    /* A binary insert needs the index to be in order, which it isn't
+     * while moved splits are waiting to be put back in place; then the
+     * new split waits with them. */
+    if (qof_instance_get_editlevel(acc) == 0 && !priv->sort_all &&
+            g_hash_table_size (priv->moved_splits) == 0)
     {
-        priv->splits = g_list_insert_sorted(priv->splits, s,
-                                            (GCompareFunc)xaccSplitOrder);
+        iter = account_link_split_node (priv, node, TRUE);
     }
     else
     {
-        priv->splits = g_list_prepend(priv->splits, s);
+        iter = account_link_split_node (priv, node, FALSE);
+        g_hash_table_insert (priv->moved_splits, s, s);
         priv->sort_dirty = TRUE;
     }
 
@@ -1745,7 +2213,7 @@ gnc_account_insert_split (Account *acc, Split *s)
     /* Also send an event based on the account */
     qof_event_gen(&acc->inst, GNC_EVENT_ITEM_ADDED, s);
 
-    priv->balance_dirty = TRUE;
+    account_set_balance_dirty_from (priv, g_sequence_iter_get_position (iter));
 //  DRH: Should the below be added? It is present in the delete path.
 //  xaccAccountRecomputeBalance(acc);
     return TRUE;
@@ -1756,22 +2224,24 @@ gnc_account_remove_split (Account *acc, Split *s)
 {
     AccountPrivate *priv;
     GList *node;
+    gint pos;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
     g_return_val_if_fail(GNC_IS_SPLIT(s), FALSE);
 
     priv = GET_PRIVATE(acc);
-    node = g_list_find(priv->splits, s);
+    node = account_unlink_split_node (priv, s, &pos);
     if (NULL == node)
         return FALSE;
 
-    priv->splits = g_list_delete_link(priv->splits, node);
+    g_list_free_1 (node);
+    g_hash_table_remove (priv->moved_splits, s);
     //FIXME: find better event type
     qof_event_gen(&acc->inst, QOF_EVENT_MODIFY, NULL);
     // And send the account-based event, too
     qof_event_gen(&acc->inst, GNC_EVENT_ITEM_REMOVED, s);
 
-    priv->balance_dirty = TRUE;
+    account_set_balance_dirty_from (priv, pos);
     xaccAccountRecomputeBalance(acc);
     return TRUE;
 }
@@ -1780,15 +2250,58 @@ void
 xaccAccountSortSplits (Account *acc, gboolean force)
 {
     AccountPrivate *priv;
+    guint n_moved, n_splits;
 
     g_return_if_fail(GNC_IS_ACCOUNT(acc));
 
     priv = GET_PRIVATE(acc);
-    if (!priv->sort_dirty || (!force && qof_instance_get_editlevel(acc) > 0))
+    if (!priv->sort_dirty)
+        return;
+    if (!force && (qof_instance_get_editlevel(acc) > 0 ||
+                   qof_book_is_bulk_loading (qof_instance_get_book (acc))))
         return;
-    priv->splits = g_list_sort(priv->splits, (GCompareFunc)xaccSplitOrder);
+
+    /* Only the moved splits can be out of order, unless sort_all is
+     * set.  Repositioning k of them one by one costs O(k log n); once
+     * that gets near n, sort them on their own and merge them back in
+     * one pass instead. */
+    n_moved = g_hash_table_size (priv->moved_splits);
+    n_splits = g_hash_table_size (priv->split_iters);
+    if (priv->sort_all)
+    {
+        g_sequence_sort (priv->split_index, split_node_order, NULL);
+        account_relink_split_nodes (priv);
+        account_set_balance_dirty_from (priv, -1);
+        split_full_sorts++;
+    }
+    else if (n_moved > 0)
+    {
+        gint first;
+        if (n_moved * g_bit_storage (n_splits) > n_splits)
+        {
+            first = account_merge_moved_splits (priv);
+            split_merges++;
+        }
+        else
+        {
+            first = account_reposition_moved_splits (priv);
+            split_repositions++;
+        }
+        if (first >= 0)
+            account_set_balance_dirty_from (priv, first);
+    }
+    g_hash_table_remove_all (priv->moved_splits);
     priv->sort_dirty = FALSE;
-    priv->balance_dirty = TRUE;
+    priv->sort_all = FALSE;
+}
+
+void
+gnc_account_get_split_sort_counts (guint *full_sorts, guint *merges,
+                                   guint *repositions)
+{
+    if (full_sorts) *full_sorts = split_full_sorts;
+    if (merges) *merges = split_merges;
+    if (repositions) *repositions = split_repositions;
 }
 
 static void
@@ -2061,6 +2574,7 @@ xaccAccountRecomputeBalance (Account * acc)
     gnc_numeric  cleared_balance;
     gnc_numeric  reconciled_balance;
     GList *lp;
+    gint start;
 
     if (NULL == acc) return;
 
@@ -2069,17 +2583,45 @@ xaccAccountRecomputeBalance (Account * acc)
     if (!priv->balance_dirty) return;
     if (qof_instance_get_destroying(acc)) return;
     if (qof_book_shutting_down(qof_instance_get_book(acc))) return;
+    if (qof_book_is_bulk_loading(qof_instance_get_book(acc))) return;
 
     balance            = priv->starting_balance;
     cleared_balance    = priv->starting_cleared_balance;
     reconciled_balance = priv->starting_reconciled_balance;
+    lp = priv->splits;
+    start = 0;
+
+    /* Only the splits from balance_dirty_pos on have changed, so pick
+     * up the running balances of the split just before it. */
+    if (priv->balance_dirty_pos > 0 && priv->splits)
+    {
+        GList *prev;
+        Split *split;
+
+        start = MIN (priv->balance_dirty_pos,
+                     g_sequence_get_length (priv->split_index));
+        prev = g_sequence_get (g_sequence_get_iter_at_pos (priv->split_index,
+                               start - 1));
+        split = (Split *) prev->data;
+
+        balance            = split->balance;
+        cleared_balance    = split->cleared_balance;
+        reconciled_balance = split->reconciled_balance;
+        lp = prev->next;
+    }
+    g_array_set_size (priv->posted_dates, start);
 
     PINFO ("acct=%s starting baln=%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT,
            priv->accountName, balance.num, balance.denom);
-    for (lp = priv->splits; lp; lp = lp->next)
+    for (; lp; lp = lp->next)
     {
         Split *split = (Split *) lp->data;
         gnc_numeric amt = xaccSplitGetAmount (split);
+        /* Splits without a transaction sort last */
+        time64 posted = split->parent ? xaccTransGetDate (split->parent)
+                        : G_MAXINT64;
+
+        g_array_append_val (priv->posted_dates, posted);
 
         balance = gnc_numeric_add_fixed(balance, amt);
 
@@ -2105,6 +2647,8 @@ xaccAccountRecomputeBalance (Account * acc)
     priv->cleared_balance = cleared_balance;
     priv->reconciled_balance = reconciled_balance;
     priv->balance_dirty = FALSE;
+    priv->balance_dirty_pos = -1;
+    account_invalidate_subtree_balances (priv);
 }
 
 /********************************************************************\
@@ -2219,7 +2763,8 @@ xaccAccountSetType (Account *acc, GNCAccountType tip)
 
     xaccAccountBeginEdit(acc);
     priv->type = tip;
-    priv->balance_dirty = TRUE; /* new type may affect balance computation */
+    /* new type may affect balance computation */
+    account_set_balance_dirty_from (priv, -1);
     mark_account(acc);
     xaccAccountCommitEdit(acc);
 }
@@ -2239,7 +2784,9 @@ xaccAccountSetName (Account *acc, const char *str)
         return;
 
     xaccAccountBeginEdit(acc);
+    account_index_remove (acc, ACCOUNT_NAME_INDEX, priv->accountName);
     CACHE_REPLACE(priv->accountName, str);
+    account_index_add (acc, ACCOUNT_NAME_INDEX, priv->accountName);
     mark_account (acc);
     xaccAccountCommitEdit(acc);
 }
@@ -2258,7 +2805,9 @@ xaccAccountSetCode (Account *acc, const char *str)
         return;
 
     xaccAccountBeginEdit(acc);
+    account_index_remove (acc, ACCOUNT_CODE_INDEX, priv->accountCode);
     CACHE_REPLACE(priv->accountCode, str ? str : "");
+    account_index_add (acc, ACCOUNT_CODE_INDEX, priv->accountCode);
     mark_account (acc);
     xaccAccountCommitEdit(acc);
 }
@@ -2418,7 +2967,7 @@ xaccAccountSetCommodity (Account * acc, gnc_commodity * com)
     }
 
     priv->sort_dirty = TRUE;  /* Not needed. */
-    priv->balance_dirty = TRUE;
+    account_set_balance_dirty_from (priv, -1);
     mark_account (acc);
 
     xaccAccountCommitEdit(acc);
@@ -2560,14 +3109,21 @@ gnc_account_append_child (Account *new_parent, Account *child)
             PWARN ("reparenting accounts across books is not correctly supported\n");
 
             qof_event_gen (&child->inst, QOF_EVENT_DESTROY, NULL);
+            /* The indexes are per book, and the book is the instance's,
+             * so the child has to belong to the new book before it is
+             * indexed again. */
+            account_index_remove_all (child);
             col = qof_book_get_collection (qof_instance_get_book(new_parent),
                                            GNC_ID_ACCOUNT);
             qof_collection_insert_entity (col, &child->inst);
+            qof_instance_set_book (child, qof_instance_get_book (new_parent));
+            account_index_add_all (child);
             qof_event_gen (&child->inst, QOF_EVENT_CREATE, NULL);
         }
     }
     cpriv->parent = new_parent;
     ppriv->children = g_list_append(ppriv->children, child);
+    account_invalidate_subtree_balances (ppriv);
     qof_instance_set_dirty(&new_parent->inst);
     qof_instance_set_dirty(&child->inst);
 
@@ -2608,6 +3164,7 @@ gnc_account_remove_child (Account *parent, Account *child)
     ed.idx = g_list_index(ppriv->children, child);
 
     ppriv->children = g_list_remove(ppriv->children, child);
+    account_invalidate_subtree_balances (ppriv);
 
     /* Now send the event. */
     qof_event_gen(&child->inst, QOF_EVENT_REMOVE, &ed);
@@ -2808,6 +3365,9 @@ gnc_account_lookup_by_name (const Account *parent, const char * name)
     g_return_val_if_fail(GNC_IS_ACCOUNT(parent), NULL);
     g_return_val_if_fail(name, NULL);
 
+    if (account_index_find (parent, ACCOUNT_NAME_INDEX, name, &result))
+        return result;
+
     /* first, look for accounts hanging off the current node */
     ppriv = GET_PRIVATE(parent);
     for (node = ppriv->children; node; node = node->next)
@@ -2841,6 +3401,9 @@ gnc_account_lookup_by_code (const Account *parent, const char * code)
     g_return_val_if_fail(GNC_IS_ACCOUNT(parent), NULL);
     g_return_val_if_fail(code, NULL);
 
+    if (account_index_find (parent, ACCOUNT_CODE_INDEX, code, &result))
+        return result;
+
     /* first, look for accounts hanging off the current node */
     ppriv = GET_PRIVATE(parent);
     for (node = ppriv->children; node; node = node->next)
@@ -2909,6 +3472,43 @@ gnc_account_lookup_by_full_name_helper (const Account *parent,
     return NULL;
 }
 
+/* Look up the last of the names in the name index and keep the
+ * accounts whose ancestors carry the other names, up to the root.
+ * Returns FALSE if the tree has to be walked instead. */
+static gboolean
+gnc_account_lookup_by_full_name_index (const Account *root, gchar **names,
+                                       Account **found)
+{
+    GList *accounts, *node;
+    guint depth = g_strv_length (names);
+
+    *found = NULL;
+    if (depth == 0 ||
+        !account_index_lookup (root, ACCOUNT_NAME_INDEX, names[depth - 1],
+                               &accounts))
+        return FALSE;
+
+    for (node = accounts; node; node = node->next)
+    {
+        Account *acc = node->data;
+        const AccountPrivate *priv = GET_PRIVATE(acc);
+        guint level = depth - 1;
+
+        while (level > 0 && priv->parent &&
+               g_strcmp0(GET_PRIVATE(priv->parent)->accountName,
+                         names[level - 1]) == 0)
+        {
+            priv = GET_PRIVATE(priv->parent);
+            level--;
+        }
+        if (level > 0 || priv->parent != root)
+            continue;
+        if (*found)
+            return FALSE;
+        *found = acc;
+    }
+    return TRUE;
+}
 
 Account *
 gnc_account_lookup_by_full_name (const Account *any_acc,
@@ -2930,7 +3530,8 @@ gnc_account_lookup_by_full_name (const Account *any_acc,
         rpriv = GET_PRIVATE(root);
     }
     names = g_strsplit(name, gnc_get_account_separator_string(), -1);
-    found = gnc_account_lookup_by_full_name_helper(root, names);
+    if (!gnc_account_lookup_by_full_name_index(root, names, &found))
+        found = gnc_account_lookup_by_full_name_helper(root, names);
     g_strfreev(names);
     return found;
 }
@@ -3195,7 +3796,7 @@ gnc_account_set_start_balance (Account *acc, const gnc_numeric start_baln)
 
     priv = GET_PRIVATE(acc);
     priv->starting_balance = start_baln;
-    priv->balance_dirty = TRUE;
+    account_set_balance_dirty_from (priv, -1);
 }
 
 void
@@ -3208,7 +3809,7 @@ gnc_account_set_start_cleared_balance (Account *acc,
 
     priv = GET_PRIVATE(acc);
     priv->starting_cleared_balance = start_baln;
-    priv->balance_dirty = TRUE;
+    account_set_balance_dirty_from (priv, -1);
 }
 
 void
@@ -3221,7 +3822,7 @@ gnc_account_set_start_reconciled_balance (Account *acc,
 
     priv = GET_PRIVATE(acc);
     priv->starting_reconciled_balance = start_baln;
-    priv->balance_dirty = TRUE;
+    account_set_balance_dirty_from (priv, -1);
 }
 
 gnc_numeric
@@ -3283,20 +3884,68 @@ xaccAccountGetProjectedMinimumBalance (const Account *acc)
 /********************************************************************\
 \********************************************************************/
 
+/* Index of the first split posted on or after date, searching from
+ * position lo on.  priv->posted_dates must be up to date. */
+static guint
+account_find_split_pos_by_date (const AccountPrivate *priv, time64 date,
+                                guint lo)
+{
+    guint hi = priv->posted_dates->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+        if (g_array_index (priv->posted_dates, time64, mid) < date)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* The balance just before the split at position pos. */
+static gnc_numeric
+account_balance_before_pos (const AccountPrivate *priv, guint pos)
+{
+    GList *node;
+
+    /* AsOf date must be before any entries, return zero. */
+    if (pos == 0)
+        return gnc_numeric_zero();
+    /* No splits posted after the given date, so the latest account
+     * balance is good enough. */
+    if (pos >= priv->posted_dates->len)
+        return priv->balance;
+
+    node = g_sequence_get (g_sequence_get_iter_at_pos (priv->split_index,
+                           pos - 1));
+    return xaccSplitGetBalance ((Split *)node->data);
+}
+
+/* The old way of finding the balance, walking the split list, for
+ * when the balances couldn't be brought up to date (the account is
+ * open for editing). */
+static gnc_numeric
+account_balance_as_of_date_walk (const AccountPrivate *priv, time64 date)
+{
+    GList *lp;
+
+    for (lp = priv->splits; lp; lp = lp->next)
+    {
+        if (xaccTransGetDate (xaccSplitGetParent ((Split *)lp->data)) >= date)
+        {
+            if (lp->prev)
+                return xaccSplitGetBalance ((Split *)lp->prev->data);
+            return gnc_numeric_zero();
+        }
+    }
+    return priv->balance;
+}
+
 gnc_numeric
 xaccAccountGetBalanceAsOfDate (Account *acc, time64 date)
 {
-    /* Ideally this could use xaccAccountForEachSplit, but
-     * it doesn't exist yet and I'm uncertain of exactly how
-     * it would work at this time, since it differs from
-     * xaccAccountForEachTransaction by using gpointer return
-     * values rather than gints.
-     */
     AccountPrivate *priv;
-    GList   *lp;
-    Timespec ts, trans_ts;
-    gboolean found = FALSE;
-    gnc_numeric balance;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), gnc_numeric_zero());
 
@@ -3304,55 +3953,41 @@ xaccAccountGetBalanceAsOfDate (Account *acc, time64 date)
     xaccAccountRecomputeBalance (acc); /* just in case, normally a noop */
 
     priv = GET_PRIVATE(acc);
-    balance = priv->balance;
-
-    /* Since transaction post times are stored as a Timespec,
-     * convert date into a Timespec as well rather than converting
-     * each transaction's Timespec into a time64.
-     *
-     * FIXME: CAS: I think this comment is a bogus justification for
-     * using xaccTransGetDatePostedTS.  There's no benefit to using
-     * Timespec when the input argument is time64, and it's hard to
-     * imagine that casting long long to long and comparing two longs is
-     * worse than comparing two long longs every time.  IMO,
-     * xaccAccountGetPresentBalance gets this right, and its algorithm
-     * should be used here.
-     */
-    ts.tv_sec = date;
-    ts.tv_nsec = 0;
+    if (priv->balance_dirty)
+        return account_balance_as_of_date_walk (priv, date);
 
-    lp = priv->splits;
-    while ( lp && !found )
-    {
-        xaccTransGetDatePostedTS( xaccSplitGetParent( (Split *)lp->data ),
-                                  &trans_ts );
-        if ( timespec_cmp( &trans_ts, &ts ) >= 0 )
-            found = TRUE;
-        else
-            lp = lp->next;
-    }
+    /* The balance as of date is the running balance of the last split
+     * posted before it. */
+    return account_balance_before_pos (
+               priv, account_find_split_pos_by_date (priv, date, 0));
+}
 
-    if ( lp )
+void
+xaccAccountGetBalancesAsOfDates (Account *acc, const time64 *dates,
+                                 guint n_dates, gnc_numeric *balances)
+{
+    AccountPrivate *priv;
+    guint i, pos = 0;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    g_return_if_fail(n_dates == 0 || (dates && balances));
+
+    xaccAccountSortSplits (acc, TRUE);
+    xaccAccountRecomputeBalance (acc);
+
+    priv = GET_PRIVATE(acc);
+    for (i = 0; i < n_dates; i++)
     {
-        if ( lp->prev )
+        if (priv->balance_dirty)
         {
-            /* Since lp is now pointing to a split which was past the reconcile
-             * date, get the running balance of the previous split.
-             */
-            balance = xaccSplitGetBalance( (Split *)lp->prev->data );
-        }
-        else
-        {
-            /* AsOf date must be before any entries, return zero. */
-            balance = gnc_numeric_zero();
+            balances[i] = account_balance_as_of_date_walk (priv, dates[i]);
+            continue;
         }
+        /* The dates are ascending, so each search can start where the
+         * previous one ended. */
+        pos = account_find_split_pos_by_date (priv, dates[i], pos);
+        balances[i] = account_balance_before_pos (priv, pos);
     }
-
-    /* Otherwise there were no splits posted after the given date,
-     * so the latest account balance should be good enough.
-     */
-
-    return( balance );
 }
 
 /*
@@ -3490,58 +4125,227 @@ xaccAccountGetXxxBalanceAsOfDateInCurrency(Account *acc, time64 date,
 }
 
 /*
- * Data structure used to pass various arguments into the following fn.
+ * The kinds of balance whose subtree totals are cached.  Present and
+ * projected minimum balances depend on today's date, so they aren't.
  */
+typedef enum
+{
+    BALANCE_KIND_NONE,
+    BALANCE_KIND_BALANCE,
+    BALANCE_KIND_CLEARED,
+    BALANCE_KIND_RECONCILED,
+    BALANCE_KIND_AS_OF_DATE
+} AccountBalanceKind;
+
+/* An entry of AccountPrivate::subtree_balances; it is its own key. */
 typedef struct
 {
-    const gnc_commodity *currency;
-    gnc_numeric balance;
+    AccountBalanceKind kind;
+    const gnc_commodity *commodity;
+    time64 date;
+    int fraction;               /* of commodity when it was worked out */
+    guint price_changes;        /* of the pricedb used to convert */
+    gnc_numeric own;            /* the account's own converted balance */
+    gnc_numeric balance;        /* own plus the descendants' balances */
+    gboolean exact;             /* all of those are whole multiples of
+                                 * 1/fraction, so nothing was rounded */
+} SubtreeBalance;
+
+/* Report commodities and as-of dates come and go; past this many
+ * entries an account's cache is started over. */
+#define SUBTREE_BALANCE_MAX_ENTRIES 32
+
+static guint
+subtree_balance_hash (gconstpointer key)
+{
+    const SubtreeBalance *sb = key;
+    return g_direct_hash (sb->commodity) ^ (guint) sb->kind ^
+           (guint) (sb->date ^ (sb->date >> 32));
+}
+
+static gboolean
+subtree_balance_equal (gconstpointer a, gconstpointer b)
+{
+    const SubtreeBalance *sa = a, *sb = b;
+    return sa->kind == sb->kind && sa->commodity == sb->commodity &&
+           sa->date == sb->date;
+}
+
+static AccountBalanceKind
+account_balance_kind (xaccGetBalanceFn fn, xaccGetBalanceAsOfDateFn asOfDateFn)
+{
+    if (asOfDateFn)
+        return asOfDateFn == xaccAccountGetBalanceAsOfDate ?
+               BALANCE_KIND_AS_OF_DATE : BALANCE_KIND_NONE;
+    if (fn == xaccAccountGetBalance)
+        return BALANCE_KIND_BALANCE;
+    if (fn == xaccAccountGetClearedBalance)
+        return BALANCE_KIND_CLEARED;
+    if (fn == xaccAccountGetReconciledBalance)
+        return BALANCE_KIND_RECONCILED;
+    return BALANCE_KIND_NONE;
+}
+
+/* What account_get_subtree_balance was asked for */
+typedef struct
+{
+    AccountBalanceKind kind;
     xaccGetBalanceFn fn;
     xaccGetBalanceAsOfDateFn asOfDateFn;
     time64 date;
-} CurrencyBalance;
+    const gnc_commodity *currency;
+    int fraction;
+} SubtreeBalanceQuery;
 
+static gboolean
+subtree_balance_is_exact (gnc_numeric value, int fraction)
+{
+    return !gnc_numeric_check (gnc_numeric_convert (value, fraction,
+                               GNC_HOW_RND_NEVER));
+}
 
-/*
- * A helper function for iterating over all the accounts in a list or
- * tree.  This function is called once per account, and sums up the
- * values of all these accounts.
- */
-static void
-xaccAccountBalanceHelper (Account *acc, gpointer data)
+static gnc_numeric
+subtree_balance_add (gnc_numeric a, gnc_numeric b, int fraction)
 {
-    CurrencyBalance *cb = data;
-    gnc_numeric balance;
+    return gnc_numeric_add (a, b, fraction, GNC_HOW_RND_ROUND_HALF_UP);
+}
 
-    if (!cb->fn || !cb->currency)
-        return;
-    balance = xaccAccountGetXxxBalanceInCurrency (acc, cb->fn, cb->currency);
-    cb->balance = gnc_numeric_add (cb->balance, balance,
-                                   gnc_commodity_get_fraction (cb->currency),
-                                   GNC_HOW_RND_ROUND_HALF_UP);
+static gnc_numeric
+account_get_own_balance (Account *acc, const SubtreeBalanceQuery *q)
+{
+    if (q->asOfDateFn)
+        return xaccAccountGetXxxBalanceAsOfDateInCurrency (
+                   acc, q->date, q->asOfDateFn, q->currency);
+    return xaccAccountGetXxxBalanceInCurrency (acc, q->fn, q->currency);
 }
 
-static void
-xaccAccountBalanceAsOfDateHelper (Account *acc, gpointer data)
+/* Add the balances of acc and its descendants to total one at a time,
+ * in the order gnc_account_foreach_descendant visits them, rounding
+ * after each addition as the running total always has been. */
+static gnc_numeric
+account_add_balances (gnc_numeric total, Account *acc,
+                      const SubtreeBalanceQuery *q)
 {
-    CurrencyBalance *cb = data;
-    gnc_numeric balance;
+    GList *node;
+
+    total = subtree_balance_add (total, account_get_own_balance (acc, q),
+                                 q->fraction);
+    for (node = GET_PRIVATE(acc)->children; node; node = node->next)
+        total = account_add_balances (total, node->data, q);
+    return total;
+}
+
+static const SubtreeBalance *
+account_get_subtree_entry (Account *acc, const SubtreeBalanceQuery *q);
+
+/* The same as account_add_balances, but from the cached entries.  A
+ * subtree that is exact is added as a whole when total is exact too:
+ * then none of the additions round, so their order doesn't matter. */
+static gnc_numeric
+account_add_subtree_balance (gnc_numeric total, Account *acc,
+                             const SubtreeBalanceQuery *q)
+{
+    const SubtreeBalance *entry = account_get_subtree_entry (acc, q);
+    GList *node;
+
+    if (entry->exact && subtree_balance_is_exact (total, q->fraction))
+        return subtree_balance_add (total, entry->balance, q->fraction);
 
-    g_return_if_fail (cb->asOfDateFn && cb->currency);
+    total = subtree_balance_add (total, entry->own, q->fraction);
+    for (node = GET_PRIVATE(acc)->children; node; node = node->next)
+        total = account_add_subtree_balance (total, node->data, q);
+    return total;
+}
+
+/* Find or work out the cached subtree balance of acc for q, which must
+ * be of a kind that is cached. */
+static const SubtreeBalance *
+account_get_subtree_entry (Account *acc, const SubtreeBalanceQuery *q)
+{
+    AccountPrivate *priv = GET_PRIVATE(acc);
+    SubtreeBalance key, *entry;
+    GList *node;
+
+    key.kind = q->kind;
+    key.commodity = q->currency;
+    key.date = q->asOfDateFn ? q->date : 0;
+    key.price_changes = gnc_pricedb_get_change_count (
+                            gnc_pricedb_get_db (gnc_account_get_book (acc)));
+
+    if (priv->subtree_balances)
+    {
+        entry = g_hash_table_lookup (priv->subtree_balances, &key);
+        if (entry && entry->price_changes == key.price_changes &&
+                entry->fraction == q->fraction)
+            return entry;
+    }
 
-    balance = xaccAccountGetXxxBalanceAsOfDateInCurrency (
-                  acc, cb->date, cb->asOfDateFn, cb->currency);
-    cb->balance = gnc_numeric_add (cb->balance, balance,
-                                   gnc_commodity_get_fraction (cb->currency),
-                                   GNC_HOW_RND_ROUND_HALF_UP);
+    entry = g_new (SubtreeBalance, 1);
+    *entry = key;
+    entry->fraction = q->fraction;
+    entry->own = account_get_own_balance (acc, q);
+    entry->balance = entry->own;
+    entry->exact = subtree_balance_is_exact (entry->own, q->fraction);
+    for (node = priv->children; node; node = node->next)
+    {
+        entry->exact = entry->exact &&
+                       account_get_subtree_entry (node->data, q)->exact;
+        entry->balance = account_add_subtree_balance (entry->balance,
+                         node->data, q);
+    }
+    entry->exact = entry->exact &&
+                   subtree_balance_is_exact (entry->balance, q->fraction);
+
+    if (!priv->subtree_balances)
+        priv->subtree_balances =
+            g_hash_table_new_full (subtree_balance_hash,
+                                   subtree_balance_equal, g_free, NULL);
+    else if (g_hash_table_size (priv->subtree_balances) >=
+             SUBTREE_BALANCE_MAX_ENTRIES)
+        g_hash_table_remove_all (priv->subtree_balances);
+    g_hash_table_replace (priv->subtree_balances, entry, entry);
+    return entry;
 }
 
+/*
+ * Sum up the balance of acc and all of its descendants, converted to
+ * 'currency'.  Either 'fn' or, for balances as of 'date', 'asOfDateFn'
+ * extracts the balance of each account.  The result is the same as
+ * adding up the accounts one by one, but for the balance kinds that
+ * are cached each account's total is kept, so a walk over the whole
+ * tree mostly reuses its children's totals, and a repeated walk only
+ * redoes the accounts whose balances changed since.  Converted totals
+ * are also dropped when the book's prices change.
+ */
+static gnc_numeric
+account_get_subtree_balance (Account *acc, xaccGetBalanceFn fn,
+                             xaccGetBalanceAsOfDateFn asOfDateFn,
+                             time64 date, const gnc_commodity *currency)
+{
+    SubtreeBalanceQuery q;
+    gnc_numeric balance;
+    GList *node;
+
+    q.kind = account_balance_kind (fn, asOfDateFn);
+    q.fn = fn;
+    q.asOfDateFn = asOfDateFn;
+    q.date = date;
+    q.currency = currency;
+    q.fraction = gnc_commodity_get_fraction (currency);
 
+    if (q.kind != BALANCE_KIND_NONE)
+        return account_get_subtree_entry (acc, &q)->balance;
+
+    balance = account_get_own_balance (acc, &q);
+    for (node = GET_PRIVATE(acc)->children; node; node = node->next)
+        balance = account_add_balances (balance, node->data, &q);
+    return balance;
+}
 
 /*
  * Common function that iterates recursively over all accounts below
- * the specified account.  It uses xaccAccountBalanceHelper to sum up
- * the balances of all its children, and uses the specified function
+ * the specified account.  It uses account_get_subtree_balance to sum
+ * up the balances of all its children, and uses the specified function
  * 'fn' for extracting the balance.  This function may extract the
  * current value, the reconciled value, etc.
  *
@@ -3554,35 +4358,17 @@ xaccAccountGetXxxBalanceInCurrencyRecursive (const Account *acc,
         const gnc_commodity *report_commodity,
         gboolean include_children)
 {
-    gnc_numeric balance;
-
     if (!acc) return gnc_numeric_zero ();
     if (!report_commodity)
         report_commodity = xaccAccountGetCommodity (acc);
     if (!report_commodity)
         return gnc_numeric_zero();
 
-    balance = xaccAccountGetXxxBalanceInCurrency (acc, fn, report_commodity);
+    if (!include_children)
+        return xaccAccountGetXxxBalanceInCurrency (acc, fn, report_commodity);
 
-    /* If needed, sum up the children converting to the *requested*
-       commodity. */
-    if (include_children)
-    {
-#ifdef _MSC_VER
-        /* MSVC compiler: Somehow, the struct initialization containing a
-           gnc_numeric doesn't work. As an exception, we hand-initialize
-           that member afterwards. */
-        CurrencyBalance cb = { report_commodity, { 0 }, fn, NULL, 0 };
-        cb.balance = balance;
-#else
-        CurrencyBalance cb = { report_commodity, balance, fn, NULL, 0 };
-#endif
-
-        gnc_account_foreach_descendant (acc, xaccAccountBalanceHelper, &cb);
-        balance = cb.balance;
-    }
-
-    return balance;
+    return account_get_subtree_balance ((Account *)acc, fn, NULL, 0,
+                                        report_commodity);
 }
 
 static gnc_numeric
@@ -3590,36 +4376,18 @@ xaccAccountGetXxxBalanceAsOfDateInCurrencyRecursive (
     Account *acc, time64 date, xaccGetBalanceAsOfDateFn fn,
     gnc_commodity *report_commodity, gboolean include_children)
 {
-    gnc_numeric balance;
-
     g_return_val_if_fail(acc, gnc_numeric_zero());
     if (!report_commodity)
         report_commodity = xaccAccountGetCommodity (acc);
     if (!report_commodity)
         return gnc_numeric_zero();
 
-    balance = xaccAccountGetXxxBalanceAsOfDateInCurrency(
-                  acc, date, fn, report_commodity);
+    if (!include_children)
+        return xaccAccountGetXxxBalanceAsOfDateInCurrency(
+                   acc, date, fn, report_commodity);
 
-    /* If needed, sum up the children converting to the *requested*
-       commodity. */
-    if (include_children)
-    {
-#ifdef _MSC_VER
-        /* MSVC compiler: Somehow, the struct initialization containing a
-           gnc_numeric doesn't work. As an exception, we hand-initialize
-           that member afterwards. */
-        CurrencyBalance cb = { report_commodity, 0, NULL, fn, date };
-        cb.balance = balance;
-#else
-        CurrencyBalance cb = { report_commodity, balance, NULL, fn, date };
-#endif
-
-        gnc_account_foreach_descendant (acc, xaccAccountBalanceAsOfDateHelper, &cb);
-        balance = cb.balance;
-    }
-
-    return balance;
+    return account_get_subtree_balance (acc, NULL, fn, date,
+                                        report_commodity);
 }
 
 gnc_numeric
@@ -3783,6 +4551,17 @@ xaccAccountForEachLot(const Account *acc,
 /********************************************************************\
 \********************************************************************/
 
+/* Look up a slot read for every account in the tree views and reports
+ * by a path made the first time. */
+static KvpValue *
+account_get_slot_by_path (const Account *acc, KvpPath **path,
+                          const char *key)
+{
+    if (!*path)
+        *path = kvp_path_new_from_string (key);
+    return kvp_frame_get_value_by_path (acc->inst.kvp_data, *path);
+}
+
 /* These functions use interchange gint64 and gboolean.  Is that right? */
 gboolean
 xaccAccountGetTaxRelated (const Account *acc)
@@ -3812,8 +4591,11 @@ xaccAccountSetTaxRelated (Account *acc, gboolean tax_related)
 const char *
 xaccAccountGetTaxUSCode (const Account *acc)
 {
+    static KvpPath *path = NULL;
+
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), NULL);
-    return kvp_frame_get_string(acc->inst.kvp_data, "tax-US/code");
+    return kvp_value_get_string(
+               account_get_slot_by_path(acc, &path, "tax-US/code"));
 }
 
 void
@@ -3893,9 +4675,12 @@ xaccAccountGetPlaceholder (const Account *acc)
 {
     const char *str;
 
+    static KvpPath *path = NULL;
+
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
 
-    str = kvp_frame_get_string(acc->inst.kvp_data, "placeholder");
+    str = kvp_value_get_string(
+              account_get_slot_by_path(acc, &path, "placeholder"));
     return (str && !strcmp(str, "true"));
 }
 
@@ -3940,9 +4725,11 @@ xaccAccountGetHidden (const Account *acc)
 {
     const char *str;
 
+    static KvpPath *path = NULL;
+
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
 
-    str = kvp_frame_get_string(acc->inst.kvp_data, "hidden");
+    str = kvp_value_get_string(account_get_slot_by_path(acc, &path, "hidden"));
     return (str && !strcmp(str, "true"));
 }
 
@@ -5447,6 +6234,244 @@ gnc_imap_add_account_bayes(GncImportMatchMap *imap,
     LEAVE(" ");
 }
 
+/* ================================================================ */
+/* Query indexes for splits.  The split list of an account is sorted
+ * by posted date, so queries for the splits of some accounts or of a
+ * range of dates can find their candidates there instead of checking
+ * every split of the book.  Like the split lists, the indexes only see
+ * the splits of committed transactions, so they decline when an open
+ * transaction has a split going into one of the accounts, or a new
+ * posted date; the query scans all splits then.  Neither sorts an
+ * account or recomputes its balances.
+ */
+
+/* The accounts of "account guid is one of a list" */
+static gboolean
+split_index_get_accounts (QofBook *book, const QofQueryParamList *param_path,
+                          const QofQueryPredData *pdata, GList **accounts)
+{
+    const query_guid_def *pd = (const query_guid_def *) pdata;
+    GList *node;
+
+    *accounts = NULL;
+    if (!param_path || !param_path->next || param_path->next->next ||
+        g_strcmp0 (param_path->data, SPLIT_ACCOUNT) ||
+        g_strcmp0 (param_path->next->data, QOF_PARAM_GUID) ||
+        g_strcmp0 (pdata->type_name, QOF_TYPE_GUID) ||
+        pdata->how != QOF_COMPARE_EQUAL || pd->options != QOF_GUID_MATCH_ANY)
+        return FALSE;
+
+    for (node = pd->guids; node; node = node->next)
+    {
+        Account *acc = xaccAccountLookup (node->data, book);
+        if (acc && !g_list_find (*accounts, acc))
+            *accounts = g_list_prepend (*accounts, acc);
+    }
+    *accounts = g_list_reverse (*accounts);
+    return TRUE;
+}
+
+static gint64
+split_account_index_estimate (QofBook *book, QofIdTypeConst search_for,
+                              const QofQueryParamList *param_path,
+                              const QofQueryPredData *pdata)
+{
+    GList *accounts, *node;
+    gint64 count = 0;
+
+    if (!split_index_get_accounts (book, param_path, pdata, &accounts))
+        return -1;
+    for (node = accounts; node; node = node->next)
+    {
+        if (xaccTransIsAccountInFlux (book, node->data))
+        {
+            count = -1;
+            break;
+        }
+        count += g_hash_table_size (GET_PRIVATE(node->data)->split_iters);
+    }
+    g_list_free (accounts);
+    return count;
+}
+
+static void
+split_account_index_foreach (QofBook *book, QofIdTypeConst search_for,
+                             const QofQueryParamList *param_path,
+                             const QofQueryPredData *pdata,
+                             QofInstanceForeachCB cb, gpointer user_data)
+{
+    GList *accounts, *node, *lp;
+
+    if (!split_index_get_accounts (book, param_path, pdata, &accounts))
+        return;
+    for (node = accounts; node; node = node->next)
+    {
+        for (lp = GET_PRIVATE(node->data)->splits; lp; lp = lp->next)
+            cb (lp->data, user_data);
+    }
+    g_list_free (accounts);
+}
+
+static const QofQueryIndex split_account_index =
+{
+    "split-account", split_account_index_estimate, split_account_index_foreach
+};
+
+/* The posted dates, in seconds, a "date posted" term can match. */
+static gboolean
+split_index_get_date_range (const QofQueryParamList *param_path,
+                            const QofQueryPredData *pdata,
+                            time64 *start, time64 *end)
+{
+    const query_date_def *pd = (const query_date_def *) pdata;
+    time64 first, last;
+
+    if (!param_path || !param_path->next || param_path->next->next ||
+        g_strcmp0 (param_path->data, SPLIT_TRANS) ||
+        g_strcmp0 (param_path->next->data, TRANS_DATE_POSTED) ||
+        g_strcmp0 (pdata->type_name, QOF_TYPE_DATE))
+        return FALSE;
+
+    first = last = pd->date.tv_sec;
+    if (pd->options == QOF_DATE_MATCH_DAY)
+    {
+        first = gnc_time64_get_day_start (first);
+        last = gnc_time64_get_day_end (last);
+    }
+    /* Only the seconds are compared here, the candidates get checked
+     * against the full date anyway. */
+    switch (pdata->how)
+    {
+    case QOF_COMPARE_LT:
+    case QOF_COMPARE_LTE:
+        *start = G_MININT64;
+        *end = last;
+        return TRUE;
+    case QOF_COMPARE_GT:
+    case QOF_COMPARE_GTE:
+        *start = first;
+        *end = G_MAXINT64;
+        return TRUE;
+    case QOF_COMPARE_EQUAL:
+        *start = first;
+        *end = last;
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+typedef struct
+{
+    time64 start;
+    time64 end;
+    gint64 n_splits;
+    gint64 count;
+    QofInstanceForeachCB cb;
+    gpointer user_data;
+} SplitDateRange;
+
+/* Find the splits of the account posted in the range, by a binary
+ * search of the posted dates when the account is up to date.  When it
+ * isn't, the estimate is all of its splits and the search a walk. */
+static void
+split_date_index_account (QofInstance *inst, gpointer data)
+{
+    Account *acc = GNC_ACCOUNT(inst);
+    AccountPrivate *priv = GET_PRIVATE(acc);
+    SplitDateRange *range = data;
+    guint n_splits = g_hash_table_size (priv->split_iters);
+    guint pos, last;
+    GList *lp;
+
+    range->n_splits += n_splits;
+    if (priv->sort_dirty || priv->balance_dirty)
+    {
+        if (!range->cb)
+        {
+            range->count += n_splits;
+            return;
+        }
+        for (lp = priv->splits; lp; lp = lp->next)
+        {
+            time64 posted = xaccTransGetDate (xaccSplitGetParent (lp->data));
+            if (posted < range->start || posted > range->end)
+                continue;
+            range->cb (lp->data, range->user_data);
+        }
+        return;
+    }
+
+    pos = account_find_split_pos_by_date (priv, range->start, 0);
+    last = range->end == G_MAXINT64 ? priv->posted_dates->len :
+           account_find_split_pos_by_date (priv, range->end + 1, pos);
+    range->count += last - pos;
+    if (!range->cb || pos == last)
+        return;
+    lp = g_sequence_get (g_sequence_get_iter_at_pos (priv->split_index, pos));
+    for (; pos < last; pos++, lp = lp->next)
+        range->cb (lp->data, range->user_data);
+}
+
+static gint64
+split_date_index_estimate (QofBook *book, QofIdTypeConst search_for,
+                           const QofQueryParamList *param_path,
+                           const QofQueryPredData *pdata)
+{
+    SplitDateRange range = { 0 };
+
+    if (xaccTransAreDatesInFlux (book))
+        return -1;
+    if (!split_index_get_date_range (param_path, pdata,
+                                     &range.start, &range.end))
+        return -1;
+    qof_collection_foreach (qof_book_get_collection (book, GNC_ID_ACCOUNT),
+                            split_date_index_account, &range);
+    /* Splits without an account are not in any split list. */
+    if (range.n_splits !=
+            qof_collection_count (qof_book_get_collection (book, GNC_ID_SPLIT)))
+        return -1;
+    return range.count;
+}
+
+static void
+split_date_index_foreach (QofBook *book, QofIdTypeConst search_for,
+                          const QofQueryParamList *param_path,
+                          const QofQueryPredData *pdata,
+                          QofInstanceForeachCB cb, gpointer user_data)
+{
+    SplitDateRange range = { 0 };
+
+    if (!split_index_get_date_range (param_path, pdata,
+                                     &range.start, &range.end))
+        return;
+    range.cb = cb;
+    range.user_data = user_data;
+    qof_collection_foreach (qof_book_get_collection (book, GNC_ID_ACCOUNT),
+                            split_date_index_account, &range);
+}
+
+static const QofQueryIndex split_date_index =
+{
+    "split-date-posted", split_date_index_estimate, split_date_index_foreach
+};
+
+/* A split going into, out of or changing in an account is reported
+ * with the split.  Other account changes can't be pinned to splits. */
+static gboolean
+account_split_dependents (QofInstance *inst, QofEventId event_type,
+                          gpointer event_data, QofInstanceForeachCB cb,
+                          gpointer user_data)
+{
+    if (event_type != GNC_EVENT_ITEM_ADDED &&
+            event_type != GNC_EVENT_ITEM_REMOVED &&
+            event_type != GNC_EVENT_ITEM_CHANGED)
+        return FALSE;
+    if (event_data)
+        cb (QOF_INSTANCE(event_data), user_data);
+    return TRUE;
+}
+
 /* ================================================================ */
 /* QofObject function implementation and registration */
 
@@ -5459,6 +6484,26 @@ gnc_account_book_end(QofBook* book)
     xaccAccountDestroy(root_account);
 }
 
+static void
+account_finish_bulk_load (QofInstance *inst, gpointer data)
+{
+    Account *acc = GNC_ACCOUNT(inst);
+
+    /* Accounts still open for editing catch up in their commit. */
+    if (qof_instance_get_editlevel(acc) > 0)
+        return;
+    xaccAccountBringUpToDate(acc);
+}
+
+/* The split inserts of a bulk load only collect the splits, so sort
+ * every account and compute its balances once now. */
+static void
+gnc_account_bulk_load_end(QofBook* book)
+{
+    qof_collection_foreach(qof_book_get_collection(book, GNC_ID_ACCOUNT),
+                           account_finish_bulk_load, NULL);
+}
+
 #ifdef _MSC_VER
 /* MSVC compiler doesn't have C99 "designated initializers"
  * so we wrap them in a macro that is empty on MSVC. */
@@ -5466,6 +6511,27 @@ gnc_account_book_end(QofBook* book)
 #else
 # define DI(x) x
 #endif
+/* The private data, its strings and lists, and the posted dates of
+ * the split index.  The GSequence and hash tables of the index are
+ * opaque and not counted. */
+static gsize
+account_memory_size (gpointer instance)
+{
+    AccountPrivate *priv = GET_PRIVATE(instance);
+    gsize size = sizeof (AccountPrivate);
+
+    if (priv->accountName)
+        size += strlen (priv->accountName) + 1;
+    if (priv->accountCode)
+        size += strlen (priv->accountCode) + 1;
+    if (priv->description)
+        size += strlen (priv->description) + 1;
+    size += (g_list_length (priv->children) + g_list_length (priv->splits) +
+             g_list_length (priv->lots)) * sizeof (GList);
+    size += priv->posted_dates->len * sizeof (time64);
+    return size;
+}
+
 static QofObject account_object_def =
 {
     DI(.interface_version = ) QOF_OBJECT_VERSION,
@@ -5479,6 +6545,8 @@ static QofObject account_object_def =
     DI(.foreach           = ) qof_collection_foreach,
     DI(.printable         = ) (const char * (*)(gpointer)) xaccAccountGetName,
     DI(.version_cmp       = ) (int (*)(gpointer, gpointer)) qof_instance_version_cmp,
+    DI(.bulk_load_end     = ) gnc_account_bulk_load_end,
+    DI(.memory_size       = ) account_memory_size,
 };
 
 gboolean xaccAccountRegister (void)
@@ -5581,6 +6649,10 @@ gboolean xaccAccountRegister (void)
     };
 
     qof_class_register (GNC_ID_ACCOUNT, (QofSortFunc) qof_xaccAccountOrder, params);
+    qof_query_register_index (GNC_ID_SPLIT, &split_account_index);
+    qof_query_register_index (GNC_ID_SPLIT, &split_date_index);
+    qof_query_register_dependents (GNC_ID_SPLIT, GNC_ID_ACCOUNT,
+                                   account_split_dependents);
 
     return qof_object_register (&account_object_def);
 }
@@ -402,6 +402,14 @@ void xaccAccountRecomputeBalance (Account *);
  */
 void xaccAccountSortSplits (Account *acc, gboolean force);
 
+/** Report how xaccAccountSortSplits() has put split lists back in
+ *  order since the program started: by sorting the whole list, by
+ *  sorting the splits that moved and merging them into the rest, or by
+ *  moving them one at a time.  Any of the pointers may be NULL.
+ */
+void gnc_account_get_split_sort_counts (guint *full_sorts, guint *merges,
+                                        guint *repositions);
+
 /** The gnc_account_get_full_name routine returns the fully qualified name
  * of the account using the given separator char. The name must be
  * g_free'd after use. The fully qualified name of an account is the
@@ -544,6 +552,12 @@ gnc_numeric xaccAccountGetProjectedMinimumBalance (const Account *account);
 /** Get the balance of the account as of the date specified */
 gnc_numeric xaccAccountGetBalanceAsOfDate (Account *account,
         time64 date);
+/** Get the balances of the account as of each of the n_dates dates,
+    which must be in ascending order, into the array balances.  This
+    is cheaper than calling xaccAccountGetBalanceAsOfDate for each
+    date, as the searches don't start over from the beginning. */
+void xaccAccountGetBalancesAsOfDates (Account *account, const time64 *dates,
+                                      guint n_dates, gnc_numeric *balances);
 
 /* These two functions convert a given balance from one commodity to
    another.  The account argument is only used to get the Book, and
@@ -109,9 +109,41 @@ typedef struct AccountPrivate
     gnc_numeric reconciled_balance;
 
     gboolean balance_dirty;     /* balances in splits incorrect */
-
+    /* When balance_dirty is set, the running balances of the splits
+     * before this position in the split list are still correct, and
+     * xaccAccountRecomputeBalance only walks the rest of the list.  -1
+     * means that all of them have to be recomputed. */
+    gint balance_dirty_pos;
+    /* The posted date of each split in the split list, filled in along
+     * with the running balances so that as-of-date lookups can be done
+     * with a binary search.  Only valid while balance_dirty is unset. */
+    GArray *posted_dates;
+
+    /* Balances of this account plus all of its descendants, by balance
+     * kind and report commodity, so that the tree doesn't have to be
+     * walked again for every node.  Cleared along the parent chain
+     * whenever a balance in the subtree changes, started over when it
+     * gets too big and freed with the account; NULL until needed. */
+    GHashTable *subtree_balances;
+
+    /* The splits list is kept for the benefit of xaccAccountGetSplitList
+     * and the many traversals over it; the nodes of the list are also
+     * held in split_index, a balanced tree ordered by xaccSplitOrder, so
+     * that finding the place of a split is O(log n) rather than a walk
+     * of the list.  split_iters maps each split to its iterator in
+     * split_index, making membership checks and removal cheap.
+     */
     GList *splits;              /* list of split pointers */
+    GSequence *split_index;     /* nodes of splits, in sort order */
+    GHashTable *split_iters;    /* Split -> GSequenceIter in split_index */
+
+    /* Splits whose sort key changed (or that were added while the
+     * account was open for editing) are remembered in moved_splits, so
+     * that only they need to be repositioned.  If sort_all is set the
+     * whole list has to be sorted again. */
+    GHashTable *moved_splits;   /* splits which may be out of order */
     gboolean sort_dirty;        /* sort order of splits is bad */
+    gboolean sort_all;          /* ... and not only for moved_splits */
 
     LotList   *lots;		/* list of lot pointers */
     GNCPolicy *policy;		/* Cached pointer to policy method */
@@ -132,6 +164,15 @@ struct account_s
  * call this on an existing account! */
 void xaccAccountSetGUID (Account *account, const GncGUID *guid);
 
+/* Note that the sort key of split s has changed, so that the next
+ * xaccAccountSortSplits only has to move s (and any other splits of
+ * the same transaction in acc) rather than sort the whole account. */
+void gnc_account_set_split_sort_dirty (Account *acc, Split *s);
+
+/* Note that the amount or reconcile state of split s has changed, so
+ * that the running balances have to be recomputed from s onward. */
+void gnc_account_set_split_balance_dirty (Account *acc, Split *s);
+
 /* Register Accounts with the engine */
 gboolean xaccAccountRegister (void);
 
@@ -780,7 +780,8 @@ void mark_split (Split *s)
 {
     if (s->acc)
     {
-        g_object_set(s->acc, "sort-dirty", TRUE, "balance-dirty", TRUE, NULL);
+        gnc_account_set_split_sort_dirty (s->acc, s);
+        gnc_account_set_split_balance_dirty (s->acc, s);
     }
 
     /* set dirty flag on lot too. */
@@ -1061,15 +1062,22 @@ xaccSplitCommitEdit(Split *s)
        original and new transactions, for the _next_ begin/commit cycle. */
     s->orig_acc = s->acc;
     s->orig_parent = s->parent;
+
+    /* Only this split can have changed its place and its effect on the
+     * running balances in the account; note that before part2, which
+     * may free the split.  Removal has already taken care of both. */
+    if (acc && !qof_instance_get_destroying(s))
+    {
+        gnc_account_set_split_sort_dirty (acc, s);
+        gnc_account_set_split_balance_dirty (acc, s);
+    }
+
     if (!qof_commit_edit_part2(QOF_INSTANCE(s), commit_err, NULL,
                                (void (*) (QofInstance *)) xaccFreeSplit))
         return;
 
     if (acc)
-    {
-        g_object_set(acc, "sort-dirty", TRUE, "balance-dirty", TRUE, NULL);
         xaccAccountRecomputeBalance(acc);
-    }
 }
 
 /* An engine-private helper for completing xaccTransRollbackEdit(). */
@@ -2191,6 +2199,21 @@ xaccSplitUnvoid(Split *split)
 #else
 # define DI(x) x
 #endif
+/* The memo and action strings; they come from the string cache and
+ * may be shared with other splits. */
+static gsize
+split_memory_size (gpointer instance)
+{
+    Split *split = instance;
+    gsize size = 0;
+
+    if (split->memo)
+        size += strlen (split->memo) + 1;
+    if (split->action)
+        size += strlen (split->action) + 1;
+    return size;
+}
+
 static QofObject split_object_def =
 {
     DI(.interface_version = ) QOF_OBJECT_VERSION,
@@ -2204,6 +2227,8 @@ static QofObject split_object_def =
     DI(.foreach           = ) qof_collection_foreach,
     DI(.printable         = ) (const char * (*)(gpointer)) xaccSplitGetMemo,
     DI(.version_cmp       = ) (int (*)(gpointer, gpointer)) qof_instance_version_cmp,
+    DI(.bulk_load_end     = ) NULL,
+    DI(.memory_size       = ) split_memory_size,
 };
 
 static gpointer
@@ -191,6 +191,12 @@ const char *assoc_uri_str = "assoc_uri";
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = GNC_MOD_ENGINE;
 
+/* The book data key of the set of the book's transactions between
+ * xaccTransBeginEdit and their commit or rollback */
+#define OPEN_TRANSACTIONS "gnc-open-transactions"
+static void trans_add_open (Transaction *trans);
+static void trans_free_orig (Transaction *trans);
+
 enum
 {
     PROP_0,
@@ -818,11 +824,7 @@ xaccFreeTransaction (Transaction *trans)
     trans->date_posted.tv_sec = 0;
     trans->date_posted.tv_nsec = 0;
 
-    if (trans->orig)
-    {
-        xaccFreeTransaction (trans->orig);
-        trans->orig = NULL;
-    }
+    trans_free_orig (trans);
 
     /* qof_instance_release (&trans->inst); */
     g_object_unref(trans);
@@ -1391,6 +1393,106 @@ xaccTransBeginEdit (Transaction *trans)
     /* Make a clone of the transaction; we will use this
      * in case we need to roll-back the edit. */
     trans->orig = dupe_trans (trans);
+    trans_add_open (trans);
+}
+
+static void
+open_transactions_destroy (QofBook *book, gpointer key, gpointer open)
+{
+    /* The transactions are freed after the book's finalizers have run,
+     * so make sure they don't find the set any more. */
+    qof_book_set_data (book, key, NULL);
+    g_hash_table_destroy (open);
+}
+
+static void
+trans_add_open (Transaction *trans)
+{
+    QofBook *book = qof_instance_get_book (trans);
+    GHashTable *open;
+
+    if (!book)
+        return;
+    open = qof_book_get_data (book, OPEN_TRANSACTIONS);
+    if (!open)
+    {
+        open = g_hash_table_new (g_direct_hash, g_direct_equal);
+        qof_book_set_data_fin (book, OPEN_TRANSACTIONS, open,
+                               open_transactions_destroy);
+    }
+    g_hash_table_insert (open, trans, trans);
+}
+
+/* The edit of trans is over; forget its copy from before the edit. */
+static void
+trans_free_orig (Transaction *trans)
+{
+    QofBook *book;
+    GHashTable *open;
+
+    if (!trans->orig)
+        return;
+    xaccFreeTransaction (trans->orig);
+    trans->orig = NULL;
+
+    book = qof_instance_get_book (trans);
+    if (!book || qof_book_shutting_down (book))
+        return;
+    open = qof_book_get_data (book, OPEN_TRANSACTIONS);
+    if (open)
+        g_hash_table_remove (open, trans);
+}
+
+/* A split of an open transaction that isn't in the split list of the
+ * account it names yet: it is new, or moved from another account. */
+static gboolean
+split_is_moving (const Split *split)
+{
+    return split->acc != split->orig_acc &&
+           !qof_instance_get_destroying (split);
+}
+
+gboolean
+xaccTransIsAccountInFlux (QofBook *book, const Account *acc)
+{
+    GHashTable *open = qof_book_get_data (book, OPEN_TRANSACTIONS);
+    GHashTableIter iter;
+    gpointer key;
+    GList *node;
+
+    if (!open)
+        return FALSE;
+    g_hash_table_iter_init (&iter, open);
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+        Transaction *trans = key;
+        for (node = trans->splits; node; node = node->next)
+        {
+            Split *split = node->data;
+            if (split->acc == acc && split_is_moving (split))
+                return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+gboolean
+xaccTransAreDatesInFlux (QofBook *book)
+{
+    GHashTable *open = qof_book_get_data (book, OPEN_TRANSACTIONS);
+    GHashTableIter iter;
+    gpointer key;
+
+    if (!open)
+        return FALSE;
+    g_hash_table_iter_init (&iter, open);
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+        Transaction *trans = key;
+        if (!timespec_equal (&trans->date_posted, &trans->orig->date_posted))
+            return TRUE;
+    }
+    return FALSE;
 }
 
 /********************************************************************\
@@ -1558,8 +1660,7 @@ static void trans_cleanup_commit(Transaction *trans)
     /* Get rid of the copy we made. We won't be rolling back,
      * so we don't need it any more.  */
     PINFO ("get rid of rollback trans=%p", trans->orig);
-    xaccFreeTransaction (trans->orig);
-    trans->orig = NULL;
+    trans_free_orig (trans);
 
     /* Sort the splits. Why do we need to do this ?? */
     /* Good question.  Who knows?  */
@@ -1798,9 +1899,7 @@ xaccTransRollbackEdit (Transaction *trans)
     if (!qof_book_is_readonly(qof_instance_get_book(trans)))
         xaccTransWriteLog (trans, 'R');
 
-    xaccFreeTransaction (trans->orig);
-
-    trans->orig = NULL;
+    trans_free_orig (trans);
     qof_instance_set_destroying(trans, FALSE);
 
     /* Put back to zero. */
@@ -2184,6 +2283,17 @@ xaccTransGetDescription (const Transaction *trans)
     return trans ? trans->description : NULL;
 }
 
+/* Look up a slot read on every commit or for every register line by
+ * a path made the first time. */
+static KvpValue *
+trans_get_slot_by_path (const Transaction *trans, KvpPath **path,
+                        const char *key)
+{
+    if (!*path)
+        *path = kvp_path_new_from_string (key);
+    return kvp_frame_get_value_by_path (trans->inst.kvp_data, *path);
+}
+
 const char *
 xaccTransGetAssociation (const Transaction *trans)
 {
@@ -2201,8 +2311,10 @@ xaccTransGetNotes (const Transaction *trans)
 gboolean
 xaccTransGetIsClosingTxn (const Transaction *trans)
 {
-    return trans ?
-           kvp_frame_get_gint64 (trans->inst.kvp_data, trans_is_closing_str)
+    static KvpPath *path = NULL;
+
+    return trans ? kvp_value_get_gint64 (
+               trans_get_slot_by_path (trans, &path, trans_is_closing_str))
            : FALSE;
 }
 
@@ -2299,9 +2411,11 @@ xaccTransRetDateDueTS (const Transaction *trans)
 char
 xaccTransGetTxnType (const Transaction *trans)
 {
+    static KvpPath *path = NULL;
     const char *s;
     if (!trans) return TXN_TYPE_NONE;
-    s = kvp_frame_get_string (trans->inst.kvp_data, TRANS_TXN_TYPE_KVP);
+    s = kvp_value_get_string (
+            trans_get_slot_by_path (trans, &path, TRANS_TXN_TYPE_KVP));
     if (s) return *s;
 
     return TXN_TYPE_NONE;
@@ -2313,8 +2427,11 @@ xaccTransGetReadOnly (const Transaction *trans)
     /* XXX This flag should be cached in the transaction structure
      * for performance reasons, since its checked every trans commit.
      */
-    return trans ? kvp_frame_get_string (
-               trans->inst.kvp_data, TRANS_READ_ONLY_REASON) : NULL;
+    static KvpPath *path = NULL;
+
+    return trans ? kvp_value_get_string (
+               trans_get_slot_by_path (trans, &path, TRANS_READ_ONLY_REASON))
+           : NULL;
 }
 
 gboolean xaccTransIsReadonlyByPostedDate(const Transaction *trans)
@@ -2730,6 +2847,21 @@ gnc_transaction_book_end(QofBook* book)
 # define DI(x) x
 #endif
 
+/* The num and description strings, which may be shared through the
+ * string cache, and the nodes of the split list. */
+static gsize
+trans_memory_size (gpointer instance)
+{
+    Transaction *trans = instance;
+    gsize size = g_list_length (trans->splits) * sizeof (GList);
+
+    if (trans->num)
+        size += strlen (trans->num) + 1;
+    if (trans->description)
+        size += strlen (trans->description) + 1;
+    return size;
+}
+
 /* Hook into the QofObject registry */
 static QofObject trans_object_def =
 {
@@ -2744,6 +2876,8 @@ static QofObject trans_object_def =
     DI(.foreach           = ) qof_collection_foreach,
     DI(.printable         = ) (const char * (*)(gpointer)) xaccTransGetDescription,
     DI(.version_cmp       = ) (int (*)(gpointer, gpointer)) qof_instance_version_cmp,
+    DI(.bulk_load_end     = ) NULL,
+    DI(.memory_size       = ) trans_memory_size,
 };
 
 static gboolean
@@ -2752,6 +2886,28 @@ trans_is_balanced_p (const Transaction *trans)
     return trans ? xaccTransIsBalanced(trans) : FALSE;
 }
 
+/* A change to a transaction may change the result of a split query for
+ * any of its splits, and for a split leaving it. */
+static gboolean
+trans_split_dependents (QofInstance *inst, QofEventId event_type,
+                        gpointer event_data, QofInstanceForeachCB cb,
+                        gpointer user_data)
+{
+    Transaction *trans = GNC_TRANSACTION(inst);
+    GList *node;
+
+    for (node = trans->splits; node; node = node->next)
+        cb (QOF_INSTANCE(node->data), user_data);
+    if ((event_type == GNC_EVENT_ITEM_ADDED ||
+            event_type == GNC_EVENT_ITEM_REMOVED) && event_data)
+    {
+        GncEventData *ed = event_data;
+        if (ed->node)
+            cb (QOF_INSTANCE(ed->node), user_data);
+    }
+    return TRUE;
+}
+
 gboolean xaccTransRegister (void)
 {
     static QofParam params[] =
@@ -2840,6 +2996,8 @@ gboolean xaccTransRegister (void)
     };
 
     qof_class_register (GNC_ID_TRANS, (QofSortFunc)xaccTransOrder, params);
+    qof_query_register_dependents (GNC_ID_SPLIT, GNC_ID_TRANS,
+                                   trans_split_dependents);
 
     return qof_object_register (&trans_object_def);
 }
@@ -174,6 +174,18 @@ void xaccDisableDataScrubbing(void);
 void xaccTransRemoveSplit (Transaction *trans, const Split *split);
 void check_open (const Transaction *trans);
 
+/* The splits' changes of account, and the changes of date, of the
+ *   transactions open for editing with xaccTransBeginEdit don't show
+ *   in the accounts' split lists until they are committed.
+ *
+ * xaccTransIsAccountInFlux is TRUE if an open transaction of book has
+ *   a split in acc that isn't in its split list yet, because it is new
+ *   or was moved there.  xaccTransAreDatesInFlux is TRUE if an open
+ *   transaction of book has a new posted date, so its splits may be
+ *   out of place in the split lists. */
+gboolean xaccTransIsAccountInFlux (QofBook *book, const Account *acc);
+gboolean xaccTransAreDatesInFlux (QofBook *book);
+
 /* Structure for accessing static functions for testing */
 typedef struct
 {
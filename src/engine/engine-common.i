@@ -29,3 +29,18 @@ AccountList * gnc_account_get_descendants_sorted (const Account *account);
 %include <Transaction.h>
 
 %include <gnc-lot.h>
+
+/* The column arrays can't be wrapped; the rows are read one at a time
+ * and the bounds of an account's rows are returned as values. */
+%ignore gnc_split_columns_get_amount_nums;
+%ignore gnc_split_columns_get_amount_denoms;
+%ignore gnc_split_columns_get_value_nums;
+%ignore gnc_split_columns_get_value_denoms;
+%ignore gnc_split_columns_get_posted_dates;
+%ignore gnc_split_columns_get_account_indices;
+%ignore gnc_split_columns_get_trans_indices;
+%ignore gnc_split_columns_get_reconcile_flags;
+%include <typemaps.i>
+%apply unsigned int *OUTPUT { guint *first, guint *last };
+%include <gnc-split-columns.h>
+%clear guint *first, guint *last;
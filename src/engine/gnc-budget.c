@@ -26,6 +26,8 @@
 #include <glib.h>
 #include <glib/gprintf.h>
 #include <glib/gi18n.h>
+#include <string.h>
+#include <stdlib.h>
 #include <time.h>
 #include <qof.h>
 #include <qofbookslots.h>
@@ -72,6 +74,17 @@ typedef struct BudgetPrivate
 
     /* Number of periods */
     guint  num_periods;
+
+    /* The budget amounts, see "Budget amounts" below. */
+    GHashTable *rows;           /* account GncGUID* -> row + 1 */
+    GArray *row_guids;          /* GncGUID of each row */
+    guint rows_alloc;
+    guint n_cols;
+    gnc_numeric *values;        /* rows_alloc * n_cols, row by row */
+    guint8 *cell_flags;
+    gboolean values_loaded;
+    gboolean values_dirty;
+    guint values_slots_serial;  /* of the slots the matrix was read from */
 } BudgetPrivate;
 
 #define GET_PRIVATE(o) \
@@ -99,6 +112,11 @@ gnc_budget_init(GncBudget* budget)
     gnc_gdate_set_today (&date);
     g_date_subtract_days(&date, g_date_get_day(&date) - 1);
     recurrenceSet(&priv->recurrence, 1, PERIOD_MONTH, &date, WEEKEND_ADJ_NONE);
+
+    priv->rows = g_hash_table_new_full(guid_hash_to_guint,
+                                       guid_g_hash_table_equal,
+                                       (GDestroyNotify)guid_free, NULL);
+    priv->row_guids = g_array_new(FALSE, FALSE, sizeof(GncGUID));
 }
 
 static void
@@ -110,6 +128,12 @@ gnc_budget_dispose (GObject *budgetp)
 static void
 gnc_budget_finalize(GObject* budgetp)
 {
+    BudgetPrivate* priv = GET_PRIVATE(budgetp);
+
+    g_hash_table_destroy(priv->rows);
+    g_array_free(priv->row_guids, TRUE);
+    g_free(priv->values);
+    g_free(priv->cell_flags);
     G_OBJECT_CLASS(gnc_budget_parent_class)->finalize(budgetp);
 }
 
@@ -277,10 +301,13 @@ gnc_budget_begin_edit(GncBudget *bgt)
     qof_begin_edit(QOF_INSTANCE(bgt));
 }
 
+static void flush_values(GncBudget *budget);
+
 void
 gnc_budget_commit_edit(GncBudget *bgt)
 {
     if (!qof_commit_edit(QOF_INSTANCE(bgt))) return;
+    flush_values(bgt);
     qof_commit_edit_part2(QOF_INSTANCE(bgt), commit_err,
                           noop, gnc_budget_free);
 }
@@ -324,16 +351,20 @@ static void
 clone_budget_values_cb(Account* a, gpointer user_data)
 {
     CloneBudgetData_t* data = (CloneBudgetData_t*)user_data;
+    gnc_numeric *values = g_new(gnc_numeric, data->num_periods);
+    gboolean *is_set = g_new(gboolean, data->num_periods);
     guint i;
 
+    gnc_budget_get_account_values(data->old_b, a, values, is_set);
     for ( i = 0; i < data->num_periods; ++i )
     {
-        if ( gnc_budget_is_account_period_value_set(data->old_b, a, i) )
+        if ( is_set[i] )
         {
-            gnc_budget_set_account_period_value(data->new_b, a, i,
-                                                gnc_budget_get_account_period_value(data->old_b, a, i));
+            gnc_budget_set_account_period_value(data->new_b, a, i, values[i]);
         }
     }
+    g_free(values);
+    g_free(is_set);
 }
 
 GncBudget*
@@ -476,24 +507,254 @@ gnc_budget_get_num_periods(const GncBudget* budget)
 #define BUF_SIZE (10 + GUID_ENCODING_LENGTH + \
    GNC_BUDGET_MAX_NUM_PERIODS_DIGITS)
 
+/* Budget amounts
+ *
+ * The amounts are kept in a matrix with a row for each account that
+ * has any and a column for each period.  The backends still see them
+ * in the budget's slots as "<account guid>/<period>", so the matrix
+ * is read from there the first time it is needed, and the cells
+ * changed since are written back when the budget is committed. */
+
+#define CELL_SET   (1 << 0)     /* The cell holds an amount */
+#define CELL_DIRTY (1 << 1)     /* Not yet written to the slots */
+
+/* Slots for later periods are left alone rather than making room for
+ * them; see GNC_BUDGET_MAX_NUM_PERIODS_DIGITS. */
+#define MAX_LOADED_PERIODS 1000
+
+static void
+resize_matrix(BudgetPrivate *priv, guint rows_alloc, guint n_cols)
+{
+    gnc_numeric *values;
+    guint8 *cell_flags;
+    guint row;
+
+    if (n_cols == priv->n_cols)
+    {
+        if (n_cols)
+        {
+            priv->values = g_renew(gnc_numeric, priv->values,
+                                   rows_alloc * n_cols);
+            priv->cell_flags = g_renew(guint8, priv->cell_flags,
+                                       rows_alloc * n_cols);
+            memset(priv->cell_flags + priv->rows_alloc * n_cols, 0,
+                   (rows_alloc - priv->rows_alloc) * n_cols);
+        }
+        priv->rows_alloc = rows_alloc;
+        return;
+    }
+
+    values = g_new(gnc_numeric, rows_alloc * n_cols);
+    cell_flags = g_new0(guint8, rows_alloc * n_cols);
+    for (row = 0; priv->n_cols && row < priv->row_guids->len; row++)
+    {
+        memcpy(values + row * n_cols, priv->values + row * priv->n_cols,
+               priv->n_cols * sizeof(gnc_numeric));
+        memcpy(cell_flags + row * n_cols, priv->cell_flags + row * priv->n_cols,
+               priv->n_cols);
+    }
+    g_free(priv->values);
+    g_free(priv->cell_flags);
+    priv->values = values;
+    priv->cell_flags = cell_flags;
+    priv->rows_alloc = rows_alloc;
+    priv->n_cols = n_cols;
+}
+
+/* Returns the row of the account plus one, or zero if it has none and
+ * create is FALSE. */
+static guint
+get_row(BudgetPrivate *priv, const GncGUID *guid, gboolean create)
+{
+    guint row = GPOINTER_TO_UINT(g_hash_table_lookup(priv->rows, guid));
+
+    if (row || !create)
+        return row;
+
+    row = priv->row_guids->len;
+    if (row == priv->rows_alloc)
+        resize_matrix(priv, MAX(16, 2 * priv->rows_alloc), priv->n_cols);
+    g_array_append_val(priv->row_guids, *guid);
+    g_hash_table_insert(priv->rows, guid_copy(guid), GUINT_TO_POINTER(row + 1));
+    return row + 1;
+}
+
+static void
+set_cell(BudgetPrivate *priv, guint row, guint period_num,
+         gnc_numeric val, guint8 flags)
+{
+    guint cell;
+
+    if (period_num >= priv->n_cols)
+        resize_matrix(priv, priv->rows_alloc,
+                      MAX(period_num + 1, priv->num_periods));
+    cell = (row - 1) * priv->n_cols + period_num;
+    priv->values[cell] = val;
+    priv->cell_flags[cell] = flags;
+}
+
+/* Returns the amount in the cell, or zero when it has none. */
+static gnc_numeric
+get_cell(const BudgetPrivate *priv, guint row, guint period_num,
+         gboolean *is_set)
+{
+    if (row && period_num < priv->n_cols)
+    {
+        guint cell = (row - 1) * priv->n_cols + period_num;
+
+        if (priv->cell_flags[cell] & CELL_SET)
+        {
+            if (is_set) *is_set = TRUE;
+            return priv->values[cell];
+        }
+    }
+    if (is_set) *is_set = FALSE;
+    return gnc_numeric_zero();
+}
+
+/* Any slot of a period counts as set, as before the matrix; one
+ * which isn't a number has an amount of zero. */
+static void
+load_period_value(const gchar *key, KvpValue *value, gpointer data)
+{
+    BudgetPrivate *priv = ((gpointer*)data)[0];
+    guint row = GPOINTER_TO_UINT(((gpointer*)data)[1]);
+    gchar *end;
+    gulong period_num;
+
+    /* Only the keys the amounts are written with, "0" to "999" */
+    if (!g_ascii_isdigit(key[0]) || (key[0] == '0' && key[1] != '\0'))
+        return;
+    period_num = strtoul(key, &end, 10);
+    if (*end != '\0' || period_num >= MAX_LOADED_PERIODS)
+        return;
+    set_cell(priv, row, period_num, kvp_value_get_numeric(value), CELL_SET);
+}
+
+static void
+load_account_values(const gchar *key, KvpValue *value, gpointer priv)
+{
+    KvpFrame *frame = kvp_value_get_frame(value);
+    GncGUID guid;
+    gpointer data[2];
+
+    if (!frame || !string_to_guid(key, &guid))
+        return;
+    data[0] = priv;
+    data[1] = GUINT_TO_POINTER(get_row(priv, &guid, TRUE));
+    kvp_frame_for_each_slot(frame, load_period_value, data);
+}
+
+/* Forget the matrix, so that it is read from the slots again */
+static void
+drop_values(BudgetPrivate *priv)
+{
+    g_hash_table_remove_all(priv->rows);
+    g_array_set_size(priv->row_guids, 0);
+    g_free(priv->values);
+    g_free(priv->cell_flags);
+    priv->values = NULL;
+    priv->cell_flags = NULL;
+    priv->rows_alloc = 0;
+    priv->n_cols = 0;
+    priv->values_loaded = FALSE;
+    priv->values_dirty = FALSE;
+}
+
+/* Whether the slots were replaced since the matrix was read, by a
+ * backend or by undo.  Then they win over the matrix. */
+static gboolean
+values_stale(const GncBudget *budget, const BudgetPrivate *priv)
+{
+    return priv->values_loaded && priv->values_slots_serial !=
+           qof_instance_get_slots_serial(QOF_INSTANCE(budget));
+}
+
+static BudgetPrivate *
+get_loaded_private(const GncBudget *budget)
+{
+    BudgetPrivate *priv = GET_PRIVATE(budget);
+
+    if (values_stale(budget, priv))
+        drop_values(priv);
+    if (!priv->values_loaded)
+    {
+        priv->values_loaded = TRUE;
+        priv->values_slots_serial =
+            qof_instance_get_slots_serial(QOF_INSTANCE(budget));
+        kvp_frame_for_each_slot(qof_instance_get_slots(QOF_INSTANCE(budget)),
+                                load_account_values, priv);
+    }
+    return priv;
+}
+
+static void
+flush_values(GncBudget *budget)
+{
+    BudgetPrivate *priv = GET_PRIVATE(budget);
+    KvpFrame *frame;
+    gchar path[BUF_SIZE];
+    gchar *bufend;
+    guint row, col;
+
+    if (values_stale(budget, priv))
+        drop_values(priv);
+    if (!priv->values_dirty)
+        return;
+
+    frame = qof_instance_get_slots(QOF_INSTANCE(budget));
+    for (row = 0; row < priv->row_guids->len; row++)
+    {
+        bufend = NULL;
+        for (col = 0; col < priv->n_cols; col++)
+        {
+            guint cell = row * priv->n_cols + col;
+
+            if (!(priv->cell_flags[cell] & CELL_DIRTY))
+                continue;
+            if (!bufend)
+                bufend = guid_to_string_buff(&g_array_index(priv->row_guids,
+                                             GncGUID, row), path);
+            g_sprintf(bufend, "/%d", col);
+            if (priv->cell_flags[cell] & CELL_SET)
+                kvp_frame_set_numeric(frame, path, priv->values[cell]);
+            else
+                kvp_frame_set_value(frame, path, NULL);
+            priv->cell_flags[cell] &= ~CELL_DIRTY;
+        }
+    }
+    priv->values_dirty = FALSE;
+}
+
 /* period_num is zero-based */
 /* What happens when account is deleted, after we have an entry for it? */
 void
 gnc_budget_unset_account_period_value(GncBudget *budget, const Account *account,
                                       guint period_num)
 {
+    BudgetPrivate *priv = get_loaded_private(budget);
     const GncGUID *guid;
-    KvpFrame *frame;
-    gchar path[BUF_SIZE];
-    gchar *bufend;
 
     gnc_budget_begin_edit(budget);
-    frame = qof_instance_get_slots(QOF_INSTANCE(budget));
     guid = xaccAccountGetGUID(account);
-    bufend = guid_to_string_buff(guid, path);
-    g_sprintf(bufend, "/%d", period_num);
-
-    kvp_frame_set_value(frame, path, NULL);
+    if (period_num < priv->n_cols)
+    {
+        set_cell(priv, get_row(priv, guid, TRUE), period_num,
+                 gnc_numeric_zero(), CELL_DIRTY);
+        priv->values_dirty = TRUE;
+    }
+    else
+    {
+        /* There is nothing in the matrix, but the slots might still
+         * have a value from before the periods were reduced. */
+        gchar path[BUF_SIZE];
+        gchar *bufend;
+
+        bufend = guid_to_string_buff(guid, path);
+        g_sprintf(bufend, "/%d", period_num);
+        kvp_frame_set_value(qof_instance_get_slots(QOF_INSTANCE(budget)),
+                            path, NULL);
+    }
     qof_instance_set_dirty(&budget->inst);
     gnc_budget_commit_edit(budget);
 
@@ -507,10 +768,8 @@ void
 gnc_budget_set_account_period_value(GncBudget *budget, const Account *account,
                                     guint period_num, gnc_numeric val)
 {
-    const GncGUID *guid;
-    KvpFrame *frame;
-    gchar path[BUF_SIZE];
-    gchar *bufend;
+    BudgetPrivate *priv;
+    guint row;
 
     /* Watch out for an off-by-one error here:
      * period_num starts from 0 while num_periods starts from 1 */
@@ -520,16 +779,14 @@ gnc_budget_set_account_period_value(GncBudget *budget, const Account *account,
         return;
     }
 
+    priv = get_loaded_private(budget);
     gnc_budget_begin_edit(budget);
-    frame = qof_instance_get_slots(QOF_INSTANCE(budget));
-    guid = xaccAccountGetGUID(account);
-    bufend = guid_to_string_buff(guid, path);
-    g_sprintf(bufend, "/%d", period_num);
-
+    row = get_row(priv, xaccAccountGetGUID(account), TRUE);
     if (gnc_numeric_check(val))
-        kvp_frame_set_value(frame, path, NULL);
+        set_cell(priv, row, period_num, gnc_numeric_zero(), CELL_DIRTY);
     else
-        kvp_frame_set_numeric(frame, path, val);
+        set_cell(priv, row, period_num, val, CELL_SET | CELL_DIRTY);
+    priv->values_dirty = TRUE;
     qof_instance_set_dirty(&budget->inst);
     gnc_budget_commit_edit(budget);
 
@@ -544,41 +801,68 @@ gboolean
 gnc_budget_is_account_period_value_set(const GncBudget *budget, const Account *account,
                                        guint period_num)
 {
-    gchar path[BUF_SIZE];
-    gchar *bufend;
-    KvpFrame *frame;
+    BudgetPrivate *priv;
+    gboolean is_set;
 
     g_return_val_if_fail(GNC_IS_BUDGET(budget), FALSE);
     g_return_val_if_fail(account, FALSE);
 
-    frame = qof_instance_get_slots(QOF_INSTANCE(budget));
-    bufend = guid_to_string_buff(xaccAccountGetGUID(account), path);
-    g_sprintf(bufend, "/%d", period_num);
-    return (kvp_frame_get_value(frame, path) != NULL);
+    priv = get_loaded_private(budget);
+    get_cell(priv, get_row(priv, xaccAccountGetGUID(account), FALSE),
+             period_num, &is_set);
+    return is_set;
 }
 
 gnc_numeric
 gnc_budget_get_account_period_value(const GncBudget *budget, const Account *account,
                                     guint period_num)
 {
-    gnc_numeric numeric;
-    gchar path[BUF_SIZE];
-    gchar *bufend;
-    KvpFrame *frame;
+    BudgetPrivate *priv;
 
-    numeric = gnc_numeric_zero();
-    g_return_val_if_fail(GNC_IS_BUDGET(budget), numeric);
-    g_return_val_if_fail(account, numeric);
+    g_return_val_if_fail(GNC_IS_BUDGET(budget), gnc_numeric_zero());
+    g_return_val_if_fail(account, gnc_numeric_zero());
 
-    frame = qof_instance_get_slots(QOF_INSTANCE(budget));
-    bufend = guid_to_string_buff(xaccAccountGetGUID(account), path);
-    g_sprintf(bufend, "/%d", period_num);
-
-    numeric = kvp_frame_get_numeric(frame, path);
+    priv = get_loaded_private(budget);
     /* This still returns zero if unset, but callers can check for that. */
-    return numeric;
+    return get_cell(priv, get_row(priv, xaccAccountGetGUID(account), FALSE),
+                    period_num, NULL);
+}
+
+void
+gnc_budget_get_account_values(const GncBudget *budget, const Account *account,
+                              gnc_numeric *values, gboolean *is_set)
+{
+    BudgetPrivate *priv;
+    guint row, i;
+
+    g_return_if_fail(GNC_IS_BUDGET(budget));
+    g_return_if_fail(account && values);
+
+    priv = get_loaded_private(budget);
+    row = get_row(priv, xaccAccountGetGUID(account), FALSE);
+    for (i = 0; i < priv->num_periods; i++)
+        values[i] = get_cell(priv, row, i, is_set ? &is_set[i] : NULL);
 }
 
+void
+gnc_budget_get_period_values(const GncBudget *budget, guint period_num,
+                             GList *accounts, gnc_numeric *values,
+                             gboolean *is_set)
+{
+    BudgetPrivate *priv;
+    GList *node;
+    guint i;
+
+    g_return_if_fail(GNC_IS_BUDGET(budget));
+    g_return_if_fail(values);
+
+    priv = get_loaded_private(budget);
+    for (node = accounts, i = 0; node; node = node->next, i++)
+    {
+        guint row = get_row(priv, xaccAccountGetGUID(node->data), FALSE);
+        values[i] = get_cell(priv, row, period_num, is_set ? &is_set[i] : NULL);
+    }
+}
 
 Timespec
 gnc_budget_get_period_start_date(const GncBudget *budget, guint period_num)
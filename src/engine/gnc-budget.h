@@ -147,6 +147,21 @@ gboolean gnc_budget_is_account_period_value_set(
 
 gnc_numeric gnc_budget_get_account_period_value(
     const GncBudget *budget, const Account *account, guint period_num);
+
+/** Get the amounts of account for all the budget's periods at once.
+ *  values must have room for gnc_budget_get_num_periods() amounts,
+ *  which are zero for periods without one.  If is_set isn't NULL, it
+ *  must be as long and tells which of the periods have an amount. */
+void gnc_budget_get_account_values(
+    const GncBudget *budget, const Account *account,
+    gnc_numeric *values, gboolean *is_set);
+
+/** Get the amounts of period period_num for each account in the list
+ *  accounts, in the same order.  values (and is_set, if it isn't NULL)
+ *  must be as long as the list. */
+void gnc_budget_get_period_values(
+    const GncBudget *budget, guint period_num, GList *accounts,
+    gnc_numeric *values, gboolean *is_set);
 gnc_numeric gnc_budget_get_account_period_actual_value(
     const GncBudget *budget, Account *account, guint period_num);
 
@@ -57,6 +57,7 @@ struct gnc_price_db_s
     QofInstance inst;              /* globally unique object identifier */
     GHashTable *commodity_hash;
     gboolean bulk_update;		 /* TRUE while reading XML file, etc. */
+    guint change_count;		 /* bumped whenever any price changes */
 };
 
 struct _GncPriceDBClass
@@ -105,4 +106,9 @@ gboolean gnc_pricedb_register (void);
 
 QofBackend * xaccPriceDBGetBackend (GNCPriceDB *prdb);
 
+/** Returns a counter that changes whenever a price is added to, removed
+ *  from or modified in the db, so that values derived from prices (such
+ *  as the cached account balances) can tell when they are stale. */
+guint gnc_pricedb_get_change_count (const GNCPriceDB *db);
+
 #endif
@@ -373,6 +373,8 @@ gnc_pricedb_commit_edit (GNCPriceDB *pdb)
 static void
 gnc_price_set_dirty (GNCPrice *p)
 {
+    if (p->db)
+        p->db->change_count++;
     qof_instance_set_dirty(&p->inst);
     qof_event_gen(&p->inst, QOF_EVENT_MODIFY, NULL);
 }
@@ -878,6 +880,12 @@ gnc_pricedb_get_db(QofBook *book)
     return gnc_collection_get_pricedb (col);
 }
 
+guint
+gnc_pricedb_get_change_count (const GNCPriceDB *db)
+{
+    return db ? db->change_count : 0;
+}
+
 /* ==================================================================== */
 
 static gboolean
@@ -1034,6 +1042,7 @@ add_price(GNCPriceDB *db, GNCPrice *p)
     }
     g_hash_table_insert(currency_hash, currency, price_list);
     p->db = db;
+    db->change_count++;
     qof_event_gen (&p->inst, QOF_EVENT_ADD, NULL);
 
     LEAVE ("db=%p, pr=%p dirty=%d dextroying=%d commodity=%s/%s currency_hash=%p",
@@ -1117,6 +1126,7 @@ remove_price(GNCPriceDB *db, GNCPrice *p, gboolean cleanup)
         return FALSE;
     }
 
+    db->change_count++;
     qof_event_gen (&p->inst, QOF_EVENT_REMOVE, NULL);
     price_list = g_hash_table_lookup(currency_hash, currency);
     gnc_price_ref(p);
@@ -0,0 +1,430 @@
+/********************************************************************\
+ * gnc-split-columns.c -- columnar read-only snapshot of splits     *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+
+#include <config.h>
+
+#include <glib.h>
+
+#include "Account.h"
+#include "Split.h"
+#include "Transaction.h"
+#include "gnc-event.h"
+#include "gnc-split-columns.h"
+
+static QofLogModule log_module = GNC_MOD_ENGINE;
+
+/* The entities whose events can change the snapshot, and those events */
+static const QofIdTypeConst split_columns_types[] =
+{
+    GNC_ID_SPLIT, GNC_ID_TRANS, GNC_ID_ACCOUNT
+};
+#define SPLIT_COLUMNS_N_TYPES G_N_ELEMENTS (split_columns_types)
+#define SPLIT_COLUMNS_EVENTS (QOF_EVENT_CREATE | QOF_EVENT_MODIFY | \
+                              QOF_EVENT_DESTROY | QOF_EVENT_ADD |   \
+                              QOF_EVENT_REMOVE | GNC_EVENT_ITEM_ADDED | \
+                              GNC_EVENT_ITEM_REMOVED | GNC_EVENT_ITEM_CHANGED)
+
+struct _GncSplitColumns
+{
+    QofBook *book;
+    gint handler_ids[SPLIT_COLUMNS_N_TYPES];
+    gboolean stale;
+
+    guint n_rows;
+    gint64 *amount_num;
+    gint64 *amount_denom;
+    gint64 *value_num;
+    gint64 *value_denom;
+    time64 *posted;
+    guint *account;
+    guint *trans;
+    char *reconcile;
+    Split **splits;
+
+    /* The rows of accounts->pdata[i] are account_start[i] up to
+     * account_start[i + 1]. */
+    GPtrArray *accounts;
+    guint *account_start;
+    GHashTable *account_index;      /* Account -> index + 1 */
+    GPtrArray *transactions;
+    GHashTable *trans_index;        /* Transaction -> index + 1 */
+};
+
+static void
+split_columns_clear (GncSplitColumns *cols)
+{
+    g_free (cols->amount_num);
+    g_free (cols->amount_denom);
+    g_free (cols->value_num);
+    g_free (cols->value_denom);
+    g_free (cols->posted);
+    g_free (cols->account);
+    g_free (cols->trans);
+    g_free (cols->reconcile);
+    g_free (cols->splits);
+    g_free (cols->account_start);
+    cols->amount_num = cols->amount_denom = NULL;
+    cols->value_num = cols->value_denom = NULL;
+    cols->posted = NULL;
+    cols->account = cols->trans = cols->account_start = NULL;
+    cols->reconcile = NULL;
+    cols->splits = NULL;
+    cols->n_rows = 0;
+
+    g_ptr_array_set_size (cols->accounts, 0);
+    g_ptr_array_set_size (cols->transactions, 0);
+    g_hash_table_remove_all (cols->account_index);
+    g_hash_table_remove_all (cols->trans_index);
+}
+
+static void
+count_account_splits (QofInstance *inst, gpointer data)
+{
+    Account *acc = GNC_ACCOUNT (inst);
+    GncSplitColumns *cols = data;
+    guint n = g_list_length (xaccAccountGetSplitList (acc));
+
+    if (n == 0)
+        return;
+    g_ptr_array_add (cols->accounts, acc);
+    g_hash_table_insert (cols->account_index, acc,
+                         GUINT_TO_POINTER (cols->accounts->len));
+    cols->n_rows += n;
+}
+
+static guint
+split_columns_trans_index (GncSplitColumns *cols, Transaction *trans)
+{
+    guint index = GPOINTER_TO_UINT (g_hash_table_lookup (cols->trans_index,
+                                    trans));
+    if (index == 0)
+    {
+        g_ptr_array_add (cols->transactions, trans);
+        index = cols->transactions->len;
+        g_hash_table_insert (cols->trans_index, trans,
+                             GUINT_TO_POINTER (index));
+    }
+    return index - 1;
+}
+
+static time64
+split_posted_date (const Split *split)
+{
+    Transaction *trans = xaccSplitGetParent (split);
+    return trans ? xaccTransGetDate (trans) : G_MAXINT64;
+}
+
+static gint
+split_posted_order (gconstpointer a, gconstpointer b)
+{
+    time64 da = split_posted_date (a), db = split_posted_date (b);
+    return da < db ? -1 : da > db;
+}
+
+/* The split list is in date order unless the account is waiting to be
+ * sorted, e.g. while it or one of its transactions is being edited. */
+static gboolean
+split_list_in_date_order (GList *node)
+{
+    for (; node && node->next; node = node->next)
+        if (split_posted_order (node->data, node->next->data) > 0)
+            return FALSE;
+    return TRUE;
+}
+
+static void
+split_columns_build (GncSplitColumns *cols)
+{
+    guint i, row = 0;
+
+    ENTER ("cols=%p", cols);
+    split_columns_clear (cols);
+    qof_collection_foreach (qof_book_get_collection (cols->book,
+                            GNC_ID_ACCOUNT),
+                            count_account_splits, cols);
+
+    cols->amount_num = g_new (gint64, cols->n_rows);
+    cols->amount_denom = g_new (gint64, cols->n_rows);
+    cols->value_num = g_new (gint64, cols->n_rows);
+    cols->value_denom = g_new (gint64, cols->n_rows);
+    cols->posted = g_new (time64, cols->n_rows);
+    cols->account = g_new (guint, cols->n_rows);
+    cols->trans = g_new (guint, cols->n_rows);
+    cols->reconcile = g_new (char, cols->n_rows);
+    cols->splits = g_new (Split *, cols->n_rows);
+    cols->account_start = g_new (guint, cols->accounts->len + 1);
+
+    for (i = 0; i < cols->accounts->len; i++)
+    {
+        GList *splits, *sorted = NULL, *node;
+
+        cols->account_start[i] = row;
+        splits = xaccAccountGetSplitList (g_ptr_array_index (cols->accounts, i));
+        /* The range sums binary-search the posted dates */
+        if (!split_list_in_date_order (splits))
+            splits = sorted = g_list_sort (g_list_copy (splits),
+                                           split_posted_order);
+        for (node = splits; node; node = node->next, row++)
+        {
+            Split *split = node->data;
+            Transaction *trans = xaccSplitGetParent (split);
+            gnc_numeric amount = xaccSplitGetAmount (split);
+            gnc_numeric value = xaccSplitGetValue (split);
+
+            cols->amount_num[row] = amount.num;
+            cols->amount_denom[row] = amount.denom;
+            cols->value_num[row] = value.num;
+            cols->value_denom[row] = value.denom;
+            cols->posted[row] = split_posted_date (split);
+            cols->account[row] = i;
+            cols->trans[row] = trans ? split_columns_trans_index (cols, trans)
+                               : G_MAXUINT;
+            cols->reconcile[row] = xaccSplitGetReconcile (split);
+            cols->splits[row] = split;
+        }
+        g_list_free (sorted);
+    }
+    cols->account_start[i] = row;
+    cols->stale = FALSE;
+    LEAVE ("%u rows, %u accounts, %u transactions", cols->n_rows,
+           cols->accounts->len, cols->transactions->len);
+}
+
+static inline void
+split_columns_update (GncSplitColumns *cols)
+{
+    if (cols->stale)
+        split_columns_build (cols);
+}
+
+static void
+split_columns_event_handler (QofInstance *ent, QofEventId event_type,
+                             gpointer handler_data, gpointer event_data)
+{
+    GncSplitColumns *cols = handler_data;
+
+    if (!cols->stale && qof_instance_get_book (ent) == cols->book)
+        cols->stale = TRUE;
+}
+
+GncSplitColumns *
+gnc_split_columns_new (QofBook *book)
+{
+    GncSplitColumns *cols;
+    guint i;
+
+    g_return_val_if_fail (book != NULL, NULL);
+
+    cols = g_new0 (GncSplitColumns, 1);
+    cols->book = book;
+    cols->stale = TRUE;
+    cols->accounts = g_ptr_array_new ();
+    cols->account_index = g_hash_table_new (g_direct_hash, g_direct_equal);
+    cols->transactions = g_ptr_array_new ();
+    cols->trans_index = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (i = 0; i < SPLIT_COLUMNS_N_TYPES; i++)
+        cols->handler_ids[i] =
+            qof_event_register_filtered_handler (split_columns_types[i],
+                    SPLIT_COLUMNS_EVENTS,
+                    split_columns_event_handler, cols);
+    return cols;
+}
+
+void
+gnc_split_columns_destroy (GncSplitColumns *cols)
+{
+    guint i;
+
+    if (!cols) return;
+
+    for (i = 0; i < SPLIT_COLUMNS_N_TYPES; i++)
+        qof_event_unregister_handler (cols->handler_ids[i]);
+    split_columns_clear (cols);
+    g_ptr_array_free (cols->accounts, TRUE);
+    g_ptr_array_free (cols->transactions, TRUE);
+    g_hash_table_destroy (cols->account_index);
+    g_hash_table_destroy (cols->trans_index);
+    g_free (cols);
+}
+
+void
+gnc_split_columns_invalidate (GncSplitColumns *cols)
+{
+    g_return_if_fail (cols != NULL);
+    cols->stale = TRUE;
+}
+
+guint
+gnc_split_columns_get_length (GncSplitColumns *cols)
+{
+    g_return_val_if_fail (cols != NULL, 0);
+    split_columns_update (cols);
+    return cols->n_rows;
+}
+
+#define SPLIT_COLUMNS_GETTER(type, name, field)                 \
+const type *                                                    \
+gnc_split_columns_get_##name (GncSplitColumns *cols)            \
+{                                                               \
+    g_return_val_if_fail (cols != NULL, NULL);                  \
+    split_columns_update (cols);                                \
+    return cols->field;                                         \
+}
+
+SPLIT_COLUMNS_GETTER (gint64, amount_nums, amount_num)
+SPLIT_COLUMNS_GETTER (gint64, amount_denoms, amount_denom)
+SPLIT_COLUMNS_GETTER (gint64, value_nums, value_num)
+SPLIT_COLUMNS_GETTER (gint64, value_denoms, value_denom)
+SPLIT_COLUMNS_GETTER (time64, posted_dates, posted)
+SPLIT_COLUMNS_GETTER (guint, account_indices, account)
+SPLIT_COLUMNS_GETTER (guint, trans_indices, trans)
+SPLIT_COLUMNS_GETTER (char, reconcile_flags, reconcile)
+
+#define SPLIT_COLUMNS_ROW_CHECK(cols, row, fail)             \
+    g_return_val_if_fail (cols != NULL, fail);                  \
+    split_columns_update (cols);                                \
+    g_return_val_if_fail (row < cols->n_rows, fail)
+
+gnc_numeric
+gnc_split_columns_get_row_amount (GncSplitColumns *cols, guint row)
+{
+    SPLIT_COLUMNS_ROW_CHECK (cols, row, gnc_numeric_zero ());
+    return gnc_numeric_create (cols->amount_num[row], cols->amount_denom[row]);
+}
+
+gnc_numeric
+gnc_split_columns_get_row_value (GncSplitColumns *cols, guint row)
+{
+    SPLIT_COLUMNS_ROW_CHECK (cols, row, gnc_numeric_zero ());
+    return gnc_numeric_create (cols->value_num[row], cols->value_denom[row]);
+}
+
+time64
+gnc_split_columns_get_row_posted_date (GncSplitColumns *cols, guint row)
+{
+    SPLIT_COLUMNS_ROW_CHECK (cols, row, 0);
+    return cols->posted[row];
+}
+
+char
+gnc_split_columns_get_row_reconcile_flag (GncSplitColumns *cols, guint row)
+{
+    SPLIT_COLUMNS_ROW_CHECK (cols, row, NREC);
+    return cols->reconcile[row];
+}
+
+Split *
+gnc_split_columns_get_split (GncSplitColumns *cols, guint row)
+{
+    g_return_val_if_fail (cols != NULL, NULL);
+    split_columns_update (cols);
+    g_return_val_if_fail (row < cols->n_rows, NULL);
+    return cols->splits[row];
+}
+
+Account *
+gnc_split_columns_get_account (GncSplitColumns *cols, guint index)
+{
+    g_return_val_if_fail (cols != NULL, NULL);
+    split_columns_update (cols);
+    g_return_val_if_fail (index < cols->accounts->len, NULL);
+    return g_ptr_array_index (cols->accounts, index);
+}
+
+Transaction *
+gnc_split_columns_get_transaction (GncSplitColumns *cols, guint index)
+{
+    g_return_val_if_fail (cols != NULL, NULL);
+    split_columns_update (cols);
+    g_return_val_if_fail (index < cols->transactions->len, NULL);
+    return g_ptr_array_index (cols->transactions, index);
+}
+
+gboolean
+gnc_split_columns_get_account_rows (GncSplitColumns *cols, const Account *acc,
+                                    guint *first, guint *last)
+{
+    guint index;
+
+    g_return_val_if_fail (cols != NULL, FALSE);
+    split_columns_update (cols);
+
+    index = GPOINTER_TO_UINT (g_hash_table_lookup (cols->account_index, acc));
+    if (index == 0)
+        return FALSE;
+    if (first) *first = cols->account_start[index - 1];
+    if (last) *last = cols->account_start[index];
+    return TRUE;
+}
+
+/* Index of the first row in [first, last) posted after date, or last */
+static guint
+split_columns_upper_bound (const GncSplitColumns *cols, guint first,
+                           guint last, time64 date)
+{
+    while (first < last)
+    {
+        guint mid = first + (last - first) / 2;
+        if (cols->posted[mid] <= date)
+            first = mid + 1;
+        else
+            last = mid;
+    }
+    return first;
+}
+
+static gnc_numeric
+split_columns_sum_account (GncSplitColumns *cols, const Account *acc,
+                           time64 start, time64 end, gboolean values)
+{
+    guint first, last;
+
+    g_return_val_if_fail (cols != NULL, gnc_numeric_zero ());
+    if (!gnc_split_columns_get_account_rows (cols, acc, &first, &last))
+        return gnc_numeric_zero ();
+    if (start > end)
+        return gnc_numeric_zero ();
+
+    if (start > G_MININT64)
+        first = split_columns_upper_bound (cols, first, last, start - 1);
+    last = split_columns_upper_bound (cols, first, last, end);
+    if (values)
+        return gnc_numeric_sum_columns (cols->value_num + first,
+                                        cols->value_denom + first,
+                                        last - first);
+    return gnc_numeric_sum_columns (cols->amount_num + first,
+                                    cols->amount_denom + first,
+                                    last - first);
+}
+
+gnc_numeric
+gnc_split_columns_sum_amount (GncSplitColumns *cols, const Account *acc,
+                              time64 start, time64 end)
+{
+    return split_columns_sum_account (cols, acc, start, end, FALSE);
+}
+
+gnc_numeric
+gnc_split_columns_sum_value (GncSplitColumns *cols, const Account *acc,
+                             time64 start, time64 end)
+{
+    return split_columns_sum_account (cols, acc, start, end, TRUE);
+}
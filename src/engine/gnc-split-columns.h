@@ -0,0 +1,125 @@
+/********************************************************************\
+ * gnc-split-columns.h -- columnar read-only snapshot of splits     *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+/** @addtogroup Engine
+    @{ */
+/** @addtogroup SplitColumns Split Columns: Read-only Split Snapshots
+ * A GncSplitColumns holds a copy of the data of all of the splits in
+ * a book that reports usually look at -- amount, value, posted date,
+ * account, transaction and reconcile state -- as parallel arrays.
+ * Scanning these arrays is much cheaper than walking the split lists
+ * and following the pointers of every Split to its Transaction.
+ *
+ * The rows are grouped by account, in the order of the account's
+ * split list, so the rows of one account are contiguous and sorted by
+ * posted date.  A split list that is waiting to be sorted is sorted by
+ * posted date for the snapshot.
+ *
+ * The snapshot listens for the events of the book's splits,
+ * transactions and accounts and is rebuilt on the next access after
+ * any of them changed.  Changes made while events are suspended are
+ * not seen; call gnc_split_columns_invalidate() after such changes.
+ *
+ * The column arrays are for C callers.  Scheme and Python get at the
+ * same data one row at a time with the row accessors below.
+ *
+ @{ */
+
+/** @file gnc-split-columns.h
+ */
+
+#ifndef GNC_SPLIT_COLUMNS_H
+#define GNC_SPLIT_COLUMNS_H
+
+#include "qof.h"
+#include "gnc-engine.h"
+
+typedef struct _GncSplitColumns GncSplitColumns;
+
+/** Create a snapshot of the splits of book.  It must be destroyed
+ *  before the book is. */
+GncSplitColumns * gnc_split_columns_new (QofBook *book);
+void gnc_split_columns_destroy (GncSplitColumns *cols);
+
+/** Force a rebuild of the snapshot on the next access. */
+void gnc_split_columns_invalidate (GncSplitColumns *cols);
+
+/** Number of rows (splits) in the snapshot. */
+guint gnc_split_columns_get_length (GncSplitColumns *cols);
+
+/** @name Columns
+ *  The returned arrays have gnc_split_columns_get_length() entries
+ *  and belong to the snapshot.  They are only valid until the next
+ *  change to the book.
+ @{ */
+const gint64 * gnc_split_columns_get_amount_nums (GncSplitColumns *cols);
+const gint64 * gnc_split_columns_get_amount_denoms (GncSplitColumns *cols);
+const gint64 * gnc_split_columns_get_value_nums (GncSplitColumns *cols);
+const gint64 * gnc_split_columns_get_value_denoms (GncSplitColumns *cols);
+const time64 * gnc_split_columns_get_posted_dates (GncSplitColumns *cols);
+/** Index of the account of each row, see gnc_split_columns_get_account() */
+const guint * gnc_split_columns_get_account_indices (GncSplitColumns *cols);
+/** Index of the transaction of each row, see
+ *  gnc_split_columns_get_transaction() */
+const guint * gnc_split_columns_get_trans_indices (GncSplitColumns *cols);
+/** The reconcile flag (NREC, CREC, ...) of each row */
+const char * gnc_split_columns_get_reconcile_flags (GncSplitColumns *cols);
+/** @} */
+
+/** @name Rows
+ *  The data of one row, for callers that can't use the arrays.
+ @{ */
+gnc_numeric gnc_split_columns_get_row_amount (GncSplitColumns *cols,
+        guint row);
+gnc_numeric gnc_split_columns_get_row_value (GncSplitColumns *cols,
+        guint row);
+time64 gnc_split_columns_get_row_posted_date (GncSplitColumns *cols,
+        guint row);
+char gnc_split_columns_get_row_reconcile_flag (GncSplitColumns *cols,
+        guint row);
+/** @} */
+
+/** @name Lookups
+ @{ */
+Split * gnc_split_columns_get_split (GncSplitColumns *cols, guint row);
+Account * gnc_split_columns_get_account (GncSplitColumns *cols, guint index);
+Transaction * gnc_split_columns_get_transaction (GncSplitColumns *cols,
+        guint index);
+
+/** Get the rows of account acc: they are the ones from *first up to,
+ *  but not including, *last.  Returns FALSE if acc has no splits. */
+gboolean gnc_split_columns_get_account_rows (GncSplitColumns *cols,
+        const Account *acc, guint *first, guint *last);
+/** @} */
+
+/** @name Aggregation
+ *  Sum the amounts or values of the splits of account acc posted
+ *  between start and end, inclusive.  The sum is exact; its
+ *  denominator is the least common one of the summands.
+ @{ */
+gnc_numeric gnc_split_columns_sum_amount (GncSplitColumns *cols,
+        const Account *acc, time64 start, time64 end);
+gnc_numeric gnc_split_columns_sum_value (GncSplitColumns *cols,
+        const Account *acc, time64 start, time64 end);
+/** @} */
+
+#endif /* GNC_SPLIT_COLUMNS_H */
+/** @} */
+/** @} */
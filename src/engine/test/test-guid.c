@@ -28,6 +28,8 @@
 
 #include "config.h"
 #include <ctype.h>
+#include <stdio.h>
+#include <string.h>
 #include <glib.h>
 #include "cashobjects.h"
 #include "test-stuff.h"
@@ -84,14 +86,147 @@ run_test (void)
     qof_session_destroy(sess);
 }
 
+static void
+test_random_guids (void)
+{
+    GncGUID *guids = g_new (GncGUID, NENT);
+    GHashTable *seen = guid_hash_table_new ();
+    QofBook *book = qof_book_new ();
+    int i;
+
+    /* New objects take their ids from the generator selected, even
+     * after ids were made with the other one */
+    xaccMallocAccount (book);
+    guid_init_with_generator (GNC_GUID_GENERATOR_RANDOM);
+    do_test (guid_get_generator () == GNC_GUID_GENERATOR_RANDOM,
+             "selected generator");
+    for (i = 0; i < 8; i++)
+    {
+        Account *acc = xaccMallocAccount (book);
+        do_test ((xaccAccountGetGUID (acc)->data[6] & 0xf0) == 0x40,
+                 "object guid from the random generator");
+    }
+    qof_book_destroy (book);
+
+    guid_new_n (guids, NENT);
+    for (i = 0; i < NENT; i++)
+    {
+        do_test ((guids[i].data[6] & 0xf0) == 0x40, "version 4 guid");
+        do_test ((guids[i].data[8] & 0xc0) == 0x80, "RFC 4122 variant guid");
+        do_test (g_hash_table_lookup (seen, &guids[i]) == NULL,
+                 "duplicate random guid");
+        g_hash_table_insert (seen, &guids[i], &guids[i]);
+    }
+    guid_new (&guids[0]);
+    do_test (g_hash_table_lookup (seen, &guids[0]) == NULL,
+             "duplicate random guid");
+    guid_init_with_generator (GNC_GUID_GENERATOR_MD5);
+
+    g_hash_table_destroy (seen);
+    g_free (guids);
+}
+
+static void
+test_guid_strings (void)
+{
+    GncGUID guids[3], decoded[3];
+    gchar buff[3 * (GUID_ENCODING_LENGTH + 1)];
+    gchar expected[GUID_ENCODING_LENGTH + 1];
+    gchar upper[GUID_ENCODING_LENGTH + 1];
+    const gchar *strings[3];
+    int i, j;
+
+    guid_new_n (guids, 3);
+    do_test (guid_to_string_buff_n (guids, 3, buff) == buff + sizeof (buff),
+             "end of bulk encoding");
+    for (i = 0; i < 3; i++)
+    {
+        strings[i] = buff + i * (GUID_ENCODING_LENGTH + 1);
+        for (j = 0; j < GUID_DATA_SIZE; j++)
+            g_snprintf (expected + 2 * j, 3, "%02x", guids[i].data[j]);
+        do_test (strcmp (strings[i], expected) == 0, "guid encoding");
+        do_test (strcmp (guid_to_string (&guids[i]), expected) == 0,
+                 "guid encoding");
+    }
+    do_test (string_to_guid_n (strings, 3, decoded), "bulk decoding");
+    for (i = 0; i < 3; i++)
+        do_test (guid_equal (&guids[i], &decoded[i]), "guid round trip");
+
+    for (i = 0; i < GUID_ENCODING_LENGTH; i++)
+        upper[i] = g_ascii_toupper (strings[0][i]);
+    upper[GUID_ENCODING_LENGTH] = '\0';
+    do_test (string_to_guid (upper, &decoded[0]) &&
+             guid_equal (&guids[0], &decoded[0]), "upper case guid");
+
+    /* A bad character or a short string anywhere is refused */
+    for (i = 0; i < GUID_ENCODING_LENGTH; i++)
+    {
+        gchar bad[GUID_ENCODING_LENGTH + 1];
+
+        strcpy (bad, strings[0]);
+        bad[i] = 'g';
+        do_test (!string_to_guid (bad, &decoded[0]), "bad guid character");
+        do_test (guid_equal (&decoded[0], guid_null ()), "bad guid zeroed");
+        bad[i] = '\0';
+        do_test (!string_to_guid (bad, &decoded[0]), "short guid string");
+    }
+    strings[1] = "not a guid";
+    do_test (!string_to_guid_n (strings, 3, decoded), "bulk decoding error");
+    do_test (guid_equal (&guids[0], &decoded[0]) &&
+             guid_equal (&decoded[1], guid_null ()) &&
+             guid_equal (&guids[2], &decoded[2]), "bulk decoding error");
+}
+
+/* Not part of the test run: compare the md5 and random generators.
+ * Run as test-guid --bench. */
+static void
+bench_guids (void)
+{
+    const int n = 1000000;
+    GncGUID *guids = g_new (GncGUID, n);
+    GTimer *timer = g_timer_new ();
+    gdouble md5_time, random_time, bulk_time;
+    int i;
+
+    guid_init_with_generator (GNC_GUID_GENERATOR_MD5);
+    g_timer_start (timer);
+    for (i = 0; i < n; i++)
+        guid_new (&guids[i]);
+    md5_time = g_timer_elapsed (timer, NULL);
+
+    guid_init_with_generator (GNC_GUID_GENERATOR_RANDOM);
+    g_timer_start (timer);
+    for (i = 0; i < n; i++)
+        guid_new (&guids[i]);
+    random_time = g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    guid_new_n (guids, n);
+    bulk_time = g_timer_elapsed (timer, NULL);
+    guid_init_with_generator (GNC_GUID_GENERATOR_MD5);
+
+    printf ("md5 guid_new: %.3f s, random guid_new: %.3f s, "
+            "random guid_new_n: %.3f s for %d guids\n",
+            md5_time, random_time, bulk_time, n);
+    g_timer_destroy (timer);
+    g_free (guids);
+}
+
 int
 main (int argc, char **argv)
 {
     qof_init();
     if (cashobjects_register())
     {
-        test_null_guid();
-        run_test ();
+        if (argc > 1 && strcmp (argv[1], "--bench") == 0)
+            bench_guids ();
+        else
+        {
+            test_null_guid();
+            run_test ();
+            test_random_guids ();
+            test_guid_strings ();
+        }
         print_test_results();
     }
     qof_close();
@@ -25,6 +25,8 @@
 
 #include "config.h"
 #include <ctype.h>
+#include <stdio.h>
+#include <string.h>
 #include <glib.h>
 #include "cashobjects.h"
 #include "test-stuff.h"
@@ -650,6 +652,141 @@ check_add_subtract_overflow (void)
 
 /* ======================================================= */
 
+static void
+check_sum (void)
+{
+    gnc_numeric values[101];
+    gnc_numeric expected, result;
+    int i, n;
+
+    do_test (gnc_numeric_zero_p (gnc_numeric_sum (values, 0)), "empty sum");
+
+    /* One denominator, every length up to the array size so that both
+     * the paired and the leftover values are exercised. */
+    for (n = 1; n <= 101; n++)
+    {
+        expected = gnc_numeric_zero ();
+        for (i = 0; i < n; i++)
+        {
+            values[i] = gnc_numeric_create (get_random_gint64 () % 100000000, 100);
+            expected = gnc_numeric_add (expected, values[i], GNC_DENOM_AUTO,
+                                        GNC_HOW_DENOM_LCD);
+        }
+        result = gnc_numeric_sum (values, n);
+        check_binary_op (expected, result, values[0], values[n - 1],
+                         "expected %s got %s = sum of %s .. %s");
+        do_test (result.denom == 100, "common denominator kept");
+    }
+
+    /* Mixed denominators */
+    expected = gnc_numeric_zero ();
+    for (i = 0; i < 101; i++)
+    {
+        values[i] = gnc_numeric_create (get_random_gint64 () % 100000000,
+                                        i % 7 ? 100 : 1000);
+        expected = gnc_numeric_add (expected, values[i], GNC_DENOM_AUTO,
+                                    GNC_HOW_DENOM_LCD);
+    }
+    result = gnc_numeric_sum (values, 101);
+    check_binary_op_equal (expected, result, values[0], values[100],
+                     "expected %s got %s = sum of %s .. %s");
+
+    /* Partial sums that overflow although the total doesn't */
+    values[0] = gnc_numeric_create (G_MAXINT64 - 10, 1);
+    values[1] = gnc_numeric_create (0, 1);
+    values[2] = gnc_numeric_create (20, 1);
+    values[3] = gnc_numeric_create (0, 1);
+    values[4] = gnc_numeric_create (-30, 1);
+    result = gnc_numeric_sum (values, 5);
+    check_binary_op (gnc_numeric_create (G_MAXINT64 - 20, 1), result,
+                     values[0], values[4],
+                     "expected %s got %s = sum of %s .. %s");
+
+    /* And a total that does overflow */
+    values[1] = gnc_numeric_create (G_MAXINT64 - 10, 1);
+    result = gnc_numeric_sum (values, 2);
+    do_test (gnc_numeric_check (result) == GNC_ERROR_OVERFLOW,
+             "overflowing sum");
+
+    values[1] = gnc_numeric_error (GNC_ERROR_ARG);
+    result = gnc_numeric_sum (values, 3);
+    do_test (gnc_numeric_check (result) != GNC_ERROR_OK, "error argument");
+}
+
+/* The same numbers kept as separate columns add up to the same sum */
+static void
+check_sum_columns (void)
+{
+    gnc_numeric values[101];
+    gint64 num[101], denom[101];
+    gnc_numeric result;
+    int i, n;
+
+    do_test (gnc_numeric_zero_p (gnc_numeric_sum_columns (num, denom, 0)),
+             "empty column sum");
+
+    for (n = 1; n <= 101; n++)
+    {
+        for (i = 0; i < n; i++)
+        {
+            values[i] = gnc_numeric_create (get_random_gint64 () % 100000000,
+                                            n % 2 || i % 7 ? 100 : 1000);
+            num[i] = values[i].num;
+            denom[i] = values[i].denom;
+        }
+        result = gnc_numeric_sum_columns (num, denom, n);
+        check_binary_op_equal (gnc_numeric_sum (values, n), result,
+                               values[0], values[n - 1],
+                               "expected %s got %s = column sum of %s .. %s");
+    }
+
+    num[0] = G_MAXINT64 - 10;
+    num[1] = G_MAXINT64 - 10;
+    denom[0] = denom[1] = 1;
+    result = gnc_numeric_sum_columns (num, denom, 2);
+    do_test (gnc_numeric_check (result) == GNC_ERROR_OVERFLOW,
+             "overflowing column sum");
+}
+
+/* Not part of the test run: compare gnc_numeric_sum with the loop of
+ * gnc_numeric_add_fixed used for account balances.  Run as
+ * test-numeric --bench. */
+static void
+bench_sum (void)
+{
+    const int n = 1000000, reps = 50;
+    gnc_numeric *values = g_new (gnc_numeric, n);
+    gnc_numeric loop_sum = gnc_numeric_zero (), sum = gnc_numeric_zero ();
+    GTimer *timer = g_timer_new ();
+    gdouble loop_time, sum_time;
+    int i, rep;
+
+    for (i = 0; i < n; i++)
+        values[i] = gnc_numeric_create (get_random_gint64 () % 100000000, 100);
+
+    g_timer_start (timer);
+    for (rep = 0; rep < reps; rep++)
+    {
+        loop_sum = gnc_numeric_zero ();
+        for (i = 0; i < n; i++)
+            loop_sum = gnc_numeric_add_fixed (loop_sum, values[i]);
+    }
+    loop_time = g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    for (rep = 0; rep < reps; rep++)
+        sum = gnc_numeric_sum (values, n);
+    sum_time = g_timer_elapsed (timer, NULL);
+
+    do_test (gnc_numeric_equal (sum, loop_sum), "benchmark sums agree");
+    printf ("gnc_numeric_add_fixed loop: %.3f s, gnc_numeric_sum: %.3f s "
+            "for %d x %d values\n", loop_time, sum_time, reps, n);
+    g_timer_destroy (timer);
+    g_free (values);
+}
+
+/* ======================================================= */
+
 
 static void
 check_mult_div (void)
@@ -975,6 +1112,8 @@ run_test (void)
     check_neg();
     check_add_subtract();
     check_add_subtract_overflow ();
+    check_sum ();
+    check_sum_columns ();
     check_mult_div ();
     check_reciprocal();
 }
@@ -985,7 +1124,10 @@ main (int argc, char **argv)
     qof_init();
     if (cashobjects_register())
     {
-        run_test ();
+        if (argc > 1 && strcmp (argv[1], "--bench") == 0)
+            bench_sum ();
+        else
+            run_test ();
         print_test_results();
     }
     qof_close();
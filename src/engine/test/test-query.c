@@ -24,6 +24,7 @@
 #include "config.h"
 #include <glib.h>
 #include "qof.h"
+#include "qofquery-p.h"
 #include "cashobjects.h"
 #include "Transaction.h"
 #include "TransLog.h"
@@ -65,6 +66,254 @@ test_trans_query (Transaction *trans, gpointer data)
     return 0;
 }
 
+static void
+count_in_range (QofInstance *inst, gpointer data)
+{
+    Split *split = (Split *) inst;
+    time64 *range = data;
+    time64 posted = xaccTransGetDate (xaccSplitGetParent (split));
+
+    if (posted >= range[0] && posted <= range[1])
+        range[2]++;
+}
+
+/* The indexes have to find the same splits as a scan would. */
+static void
+test_account_query (Account *acc, gpointer data)
+{
+    QofBook *book = data;
+    guint n_splits = qof_collection_count (qof_book_get_collection (
+            book, GNC_ID_SPLIT));
+    guint n_acc_splits = g_list_length (xaccAccountGetSplitList (acc));
+    Timespec ts_start = { 0, 0 }, ts_end = { 0, 0 };
+    time64 range[3];
+    QofQuery *q;
+    GList *list;
+
+    q = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (q, book);
+    xaccQueryAddSingleAccountMatch (q, acc, QOF_QUERY_AND);
+    list = qof_query_run (q);
+    if (g_list_length (list) != n_acc_splits)
+    {
+        failure_args ("account query", __FILE__, __LINE__,
+                      "found %d splits of %d", g_list_length (list),
+                      n_acc_splits);
+    }
+    else if (n_acc_splits < n_splits &&
+             !g_str_has_prefix (qof_query_get_plan (q), "index split-account"))
+    {
+        failure_args ("account query plan", __FILE__, __LINE__,
+                      "plan is %s", qof_query_get_plan (q));
+    }
+
+    /* With max_results only the last of the sorted results are kept */
+    if (n_acc_splits > 2)
+    {
+        QofQuery *q2 = qof_query_copy (q);
+        GList *all = list, *top;
+
+        qof_query_set_max_results (q2, 2);
+        top = qof_query_run (q2);
+        if (g_list_length (top) != 2 ||
+            top->data != g_list_nth_data (all, n_acc_splits - 2) ||
+            top->next->data != g_list_last (all)->data)
+            failure_args ("max results", __FILE__, __LINE__,
+                          "wrong %d results of %d", g_list_length (top),
+                          n_acc_splits);
+        qof_query_destroy (q2);
+    }
+    qof_query_destroy (q);
+
+    if (!n_acc_splits)
+        return;
+
+    /* The account term is cheaper than the description, so it has to
+     * be checked first although it was added last. */
+    q = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (q, book);
+    xaccQueryAddDescriptionMatch (q, "no such description", TRUE, FALSE,
+                                  QOF_QUERY_AND);
+    xaccQueryAddSingleAccountMatch (q, acc, QOF_QUERY_AND);
+    qof_query_run (q);
+    for (list = qof_query_get_terms (q)->data; list; list = list->next)
+    {
+        QofQueryTerm *qt = list->data;
+        guint64 evaluated, passed;
+
+        if (g_strcmp0 (qof_query_term_get_param_path (qt)->data, SPLIT_ACCOUNT))
+            continue;
+        qof_query_term_get_counts (qt, &evaluated, &passed);
+        if (evaluated < n_acc_splits || passed < n_acc_splits)
+            failure_args ("term order", __FILE__, __LINE__,
+                          "account term evaluated %d times for %d splits",
+                          (int) evaluated, n_acc_splits);
+    }
+    qof_query_destroy (q);
+
+    /* The dates of the account's first and last splits */
+    list = xaccAccountGetSplitList (acc);
+    range[0] = xaccTransGetDate (xaccSplitGetParent (list->data));
+    range[1] = xaccTransGetDate (xaccSplitGetParent (g_list_last (list)->data));
+    range[2] = 0;
+    qof_collection_foreach (qof_book_get_collection (book, GNC_ID_SPLIT),
+                            count_in_range, range);
+    ts_start.tv_sec = range[0];
+    ts_end.tv_sec = range[1];
+
+    q = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (q, book);
+    xaccQueryAddDateMatchTS (q, TRUE, ts_start, TRUE, ts_end, QOF_QUERY_AND);
+    list = qof_query_run (q);
+    if (g_list_length (list) != range[2])
+    {
+        failure_args ("date query", __FILE__, __LINE__,
+                      "found %d splits of %d", g_list_length (list),
+                      (int) range[2]);
+    }
+    qof_query_destroy (q);
+}
+
+/* While a transaction is open its new split isn't in the account's
+ * split list yet, so the index can't be used to find it.  The other
+ * accounts' indexes still can. */
+static void
+test_open_transaction_query (QofBook *book, Account *acc)
+{
+    Transaction *trans = get_random_transaction (book);
+    guint n_splits = qof_collection_count (qof_book_get_collection (
+            book, GNC_ID_SPLIT));
+    GList *accounts = gnc_account_get_descendants (gnc_account_get_root (acc));
+    Split *split;
+    QofQuery *q;
+    GList *list, *node;
+
+    xaccTransBeginEdit (trans);
+    split = xaccMallocSplit (book);
+    xaccSplitSetAccount (split, acc);
+    xaccSplitSetParent (split, trans);
+
+    q = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (q, book);
+    xaccQueryAddSingleAccountMatch (q, acc, QOF_QUERY_AND);
+    list = qof_query_run (q);
+    if (!g_list_find (list, split))
+        failure_args ("open transaction query", __FILE__, __LINE__,
+                      "missed the split of the open transaction, plan %s",
+                      qof_query_get_plan (q));
+    if (!g_str_has_prefix (qof_query_get_plan (q), "scan"))
+        failure_args ("open transaction plan", __FILE__, __LINE__,
+                      "plan is %s", qof_query_get_plan (q));
+    qof_query_destroy (q);
+
+    for (node = accounts; node; node = node->next)
+    {
+        guint n_acc_splits = g_list_length (xaccAccountGetSplitList (node->data));
+
+        if (node->data == acc || !n_acc_splits || n_acc_splits >= n_splits)
+            continue;
+        q = qof_query_create_for (GNC_ID_SPLIT);
+        qof_query_set_book (q, book);
+        xaccQueryAddSingleAccountMatch (q, node->data, QOF_QUERY_AND);
+        qof_query_run (q);
+        if (!g_str_has_prefix (qof_query_get_plan (q), "index split-account"))
+            failure_args ("open transaction, other account plan",
+                          __FILE__, __LINE__, "plan is %s",
+                          qof_query_get_plan (q));
+        qof_query_destroy (q);
+        break;
+    }
+    g_list_free (accounts);
+
+    xaccTransRollbackEdit (trans);
+}
+
+/* A live query has to give what a fresh run of the same query does */
+static void
+check_live_query (QofQuery *live, const char *what)
+{
+    QofQuery *q = qof_query_copy (live);
+    GList *live_list = qof_query_run (live);
+    GList *list = qof_query_run (q);
+
+    for (; list && live_list; list = list->next, live_list = live_list->next)
+        if (list->data != live_list->data)
+            break;
+    if (list || live_list)
+        failure_args ("live query", __FILE__, __LINE__,
+                      "results differ after %s", what);
+    qof_query_destroy (q);
+}
+
+static void
+test_live_query (QofBook *book, Account *root)
+{
+    GList *accounts = gnc_account_get_descendants (root);
+    Account *acc = accounts ? accounts->data : root;
+    QofQuery *live;
+    GList *splits;
+    Transaction *trans;
+    Split *split;
+
+    live = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (live, book);
+    xaccQueryAddSingleAccountMatch (live, acc, QOF_QUERY_AND);
+    qof_query_set_live (live, TRUE);
+    check_live_query (live, "the first run");
+
+    add_random_transactions_to_book (book, 5);
+    check_live_query (live, "adding transactions");
+
+    splits = xaccAccountGetSplitList (acc);
+    if (splits)
+    {
+        trans = xaccSplitGetParent (g_list_last (splits)->data);
+        make_random_changes_to_transaction_and_splits (book, trans, accounts);
+        check_live_query (live, "changing a transaction");
+
+        trans = xaccSplitGetParent (xaccAccountGetSplitList (acc)->data);
+        xaccTransBeginEdit (trans);
+        xaccTransDestroy (trans);
+        xaccTransCommitEdit (trans);
+        check_live_query (live, "destroying a transaction");
+    }
+
+    /* A rolled back split is freed without an event */
+    trans = get_random_transaction (book);
+    xaccTransBeginEdit (trans);
+    split = xaccMallocSplit (book);
+    xaccSplitSetAccount (split, acc);
+    xaccSplitSetParent (split, trans);
+    check_live_query (live, "adding a split");
+    xaccTransRollbackEdit (trans);
+    check_live_query (live, "rolling back a split");
+
+    /* The events dropped while suspended are made up for by the next run */
+    qof_event_suspend ();
+    add_random_transactions_to_book (book, 3);
+    qof_event_resume ();
+    check_live_query (live, "adding transactions with events suspended");
+
+    /* Only the last matches are kept, and the one before them is found
+     * when one of them goes */
+    qof_query_set_max_results (live, 2);
+    check_live_query (live, "setting max results");
+    splits = xaccAccountGetSplitList (acc);
+    if (splits)
+    {
+        trans = xaccSplitGetParent (g_list_last (splits)->data);
+        xaccTransBeginEdit (trans);
+        xaccTransDestroy (trans);
+        xaccTransCommitEdit (trans);
+        check_live_query (live, "destroying a kept match");
+    }
+    add_random_transactions_to_book (book, 5);
+    check_live_query (live, "adding transactions with max results");
+
+    qof_query_destroy (live);
+    g_list_free (accounts);
+}
+
 static void
 run_test (void)
 {
@@ -79,6 +328,10 @@ run_test (void)
     add_random_transactions_to_book (book, 20);
 
     xaccAccountTreeForEachTransaction (root, test_trans_query, book);
+    gnc_account_foreach_descendant (root, test_account_query, book);
+    if (gnc_account_n_children (root) > 0)
+        test_open_transaction_query (book, gnc_account_nth_child (root, 0));
+    test_live_query (book, root);
 
     qof_session_end (session);
 }
@@ -1186,12 +1186,155 @@ test_gnc_account_insert_remove_split (Fixture *fixture, gconstpointer pData)
     test_signal_free (sig3);
     test_signal_free (sig1);
 }
+static void
+check_split_order (AccountPrivate *priv)
+{
+    GList *node;
+    GSequenceIter *iter = g_sequence_get_begin_iter (priv->split_index);
+
+    g_assert_cmpint (g_sequence_get_length (priv->split_index), == ,
+                     g_list_length (priv->splits));
+    for (node = priv->splits; node; node = node->next)
+    {
+        g_assert (g_sequence_get (iter) == node);
+        g_assert (g_hash_table_lookup (priv->split_iters, node->data) == iter);
+        if (node->next)
+            g_assert_cmpint (xaccSplitOrder (node->data, node->next->data),
+                             < , 0);
+        iter = g_sequence_iter_next (iter);
+    }
+    g_assert (g_sequence_iter_is_end (iter));
+}
 /* xaccAccountSortSplits
 void
 xaccAccountSortSplits (Account *acc, gboolean force)// C: 4 in 2
 Make static?
-Passthrough, no test.
 */
+static void
+test_xaccAccountSortSplits (Fixture *fixture, gconstpointer pData)
+{
+    AccountPrivate *priv = fixture->func->get_private (fixture->acct);
+    Split *first = priv->splits->data, *last;
+    Transaction *txn = xaccSplitGetParent (first);
+    GList *splits, *node;
+    guint full, merges, repos, full2, merges2, repos2;
+    gint i;
+
+    check_split_order (priv);
+    g_assert (!priv->sort_dirty);
+    gnc_account_get_split_sort_counts (&full, &merges, &repos);
+    /* Moving the first transaction to the end only marks its split. */
+    xaccTransBeginEdit (txn);
+    xaccTransSetDatePostedSecs (txn, gnc_time (NULL) + 30 * 24 * 3600);
+    g_assert (priv->sort_dirty);
+    g_assert (!priv->sort_all);
+    g_assert_cmpint (g_hash_table_size (priv->moved_splits), == , 1);
+    xaccAccountSortSplits (fixture->acct, TRUE);
+    g_assert (!priv->sort_dirty);
+    g_assert_cmpint (g_hash_table_size (priv->moved_splits), == , 0);
+    g_assert (g_list_last (priv->splits)->data == first);
+    check_split_order (priv);
+    gnc_account_get_split_sort_counts (&full2, &merges2, &repos2);
+    g_assert_cmpuint (repos2, == , repos + 1);
+    g_assert_cmpuint (merges2, == , merges);
+    g_assert_cmpuint (full2, == , full);
+    /* Moving it back leaves the index out of order until the next sort,
+     * so a split inserted meanwhile waits with the moved one instead of
+     * being binary-inserted. */
+    xaccTransSetDatePostedSecs (txn, gnc_time (NULL) - 30 * 24 * 3600);
+    last = g_list_previous (g_list_last (priv->splits))->data;
+    g_assert (gnc_account_remove_split (fixture->acct, last));
+    g_assert (gnc_account_insert_split (fixture->acct, last));
+    g_assert_cmpint (g_hash_table_size (priv->moved_splits), == , 2);
+    xaccAccountSortSplits (fixture->acct, TRUE);
+    g_assert (priv->splits->data == first);
+    check_split_order (priv);
+    gnc_account_get_split_sort_counts (&full2, NULL, NULL);
+    /* Now force a full sort. */
+    gnc_account_set_sort_dirty (fixture->acct);
+    g_assert (priv->sort_all);
+    xaccAccountSortSplits (fixture->acct, TRUE);
+    g_assert (!priv->sort_dirty);
+    g_assert (!priv->sort_all);
+    g_assert (priv->splits->data == first);
+    check_split_order (priv);
+    gnc_account_get_split_sort_counts (&full, NULL, NULL);
+    g_assert_cmpuint (full, == , full2 + 1);
+    qof_commit_edit (QOF_INSTANCE (txn));
+
+    /* Reversing the order of all of the splits merges them back in. */
+    gnc_account_get_split_sort_counts (&full, &merges, &repos);
+    splits = g_list_copy (priv->splits);
+    for (node = splits, i = 0; node; node = node->next, i++)
+    {
+        Transaction *t = xaccSplitGetParent (node->data);
+        xaccTransBeginEdit (t);
+        xaccTransSetDatePostedSecs (t, gnc_time (NULL) + (100 - i) * 24 * 3600);
+    }
+    g_assert (priv->sort_dirty);
+    g_assert (!priv->sort_all);
+    xaccAccountSortSplits (fixture->acct, TRUE);
+    check_split_order (priv);
+    g_assert (priv->splits->data == g_list_last (splits)->data);
+    g_assert (g_list_last (priv->splits)->data == splits->data);
+    gnc_account_get_split_sort_counts (&full2, &merges2, &repos2);
+    g_assert_cmpuint (merges2, == , merges + 1);
+    g_assert_cmpuint (full2, == , full);
+    g_assert_cmpuint (repos2, == , repos);
+    for (node = splits; node; node = node->next)
+        qof_commit_edit (QOF_INSTANCE (xaccSplitGetParent (node->data)));
+    g_list_free (splits);
+}
+/* gnc_account_bulk_load_end
+static void
+gnc_account_bulk_load_end (QofBook *book)// Local: 0:1:0
+*/
+static void
+test_gnc_account_bulk_load (Fixture *fixture, gconstpointer pData)
+{
+    AccountPrivate *priv = fixture->func->get_private (fixture->acct);
+    QofBook *book = gnc_account_get_book (fixture->acct);
+    Split *last = g_list_last (priv->splits)->data;
+    guint n_splits = g_list_length (priv->splits);
+    gnc_numeric balance = priv->balance;
+    TestSignal sig1, sig2;
+
+    sig1 = test_signal_new (&fixture->acct->inst, QOF_EVENT_MODIFY, NULL);
+    sig2 = test_signal_new (&book->inst, QOF_EVENT_MODIFY, NULL);
+    check_split_order (priv);
+    qof_book_begin_bulk_load (book);
+    qof_book_begin_bulk_load (book);
+    g_assert (qof_book_is_bulk_loading (book));
+    /* Reinserting the last split puts it in front, unsorted. */
+    g_assert (gnc_account_remove_split (fixture->acct, last));
+    g_assert (gnc_account_insert_split (fixture->acct, last));
+    g_assert_cmpuint (g_list_length (priv->splits), == , n_splits);
+    g_assert (priv->splits->data == last);
+    g_assert (priv->sort_dirty);
+    g_assert (priv->sort_all);
+    g_assert_cmpint (g_hash_table_size (priv->moved_splits), == , 0);
+    /* Nothing is caught up until the outer bulk load ends */
+    xaccAccountSortSplits (fixture->acct, FALSE);
+    xaccAccountRecomputeBalance (fixture->acct);
+    g_assert (priv->sort_dirty);
+    g_assert (priv->balance_dirty);
+    qof_book_end_bulk_load (book);
+    g_assert (qof_book_is_bulk_loading (book));
+    g_assert (priv->sort_dirty);
+    test_signal_assert_hits (sig2, 0);
+    qof_book_end_bulk_load (book);
+    g_assert (!qof_book_is_bulk_loading (book));
+    g_assert (!priv->sort_dirty);
+    g_assert (!priv->balance_dirty);
+    g_assert (g_list_last (priv->splits)->data == last);
+    check_split_order (priv);
+    g_assert (gnc_numeric_equal (priv->balance, balance));
+    test_signal_assert_hits (sig1, 0);
+    test_signal_assert_hits (sig2, 1);
+
+    test_signal_free (sig1);
+    test_signal_free (sig2);
+}
 /* xaccAccountBringUpToDate
 static void
 xaccAccountBringUpToDate (Account *acc)// 3
@@ -1339,6 +1482,28 @@ test_xaccAccountRecomputeBalance (Fixture *fixture, gconstpointer pData)
     g_assert (gnc_numeric_eq (priv->cleared_balance, clr_bal));
     g_assert (gnc_numeric_eq (priv->reconciled_balance, rec_bal));
     g_assert (!priv->balance_dirty);
+    g_assert_cmpint (priv->balance_dirty_pos, == , -1);
+
+    /* Marking the last split only recomputes from there, so sneaking a
+     * different starting balance in doesn't show up ... */
+    priv->starting_balance = gnc_numeric_create (100, 1);
+    gnc_account_set_split_balance_dirty (fixture->acct,
+                                         g_list_last (priv->splits)->data);
+    g_assert (priv->balance_dirty);
+    g_assert_cmpint (priv->balance_dirty_pos, == ,
+                     g_list_length (priv->splits) - 1);
+    xaccAccountRecomputeBalance (fixture->acct);
+    g_assert (gnc_numeric_eq (priv->balance, bal));
+    g_assert (!priv->balance_dirty);
+    g_assert_cmpint (priv->balance_dirty_pos, == , -1);
+    /* ... until the whole account is marked. */
+    gnc_account_set_split_balance_dirty (fixture->acct,
+                                         g_list_last (priv->splits)->data);
+    gnc_account_set_start_balance (fixture->acct, priv->starting_balance);
+    g_assert_cmpint (priv->balance_dirty_pos, == , -1);
+    xaccAccountRecomputeBalance (fixture->acct);
+    g_assert (gnc_numeric_eq (priv->balance,
+                              gnc_numeric_add_fixed (bal, priv->starting_balance)));
 }
 
 /* xaccAccountOrder
@@ -1749,6 +1914,114 @@ test_gnc_account_lookup_by_full_name (Fixture *fixture, gconstpointer pData)
     g_assert (target == NULL);
     g_free (code);
 }
+/* The lookups go through the book's name and code indexes; make sure
+ * that those follow renames, moves and deletions and that ambiguous
+ * names still resolve to the first account in tree order. */
+static void
+test_gnc_account_lookup_index (Fixture *fixture, gconstpointer pData)
+{
+    Account *root, *taxable, *exempt, *target, *acct;
+    QofBook *book = gnc_account_get_book (fixture->acct);
+
+    root = gnc_account_get_root (fixture->acct);
+    taxable = gnc_account_lookup_by_full_name (root, "income:taxable");
+    exempt = gnc_account_lookup_by_full_name (root, "income:exempt");
+    g_assert (taxable != NULL && exempt != NULL);
+
+    /* "int" is both under taxable and exempt */
+    target = gnc_account_lookup_by_name (root, "int");
+    g_assert_cmpstr (xaccAccountGetCode (target), == , "4160");
+    target = gnc_account_lookup_by_name (exempt, "int");
+    g_assert_cmpstr (xaccAccountGetCode (target), == , "4210");
+    g_assert (gnc_account_lookup_by_name (exempt, "exempt") == NULL);
+
+    /* Renaming */
+    target = gnc_account_lookup_by_name (root, "gift");
+    xaccAccountSetName (target, "present");
+    g_assert (gnc_account_lookup_by_name (root, "gift") == NULL);
+    g_assert (gnc_account_lookup_by_name (root, "present") == target);
+    g_assert (gnc_account_lookup_by_full_name (root, "income:exempt:present")
+              == target);
+    g_assert (gnc_account_lookup_by_full_name (root, "income:exempt:gift")
+              == NULL);
+    /* Renaming a parent changes the full names of its children */
+    xaccAccountSetName (exempt, "tax-free");
+    g_assert (gnc_account_lookup_by_full_name (root, "income:exempt:present")
+              == NULL);
+    g_assert (gnc_account_lookup_by_full_name (root, "income:tax-free:present")
+              == target);
+
+    /* Codes */
+    xaccAccountSetCode (target, "4225");
+    g_assert (gnc_account_lookup_by_code (root, "4220") == NULL);
+    g_assert (gnc_account_lookup_by_code (root, "4225") == target);
+    g_assert (gnc_account_lookup_by_code (taxable, "4225") == NULL);
+    target = gnc_account_lookup_by_code (root, "4140");
+    g_assert_cmpstr (xaccAccountGetName (target), == , "div");
+
+    /* Deleting it */
+    target = gnc_account_lookup_by_name (root, "present");
+    xaccAccountBeginEdit (target);
+    xaccAccountDestroy (target);
+    g_assert (gnc_account_lookup_by_name (root, "present") == NULL);
+    g_assert (gnc_account_lookup_by_code (root, "4225") == NULL);
+
+    /* A new account with the name of an existing one */
+    acct = xaccMallocAccount (book);
+    xaccAccountSetName (acct, "ltcg");
+    gnc_account_append_child (exempt, acct);
+    target = gnc_account_lookup_by_name (root, "ltcg");
+    g_assert_cmpstr (xaccAccountGetCode (target), == , "4120");
+    g_assert (gnc_account_lookup_by_name (exempt, "ltcg") == acct);
+    g_assert (gnc_account_lookup_by_full_name (root, "income:tax-free:ltcg")
+              == acct);
+    g_assert (gnc_account_lookup_by_full_name (root, "income:ltcg") == NULL);
+    g_assert (gnc_account_lookup_by_full_name (root, "income:tax-free:") == NULL);
+}
+
+/* An account moved to another book has to be found through that
+ * book's indexes, and no longer through those of its old book. */
+static void
+test_gnc_account_lookup_index_books (Fixture *fixture, gconstpointer pData)
+{
+    Account *root = gnc_account_get_root (fixture->acct);
+    QofBook *book = gnc_account_get_book (fixture->acct);
+    QofBook *other_book = qof_book_new ();
+    Account *other_root = gnc_account_create_root (other_book);
+    Account *other = xaccMallocAccount (other_book);
+    Account *exempt = gnc_account_lookup_by_full_name (root, "income:exempt");
+    Account *target = gnc_account_lookup_by_name (root, "gift");
+    gchar *logdomain = "gnc.account";
+    gchar *msg = "[gnc_account_append_child()] reparenting accounts across books is not correctly supported\n";
+    guint log_handler = 0;
+    TestErrorStruct check_warn = {G_LOG_LEVEL_WARNING | G_LOG_FLAG_FATAL, "gnc.account", msg, 0 };
+
+    g_assert (exempt != NULL && target != NULL);
+    /* The other book has got an index of its own */
+    xaccAccountSetName (other, "other");
+    gnc_account_append_child (other_root, other);
+
+    log_handler = g_log_set_handler (logdomain, G_LOG_LEVEL_WARNING | G_LOG_FLAG_FATAL | G_LOG_FLAG_RECURSION, (GLogFunc)test_null_handler, &check_warn);
+    g_test_log_set_fatal_handler ((GTestLogFatalFunc)test_checked_handler, &check_warn);
+    gnc_account_append_child (other_root, target);
+    g_assert (gnc_account_get_book (target) == other_book);
+    g_assert (gnc_account_lookup_by_name (root, "gift") == NULL);
+    g_assert (gnc_account_lookup_by_name (other_root, "gift") == target);
+    g_assert (gnc_account_lookup_by_code (other_root, "4220") == target);
+    g_assert (gnc_account_lookup_by_name (other_root, "other") == other);
+
+    /* And back again */
+    gnc_account_append_child (exempt, target);
+    g_log_remove_handler (logdomain, log_handler);
+    g_assert_cmpint (check_warn.hits, ==, 2);
+    g_assert (gnc_account_get_book (target) == book);
+    g_assert (gnc_account_lookup_by_name (other_root, "gift") == NULL);
+    g_assert (gnc_account_lookup_by_name (root, "gift") == target);
+    g_assert (gnc_account_lookup_by_full_name (root, "income:exempt:gift")
+              == target);
+
+    qof_book_destroy (other_book);
+}
 
 static void
 thunk (Account *s, gpointer data)
@@ -1938,6 +2211,26 @@ test_xaccAccountGetBalanceAsOfDate (Fixture *fixture, gconstpointer pData)
                                          (gnc_time (NULL) - offset));
     dval = gnc_numeric_to_double (val);
     g_assert_cmpfloat (dval, == , dbal);
+
+    /* The batch version must agree with the single lookups, before,
+     * between and after all of the splits. */
+    {
+        time64 now = gnc_time (NULL), dates[5];
+        gnc_numeric balances[5];
+        dates[0] = now - 10 * offset;
+        dates[1] = now - offset;
+        dates[2] = now - offset;
+        dates[3] = now;
+        dates[4] = now + 10 * offset;
+        xaccAccountGetBalancesAsOfDates (fixture->acct, dates, 5, balances);
+        g_assert (gnc_numeric_zero_p (balances[0]));
+        for (ind = 0; ind < 5; ind++)
+            g_assert (gnc_numeric_equal (balances[ind],
+                                         xaccAccountGetBalanceAsOfDate (
+                                             fixture->acct, dates[ind])));
+        g_assert (gnc_numeric_equal (balances[4],
+                                     xaccAccountGetBalance (fixture->acct)));
+    }
 }
 /* xaccAccountGetPresentBalance
 gnc_numeric
@@ -1965,6 +2258,114 @@ test_xaccAccountGetPresentBalance (Fixture *fixture, gconstpointer pData)
     dval = gnc_numeric_to_double (val);
     g_assert_cmpfloat (dval, == , dbal);
 }
+/* xaccAccountGetBalanceInCurrency with include_children caches the
+ * totals of each subtree; check that they're reused and dropped.
+ */
+static void
+test_xaccAccountGetBalanceInCurrency_cached (Fixture *fixture,
+        gconstpointer pData)
+{
+    Account *root = fixture->acct;
+    QofBook *book = gnc_account_get_book (root);
+    Account *parent = xaccMallocAccount (book);
+    Account *child = xaccMallocAccount (book);
+    AccountPrivate *r_priv = fixture->func->get_private (root);
+    AccountPrivate *p_priv = fixture->func->get_private (parent);
+    AccountPrivate *c_priv = fixture->func->get_private (child);
+    gnc_commodity *usd = gnc_commodity_new (book, "US Dollar", "CURRENCY",
+                                            "USD", "0", 100);
+    gnc_numeric amt = gnc_numeric_create (12345, 100);
+    gnc_numeric bal;
+
+    xaccAccountSetCommodity (root, usd);
+    xaccAccountSetCommodity (parent, usd);
+    xaccAccountSetCommodity (child, usd);
+    gnc_account_append_child (root, parent);
+    gnc_account_append_child (parent, child);
+    gnc_account_set_start_balance (child, amt);
+    xaccAccountRecomputeBalance (child);
+
+    bal = xaccAccountGetBalanceInCurrency (root, usd, TRUE);
+    g_assert (gnc_numeric_equal (bal, amt));
+    g_assert_cmpuint (g_hash_table_size (r_priv->subtree_balances), == , 1);
+    g_assert_cmpuint (g_hash_table_size (p_priv->subtree_balances), == , 1);
+    g_assert_cmpuint (g_hash_table_size (c_priv->subtree_balances), == , 1);
+    /* A different kind of balance gets its own entry */
+    bal = xaccAccountGetClearedBalanceInCurrency (parent, usd, TRUE);
+    g_assert (gnc_numeric_zero_p (bal));
+    g_assert_cmpuint (g_hash_table_size (p_priv->subtree_balances), == , 2);
+    g_assert_cmpuint (g_hash_table_size (r_priv->subtree_balances), == , 1);
+
+    /* Changing the child's balance drops the totals up to the root ... */
+    gnc_account_set_start_balance (child, gnc_numeric_add_fixed (amt, amt));
+    g_assert_cmpuint (g_hash_table_size (c_priv->subtree_balances), == , 0);
+    g_assert_cmpuint (g_hash_table_size (p_priv->subtree_balances), == , 0);
+    g_assert_cmpuint (g_hash_table_size (r_priv->subtree_balances), == , 0);
+    xaccAccountRecomputeBalance (child);
+    bal = xaccAccountGetBalanceInCurrency (root, usd, TRUE);
+    g_assert (gnc_numeric_equal (bal, gnc_numeric_add_fixed (amt, amt)));
+
+    /* ... and so does taking it out of the tree. */
+    gnc_account_remove_child (parent, child);
+    g_assert_cmpuint (g_hash_table_size (p_priv->subtree_balances), == , 0);
+    g_assert_cmpuint (g_hash_table_size (r_priv->subtree_balances), == , 0);
+    bal = xaccAccountGetBalanceInCurrency (root, usd, TRUE);
+    g_assert (gnc_numeric_zero_p (bal));
+    xaccAccountBeginEdit (child);
+    xaccAccountDestroy (child);
+}
+/* The cached totals round the same as adding up the accounts one by
+ * one in the report commodity's fraction.
+ */
+static void
+test_xaccAccountGetBalanceInCurrency_rounding (Fixture *fixture,
+        gconstpointer pData)
+{
+    Account *root = fixture->acct;
+    QofBook *book = gnc_account_get_book (root);
+    Account *parent = xaccMallocAccount (book);
+    Account *child = xaccMallocAccount (book);
+    AccountPrivate *p_priv = fixture->func->get_private (parent);
+    gnc_commodity *mills = gnc_commodity_new (book, "US Dollar", "CURRENCY",
+                           "USD", "0", 1000);
+    gnc_commodity *usd = gnc_commodity_new (book, "US Dollar", "CURRENCY",
+                                            "USD", "0", 100);
+    gnc_numeric half_cent = gnc_numeric_create (5, 1000);
+    gnc_numeric bal;
+    time64 date;
+    gint i;
+
+    xaccAccountSetCommodity (root, mills);
+    xaccAccountSetCommodity (parent, mills);
+    xaccAccountSetCommodity (child, mills);
+    gnc_account_append_child (root, parent);
+    gnc_account_append_child (parent, child);
+    gnc_account_set_start_balance (parent, half_cent);
+    gnc_account_set_start_balance (child, half_cent);
+    xaccAccountRecomputeBalance (parent);
+    xaccAccountRecomputeBalance (child);
+
+    /* 0 + 0.005 rounds to 0.01, + 0.005 to 0.02; adding the parent's
+     * own total of 0.01 instead would give 0.01. */
+    bal = xaccAccountGetBalanceInCurrency (root, usd, TRUE);
+    g_assert_cmpint (bal.num, == , 2);
+    g_assert_cmpint (bal.denom, == , 100);
+    bal = xaccAccountGetBalanceInCurrency (parent, usd, TRUE);
+    g_assert_cmpint (bal.num, == , 1);
+    bal = xaccAccountGetBalanceInCurrency (root, usd, TRUE);
+    g_assert_cmpint (bal.num, == , 2);
+
+    /* One entry per as-of date, but only so many of them. */
+    date = gnc_time (NULL);
+    for (i = 0; i < 100; i++)
+        xaccAccountGetBalanceAsOfDateInCurrency (parent, date - i * 3600,
+                usd, TRUE);
+    g_assert_cmpuint (g_hash_table_size (p_priv->subtree_balances), <= , 32);
+
+    gnc_account_remove_child (parent, child);
+    xaccAccountBeginEdit (child);
+    xaccAccountDestroy (child);
+}
 /*
  * xaccAccountConvertBalanceToCurrency
  * xaccAccountConvertBalanceToCurrencyAsOfDate are wrappers around
@@ -2527,6 +2928,8 @@ test_suite_account (void)
 // GNC_TEST_ADD (suitename, "xaccAcctChildrenEqual", Fixture, NULL, setup, test_xaccAcctChildrenEqual,  teardown );
 // GNC_TEST_ADD (suitename, "xaccAccountEqual", Fixture, NULL, setup, test_xaccAccountEqual,  teardown );
     GNC_TEST_ADD (suitename, "gnc account insert & remove split", Fixture, NULL, setup, test_gnc_account_insert_remove_split,  teardown );
+    GNC_TEST_ADD (suitename, "xaccAccountSortSplits", Fixture, &some_data, setup, test_xaccAccountSortSplits,  teardown );
+    GNC_TEST_ADD (suitename, "gnc account bulk load", Fixture, &some_data, setup, test_gnc_account_bulk_load,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccount Insert and Remove Lot", Fixture, &good_data, setup, test_xaccAccountInsertRemoveLot,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountRecomputeBalance", Fixture, &some_data, setup, test_xaccAccountRecomputeBalance,  teardown );
     GNC_TEST_ADD_FUNC (suitename, "xaccAccountOrder", test_xaccAccountOrder );
@@ -2541,12 +2944,16 @@ test_suite_account (void)
     GNC_TEST_ADD (suitename, "gnc account lookup by code", Fixture, &complex, setup, test_gnc_account_lookup_by_code,  teardown );
     GNC_TEST_ADD (suitename, "gnc account lookup by full name helper", Fixture, &complex, setup, test_gnc_account_lookup_by_full_name_helper,  teardown );
     GNC_TEST_ADD (suitename, "gnc account lookup by full name", Fixture, &complex, setup, test_gnc_account_lookup_by_full_name,  teardown );
+    GNC_TEST_ADD (suitename, "gnc account lookup index", Fixture, &complex, setup, test_gnc_account_lookup_index,  teardown );
+    GNC_TEST_ADD (suitename, "gnc account lookup index across books", Fixture, &complex, setup, test_gnc_account_lookup_index_books,  teardown );
     GNC_TEST_ADD (suitename, "gnc account foreach child", Fixture, &complex, setup, test_gnc_account_foreach_child,  teardown );
     GNC_TEST_ADD (suitename, "gnc account foreach descendant", Fixture, &complex, setup, test_gnc_account_foreach_descendant,  teardown );
     GNC_TEST_ADD (suitename, "gnc account foreach descendant until", Fixture, &complex, setup, test_gnc_account_foreach_descendant_until,  teardown );
     GNC_TEST_ADD (suitename, "gnc account get full name", Fixture, &good_data, setup, test_gnc_account_get_full_name,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountGetProjectedMinimumBalance", Fixture, &some_data, setup, test_xaccAccountGetProjectedMinimumBalance,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountGetBalanceAsOfDate", Fixture, &some_data, setup, test_xaccAccountGetBalanceAsOfDate,  teardown );
+    GNC_TEST_ADD (suitename, "xaccAccountGetBalanceInCurrency cached", Fixture, NULL, setup, test_xaccAccountGetBalanceInCurrency_cached,  teardown );
+    GNC_TEST_ADD (suitename, "xaccAccountGetBalanceInCurrency rounding", Fixture, NULL, setup, test_xaccAccountGetBalanceInCurrency_rounding,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountGetPresentBalance", Fixture, &some_data, setup, test_xaccAccountGetPresentBalance,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountFindOpenLots", Fixture, &complex_data, setup, test_xaccAccountFindOpenLots,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountForEachLot", Fixture, &complex_data, setup, test_xaccAccountForEachLot,  teardown );
@@ -26,6 +26,7 @@
 #include <gnc-event.h>
 /* Add specific headers for this class */
 #include "gnc-budget.h"
+#include "qofinstance-p.h"
 
 static const gchar *suitename = "/engine/Budget";
 void test_suite_budget(void);
@@ -2582,6 +2583,89 @@ test_gnc_set_budget_account_period_value()
     gnc_budget_destroy(budget);
 }
 
+static void
+test_gnc_budget_account_values()
+{
+    QofBook *book = qof_book_new();
+    GncBudget* budget = gnc_budget_new(book);
+    GncBudget* loaded = gnc_budget_new(book);
+    Account *root, *acc1, *acc2;
+    GList *accounts = NULL;
+    gnc_numeric values[12];
+    gboolean is_set[12];
+    gchar path[GUID_ENCODING_LENGTH + 5];
+    gchar *bufend;
+    KvpFrame *slots;
+
+    root = gnc_account_create_root(book);
+    acc1 = xaccMallocAccount(book);
+    acc2 = xaccMallocAccount(book);
+    gnc_account_append_child(root, acc1);
+    gnc_account_append_child(root, acc2);
+
+    gnc_budget_set_account_period_value(budget, acc1, 0, gnc_numeric_create(100,1));
+    gnc_budget_set_account_period_value(budget, acc1, 11, gnc_numeric_create(300,1));
+    gnc_budget_set_account_period_value(budget, acc2, 11, gnc_numeric_create(50,1));
+
+    /* A whole row */
+    gnc_budget_get_account_values(budget, acc1, values, is_set);
+    g_assert(is_set[0] && is_set[11] && !is_set[5]);
+    g_assert(gnc_numeric_equal(values[0], gnc_numeric_create(100,1)));
+    g_assert(gnc_numeric_equal(values[11], gnc_numeric_create(300,1)));
+    g_assert(gnc_numeric_zero_p(values[5]));
+    gnc_budget_get_account_values(budget, root, values, is_set);
+    g_assert(!is_set[0] && gnc_numeric_zero_p(values[11]));
+
+    /* A whole column */
+    accounts = g_list_append(accounts, acc2);
+    accounts = g_list_append(accounts, root);
+    accounts = g_list_append(accounts, acc1);
+    gnc_budget_get_period_values(budget, 11, accounts, values, is_set);
+    g_assert(is_set[0] && !is_set[1] && is_set[2]);
+    g_assert(gnc_numeric_equal(values[0], gnc_numeric_create(50,1)));
+    g_assert(gnc_numeric_equal(values[2], gnc_numeric_create(300,1)));
+    g_list_free(accounts);
+
+    /* The amounts are saved in the slots as before */
+    slots = qof_instance_get_slots(QOF_INSTANCE(budget));
+    bufend = guid_to_string_buff(xaccAccountGetGUID(acc1), path);
+    strcpy(bufend, "/11");
+    g_assert(gnc_numeric_equal(kvp_frame_get_numeric(slots, path),
+                               gnc_numeric_create(300,1)));
+    gnc_budget_unset_account_period_value(budget, acc1, 11);
+    g_assert(!gnc_budget_is_account_period_value_set(budget, acc1, 11));
+    g_assert(kvp_frame_get_value(slots, path) == NULL);
+
+    /* and read back from there */
+    kvp_frame_set_numeric(qof_instance_get_slots(QOF_INSTANCE(loaded)), path,
+                          gnc_numeric_create(7,1));
+    g_assert(gnc_budget_is_account_period_value_set(loaded, acc1, 11));
+    g_assert(gnc_numeric_equal(gnc_budget_get_account_period_value(loaded, acc1, 11),
+                               gnc_numeric_create(7,1)));
+    g_assert(!gnc_budget_is_account_period_value_set(loaded, acc2, 11));
+
+    /* Slots replaced by undo or a backend win over the amounts read and
+     * changed before, and a slot which isn't a number is set to zero */
+    slots = kvp_frame_new();
+    strcpy(bufend, "/3");
+    kvp_frame_set_string(slots, path, "not a number");
+    gnc_budget_begin_edit(loaded);
+    gnc_budget_set_account_period_value(loaded, acc2, 0, gnc_numeric_create(1,1));
+    qof_instance_set_slots(QOF_INSTANCE(loaded), slots);
+    gnc_budget_commit_edit(loaded);
+    g_assert(gnc_budget_is_account_period_value_set(loaded, acc1, 3));
+    g_assert(gnc_numeric_zero_p(gnc_budget_get_account_period_value(loaded, acc1, 3)));
+    g_assert(!gnc_budget_is_account_period_value_set(loaded, acc1, 11));
+    g_assert(!gnc_budget_is_account_period_value_set(loaded, acc2, 0));
+    bufend = guid_to_string_buff(xaccAccountGetGUID(acc2), path);
+    strcpy(bufend, "/0");
+    g_assert(kvp_frame_get_value(slots, path) == NULL);
+
+    gnc_budget_destroy(budget);
+    gnc_budget_destroy(loaded);
+    qof_book_destroy(book);
+}
+
 void
 test_suite_budget(void)
 {
@@ -2591,6 +2675,7 @@ test_suite_budget(void)
     GNC_TEST_ADD_FUNC(suitename, "gnc_budget_set_num_periods()", test_gnc_set_budget_num_periods);
     GNC_TEST_ADD_FUNC(suitename, "gnc_budget_set_recurrence()", test_gnc_set_budget_recurrence);
     GNC_TEST_ADD_FUNC(suitename, "gnc_budget_set_account_period_value()", test_gnc_set_budget_account_period_value);
+    GNC_TEST_ADD_FUNC(suitename, "gnc_budget_get_account_values()", test_gnc_budget_account_values);
 
 #if 0
     GNC_TEST_ADD_FUNC (suitename, "gnc set account separator", test_gnc_set_account_separator);
@@ -0,0 +1,250 @@
+/********************************************************************
+ * utest-split-columns.c: GLib g_test test suite for                *
+ * gnc-split-columns.c.                                             *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+********************************************************************/
+#include "config.h"
+#include <glib.h>
+#include <unittest-support.h>
+/* Add specific headers for this class */
+#include "Account.h"
+#include "Split.h"
+#include "Transaction.h"
+#include "gnc-split-columns.h"
+
+static const gchar *suitename = "/engine/SplitColumns";
+void test_suite_split_columns (void);
+
+typedef struct
+{
+    QofBook *book;
+    Account *bank;
+    Account *expense;
+    time64 start;
+    GncSplitColumns *cols;
+} Fixture;
+
+static const gint64 amounts[] = { 1000, -250, 333, -1200 };
+
+static void
+add_txn (Fixture *fixture, time64 date, gnc_numeric amount)
+{
+    Transaction *txn = xaccMallocTransaction (fixture->book);
+    Split *split1 = xaccMallocSplit (fixture->book);
+    Split *split2 = xaccMallocSplit (fixture->book);
+    gnc_numeric neg = gnc_numeric_neg (amount);
+
+    xaccTransBeginEdit (txn);
+    xaccTransSetDatePostedSecs (txn, date);
+    xaccSplitSetParent (split1, txn);
+    xaccSplitSetParent (split2, txn);
+    g_object_set (split1, "account", fixture->bank,
+                  "amount", &amount, "value", &amount, NULL);
+    g_object_set (split2, "account", fixture->expense,
+                  "amount", &neg, "value", &neg, NULL);
+    xaccSplitSetReconcile (split1, CREC);
+    gnc_account_insert_split (fixture->bank, split1);
+    gnc_account_insert_split (fixture->expense, split2);
+    /* xaccTransCommitEdit () does a bunch of scrubbing that we don't need */
+    qof_commit_edit (QOF_INSTANCE (txn));
+}
+
+static void
+setup (Fixture *fixture, gconstpointer pData)
+{
+    Account *root;
+    guint i;
+
+    fixture->book = qof_book_new ();
+    root = gnc_account_create_root (fixture->book);
+    fixture->bank = xaccMallocAccount (fixture->book);
+    fixture->expense = xaccMallocAccount (fixture->book);
+    gnc_account_append_child (root, fixture->bank);
+    gnc_account_append_child (root, fixture->expense);
+    xaccAccountSetCommoditySCU (fixture->bank, 100);
+    xaccAccountSetCommoditySCU (fixture->expense, 1000);
+    fixture->start = gnc_time (NULL) - 10 * 24 * 3600;
+    /* Added in reverse date order */
+    for (i = G_N_ELEMENTS (amounts); i > 0; i--)
+        add_txn (fixture, fixture->start + (i - 1) * 24 * 3600,
+                 gnc_numeric_create (amounts[i - 1], 100));
+    fixture->cols = gnc_split_columns_new (fixture->book);
+}
+
+static void
+teardown (Fixture *fixture, gconstpointer pData)
+{
+    gnc_split_columns_destroy (fixture->cols);
+    qof_book_destroy (fixture->book);
+}
+
+static void
+test_gnc_split_columns_build (Fixture *fixture, gconstpointer pData)
+{
+    GncSplitColumns *cols = fixture->cols;
+    const gint64 *amount_num = gnc_split_columns_get_amount_nums (cols);
+    const gint64 *amount_denom = gnc_split_columns_get_amount_denoms (cols);
+    const time64 *posted = gnc_split_columns_get_posted_dates (cols);
+    const guint *account = gnc_split_columns_get_account_indices (cols);
+    const guint *trans = gnc_split_columns_get_trans_indices (cols);
+    const char *reconcile = gnc_split_columns_get_reconcile_flags (cols);
+    guint first, last, row;
+
+    g_assert_cmpuint (gnc_split_columns_get_length (cols), == ,
+                      2 * G_N_ELEMENTS (amounts));
+    g_assert (gnc_split_columns_get_account_rows (cols, fixture->bank,
+              &first, &last));
+    g_assert_cmpuint (last - first, == , G_N_ELEMENTS (amounts));
+    for (row = first; row < last; row++)
+    {
+        Split *split = gnc_split_columns_get_split (cols, row);
+        Transaction *txn = gnc_split_columns_get_transaction (cols,
+                           trans[row]);
+        g_assert (gnc_split_columns_get_account (cols, account[row]) ==
+                  fixture->bank);
+        g_assert (xaccSplitGetParent (split) == txn);
+        g_assert_cmpint (posted[row], == , xaccTransGetDate (txn));
+        g_assert_cmpint (amount_num[row], == , amounts[row - first]);
+        g_assert_cmpint (amount_denom[row], == , 100);
+        g_assert_cmpint (reconcile[row], == , CREC);
+        if (row > first)
+            g_assert_cmpint (posted[row - 1], <= , posted[row]);
+    }
+    g_assert (!gnc_split_columns_get_account_rows (
+                  cols, gnc_account_get_root (fixture->bank), NULL, NULL));
+}
+
+static void
+test_gnc_split_columns_rows (Fixture *fixture, gconstpointer pData)
+{
+    GncSplitColumns *cols = fixture->cols;
+    const gint64 *value_num = gnc_split_columns_get_value_nums (cols);
+    const gint64 *value_denom = gnc_split_columns_get_value_denoms (cols);
+    const time64 *posted = gnc_split_columns_get_posted_dates (cols);
+    const char *reconcile = gnc_split_columns_get_reconcile_flags (cols);
+    guint row, n_rows = gnc_split_columns_get_length (cols);
+
+    for (row = 0; row < n_rows; row++)
+    {
+        gnc_numeric value = gnc_numeric_create (value_num[row],
+                                                value_denom[row]);
+        g_assert (gnc_numeric_equal (
+                      gnc_split_columns_get_row_value (cols, row), value));
+        g_assert (gnc_numeric_equal (
+                      gnc_split_columns_get_row_amount (cols, row),
+                      xaccSplitGetAmount (gnc_split_columns_get_split (cols,
+                                          row))));
+        g_assert_cmpint (gnc_split_columns_get_row_posted_date (cols, row),
+                         == , posted[row]);
+        g_assert_cmpint (gnc_split_columns_get_row_reconcile_flag (cols, row),
+                         == , reconcile[row]);
+    }
+}
+
+static void
+test_gnc_split_columns_sum (Fixture *fixture, gconstpointer pData)
+{
+    GncSplitColumns *cols = fixture->cols;
+    time64 day = 24 * 3600;
+    gnc_numeric sum;
+
+    sum = gnc_split_columns_sum_amount (cols, fixture->bank,
+                                        G_MININT64, G_MAXINT64);
+    g_assert (gnc_numeric_equal (sum, gnc_numeric_create (-117, 100)));
+    g_assert (gnc_numeric_equal (sum, xaccAccountGetBalance (fixture->bank)));
+    sum = gnc_split_columns_sum_amount (cols, fixture->expense,
+                                        G_MININT64, G_MAXINT64);
+    g_assert (gnc_numeric_equal (sum, gnc_numeric_create (117, 100)));
+    sum = gnc_split_columns_sum_value (cols, fixture->expense,
+                                       G_MININT64, G_MAXINT64);
+    g_assert (gnc_numeric_equal (sum, gnc_numeric_create (117, 100)));
+    /* The second and third day, inclusive */
+    sum = gnc_split_columns_sum_amount (cols, fixture->bank,
+                                        fixture->start + day,
+                                        fixture->start + 2 * day);
+    g_assert (gnc_numeric_equal (sum, gnc_numeric_create (83, 100)));
+    sum = gnc_split_columns_sum_amount (cols, fixture->bank,
+                                        fixture->start + 4 * day, G_MAXINT64);
+    g_assert (gnc_numeric_zero_p (sum));
+    sum = gnc_split_columns_sum_amount (cols, fixture->bank,
+                                        fixture->start, fixture->start - 1);
+    g_assert (gnc_numeric_zero_p (sum));
+}
+
+static void
+test_gnc_split_columns_events (Fixture *fixture, gconstpointer pData)
+{
+    GncSplitColumns *cols = fixture->cols;
+    gnc_numeric sum;
+
+    g_assert_cmpuint (gnc_split_columns_get_length (cols), == , 8);
+    /* Inserting the splits sends account events */
+    add_txn (fixture, fixture->start, gnc_numeric_create (5, 1));
+    g_assert_cmpuint (gnc_split_columns_get_length (cols), == , 10);
+    sum = gnc_split_columns_sum_amount (cols, fixture->bank,
+                                        G_MININT64, G_MAXINT64);
+    g_assert (gnc_numeric_equal (sum, gnc_numeric_create (383, 100)));
+
+    /* With events suspended the snapshot has to be told. */
+    qof_event_suspend ();
+    add_txn (fixture, fixture->start, gnc_numeric_create (5, 1));
+    qof_event_resume ();
+    g_assert_cmpuint (gnc_split_columns_get_length (cols), == , 10);
+    gnc_split_columns_invalidate (cols);
+    g_assert_cmpuint (gnc_split_columns_get_length (cols), == , 12);
+}
+
+static void
+test_gnc_split_columns_unsorted (Fixture *fixture, gconstpointer pData)
+{
+    GncSplitColumns *cols = fixture->cols;
+    const time64 *posted;
+    time64 day = 24 * 3600;
+    guint first, last, row;
+    gnc_numeric sum;
+
+    /* While the account is open for editing new splits go to the front
+     * of its list, out of date order. */
+    xaccAccountBeginEdit (fixture->bank);
+    add_txn (fixture, fixture->start + 8 * day, gnc_numeric_create (5, 1));
+    g_assert (gnc_split_columns_get_account_rows (cols, fixture->bank,
+              &first, &last));
+    g_assert_cmpuint (last - first, == , G_N_ELEMENTS (amounts) + 1);
+    posted = gnc_split_columns_get_posted_dates (cols);
+    for (row = first + 1; row < last; row++)
+        g_assert_cmpint (posted[row - 1], <= , posted[row]);
+    g_assert_cmpint (posted[last - 1], == , fixture->start + 8 * day);
+    sum = gnc_split_columns_sum_amount (cols, fixture->bank,
+                                        fixture->start + 4 * day, G_MAXINT64);
+    g_assert (gnc_numeric_equal (sum, gnc_numeric_create (5, 1)));
+    sum = gnc_split_columns_sum_amount (cols, fixture->bank,
+                                        G_MININT64, fixture->start + 2 * day);
+    g_assert (gnc_numeric_equal (sum, gnc_numeric_create (1083, 100)));
+    xaccAccountCommitEdit (fixture->bank);
+}
+
+void
+test_suite_split_columns (void)
+{
+    GNC_TEST_ADD (suitename, "build", Fixture, NULL, setup, test_gnc_split_columns_build, teardown);
+    GNC_TEST_ADD (suitename, "rows", Fixture, NULL, setup, test_gnc_split_columns_rows, teardown);
+    GNC_TEST_ADD (suitename, "sum", Fixture, NULL, setup, test_gnc_split_columns_sum, teardown);
+    GNC_TEST_ADD (suitename, "events", Fixture, NULL, setup, test_gnc_split_columns_events, teardown);
+    GNC_TEST_ADD (suitename, "unsorted", Fixture, NULL, setup, test_gnc_split_columns_unsorted, teardown);
+}
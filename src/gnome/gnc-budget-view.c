@@ -734,11 +734,16 @@ bgv_get_total_for_account(Account* account, GncBudget* budget)
     int period_num;
     gnc_numeric numeric;
     gnc_numeric total = gnc_numeric_zero();
+    gnc_numeric *values;
+    gboolean *is_set;
 
     num_periods = gnc_budget_get_num_periods(budget);
+    values = g_new(gnc_numeric, num_periods);
+    is_set = g_new(gboolean, num_periods);
+    gnc_budget_get_account_values(budget, account, values, is_set);
     for (period_num = 0; period_num < num_periods; ++period_num)
     {
-        if (!gnc_budget_is_account_period_value_set(budget, account, period_num))
+        if (!is_set[period_num])
         {
             if (gnc_account_n_children(account) != 0)
             {
@@ -748,13 +753,15 @@ bgv_get_total_for_account(Account* account, GncBudget* budget)
         }
         else
         {
-            numeric = gnc_budget_get_account_period_value(budget, account, period_num);
+            numeric = values[period_num];
             if (!gnc_numeric_check(numeric))
             {
                 total = gnc_numeric_add(total, numeric, GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
             }
         }
     }
+    g_free(values);
+    g_free(is_set);
 
     return total;
 }
@@ -39,6 +39,10 @@ extern "C"
 
 #include "gnc-numeric.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 /* Note: The qofmath128 functions are used mostly here and almost
          nowhere else. Hence, we inline the C code directly into here so
          that the compiler can potentially inline the code as-is and speed
@@ -467,6 +471,154 @@ gnc_numeric_add(gnc_numeric a, gnc_numeric b,
     return gnc_numeric_convert(sum, denom, how);
 }
 
+/* *******************************************************************
+ *  gnc_numeric_sum
+ ********************************************************************/
+
+/* The numbers summed are num[i * stride] / denom[i * stride]: a stride
+ * of 2 walks an array of gnc_numeric, one of 1 separate columns of
+ * numerators and denominators. */
+G_STATIC_ASSERT (sizeof (gnc_numeric) == 2 * sizeof (gint64));
+
+/* Add up the numerators of numbers [0..n) as long as their denominator
+ * is denom.  Returns the number of numbers consumed; *overflow is set if
+ * the running sum may have wrapped around, in which case *sum is
+ * meaningless. */
+static gsize
+sum_common_denom (const gint64 *num, const gint64 *denoms, gsize stride,
+                  gsize n, gint64 denom, gint64 *sum, gboolean *overflow)
+{
+    gint64 total = 0;
+    guint64 wrapped = 0;
+    gsize i = 0;
+
+#ifdef __SSE2__
+    /* Two numbers at a time: the numerators go into the two lanes of
+     * acc, the denominators are checked against denom.  Overflow of a
+     * lane shows up in the sign bit of ovf. */
+    __m128i acc = _mm_setzero_si128 ();
+    __m128i ovf = _mm_setzero_si128 ();
+    const __m128i dd = _mm_set1_epi64x (denom);
+    gint64 lanes[2];
+
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128i nums, dens, s;
+
+        if (stride == 1)
+        {
+            nums = _mm_loadu_si128 (reinterpret_cast<const __m128i*>(num + i));
+            dens = _mm_loadu_si128 (reinterpret_cast<const __m128i*>(denoms + i));
+        }
+        else
+        {
+            __m128i v0 = _mm_loadu_si128 (reinterpret_cast<const __m128i*>(num + i * stride));
+            __m128i v1 = _mm_loadu_si128 (reinterpret_cast<const __m128i*>(num + (i + 1) * stride));
+            nums = _mm_unpacklo_epi64 (v0, v1);
+            dens = _mm_unpackhi_epi64 (v0, v1);
+        }
+
+        if (_mm_movemask_epi8 (_mm_cmpeq_epi32 (dens, dd)) != 0xffff)
+            break;
+        s = _mm_add_epi64 (acc, nums);
+        ovf = _mm_or_si128 (ovf, _mm_and_si128 (_mm_xor_si128 (acc, s),
+                                                _mm_xor_si128 (nums, s)));
+        acc = s;
+    }
+    if (_mm_movemask_pd (_mm_castsi128_pd (ovf)))
+    {
+        *overflow = TRUE;
+        return i;
+    }
+    _mm_storeu_si128 (reinterpret_cast<__m128i*>(lanes), acc);
+    total = lanes[0];
+    {
+        gint64 s = (gint64)((guint64)total + (guint64)lanes[1]);
+        wrapped |= (guint64)((total ^ s) & (lanes[1] ^ s));
+        total = s;
+    }
+#endif
+    for (; i < n && denoms[i * stride] == denom; i++)
+    {
+        gint64 v = num[i * stride];
+        gint64 s = (gint64)((guint64)total + (guint64)v);
+        wrapped |= (guint64)((total ^ s) & (v ^ s));
+        total = s;
+    }
+    *overflow = (wrapped >> 63) != 0;
+    *sum = total;
+    return i;
+}
+
+static gnc_numeric
+sum_numbers (const gint64 *num, const gint64 *denom, gsize stride, gsize n)
+{
+    gnc_numeric sum;
+    gboolean overflow = FALSE;
+    gsize i;
+
+    if (n == 0)
+        return gnc_numeric_zero ();
+
+    sum = gnc_numeric_create (num[0], denom[0]);
+    if (gnc_numeric_check (sum))
+        return gnc_numeric_error (GNC_ERROR_ARG);
+
+    /* The common case: one positive denominator for all of them */
+    if (sum.denom > 0)
+    {
+        gint64 total;
+        if (sum_common_denom (num, denom, stride, n, sum.denom, &total,
+                              &overflow) == n && !overflow)
+            return gnc_numeric_create (total, sum.denom);
+    }
+
+    /* Add them up exactly in 128 bits while the denominator stays the
+     * same, otherwise one by one with gnc_numeric_add. */
+    i = 1;
+    while (i < n)
+    {
+        if (sum.denom > 0 && denom[i * stride] == sum.denom)
+        {
+            qofint128 total = mult128 (sum.num, 1);
+            for (; i < n && denom[i * stride] == sum.denom; i++)
+                total = add128 (total, mult128 (num[i * stride], 1));
+            if (total.isbig)
+                return gnc_numeric_error (GNC_ERROR_OVERFLOW);
+            sum.num = total.isneg ? -(gint64)total.lo : (gint64)total.lo;
+            continue;
+        }
+        sum = gnc_numeric_add (sum, gnc_numeric_create (num[i * stride],
+                                                        denom[i * stride]),
+                               GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+        if (gnc_numeric_check (sum))
+            return sum;
+        i++;
+    }
+    return sum;
+}
+
+gnc_numeric
+gnc_numeric_sum(const gnc_numeric *values, gsize n)
+{
+    if (n == 0)
+        return gnc_numeric_zero ();
+    g_return_val_if_fail (values != NULL, gnc_numeric_error (GNC_ERROR_ARG));
+
+    return sum_numbers (&values[0].num, &values[0].denom, 2, n);
+}
+
+gnc_numeric
+gnc_numeric_sum_columns(const gint64 *num, const gint64 *denom, gsize n)
+{
+    if (n == 0)
+        return gnc_numeric_zero ();
+    g_return_val_if_fail (num != NULL && denom != NULL,
+                          gnc_numeric_error (GNC_ERROR_ARG));
+
+    return sum_numbers (num, denom, 1, n);
+}
+
 /* *******************************************************************
  *  gnc_numeric_sub
  ********************************************************************/
@@ -448,6 +448,25 @@ gnc_numeric gnc_numeric_sub_fixed(gnc_numeric a, gnc_numeric b)
     return gnc_numeric_sub(a, b, GNC_DENOM_AUTO,
                            GNC_HOW_DENOM_FIXED | GNC_HOW_RND_NEVER);
 }
+
+/** Returns the exact sum of the n numbers in values, as adding them
+ *  one by one with gnc_numeric_add(..., GNC_DENOM_AUTO,
+ *  GNC_HOW_DENOM_LCD) would.
+ *
+ *  When all of them share one denominator, which is the usual case
+ *  for the splits of an account, only the numerators are added, two at
+ *  a time where SSE2 is available.  Only if the denominators differ or
+ *  that sum overflows 64 bits are the numbers added with 128-bit
+ *  intermediates.  Returns zero for n == 0 and an error code if one of
+ *  the values is an error or the sum cannot be represented.
+ */
+gnc_numeric gnc_numeric_sum(const gnc_numeric *values, gsize n);
+
+/** Like gnc_numeric_sum(), for n numbers whose numerators and
+ *  denominators are kept in separate arrays, num[i]/denom[i].
+ */
+gnc_numeric gnc_numeric_sum_columns(const gint64 *num, const gint64 *denom,
+                                    gsize n);
 /** @} */
 
 /** @name Arithmetic Functions with Exact Error Returns
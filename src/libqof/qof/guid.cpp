@@ -49,6 +49,12 @@ extern "C"
 #ifdef HAVE_UNISTD_H
 # include <unistd.h>
 #endif
+#ifdef HAVE_SYS_RANDOM_H
+# include <sys/random.h>
+#endif
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
 #include "qof.h"
 #include "md5.h"
 
@@ -76,6 +82,7 @@ extern "C"
 /* Static global variables *****************************************/
 static gboolean guid_initialized = FALSE;
 static struct md5_ctx guid_context;
+static GncGUIDGenerator guid_generator = GNC_GUID_GENERATOR_MD5;
 
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = QOF_MOD_ENGINE;
@@ -547,17 +554,28 @@ guid_shutdown (void)
 {
 }
 
+void
+guid_init_with_generator (GncGUIDGenerator generator)
+{
+    guid_generator = generator;
+    if (generator == GNC_GUID_GENERATOR_MD5 && !guid_initialized)
+        guid_init();
+}
+
+GncGUIDGenerator
+guid_get_generator (void)
+{
+    return guid_generator;
+}
+
 #define GUID_PERIOD 5000
 
-void
-guid_new(GncGUID *guid)
+static void
+guid_new_md5(GncGUID *guid)
 {
     static int counter = 0;
     struct md5_ctx ctx;
 
-    if (guid == NULL)
-        return;
-
     if (!guid_initialized)
         guid_init();
 
@@ -600,6 +618,160 @@ guid_new(GncGUID *guid)
     counter--;
 }
 
+/* The random generator is xoshiro256** (see http://prng.di.unimi.it/),
+ * with its 256 bits of state seeded separately for each thread from
+ * the system's random source. */
+#define RANDOM_STATE_SIZE 4
+
+static void
+guid_random_seed (guint64 *state)
+{
+    size_t got = 0;
+
+#ifdef HAVE_GETRANDOM
+    if (getrandom (state, RANDOM_STATE_SIZE * sizeof (guint64), 0) ==
+            RANDOM_STATE_SIZE * sizeof (guint64))
+        got = RANDOM_STATE_SIZE * sizeof (guint64);
+#endif
+    if (got == 0)
+    {
+        FILE *fp = g_fopen ("/dev/urandom", "rb");
+
+        if (fp != NULL)
+        {
+            got = fread (state, 1, RANDOM_STATE_SIZE * sizeof (guint64), fp);
+            fclose (fp);
+        }
+    }
+    if (got < RANDOM_STATE_SIZE * sizeof (guint64))
+    {
+        /* No system random source, so fall back on what guid_init
+         * collected. */
+        GncGUID seed;
+        int i;
+
+        PWARN ("no random source, seeding from the md5 generator");
+        for (i = 0; i < RANDOM_STATE_SIZE; i += 2)
+        {
+            guid_new_md5 (&seed);
+            memcpy (state + i, seed.data, 2 * sizeof (guint64));
+        }
+    }
+    /* The one state the generator can't leave */
+    if (!(state[0] | state[1] | state[2] | state[3]))
+        state[0] = 1;
+}
+
+static guint64 *
+guid_random_state (void)
+{
+#ifdef G_THREADS_ENABLED
+#ifndef HAVE_GLIB_2_32
+    static GStaticPrivate guid_state_key = G_STATIC_PRIVATE_INIT;
+    guint64 *state;
+
+    state = static_cast<guint64*>(g_static_private_get (&guid_state_key));
+    if (state == NULL)
+    {
+        state = g_new (guint64, RANDOM_STATE_SIZE);
+        guid_random_seed (state);
+        g_static_private_set (&guid_state_key, state, g_free);
+    }
+#else
+    static GPrivate guid_state_key = G_PRIVATE_INIT(g_free);
+    guint64 *state;
+
+    state = static_cast<guint64*>(g_private_get (&guid_state_key));
+    if (state == NULL)
+    {
+        state = g_new (guint64, RANDOM_STATE_SIZE);
+        guid_random_seed (state);
+        g_private_set (&guid_state_key, state);
+    }
+#endif
+#else
+    static guint64 state[RANDOM_STATE_SIZE];
+    static gboolean seeded = FALSE;
+
+    if (!seeded)
+    {
+        guid_random_seed (state);
+        seeded = TRUE;
+    }
+#endif
+    return state;
+}
+
+static inline guint64
+rotl64 (guint64 x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline guint64
+random_next (guint64 *s)
+{
+    guint64 result = rotl64 (s[1] * 5, 7) * 9;
+    guint64 t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64 (s[3], 45);
+
+    return result;
+}
+
+/* Fill the guid with random bits, except for those marking it as an
+ * RFC 4122 version 4 (random) UUID. */
+static inline void
+guid_new_random (GncGUID *guid, guint64 *state)
+{
+    guint64 bits[2];
+
+    bits[0] = random_next (state);
+    bits[1] = random_next (state);
+    memcpy (guid->data, bits, GUID_DATA_SIZE);
+    guid->data[6] = (guid->data[6] & 0x0f) | 0x40;
+    guid->data[8] = (guid->data[8] & 0x3f) | 0x80;
+}
+
+void
+guid_new(GncGUID *guid)
+{
+    if (guid == NULL)
+        return;
+
+    if (guid_generator == GNC_GUID_GENERATOR_RANDOM)
+        guid_new_random (guid, guid_random_state ());
+    else
+        guid_new_md5 (guid);
+}
+
+void
+guid_new_n (GncGUID *guids, gsize n)
+{
+    gsize i;
+
+    if (guids == NULL)
+        return;
+
+    if (guid_generator == GNC_GUID_GENERATOR_RANDOM)
+    {
+        guint64 *state = guid_random_state ();
+
+        for (i = 0; i < n; i++)
+            guid_new_random (&guids[i], state);
+    }
+    else
+    {
+        for (i = 0; i < n; i++)
+            guid_new_md5 (&guids[i]);
+    }
+}
+
 GncGUID
 guid_new_return(void)
 {
@@ -610,59 +782,139 @@ guid_new_return(void)
     return guid;
 }
 
+/* The hex conversions work on the whole guid at once with SSE2 where
+ * it's available, which is everywhere on x86-64.  The data is small
+ * enough that wider vectors wouldn't gain anything. */
+
 /* needs 32 bytes exactly, doesn't print a null char */
 static void
 encode_md5_data(const unsigned char *data, char *buffer)
 {
+#ifdef __SSE2__
+    const __m128i low_nibbles = _mm_set1_epi8(0x0f);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i letter_gap = _mm_set1_epi8('a' - '0' - 10);
+    __m128i bytes, high, low, digits;
+
+    bytes = _mm_loadu_si128((const __m128i*)data);
+    high = _mm_and_si128(_mm_srli_epi16(bytes, 4), low_nibbles);
+    low = _mm_and_si128(bytes, low_nibbles);
+
+    /* nibble + '0', plus the gap up to 'a' for nibbles above 9 */
+    digits = _mm_unpacklo_epi8(high, low);
+    digits = _mm_add_epi8(_mm_add_epi8(digits, zero_char),
+                          _mm_and_si128(_mm_cmpgt_epi8(digits, nine),
+                                        letter_gap));
+    _mm_storeu_si128((__m128i*)buffer, digits);
+
+    digits = _mm_unpackhi_epi8(high, low);
+    digits = _mm_add_epi8(_mm_add_epi8(digits, zero_char),
+                          _mm_and_si128(_mm_cmpgt_epi8(digits, nine),
+                                        letter_gap));
+    _mm_storeu_si128((__m128i*)(buffer + 16), digits);
+#else
+    static const char hex_digits[] = "0123456789abcdef";
     size_t count;
 
     for (count = 0; count < GUID_DATA_SIZE; count++, buffer += 2)
-        sprintf(buffer, "%02x", data[count]);
+    {
+        buffer[0] = hex_digits[data[count] >> 4];
+        buffer[1] = hex_digits[data[count] & 0x0f];
+    }
+#endif
 }
 
+#ifdef __SSE2__
+/* Turn 16 hex characters into 16 nibble values, or return FALSE if
+ * any of them isn't a hex digit.  The compares are signed, so bytes
+ * above 0x7f come out negative and fail the range checks. */
+static inline gboolean
+decode_hex_chars(__m128i chars, __m128i *nibbles)
+{
+    const __m128i minus_one = _mm_set1_epi8(-1);
+    __m128i digit, letter, is_digit, is_letter;
+
+    digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    is_digit = _mm_and_si128(_mm_cmpgt_epi8(digit, minus_one),
+                             _mm_cmplt_epi8(digit, _mm_set1_epi8(10)));
+    letter = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)),
+                          _mm_set1_epi8('a'));
+    is_letter = _mm_and_si128(_mm_cmpgt_epi8(letter, minus_one),
+                              _mm_cmplt_epi8(letter, _mm_set1_epi8(6)));
+    if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xffff)
+        return FALSE;
+
+    *nibbles = _mm_or_si128(
+                   _mm_and_si128(is_digit, digit),
+                   _mm_and_si128(is_letter,
+                                 _mm_add_epi8(letter, _mm_set1_epi8(10))));
+    return TRUE;
+}
+
+/* Pack pairs of nibbles, the high one first, into 8 bytes, one in
+ * each 16 bit lane. */
+static inline __m128i
+pack_nibble_pairs(__m128i nibbles)
+{
+    return _mm_or_si128(
+               _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00ff)), 4),
+               _mm_srli_epi16(nibbles, 8));
+}
+#else
+static inline int
+hex_value(unsigned char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+#endif
+
 /* returns true if the first 32 bytes of buffer encode
  * a hex number. returns false otherwise. Decoded number
  * is packed into data in little endian order. */
 static gboolean
 decode_md5_string(const gchar *string, unsigned char *data)
 {
-    unsigned char n1, n2;
-    size_t count = -1;
-    unsigned char c1, c2;
-
     if (NULL == data) return FALSE;
-    if (NULL == string) goto badstring;
+    /* check for a short string e.g. null string ... */
+    if (NULL == string || memchr(string, '\0', GUID_ENCODING_LENGTH))
+        goto badstring;
 
-    for (count = 0; count < GUID_DATA_SIZE; count++)
+#ifdef __SSE2__
     {
-        /* check for a short string e.g. null string ... */
-        if ((0 == string[2*count]) || (0 == string[2*count+1])) goto badstring;
-
-        c1 = tolower(string[2 * count]);
-        if (!isxdigit(c1)) goto badstring;
-
-        c2 = tolower(string[2 * count + 1]);
-        if (!isxdigit(c2)) goto badstring;
-
-        if (isdigit(c1))
-            n1 = c1 - '0';
-        else
-            n1 = c1 - 'a' + 10;
+        __m128i first, second;
+
+        if (!decode_hex_chars(_mm_loadu_si128((const __m128i*)string), &first) ||
+                !decode_hex_chars(_mm_loadu_si128((const __m128i*)(string + 16)),
+                                  &second))
+            goto badstring;
+        _mm_storeu_si128((__m128i*)data,
+                         _mm_packus_epi16(pack_nibble_pairs(first),
+                                          pack_nibble_pairs(second)));
+    }
+#else
+    {
+        size_t count;
 
-        if (isdigit(c2))
-            n2 = c2 - '0';
-        else
-            n2 = c2 - 'a' + 10;
+        for (count = 0; count < GUID_DATA_SIZE; count++)
+        {
+            int n1 = hex_value(string[2 * count]);
+            int n2 = hex_value(string[2 * count + 1]);
 
-        data[count] = (n1 << 4) | n2;
+            if (n1 < 0 || n2 < 0) goto badstring;
+            data[count] = (n1 << 4) | n2;
+        }
     }
+#endif
     return TRUE;
 
 badstring:
-    for (count = 0; count < GUID_DATA_SIZE; count++)
-    {
-        data[count] = 0;
-    }
+    memset(data, 0, GUID_DATA_SIZE);
     return FALSE;
 }
 
@@ -720,6 +972,35 @@ string_to_guid(const char * string, GncGUID * guid)
     return decode_md5_string(string, (guid != NULL) ? guid->data : NULL);
 }
 
+gchar *
+guid_to_string_buff_n(const GncGUID *guids, gsize n, gchar *buff)
+{
+    gsize i;
+
+    if (!guids || !buff) return NULL;
+
+    for (i = 0; i < n; i++, buff += GUID_ENCODING_LENGTH + 1)
+    {
+        encode_md5_data(guids[i].data, buff);
+        buff[GUID_ENCODING_LENGTH] = '\0';
+    }
+    return buff;
+}
+
+gboolean
+string_to_guid_n(const gchar * const *strings, gsize n, GncGUID *guids)
+{
+    gboolean all_valid = TRUE;
+    gsize i;
+
+    if (!strings || !guids) return FALSE;
+
+    for (i = 0; i < n; i++)
+        if (!decode_md5_string(strings[i], guids[i].data))
+            all_valid = FALSE;
+    return all_valid;
+}
+
 gboolean
 guid_equal(const GncGUID *guid_1, const GncGUID *guid_2)
 {
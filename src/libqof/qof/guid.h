@@ -75,6 +75,18 @@ const GncGUID* gnc_value_get_guid (const GValue *value);
  * not including the null terminator. */
 #define GUID_ENCODING_LENGTH 32
 
+/** The ways guid_new() can make new ids. */
+typedef enum
+{
+    /** An md5 digest of the entropy collected by guid_init(), salted
+     *  anew after every id.  This is the default. */
+    GNC_GUID_GENERATOR_MD5,
+    /** RFC 4122 version 4 (random) UUIDs from a fast pseudo-random
+     *  generator, seeded for each thread from the system's random
+     *  source.  Much cheaper when making many ids. */
+    GNC_GUID_GENERATOR_RANDOM
+} GncGUIDGenerator;
+
 
 /** Initialize the id generator with a variety of random
  *  sources.
@@ -86,6 +98,15 @@ const GncGUID* gnc_value_get_guid (const GValue *value);
  */
 void guid_init(void);
 
+/** Select the generator used by guid_new() and guid_new_n() from now
+ *  on.  guid_init() doesn't change it, so this can be called before or
+ *  after it.  Selecting GNC_GUID_GENERATOR_MD5 calls guid_init() if
+ *  it hasn't been called yet. */
+void guid_init_with_generator(GncGUIDGenerator generator);
+
+/** Return the generator selected with guid_init_with_generator(). */
+GncGUIDGenerator guid_get_generator(void);
+
 /** Release the memory chunk associated with gui storage. Use this
  *  only when shutting down the program, as it invalidates *all*
  *  GUIDs at once. */
@@ -97,7 +118,8 @@ void guid_shutdown (void);
  *  @param guid A pointer to an existing guid data structure.  The
  *  existing value will be replaced with a new value.
  *
- * This routine uses the md5 algorithm to build strong random guids.
+ * By default this routine uses the md5 algorithm to build strong
+ * random guids; see guid_init_with_generator() for a faster one.
  * Note that while guid's are generated randomly, the odds of this
  * routine returning a non-unique id are astronomically small.
  * (Literally astronomically: If you had Cray's on every solar
@@ -107,6 +129,10 @@ void guid_shutdown (void);
  */
 void guid_new(GncGUID *guid);
 
+/** Generate n new ids into the array guids, the same as calling
+ *  guid_new() on each of them, only faster. */
+void guid_new_n(GncGUID *guids, gsize n);
+
 /** Generate a new id. If no initialization function has been called,
  *  guid_init() will be called before the id is created.
  *
@@ -167,6 +193,20 @@ gchar * guid_to_string_buff (const GncGUID * guid, /*@ out @*/ gchar *buff);
  * undefined. */
 gboolean string_to_guid(const gchar * string, /*@ out @*/ GncGUID * guid);
 
+/** Encode n guids into buff, as consecutive null-terminated strings
+ *  of GUID_ENCODING_LENGTH characters each, the same as calling
+ *  guid_to_string_buff() on each of them.  buff must have room for
+ *  n * (GUID_ENCODING_LENGTH + 1) characters.  Returns a pointer just
+ *  past the last string written. */
+gchar * guid_to_string_buff_n (const GncGUID *guids, gsize n,
+                               /*@ out @*/ gchar *buff);
+
+/** Decode the n strings into the array guids, the same as calling
+ *  string_to_guid() on each of them.  Returns TRUE if all of them
+ *  were valid; the guids of those that weren't are set to zero. */
+gboolean string_to_guid_n (const gchar * const *strings, gsize n,
+                           /*@ out @*/ GncGUID *guids);
+
 
 /** Given two GUIDs, return TRUE if they are non-NULL and equal.
  * Return FALSE, otherwise. */
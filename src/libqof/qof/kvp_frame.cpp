@@ -41,13 +41,41 @@ extern "C"
 
 #include "qof.h"
 
-/* Note that we keep the keys for this hash table in the
+/* A slot of a frame.  Note that we keep the keys in the
  * qof_string_cache, as it is very likely we will see the
- * same keys over and over again  */
+ * same keys over and over again; equal keys are then usually
+ * the same pointer. */
+typedef struct
+{
+    const char  * key;      /* NULL if the slot is free */
+    guint         hash;     /* kvp_key_hash_len() of key */
+    KvpValue    * value;
+} KvpSlot;
+
+/* Frames with up to KVP_FRAME_SMALL_SLOTS slots keep them in a short
+ * array, searched in order.  Bigger frames keep them in an open
+ * addressing table of a power of two size with linear probing, at
+ * most half full. */
+#define KVP_FRAME_SMALL_SLOTS 4
 
 struct _KvpFrame
 {
-    GHashTable  * hash;
+    KvpSlot     * slots;    /* NULL until the frame is used */
+    guint         n_slots;
+    guint         size;     /* of slots */
+};
+
+typedef struct
+{
+    const char  * key;      /* owned by the path */
+    gsize         len;
+    guint         hash;
+} KvpPathKey;
+
+struct _KvpPath
+{
+    guint         n_keys;
+    KvpPathKey    keys[1];  /* n_keys of them */
 };
 
 
@@ -82,59 +110,196 @@ static QofLogModule log_module = QOF_MOD_KVP;
  * KvpFrame functions
  ********************************************************************/
 
-static guint
-kvp_hash_func(gconstpointer v)
+/* The hash of the first len bytes of key */
+static inline guint
+kvp_key_hash_len (const char *key, gsize len)
 {
-    return g_str_hash(v);
+    guint hash = 5381;
+    gsize i;
+
+    for (i = 0; i < len; i++)
+        hash = (hash << 5) + hash + (guchar) key[i];
+    return hash;
 }
 
-static gint
-kvp_comp_func(gconstpointer v, gconstpointer v2)
+static inline gboolean
+kvp_frame_is_table (const KvpFrame *f)
 {
-    return g_str_equal(v, v2);
+    return f->size > KVP_FRAME_SMALL_SLOTS;
 }
 
 static gboolean
 init_frame_body_if_needed(KvpFrame *f)
 {
-    if (!f->hash)
+    if (!f->slots)
     {
-        f->hash = g_hash_table_new(&kvp_hash_func, &kvp_comp_func);
+        f->slots = g_new0 (KvpSlot, KVP_FRAME_SMALL_SLOTS);
+        f->size = KVP_FRAME_SMALL_SLOTS;
+        f->n_slots = 0;
     }
-    return(f->hash != NULL);
+    return(f->slots != NULL);
 }
 
-KvpFrame *
-kvp_frame_new(void)
+/* Find the slot for the key made of the first len bytes of key. */
+static KvpSlot *
+kvp_frame_find_slot (const KvpFrame *f, const char *key, gsize len,
+                     guint hash)
 {
-    KvpFrame * retval = g_new0(KvpFrame, 1);
+    guint i, mask;
 
-    /* Save space until the frame is actually used */
-    retval->hash = NULL;
-    return retval;
+    if (!f->slots) return NULL;
+
+    if (!kvp_frame_is_table (f))
+    {
+        for (i = 0; i < f->n_slots; i++)
+        {
+            KvpSlot *slot = &f->slots[i];
+
+            if (slot->hash == hash && (slot->key == key ||
+                                       (!strncmp (slot->key, key, len) &&
+                                        slot->key[len] == '\0')))
+                return slot;
+        }
+        return NULL;
+    }
+
+    mask = f->size - 1;
+    for (i = hash & mask; f->slots[i].key; i = (i + 1) & mask)
+    {
+        KvpSlot *slot = &f->slots[i];
+
+        if (slot->hash == hash && (slot->key == key ||
+                                   (!strncmp (slot->key, key, len) &&
+                                    slot->key[len] == '\0')))
+            return slot;
+    }
+    return NULL;
+}
+
+static inline KvpSlot *
+kvp_frame_lookup (const KvpFrame *f, const char *key)
+{
+    gsize len = strlen (key);
+    return kvp_frame_find_slot (f, key, len, kvp_key_hash_len (key, len));
+}
+
+/* Put a slot into a table which has a free slot for it */
+static void
+kvp_table_put (KvpSlot *slots, guint size, const KvpSlot *slot)
+{
+    guint mask = size - 1;
+    guint i;
+
+    for (i = slot->hash & mask; slots[i].key; i = (i + 1) & mask)
+        ;
+    slots[i] = *slot;
 }
 
 static void
-kvp_frame_delete_worker(gpointer key, gpointer value, G_GNUC_UNUSED gpointer user_data)
+kvp_frame_grow (KvpFrame *f, guint size)
 {
-    qof_string_cache_remove(key);
-    kvp_value_delete((KvpValue *)value);
+    KvpSlot *old_slots = f->slots;
+    guint old_size = f->size;
+    guint i;
+
+    f->slots = g_new0 (KvpSlot, size);
+    f->size = size;
+    for (i = 0; i < old_size; i++)
+        if (old_slots[i].key)
+            kvp_table_put (f->slots, size, &old_slots[i]);
+    g_free (old_slots);
+}
+
+/* Add a slot for a key that isn't in the frame yet.  key must be
+ * in the qof_string_cache already. */
+static void
+kvp_frame_insert_slot (KvpFrame *f, const char *key, guint hash,
+                       KvpValue *value)
+{
+    KvpSlot slot;
+
+    slot.key = key;
+    slot.hash = hash;
+    slot.value = value;
+
+    if (!kvp_frame_is_table (f))
+    {
+        if (f->n_slots < f->size)
+        {
+            f->slots[f->n_slots++] = slot;
+            return;
+        }
+        kvp_frame_grow (f, KVP_FRAME_SMALL_SLOTS * 4);
+    }
+    else if ((f->n_slots + 1) * 2 > f->size)
+    {
+        kvp_frame_grow (f, f->size * 2);
+    }
+    kvp_table_put (f->slots, f->size, &slot);
+    f->n_slots++;
+}
+
+/* Take the slot out of the frame.  Its key and value are left to the
+ * caller. */
+static void
+kvp_frame_remove_slot (KvpFrame *f, KvpSlot *slot)
+{
+    guint i, j, mask;
+
+    if (!kvp_frame_is_table (f))
+    {
+        *slot = f->slots[--f->n_slots];
+        f->slots[f->n_slots].key = NULL;
+        return;
+    }
+
+    /* Move the following slots of the probe sequence back, so that
+     * no free slot is left between a slot and its home. */
+    mask = f->size - 1;
+    i = slot - f->slots;
+    for (j = (i + 1) & mask; f->slots[j].key; j = (j + 1) & mask)
+    {
+        guint home = f->slots[j].hash & mask;
+
+        if ((j > i && (home <= i || home > j)) ||
+                (j < i && (home <= i && home > j)))
+        {
+            f->slots[i] = f->slots[j];
+            i = j;
+        }
+    }
+    f->slots[i].key = NULL;
+    f->slots[i].value = NULL;
+    f->n_slots--;
+}
+
+KvpFrame *
+kvp_frame_new(void)
+{
+    /* Save space until the frame is actually used */
+    KvpFrame * retval = g_new0(KvpFrame, 1);
+    return retval;
 }
 
 void
 kvp_frame_delete(KvpFrame * frame)
 {
+    guint i;
+
     if (!frame) return;
 
-    if (frame->hash)
+    if (frame->slots)
     {
         /* free any allocated resource for frame or its children */
-        g_hash_table_foreach(frame->hash, & kvp_frame_delete_worker,
-                             (gpointer)frame);
+        for (i = 0; i < frame->size; i++)
+        {
+            if (!frame->slots[i].key) continue;
+            qof_string_cache_remove(frame->slots[i].key);
+            kvp_value_delete(frame->slots[i].value);
+        }
 
-        /* delete the hash table */
-        g_hash_table_destroy(frame->hash);
-        frame->hash = NULL;
+        g_free(frame->slots);
+        frame->slots = NULL;
     }
     g_free(frame);
 }
@@ -143,32 +308,34 @@ gboolean
 kvp_frame_is_empty(const KvpFrame * frame)
 {
     if (!frame) return TRUE;
-    if (!frame->hash) return TRUE;
+    if (!frame->slots) return TRUE;
     return FALSE;
 }
 
-static void
-kvp_frame_copy_worker(gpointer key, gpointer value, gpointer user_data)
-{
-    KvpFrame * dest = (KvpFrame *)user_data;
-    g_hash_table_insert(dest->hash,
-                        qof_string_cache_insert(key),
-                        static_cast<void*>(kvp_value_copy(static_cast<KvpValue*>(value))));
-}
-
 KvpFrame *
 kvp_frame_copy(const KvpFrame * frame)
 {
     KvpFrame * retval = kvp_frame_new();
+    guint i;
 
     if (!frame) return retval;
 
-    if (frame->hash)
+    if (frame->slots)
     {
-        if (!init_frame_body_if_needed(retval)) return(NULL);
-        g_hash_table_foreach(frame->hash,
-                             & kvp_frame_copy_worker,
-                             (gpointer)retval);
+        /* Same size and hashes, so the slots can stay where they are */
+        retval->slots = g_new0 (KvpSlot, frame->size);
+        retval->size = frame->size;
+        retval->n_slots = frame->n_slots;
+        for (i = 0; i < frame->size; i++)
+        {
+            const KvpSlot *slot = &frame->slots[i];
+
+            if (!slot->key) continue;
+            retval->slots[i].key =
+                static_cast<const char*>(qof_string_cache_insert(slot->key));
+            retval->slots[i].hash = slot->hash;
+            retval->slots[i].value = kvp_value_copy(slot->value);
+        }
     }
     return retval;
 }
@@ -181,33 +348,40 @@ static KvpValue *
 kvp_frame_replace_slot_nc (KvpFrame * frame, const char * slot,
                            KvpValue * new_value)
 {
-    gpointer orig_key;
-    gpointer orig_value = NULL;
-    int      key_exists;
+    KvpSlot *kslot;
+    KvpValue *orig_value;
+    guint hash;
+    gsize len;
 
     if (!frame || !slot) return NULL;
     if (!init_frame_body_if_needed(frame)) return NULL; /* Error ... */
 
-    key_exists = g_hash_table_lookup_extended(frame->hash, slot,
-                 & orig_key, & orig_value);
-    if (key_exists)
+    len = strlen (slot);
+    hash = kvp_key_hash_len (slot, len);
+    kslot = kvp_frame_find_slot (frame, slot, len, hash);
+    if (!kslot)
     {
-        g_hash_table_remove(frame->hash, slot);
-        qof_string_cache_remove(orig_key);
-    }
-    else
-    {
-        orig_value = NULL;
+        if (new_value)
+            kvp_frame_insert_slot (frame, static_cast<const char*>(
+                                       qof_string_cache_insert(slot)),
+                                   hash, new_value);
+        return NULL;
     }
 
+    orig_value = kslot->value;
     if (new_value)
     {
-        g_hash_table_insert(frame->hash,
-                            qof_string_cache_insert((gpointer) slot),
-                            new_value);
+        kslot->value = new_value;
     }
+    else
+    {
+        const char *orig_key = kslot->key;
 
-    return (KvpValue *) orig_value;
+        kvp_frame_remove_slot (frame, kslot);
+        qof_string_cache_remove(orig_key);
+    }
+
+    return orig_value;
 }
 
 /* Passing in a null value into this routine has the effect
@@ -358,42 +532,51 @@ get_trailer_make (KvpFrame * frame, const char * key_path, char **end_key)
 
 /* Return pointer to last frame in path, or NULL if the path
  * doesn't exist.  Also store the last dangling part of path
- * in 'end_key'.
+ * in 'end_key'.  The keys along the path are looked up in place,
+ * without copying the path.
  */
 
 static inline const KvpFrame *
 get_trailer_or_null (const KvpFrame * frame, const char * key_path, char **end_key)
 {
-    char *last_key;
+    const char *key, *last_key;
 
     if (!frame || !key_path || (0 == key_path[0])) return NULL;
 
-    last_key = strrchr (const_cast<char*>(key_path), '/');
+    last_key = strrchr (key_path, '/');
     if (NULL == last_key)
     {
-        last_key = (char *) key_path;
-    }
-    else if (last_key == key_path)
-    {
-        last_key ++;
+        *end_key = (char *) key_path;
+        return frame;
     }
-    else if (0 == last_key[1])
-    {
+    if (0 == last_key[1] && last_key != key_path)
         return NULL;
-    }
-    else
+
+    *end_key = (char *) last_key + 1;
+    for (key = key_path; key < last_key; )
     {
-        char *root, *lkey;
-        root = g_strdup (key_path);
-        lkey = strrchr (root, '/');
-        *lkey = 0;
-        frame = kvp_frame_get_frame_or_null_slash_trash (frame, root);
-        g_free(root);
+        const char *next;
+        KvpSlot *slot;
+        gsize len;
 
-        last_key ++;
+        if ('/' == *key)
+        {
+            key++;
+            continue;
+        }
+        next = static_cast<const char*>(memchr (key, '/', last_key - key));
+        if (!next) next = last_key;
+        len = next - key;
+
+        slot = kvp_frame_find_slot (frame, key, len,
+                                    kvp_key_hash_len (key, len));
+        if (!slot) return NULL;
+        frame = kvp_value_get_frame (slot->value);
+        if (!frame) return NULL;
+
+        key = next;
     }
 
-    *end_key = last_key;
     return frame;
 }
 
@@ -607,11 +790,11 @@ kvp_frame_set_slot_nc(KvpFrame * frame, const char * slot,
 KvpValue *
 kvp_frame_get_slot(const KvpFrame * frame, const char * slot)
 {
-    KvpValue *v;
-    if (!frame) return NULL;
-    if (!frame->hash) return NULL;  /* Error ... */
-    v = static_cast<KvpValue*>(g_hash_table_lookup(frame->hash, slot));
-    return v;
+    KvpSlot *kslot;
+    if (!frame || !slot) return NULL;
+    if (!frame->slots) return NULL;  /* Error ... */
+    kslot = kvp_frame_lookup(frame, slot);
+    return kslot ? kslot->value : NULL;
 }
 
 /* ============================================================ */
@@ -710,6 +893,192 @@ kvp_frame_set_slot_path_gslist (KvpFrame *frame,
     }
 }
 
+/* ============================================================ */
+
+static KvpPath *
+kvp_path_alloc (guint n_keys)
+{
+    KvpPath *path;
+
+    path = static_cast<KvpPath*>(g_malloc (sizeof (KvpPath) +
+                                 (n_keys - 1) * sizeof (KvpPathKey)));
+    path->n_keys = 0;
+    return path;
+}
+
+/* The keys are copied rather than taken from the string cache, so a
+ * path made once can be kept across qof_close() and qof_init(). */
+static void
+kvp_path_add_key (KvpPath *path, const char *key, gsize len)
+{
+    KvpPathKey *pkey = &path->keys[path->n_keys++];
+
+    pkey->key = g_strndup (key, len);
+    pkey->len = len;
+    pkey->hash = kvp_key_hash_len (key, len);
+}
+
+KvpPath *
+kvp_path_new (const char *first_key, ...)
+{
+    va_list ap;
+    const char *key;
+    KvpPath *path;
+    guint n_keys = 0;
+
+    g_return_val_if_fail (first_key && *first_key != '\0', NULL);
+
+    va_start (ap, first_key);
+    for (key = first_key; key; key = va_arg (ap, const char *))
+        n_keys++;
+    va_end (ap);
+
+    path = kvp_path_alloc (n_keys);
+    va_start (ap, first_key);
+    for (key = first_key; key; key = va_arg (ap, const char *))
+        kvp_path_add_key (path, key, strlen (key));
+    va_end (ap);
+
+    return path;
+}
+
+KvpPath *
+kvp_path_new_from_string (const char *key_path)
+{
+    const char *key;
+    KvpPath *path;
+    guint n_keys = 0;
+
+    if (!key_path) return NULL;
+
+    for (key = key_path; *key; key++)
+        if ('/' != *key && (key == key_path || '/' == key[-1]))
+            n_keys++;
+    if (!n_keys) return NULL;
+
+    path = kvp_path_alloc (n_keys);
+    for (key = key_path; *key; )
+    {
+        const char *next;
+
+        if ('/' == *key)
+        {
+            key++;
+            continue;
+        }
+        next = strchr (key, '/');
+        if (!next) next = key + strlen (key);
+        kvp_path_add_key (path, key, next - key);
+        key = next;
+    }
+
+    return path;
+}
+
+void
+kvp_path_free (KvpPath *path)
+{
+    guint i;
+
+    if (!path) return;
+
+    for (i = 0; i < path->n_keys; i++)
+        g_free ((gchar*)path->keys[i].key);
+    g_free (path);
+}
+
+/* The slot of a path key, found by the hash worked out beforehand */
+static inline KvpSlot *
+kvp_frame_find_path_slot (const KvpFrame *frame, const KvpPathKey *pkey)
+{
+    return kvp_frame_find_slot (frame, pkey->key, pkey->len, pkey->hash);
+}
+
+KvpValue *
+kvp_frame_get_value_by_path (const KvpFrame *frame, const KvpPath *path)
+{
+    KvpSlot *slot = NULL;
+    guint i;
+
+    if (!frame || !path) return NULL;
+
+    for (i = 0; i < path->n_keys; i++)
+    {
+        if (i > 0)
+        {
+            frame = kvp_value_get_frame (slot->value);
+            if (!frame) return NULL;
+        }
+        slot = kvp_frame_find_path_slot (frame, &path->keys[i]);
+        if (!slot) return NULL;
+    }
+    return slot ? slot->value : NULL;
+}
+
+KvpFrame *
+kvp_frame_set_value_by_path_nc (KvpFrame *frame, const KvpPath *path,
+                                KvpValue *value)
+{
+    const KvpPathKey *last;
+    KvpSlot *slot;
+    guint i;
+
+    if (!frame || !path) return NULL;
+
+    for (i = 0; i + 1 < path->n_keys; i++)
+    {
+        const KvpPathKey *pkey = &path->keys[i];
+        KvpFrame *next_frame;
+
+        slot = kvp_frame_find_path_slot (frame, pkey);
+        if (slot)
+        {
+            next_frame = kvp_value_get_frame (slot->value);
+        }
+        else
+        {
+            /* Nothing to delete */
+            if (!value) return frame;
+            next_frame = kvp_frame_new ();
+            init_frame_body_if_needed (frame);
+            kvp_frame_insert_slot (frame, static_cast<const char*>(
+                                       qof_string_cache_insert (pkey->key)),
+                                   pkey->hash,
+                                   kvp_value_new_frame_nc (next_frame));
+        }
+        if (!next_frame) return NULL;
+        frame = next_frame;
+    }
+
+    last = &path->keys[path->n_keys - 1];
+    init_frame_body_if_needed (frame);
+    slot = kvp_frame_find_path_slot (frame, last);
+    if (slot)
+    {
+        KvpValue *old_value = slot->value;
+
+        if (value)
+        {
+            slot->value = value;
+        }
+        else
+        {
+            const char *old_key = slot->key;
+
+            kvp_frame_remove_slot (frame, slot);
+            qof_string_cache_remove (old_key);
+        }
+        kvp_value_delete (old_value);
+    }
+    else if (value)
+    {
+        kvp_frame_insert_slot (frame, static_cast<const char*>(
+                                   qof_string_cache_insert (last->key)),
+                               last->hash, value);
+    }
+    return frame;
+}
+
 gint64
 kvp_frame_get_gint64(const KvpFrame *frame, const char *path)
 {
@@ -1329,11 +1698,15 @@ kvp_frame_for_each_slot(KvpFrame *f,
                                      gpointer data),
                         gpointer data)
 {
+    guint i;
+
     if (!f) return;
     if (!proc) return;
-    if (!(f->hash)) return;
+    if (!(f->slots)) return;
 
-    g_hash_table_foreach(f->hash, (GHFunc) proc, data);
+    for (i = 0; i < f->size; i++)
+        if (f->slots[i].key)
+            proc(f->slots[i].key, f->slots[i].value, data);
 }
 
 #ifdef _MSC_VER
@@ -1443,8 +1816,8 @@ kvp_frame_compare(const KvpFrame *fa, const KvpFrame *fb)
     if (fa && !fb) return 1;
 
     /* nothing is always less than something */
-    if (!fa->hash && fb->hash) return -1;
-    if (fa->hash && !fb->hash) return 1;
+    if (!fa->slots && fb->slots) return -1;
+    if (fa->slots && !fb->slots) return 1;
 
     status.compare = 0;
     status.other_frame = (KvpFrame *) fb;
@@ -1619,7 +1992,7 @@ kvp_value_to_string(const KvpValue *val)
 }
 
 static void
-kvp_frame_to_string_helper(gpointer key, gpointer value, gpointer data)
+kvp_frame_to_string_helper(const char *key, KvpValue *value, gpointer data)
 {
     gchar *tmp_val;
     gchar **str = (gchar**)data;
@@ -1645,8 +2018,8 @@ kvp_frame_to_string(const KvpFrame *frame)
 
     tmp1 = g_strdup_printf("{\n");
 
-    if (frame->hash)
-        g_hash_table_foreach(frame->hash, kvp_frame_to_string_helper, &tmp1);
+    kvp_frame_for_each_slot(const_cast<KvpFrame*>(frame),
+                            kvp_frame_to_string_helper, &tmp1);
 
     {
         gchar *tmp2;
@@ -1658,11 +2031,60 @@ kvp_frame_to_string(const KvpFrame *frame)
     return tmp1;
 }
 
-GHashTable*
-kvp_frame_get_hash(const KvpFrame *frame)
+guint
+kvp_frame_get_slot_count(const KvpFrame *frame)
 {
-    g_return_val_if_fail (frame != NULL, NULL);
-    return frame->hash;
+    g_return_val_if_fail (frame != NULL, 0);
+    return frame->n_slots;
+}
+
+static gsize
+kvp_value_get_memory_size(const KvpValue *value)
+{
+    gsize size = sizeof (KvpValue);
+    const GList *node;
+
+    switch (value->type)
+    {
+    case KVP_TYPE_STRING:
+        if (value->value.str)
+            size += strlen (value->value.str) + 1;
+        break;
+    case KVP_TYPE_GUID:
+        size += sizeof (GncGUID);
+        break;
+    case KVP_TYPE_BINARY:
+        size += value->value.binary.datasize;
+        break;
+    case KVP_TYPE_GLIST:
+        for (node = value->value.list; node; node = node->next)
+            size += sizeof (GList) +
+                    kvp_value_get_memory_size (static_cast<KvpValue*>(node->data));
+        break;
+    case KVP_TYPE_FRAME:
+        size += kvp_frame_get_memory_size (value->value.frame);
+        break;
+    default:
+        break;
+    }
+    return size;
+}
+
+gsize
+kvp_frame_get_memory_size(const KvpFrame *frame)
+{
+    gsize size;
+    guint i;
+
+    if (!frame) return 0;
+
+    size = sizeof (KvpFrame) + frame->size * sizeof (KvpSlot);
+    if (!frame->slots) return size;
+    /* The keys are shared through the string cache */
+    for (i = 0; i < frame->size; i++)
+        if (frame->slots[i].key)
+            size += kvp_value_get_memory_size (frame->slots[i].value);
+    return size;
 }
 
 static GValue *gvalue_from_kvp_value (KvpValue*);
@@ -79,6 +79,9 @@ typedef struct _KvpFrame KvpFrame;
  * KvpValueType enum. */
 typedef struct _KvpValue KvpValue;
 
+/** A precompiled path, see kvp_path_new() */
+typedef struct _KvpPath KvpPath;
+
 /** \brief possible types in the union KvpValue
  * \todo : People have asked for boolean values,
  *  e.g. in xaccAccountSetAutoInterestXfer
@@ -409,6 +412,40 @@ KvpValue   * kvp_frame_get_slot_path (KvpFrame *frame,
  */
 KvpValue   * kvp_frame_get_slot_path_gslist (KvpFrame *frame,
         const GSList *key_path);
+/** @} */
+
+/** @name Precompiled Paths
+
+  A KvpPath holds the keys of a path already split out and hashed.
+  Code that reads or writes the same path over and over can make the
+  path once, instead of having its keys split out and hashed on every
+  access.  A path doesn't refer to any frame or to the string cache, so
+  it can be kept in a static variable.
+ @{
+*/
+/** Make a path from a NULL-terminated list of keys. */
+KvpPath    * kvp_path_new (const gchar *first_key, ...);
+
+/** Make a path from a unix-style slash-separated string.  Empty keys
+ *  are skipped; NULL is returned if there are no keys at all. */
+KvpPath    * kvp_path_new_from_string (const gchar *key_path);
+
+void         kvp_path_free (KvpPath *path);
+
+/** Return the value at the end of the path, or NULL if any portion
+ *  of the path doesn't exist. */
+KvpValue   * kvp_frame_get_value_by_path (const KvpFrame *frame,
+        const KvpPath *path);
+
+/** Put the value (without copying it) at the end of the path,
+ *  creating the frames along it as needed.  The old value at this
+ *  location, if any, is destroyed; a NULL value just deletes it.
+ *  Returns the frame holding the value, or NULL if a portion of the
+ *  path is not a frame, in which case the value is not taken over.
+ */
+KvpFrame   * kvp_frame_set_value_by_path_nc (KvpFrame *frame,
+        const KvpPath *path,
+        KvpValue *value);
 
 /**
  * Similar returns as strcmp.
@@ -592,7 +629,11 @@ void kvp_frame_for_each_slot(KvpFrame *f,
 /** Internal helper routines, you probably shouldn't be using these. */
 gchar* kvp_frame_to_string(const KvpFrame *frame);
 gchar* binary_to_string(const void *data, guint32 size);
-GHashTable* kvp_frame_get_hash(const KvpFrame *frame);
+guint  kvp_frame_get_slot_count(const KvpFrame *frame);
+/** The bytes allocated for frame, its slots and their values, down
+ *  through nested frames and lists.  The keys are shared with other
+ *  frames and not counted. */
+gsize  kvp_frame_get_memory_size(const KvpFrame *frame);
 
 /** KvpItem: GValue Exchange
  * \brief Transfer of KVP to and from GValue, with the key
@@ -443,6 +443,37 @@ qof_book_shutting_down (const QofBook *book)
     return book->shutting_down;
 }
 
+void
+qof_book_begin_bulk_load (QofBook *book)
+{
+    g_return_if_fail (book != NULL);
+    if (book->bulk_load_level++ == 0)
+        qof_event_suspend ();
+}
+
+void
+qof_book_end_bulk_load (QofBook *book)
+{
+    g_return_if_fail (book != NULL);
+    g_return_if_fail (book->bulk_load_level > 0);
+
+    if (--book->bulk_load_level > 0)
+        return;
+
+    /* Let the objects catch up while events are still suspended, so
+     * that listeners see one event for the whole load. */
+    qof_object_book_bulk_load_end (book);
+    qof_event_resume ();
+    qof_event_gen (&book->inst, QOF_EVENT_MODIFY, NULL);
+}
+
+gboolean
+qof_book_is_bulk_loading (const QofBook *book)
+{
+    if (!book) return FALSE;
+    return book->bulk_load_level > 0;
+}
+
 /* ====================================================================== */
 /* setters */
 
@@ -550,6 +581,58 @@ qof_book_foreach_collection (const QofBook *book,
 
 /* ====================================================================== */
 
+typedef struct
+{
+    GType type;
+    const QofObject *obj;
+    gsize bytes;
+} MemoryStatsData;
+
+static void
+memory_stats_instance_cb (QofInstance *inst, gpointer data)
+{
+    MemoryStatsData *msd = static_cast<MemoryStatsData*>(data);
+
+    if (msd->type == G_TYPE_INVALID)
+        msd->type = G_TYPE_FROM_INSTANCE (inst);
+    msd->bytes += kvp_frame_get_memory_size (qof_instance_get_slots (inst));
+    if (msd->obj && msd->obj->memory_size)
+        msd->bytes += msd->obj->memory_size (inst);
+}
+
+static void
+memory_stats_collection_cb (QofCollection *col, gpointer data)
+{
+    GList **stats = static_cast<GList**>(data);
+    QofBookMemoryStats *stat;
+    MemoryStatsData msd = { G_TYPE_INVALID, NULL, 0 };
+    GTypeQuery query;
+
+    if (qof_collection_count (col) == 0)
+        return;
+    msd.obj = qof_object_lookup (qof_collection_get_type (col));
+    qof_collection_foreach (col, memory_stats_instance_cb, &msd);
+    g_type_query (msd.type, &query);
+
+    stat = g_new0 (QofBookMemoryStats, 1);
+    stat->e_type = qof_collection_get_type (col);
+    stat->count = qof_collection_count (col);
+    stat->bytes = (gsize) stat->count * query.instance_size + msd.bytes;
+    *stats = g_list_prepend (*stats, stat);
+}
+
+GList *
+qof_book_get_memory_stats (const QofBook *book)
+{
+    GList *stats = NULL;
+
+    g_return_val_if_fail (book != NULL, NULL);
+    qof_book_foreach_collection (book, memory_stats_collection_cb, &stats);
+    return stats;
+}
+
+/* ====================================================================== */
+
 void qof_book_mark_closed (QofBook *book)
 {
     if (!book)
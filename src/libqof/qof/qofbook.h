@@ -135,6 +135,11 @@ struct _QofBook
      */
     gboolean shutting_down;
 
+    /* Nesting depth of qof_book_begin_bulk_load; while it is non-zero
+     * the objects are being read in by a backend, events are suspended
+     * and the engine defers keeping its caches in order. */
+    gint bulk_load_level;
+
     /* version number, used for tracking multiuser updates */
     gint32  version;
 
@@ -216,6 +221,24 @@ QofCollection  * qof_book_get_collection (const QofBook *, QofIdType);
 typedef void (*QofCollectionForeachCB) (QofCollection *, gpointer user_data);
 void qof_book_foreach_collection (const QofBook *, QofCollectionForeachCB, gpointer);
 
+/** Memory used by the objects of one type in a book */
+typedef struct
+{
+    QofIdTypeConst e_type;  /**< The type of the objects */
+    guint count;            /**< How many there are */
+    gsize bytes;            /**< Bytes they use */
+} QofBookMemoryStats;
+
+/** Return a list of QofBookMemoryStats, one for each non-empty
+ *  collection in the book.  The bytes are those of the instance
+ *  structures, of their slots and of whatever the type's QofObject
+ *  memory_size hook reports, such as strings and lists.  Strings from
+ *  the string cache are shared, so they are counted for every instance
+ *  that refers to them.  Free the list with
+ *  g_list_free_full (stats, g_free).
+ */
+GList * qof_book_get_memory_stats (const QofBook *book);
+
 /** The qof_book_set_data() allows arbitrary pointers to structs
  *    to be stored in QofBook. This is the "preferred" method for
  *    extending QofBook to hold new data types.  This is also
@@ -271,6 +294,23 @@ gboolean qof_book_use_split_action_for_num_field (const QofBook *book);
 /** Is the book shutting down? */
 gboolean qof_book_shutting_down (const QofBook *book);
 
+/** Start loading a large number of objects into the book, as the
+ *  backends do when reading a file or database.  Until the matching
+ *  qof_book_end_bulk_load() events are suspended and the objects may
+ *  defer any sorting or balancing work.  Calls may be nested.
+ */
+void qof_book_begin_bulk_load (QofBook *book);
+
+/** Finish a bulk load started with qof_book_begin_bulk_load().  When
+ *  the outermost bulk load ends each object type gets a chance to do
+ *  its deferred work, events are resumed and a single
+ *  QOF_EVENT_MODIFY is sent for the book.
+ */
+void qof_book_end_bulk_load (QofBook *book);
+
+/** Is a bulk load of the book in progress? */
+gboolean qof_book_is_bulk_loading (const QofBook *book);
+
 /** qof_book_not_saved() returns the value of the session_dirty flag,
  * set when changes to any object in the book are committed
  * (qof_backend->commit_edit has been called) and the backend hasn't
@@ -34,9 +34,22 @@ typedef struct
     gpointer user_data;
 
     gint handler_id;
+
+    /* The filter given to qof_event_register_filtered_handler() */
+    QofIdTypeConst obj_type;
+    QofEventId event_mask;
+
+    /* Handlers are called newest first, in order of serial */
+    guint serial;
 } HandlerInfo;
 
 /* generates an event even when events are suspended! */
 void qof_event_force (QofInstance *entity, QofEventId event_id, gpointer event_data);
 
+/* The serial number of the last event on an object of type obj_type,
+ * or of any type if obj_type is NULL, that was dropped because events
+ * were suspended; 0 if there was none.  The serials only grow, so a
+ * handler can tell whether it missed events since it last looked. */
+guint64 qof_event_get_suppressed_serial (QofIdTypeConst obj_type);
+
 #endif
@@ -44,6 +44,20 @@ static guint   handler_run_level = 0;
 static guint   pending_deletes   = 0;
 static GList   *handlers  =   NULL;
 
+/* The handlers again, for dispatching: those for all types, and those
+ * for each type in a table of lists.  All lists are newest first. */
+static GList      *any_type_handlers = NULL;
+static GHashTable *type_handlers     = NULL;
+static guint       next_serial       = 0;
+
+static guint64 events_generated = 0;
+static guint64 handlers_invoked = 0;
+
+/* The serial of the last event dropped while events were suspended,
+ * of any type and for each type (a guint64 in the table). */
+static guint64     suppressed_serial = 0;
+static GHashTable *suppressed_types  = NULL;
+
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = QOF_MOD_ENGINE;
 
@@ -78,13 +92,63 @@ find_next_handler_id(void)
     return handler_id;
 }
 
+static void
+dispatch_list_add (HandlerInfo *hi)
+{
+    GList *list;
+
+    if (!hi->obj_type)
+    {
+        any_type_handlers = g_list_prepend (any_type_handlers, hi);
+        return;
+    }
+    if (!type_handlers)
+        type_handlers = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                               g_free, NULL);
+    list = static_cast<GList*>(g_hash_table_lookup (type_handlers,
+                               hi->obj_type));
+    g_hash_table_insert (type_handlers, g_strdup (hi->obj_type),
+                         g_list_prepend (list, hi));
+}
+
+static void
+dispatch_list_remove (HandlerInfo *hi)
+{
+    GList *list;
+
+    if (!hi->obj_type)
+    {
+        any_type_handlers = g_list_remove (any_type_handlers, hi);
+        return;
+    }
+    list = static_cast<GList*>(g_hash_table_lookup (type_handlers,
+                               hi->obj_type));
+    list = g_list_remove (list, hi);
+    if (list)
+        g_hash_table_insert (type_handlers, g_strdup (hi->obj_type), list);
+    else
+        g_hash_table_remove (type_handlers, hi->obj_type);
+}
+
+static void
+handler_free (HandlerInfo *hi)
+{
+    dispatch_list_remove (hi);
+    g_free ((gchar*)hi->obj_type);
+    g_free (hi);
+}
+
 gint
-qof_event_register_handler (QofEventHandler handler, gpointer user_data)
+qof_event_register_filtered_handler (QofIdTypeConst obj_type,
+                                     QofEventId event_mask,
+                                     QofEventHandler handler,
+                                     gpointer user_data)
 {
     HandlerInfo *hi;
     gint handler_id;
 
-    ENTER ("(handler=%p, data=%p)", handler, user_data);
+    ENTER ("(type=%s, mask=%x, handler=%p, data=%p)",
+           obj_type ? obj_type : "(all)", event_mask, handler, user_data);
 
     /* sanity check */
     if (!handler)
@@ -102,12 +166,22 @@ qof_event_register_handler (QofEventHandler handler, gpointer user_data)
     hi->handler = handler;
     hi->user_data = user_data;
     hi->handler_id = handler_id;
+    hi->obj_type = g_strdup (obj_type);
+    hi->event_mask = event_mask;
+    hi->serial = next_serial++;
 
     handlers = g_list_prepend (handlers, hi);
+    dispatch_list_add (hi);
     LEAVE ("(handler=%p, data=%p) handler_id=%d", handler, user_data, handler_id);
     return handler_id;
 }
 
+gint
+qof_event_register_handler (QofEventHandler handler, gpointer user_data)
+{
+    return qof_event_register_filtered_handler (NULL, 0, handler, user_data);
+}
+
 void
 qof_event_unregister_handler (gint handler_id)
 {
@@ -137,7 +211,7 @@ qof_event_unregister_handler (gint handler_id)
         {
             handlers = g_list_remove_link (handlers, node);
             g_list_free_1 (node);
-            g_free (hi);
+            handler_free (hi);
         }
         else
         {
@@ -179,6 +253,7 @@ qof_event_generate_internal (QofInstance *entity, QofEventId event_id,
 {
     GList *node;
     GList *next_node = NULL;
+    GList *any_node, *type_node = NULL;
 
     g_return_if_fail(entity);
 
@@ -191,16 +266,38 @@ qof_event_generate_internal (QofInstance *entity, QofEventId event_id,
     }
     }
 
+    events_generated++;
+
+    /* Walk the handlers for all types and those for the entity's type
+     * together, newest first, as if they were still a single list. */
+    any_node = any_type_handlers;
+    if (type_handlers && entity->e_type)
+        type_node = static_cast<GList*>(g_hash_table_lookup (type_handlers,
+                                        entity->e_type));
+
     handler_run_level++;
-    for (node = handlers; node; node = next_node)
+    while (any_node || type_node)
     {
-        HandlerInfo *hi = static_cast<HandlerInfo*>(node->data);
+        HandlerInfo *hi;
 
-        next_node = node->next;
-        if (hi->handler)
+        if (!type_node || (any_node &&
+                           static_cast<HandlerInfo*>(any_node->data)->serial >
+                           static_cast<HandlerInfo*>(type_node->data)->serial))
+        {
+            hi = static_cast<HandlerInfo*>(any_node->data);
+            any_node = any_node->next;
+        }
+        else
+        {
+            hi = static_cast<HandlerInfo*>(type_node->data);
+            type_node = type_node->next;
+        }
+
+        if (hi->handler && (!hi->event_mask || (hi->event_mask & event_id)))
         {
             PINFO("id=%d hi=%p han=%p data=%p", hi->handler_id, hi,
                   hi->handler, event_data);
+            handlers_invoked++;
             hi->handler (entity, event_id, hi->user_data, event_data);
         }
     }
@@ -220,7 +317,7 @@ qof_event_generate_internal (QofInstance *entity, QofEventId event_id,
                 /* remove this node from the list, then free this node */
                 handlers = g_list_remove_link (handlers, node);
                 g_list_free_1 (node);
-                g_free (hi);
+                handler_free (hi);
             }
         }
         pending_deletes = 0;
@@ -236,6 +333,31 @@ qof_event_force (QofInstance *entity, QofEventId event_id, gpointer event_data)
     qof_event_generate_internal (entity, event_id, event_data);
 }
 
+static void
+qof_event_suppress (QofInstance *entity, QofEventId event_id)
+{
+    guint64 *serial;
+
+    if (event_id == QOF_EVENT_NONE)
+        return;
+
+    suppressed_serial++;
+    if (!entity->e_type)
+        return;
+    if (!suppressed_types)
+        suppressed_types = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  g_free, g_free);
+    serial = static_cast<guint64*>(g_hash_table_lookup (suppressed_types,
+                                   entity->e_type));
+    if (!serial)
+    {
+        serial = g_new (guint64, 1);
+        g_hash_table_insert (suppressed_types, g_strdup (entity->e_type),
+                             serial);
+    }
+    *serial = suppressed_serial;
+}
+
 void
 qof_event_gen (QofInstance *entity, QofEventId event_id, gpointer event_data)
 {
@@ -243,9 +365,42 @@ qof_event_gen (QofInstance *entity, QofEventId event_id, gpointer event_data)
         return;
 
     if (suspend_counter)
+    {
+        qof_event_suppress (entity, event_id);
         return;
+    }
 
     qof_event_generate_internal (entity, event_id, event_data);
 }
 
+void
+qof_event_get_counts (guint64 *n_generated, guint64 *n_invoked)
+{
+    if (n_generated)
+        *n_generated = events_generated;
+    if (n_invoked)
+        *n_invoked = handlers_invoked;
+}
+
+guint64
+qof_event_get_suppressed_serial (QofIdTypeConst obj_type)
+{
+    guint64 *serial;
+
+    if (!obj_type)
+        return suppressed_serial;
+    if (!suppressed_types)
+        return 0;
+    serial = static_cast<guint64*>(g_hash_table_lookup (suppressed_types,
+                                   obj_type));
+    return serial ? *serial : 0;
+}
+
+void
+qof_event_reset_counts (void)
+{
+    events_generated = 0;
+    handlers_invoked = 0;
+}
+
 /* =========================== END OF FILE ======================= */
@@ -98,6 +98,25 @@ typedef void (*QofEventHandler) (QofInstance *ent,  QofEventId event_type,
  */
 gint qof_event_register_handler (QofEventHandler handler, gpointer handler_data);
 
+/** \brief Register a handler for some of the events.
+ *
+ * The handler is only invoked for events on entities of type obj_type
+ * whose event id has a bit in common with event_mask.  Events are
+ * dispatched through a table of the handlers for each type, so the
+ * handlers for other types cost nothing.
+ *
+ * @param obj_type: the type of the entities, or NULL for all of them
+ * @param event_mask: the events, or 0 for all of them
+ * @param handler:   handler to register
+ * @param handler_data: data provided when handler is invoked
+ *
+ * @return id identifying handler, for qof_event_unregister_handler()
+ */
+gint qof_event_register_filtered_handler (QofIdTypeConst obj_type,
+        QofEventId event_mask,
+        QofEventHandler handler,
+        gpointer handler_data);
+
 /** \brief Unregister an event handler.
  *
  * @param handler_id: the id of the handler to unregister
@@ -139,6 +158,15 @@ void qof_event_suspend (void);
 /** Resume engine event generation. */
 void qof_event_resume (void);
 
+/** \brief Get the number of events generated and of handler
+ *  invocations since the start or the last qof_event_reset_counts().
+ *
+ * Suspended events are not counted. */
+void qof_event_get_counts (guint64 *n_generated, guint64 *n_invoked);
+
+/** Reset the counts of qof_event_get_counts(). */
+void qof_event_reset_counts (void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -44,6 +44,11 @@ void qof_instance_set_collection (gconstpointer ptr, QofCollection *col);
 
 void qof_instance_set_slots (QofInstance *, KvpFrame *);
 
+/** Return a number which changes whenever the slots are replaced with
+ *  qof_instance_set_slots(), so that an object keeping data read from
+ *  its slots can tell when to read them again. */
+guint qof_instance_get_slots_serial (const QofInstance *inst);
+
 /*  Set the last_update time. Reserved for use by the SQL backend;
  *  used for comparing version in local memory to that in remote
  *  server.
@@ -108,6 +108,9 @@ typedef struct QofInstancePrivate
     gint32 version;
     guint32 version_check;  /* data aging timestamp */
 
+    /* bumped whenever the slots are replaced */
+    guint slots_serial;
+
     /* -------------------------------------------------------------- */
     /* Backend private expansion data */
     guint32  idata;   /* used by the sql backend for kvp management */
@@ -274,6 +277,30 @@ qof_instance_init (QofInstance *inst)
     priv->infant = TRUE;
 }
 
+/* The ids of new instances are made in batches, which costs less than
+ * one at a time with either generator.  Imports and loads make many. */
+#define GUID_BATCH_SIZE 64
+static GncGUID guid_batch[GUID_BATCH_SIZE];
+static guint guid_batch_next = GUID_BATCH_SIZE;
+static GncGUIDGenerator guid_batch_generator;
+G_LOCK_DEFINE_STATIC (guid_batch);
+
+static void
+instance_new_guid (GncGUID *guid)
+{
+    G_LOCK (guid_batch);
+    /* The rest of a batch made by another generator is thrown away */
+    if (guid_batch_next == GUID_BATCH_SIZE ||
+            guid_batch_generator != guid_get_generator ())
+    {
+        guid_batch_generator = guid_get_generator ();
+        guid_new_n (guid_batch, GUID_BATCH_SIZE);
+        guid_batch_next = 0;
+    }
+    *guid = guid_batch[guid_batch_next++];
+    G_UNLOCK (guid_batch);
+}
+
 void
 qof_instance_init_data (QofInstance *inst, QofIdType type, QofBook *book)
 {
@@ -303,7 +330,7 @@ qof_instance_init_data (QofInstance *inst, QofIdType type, QofBook *book)
 
     do
     {
-        guid_new(&priv->guid);
+        instance_new_guid (&priv->guid);
 
         if (NULL == qof_collection_lookup_entity (col, &priv->guid))
             break;
@@ -595,9 +622,17 @@ qof_instance_set_slots (QofInstance *inst, KvpFrame *frm)
     }
 
     priv->dirty = TRUE;
+    priv->slots_serial++;
     inst->kvp_data = frm;
 }
 
+guint
+qof_instance_get_slots_serial (const QofInstance *inst)
+{
+    g_return_val_if_fail(QOF_IS_INSTANCE(inst), 0);
+    return GET_PRIVATE(inst)->slots_serial;
+}
+
 void
 qof_instance_set_last_update (QofInstance *inst, Timespec ts)
 {
@@ -44,6 +44,7 @@ extern "C"
 /** To be called from within the book */
 void qof_object_book_begin (QofBook *book);
 void qof_object_book_end (QofBook *book);
+void qof_object_book_bulk_load_end (QofBook *book);
 
 gboolean qof_object_is_dirty (const QofBook *book);
 void qof_object_mark_clean (QofBook *book);
@@ -124,6 +124,19 @@ struct _QofObject
      *  to or later than than 'instance_right'.
      */
     int                 (*version_cmp)(gpointer instance_left, gpointer instance_right);
+
+    /** bulk_load_end is called from qof_book_end_bulk_load once all of
+     *  the objects have been loaded, so that work deferred during the
+     *  load (sorting, balance computation) can be done in one go.
+     *  It may be NULL.
+     */
+    void                (*bulk_load_end)(QofBook *);
+
+    /** Return the bytes an instance of this type uses beyond its
+     *  instance structure and its slots, e.g. for private data, strings
+     *  and list nodes, for qof_book_get_memory_stats.  It may be NULL.
+     */
+    gsize               (*memory_size)(gpointer instance);
 };
 
 /* -------------------------------------------------------------- */
@@ -37,6 +37,11 @@ extern "C"
 /* Functions to get Query information */
 int qof_query_get_max_results (const QofQuery *q);
 
+/* How the last run of the query found its results: for each book,
+ * either by a scan of all of the objects or by the indexes used for
+ * each OR-clause.  NULL if the query hasn't been run. */
+const char * qof_query_get_plan (const QofQuery *q);
+
 
 /* Functions to get and look at QueryTerms */
 
@@ -56,6 +61,11 @@ QofQueryParamList * qof_query_term_get_param_path (const QofQueryTerm *queryterm
 /*@ dependent @*/
 QofQueryPredData *qof_query_term_get_pred_data (const QofQueryTerm *queryterm);
 gboolean qof_query_term_is_inverted (const QofQueryTerm *queryterm);
+/* How often the term was evaluated, and how often it held, by the
+ * runs of the query since it last changed.  Terms which are served by
+ * an index are still checked for each candidate and counted. */
+void qof_query_term_get_counts (const QofQueryTerm *queryterm,
+                                guint64 *evaluated, guint64 *passed);
 
 
 /* Functions to get and look at QuerySorts */
@@ -42,6 +42,7 @@ extern "C"
 #include "qofbackend-p.h"
 #include "qofbook-p.h"
 #include "qofclass-p.h"
+#include "qofevent-p.h"
 #include "qofquery-p.h"
 #include "qofquerycore-p.h"
 
@@ -60,6 +61,11 @@ struct _QofQueryTerm
      */
     GSList *                param_fcns;
     QofQueryPredicateFunc   pred_fcn;
+
+    /* How often the term was evaluated, and how often it held, since
+     * the query was last compiled. */
+    guint64                 n_evaluated;
+    guint64                 n_passed;
 };
 
 struct _QofQuerySort
@@ -110,6 +116,24 @@ struct _QofQuery
     gint              changed;
 
     GList *           results;
+
+    /* How the last run found its results, see query_plan_book() */
+    gchar *           plan;
+
+    /* The OR-terms compiled into QofQueryClauses, see compile_clause() */
+    GPtrArray *       clauses;
+
+    /* The state of a live query, see qof_query_set_live() */
+    GHashTable *      live_handlers;  /* type -> event handler id */
+    gboolean          live_stale;     /* everything needs checking again */
+    gboolean          live_cropped;   /* matches before live_results dropped */
+    gint              live_max_results; /* max_results of the last full run */
+    guint64           live_serial;    /* last suppressed event serial seen */
+    GHashTable *      live_pending;   /* changed object -> QofQueryLiveRef */
+    GHashTable *      live_types;     /* types whose parameters are read */
+    GSequence *       live_results;   /* of QofQueryLiveMatch, sorted */
+    GHashTable *      live_iters;     /* object -> iter in live_results */
+    gint              live_seq;       /* seq of the next match found */
 };
 
 typedef struct _QofQueryCB
@@ -117,8 +141,95 @@ typedef struct _QofQueryCB
     QofQuery *        query;
     GList *           list;
     gint              count;
+
+    /* With max_results set, only the best max_results matches are
+     * kept, in a heap instead of the list; see query_keep_top(). */
+    GArray *          top;
 } QofQueryCB;
 
+/* A match kept in QofQueryCB.top; seq is its position among all of
+ * the matches */
+typedef struct
+{
+    gpointer          object;
+    gint              seq;
+} QofQueryMatch;
+
+/* Where a live query finds an object again.  Objects can be freed
+ * without an event, as a new split is when its transaction is rolled
+ * back, so a live query looks an object up in its collection by GUID
+ * before it touches it. */
+typedef struct
+{
+    GncGUID           guid;
+    QofCollection *   col;
+} QofQueryLiveRef;
+
+/* A match kept in QofQuery.live_results */
+typedef struct
+{
+    QofQueryMatch     match;
+    QofQueryLiveRef   ref;
+} QofQueryLiveMatch;
+
+/* A registered index, see qof_query_register_index() */
+typedef struct
+{
+    QofIdTypeConst        obj_type;   /* NULL for all types */
+    const QofQueryIndex * index;
+} QofQueryIndexDef;
+
+/* A value on the way from the searched object to the parameters of
+ * the terms: the result of param applied to the value in slot parent,
+ * or to the searched object itself if parent is -1.  Terms whose paths
+ * start the same way share the slots of the common part. */
+typedef struct
+{
+    gint                  parent;
+    const QofParam *      param;
+} QofQuerySlot;
+
+/* Checking one term: get its parameter from the value in slot and
+ * call its predicate on it. */
+typedef struct
+{
+    QofQueryTerm *        term;
+    gint                  slot;
+    const QofParam *      param;
+    gint                  cost;
+    gint                  order;    /* position in the AND-terms */
+    gdouble               rank;     /* see query_rank_steps() */
+} QofQueryStep;
+
+/* An AND-clause compiled into the values it needs and the steps,
+ * ordered so that the cheap and selective terms come first. */
+typedef struct
+{
+    GArray *              slots;    /* of QofQuerySlot */
+    GArray *              steps;    /* of QofQueryStep */
+} QofQueryClause;
+
+/* The index chosen to find the candidates for one OR-clause */
+typedef struct
+{
+    const QofQueryIndex * index;
+    const QofQueryTerm *  term;
+    gint64                estimate;
+} QofQueryPlanStep;
+
+/* A registered QofQueryDependentsFunc */
+typedef struct
+{
+    QofIdTypeConst         search_for;
+    QofIdTypeConst         obj_type;
+    QofQueryDependentsFunc func;
+} QofQueryDependentsDef;
+
+static GList *query_indexes = NULL;
+static GList *query_dependents = NULL;
+
+static void live_query_stop (QofQuery *q);
+
 /* initial_term will be owned by the new Query */
 static void query_init (QofQuery *q, QofQueryTerm *initial_term)
 {
@@ -139,6 +250,10 @@ static void query_init (QofQuery *q, QofQueryTerm *initial_term)
 
     g_list_free (q->results);
     g_list_free (q->books);
+    g_free (q->plan);
+    if (q->clauses)
+        g_ptr_array_free (q->clauses, TRUE);
+    live_query_stop (q);
 
     g_slist_free (q->primary_sort.param_list);
     g_slist_free (q->secondary_sort.param_list);
@@ -201,6 +316,8 @@ static QofQueryTerm * copy_query_term (const QofQueryTerm *qt)
     new_qt->param_list = g_slist_copy (qt->param_list);
     new_qt->param_fcns = g_slist_copy (qt->param_fcns);
     new_qt->pdata = qof_query_core_predicate_copy (qt->pdata);
+    new_qt->n_evaluated = 0;
+    new_qt->n_passed = 0;
     return new_qt;
 }
 
@@ -280,6 +397,15 @@ static void free_members (QofQuery *q)
 
     g_list_free(q->results);
     q->results = NULL;
+
+    g_free(q->plan);
+    q->plan = NULL;
+
+    if (q->clauses)
+        g_ptr_array_free (q->clauses, TRUE);
+    q->clauses = NULL;
+
+    live_query_stop (q);
 }
 
 static int cmp_func (const QofQuerySort *sort, QofSortFunc default_sort,
@@ -364,58 +490,58 @@ sort_func (const gconstpointer a, const gconstpointer b, const gpointer q)
 
 /* ==================================================================== */
 /* This is the main workhorse for performing the query.  For each
- * object, it walks over all of the query terms to see if the
+ * object, it runs the compiled clauses of the query to see if the
  * object passes the seive.
  */
 
-static int
-check_object (const QofQuery *q, gpointer object)
+static gpointer
+clause_get_slot (const QofQueryClause *clause, gpointer object,
+                 gpointer *values, gboolean *done, gint slot)
 {
-    const GList     * and_ptr;
-    const GList     * or_ptr;
-    const QofQueryTerm * qt;
-    int       and_terms_ok = 1;
+    const QofQuerySlot *qs;
 
-    for (or_ptr = q->terms; or_ptr; or_ptr = or_ptr->next)
-    {
-        and_terms_ok = 1;
-        for (and_ptr = static_cast<GList*>(or_ptr->data); and_ptr;
-	     and_ptr = static_cast<GList*>(and_ptr->next))
-        {
-            qt = (QofQueryTerm *)(and_ptr->data);
-            if (qt->param_fcns && qt->pred_fcn)
-            {
-                const GSList *node;
-                QofParam *param = NULL;
-                gpointer conv_obj = object;
-
-                /* iterate through the conversions */
-                for (node = qt->param_fcns; node; node = node->next)
-                {
-                    param = static_cast<QofParam*>(node->data);
+    if (slot < 0) return object;
+    if (done[slot]) return values[slot];
 
-                    /* The last term is the actual parameter getter */
-                    if (!node->next) break;
+    qs = &g_array_index (clause->slots, QofQuerySlot, slot);
+    values[slot] = qs->param->param_getfcn (
+                       clause_get_slot (clause, object, values, done,
+                                        qs->parent),
+                       const_cast<QofParam*>(qs->param));
+    done[slot] = TRUE;
+    return values[slot];
+}
 
-                    conv_obj = param->param_getfcn (conv_obj, param);
-                }
+static gboolean
+check_clause (const QofQueryClause *clause, gpointer object)
+{
+    guint n_slots = clause->slots->len;
+    gpointer *values = g_newa (gpointer, n_slots + 1);
+    gboolean *done = g_newa (gboolean, n_slots + 1);
+    guint i;
 
-                if (((qt->pred_fcn)(conv_obj, param, qt->pdata)) == qt->invert)
-                {
-                    and_terms_ok = 0;
-                    break;
-                }
-            }
-            else
-            {
-                /* XXX: Don't know how to do this conversion -- do we care? */
-            }
-        }
-        if (and_terms_ok)
-        {
-            return 1;
-        }
+    memset (done, 0, (n_slots + 1) * sizeof (gboolean));
+    for (i = 0; i < clause->steps->len; i++)
+    {
+        const QofQueryStep *step = &g_array_index (clause->steps,
+                                   QofQueryStep, i);
+        QofQueryTerm *qt = step->term;
+        gpointer conv_obj = clause_get_slot (clause, object, values, done,
+                                             step->slot);
+
+        qt->n_evaluated++;
+        if (((qt->pred_fcn)(conv_obj, const_cast<QofParam*>(step->param),
+                            qt->pdata)) == qt->invert)
+            return FALSE;
+        qt->n_passed++;
     }
+    return TRUE;
+}
+
+static int
+check_object (const QofQuery *q, gpointer object)
+{
+    guint i;
 
     /* If there are no terms, assume a "match any" applies.
      * A query with no terms is still meaningful, since the user
@@ -423,6 +549,13 @@ check_object (const QofQuery *q, gpointer object)
      * order.
      */
     if (NULL == q->terms) return 1;
+
+    for (i = 0; i < q->clauses->len; i++)
+    {
+        if (check_clause (static_cast<QofQueryClause*>(
+                              g_ptr_array_index (q->clauses, i)), object))
+            return 1;
+    }
     return 0;
 }
 
@@ -514,6 +647,138 @@ compile_sort (QofQuerySort *sort, QofIdType obj)
     LEAVE ("sort=%p id=%s", sort, obj);
 }
 
+/* A rough cost of checking a term, in parameter fetches */
+static gint term_cost (const QofQueryTerm *qt)
+{
+    QofQueryPredData *pd = qt->pdata;
+    gint cost = g_slist_length (qt->param_fcns);
+
+    if (!g_strcmp0 (pd->type_name, QOF_TYPE_GUID))
+    {
+        QofGuidMatch options = ((query_guid_def *) pd)->options;
+        /* These two look at a list of objects */
+        if (options == QOF_GUID_MATCH_ALL || options == QOF_GUID_MATCH_LIST_ANY)
+            cost += 8;
+        else
+            cost += 1;
+    }
+    else if (!g_strcmp0 (pd->type_name, QOF_TYPE_DATE) ||
+             !g_strcmp0 (pd->type_name, QOF_TYPE_CHAR) ||
+             !g_strcmp0 (pd->type_name, QOF_TYPE_BOOLEAN) ||
+             !g_strcmp0 (pd->type_name, QOF_TYPE_INT32) ||
+             !g_strcmp0 (pd->type_name, QOF_TYPE_INT64) ||
+             !g_strcmp0 (pd->type_name, QOF_TYPE_DOUBLE))
+        cost += 1;
+    else if (!g_strcmp0 (pd->type_name, QOF_TYPE_NUMERIC))
+        cost += 2;
+    else if (!g_strcmp0 (pd->type_name, QOF_TYPE_STRING))
+        cost += ((query_string_def *) pd)->is_regex ? 16 : 4;
+    else
+        cost += 8;
+    return cost;
+}
+
+/* Find or add the slot for the value of param applied to slot parent */
+static gint clause_get_slot_index (GArray *slots, gint parent,
+                                   const QofParam *param)
+{
+    QofQuerySlot qs;
+    guint i;
+
+    for (i = 0; i < slots->len; i++)
+    {
+        QofQuerySlot *s = &g_array_index (slots, QofQuerySlot, i);
+        if (s->parent == parent && s->param == param)
+            return i;
+    }
+    qs.parent = parent;
+    qs.param = param;
+    g_array_append_val (slots, qs);
+    return slots->len - 1;
+}
+
+static void free_clause (gpointer data)
+{
+    QofQueryClause *clause = static_cast<QofQueryClause*>(data);
+
+    g_array_free (clause->slots, TRUE);
+    g_array_free (clause->steps, TRUE);
+    g_free (clause);
+}
+
+static QofQueryClause * compile_clause (GList *and_terms)
+{
+    QofQueryClause *clause = g_new0 (QofQueryClause, 1);
+    GList *and_ptr;
+    gint order = 0;
+
+    clause->slots = g_array_new (FALSE, FALSE, sizeof (QofQuerySlot));
+    clause->steps = g_array_new (FALSE, FALSE, sizeof (QofQueryStep));
+    for (and_ptr = and_terms; and_ptr; and_ptr = and_ptr->next)
+    {
+        QofQueryTerm *qt = static_cast<QofQueryTerm*>(and_ptr->data);
+        QofQueryStep step;
+        GSList *node;
+        gint slot = -1;
+
+        if (!qt->param_fcns || !qt->pred_fcn)
+        {
+            /* XXX: Don't know how to do this conversion -- do we care? */
+            continue;
+        }
+
+        /* All but the last parameter lead to the object that the last
+         * one, the actual parameter getter, is applied to. */
+        for (node = qt->param_fcns; node->next; node = node->next)
+            slot = clause_get_slot_index (clause->slots, slot,
+                                          static_cast<QofParam*>(node->data));
+
+        step.term = qt;
+        step.slot = slot;
+        step.param = static_cast<QofParam*>(node->data);
+        step.cost = term_cost (qt);
+        step.order = order++;
+        step.rank = 0;
+        g_array_append_val (clause->steps, step);
+    }
+    return clause;
+}
+
+static gint step_cmp (gconstpointer a, gconstpointer b)
+{
+    const QofQueryStep *sa = static_cast<const QofQueryStep*>(a);
+    const QofQueryStep *sb = static_cast<const QofQueryStep*>(b);
+
+    if (sa->rank < sb->rank) return -1;
+    if (sa->rank > sb->rank) return 1;
+    return sa->order - sb->order;
+}
+
+/* Order the terms of each clause by their expected cost per object
+ * rejected, cost / (1 - p), so that the cheap terms which reject the
+ * most objects run first.  The chance p that a term holds is taken
+ * from the counts of the previous runs; before the first run it is
+ * 1/2 for every term and the order is that of the costs. */
+static void query_rank_steps (QofQuery *q)
+{
+    guint i, j;
+
+    for (i = 0; i < q->clauses->len; i++)
+    {
+        QofQueryClause *clause = static_cast<QofQueryClause*>(
+                                     g_ptr_array_index (q->clauses, i));
+
+        for (j = 0; j < clause->steps->len; j++)
+        {
+            QofQueryStep *step = &g_array_index (clause->steps, QofQueryStep, j);
+            gdouble p = (step->term->n_passed + 1.0) /
+                        (step->term->n_evaluated + 2.0);
+            step->rank = step->cost / (1.0 - p);
+        }
+        g_array_sort (clause->steps, step_cmp);
+    }
+}
+
 static void compile_terms (QofQuery *q)
 {
     GList *or_ptr, *and_ptr, *node;
@@ -545,9 +810,20 @@ static void compile_terms (QofQuery *q)
                 qt->pred_fcn = qof_query_core_get_predicate (resObj->param_type);
             else
                 qt->pred_fcn = NULL;
+
+            qt->n_evaluated = 0;
+            qt->n_passed = 0;
         }
     }
 
+    /* And put the terms together into the clauses that get run */
+    if (q->clauses)
+        g_ptr_array_free (q->clauses, TRUE);
+    q->clauses = g_ptr_array_new_with_free_func (free_clause);
+    for (or_ptr = q->terms; or_ptr; or_ptr = or_ptr->next)
+        g_ptr_array_add (q->clauses,
+                         compile_clause (static_cast<GList*>(or_ptr->data)));
+
     /* Update the sort functions */
     compile_sort (&(q->primary_sort), q->search_for);
     compile_sort (&(q->secondary_sort), q->search_for);
@@ -571,6 +847,116 @@ static void compile_terms (QofQuery *q)
     LEAVE (" query=%p", q);
 }
 
+/* ==================================================================== */
+/* When only the last max_results of the sorted matches are wanted,
+ * there is no need to keep and sort all of them.  The matches kept so
+ * far are held in a heap with the least of them on top; a new match
+ * either replaces that one or is dropped.  That takes O(n log k) time
+ * and O(k) space for k results of n matches.
+ *
+ * Matches that sort equal are ordered by when they were found, as the
+ * stable sort of the full list would do.
+ */
+
+static gboolean query_has_sort (const QofQuery *q)
+{
+    return (q->primary_sort.comp_fcn || q->primary_sort.obj_cmp ||
+            (q->primary_sort.use_default && q->defaultSort));
+}
+
+static gint match_cmp (gconstpointer a, gconstpointer b, gpointer q)
+{
+    const QofQueryMatch *ma = static_cast<const QofQueryMatch*>(a);
+    const QofQueryMatch *mb = static_cast<const QofQueryMatch*>(b);
+    gint retval = 0;
+
+    if (query_has_sort (static_cast<QofQuery*>(q)))
+        retval = sort_func (ma->object, mb->object, q);
+    if (retval == 0)
+        retval = ma->seq - mb->seq;
+    return retval;
+}
+
+static void heap_sift_down (GArray *heap, guint pos, QofQuery *q)
+{
+    while (TRUE)
+    {
+        guint least = pos, child = 2 * pos + 1;
+        QofQueryMatch tmp;
+
+        if (child < heap->len &&
+                match_cmp (&g_array_index (heap, QofQueryMatch, child),
+                           &g_array_index (heap, QofQueryMatch, least), q) < 0)
+            least = child;
+        if (child + 1 < heap->len &&
+                match_cmp (&g_array_index (heap, QofQueryMatch, child + 1),
+                           &g_array_index (heap, QofQueryMatch, least), q) < 0)
+            least = child + 1;
+        if (least == pos)
+            return;
+
+        tmp = g_array_index (heap, QofQueryMatch, pos);
+        g_array_index (heap, QofQueryMatch, pos) =
+            g_array_index (heap, QofQueryMatch, least);
+        g_array_index (heap, QofQueryMatch, least) = tmp;
+        pos = least;
+    }
+}
+
+static void heap_sift_up (GArray *heap, guint pos, QofQuery *q)
+{
+    while (pos > 0)
+    {
+        guint parent = (pos - 1) / 2;
+        QofQueryMatch tmp;
+
+        if (match_cmp (&g_array_index (heap, QofQueryMatch, parent),
+                       &g_array_index (heap, QofQueryMatch, pos), q) <= 0)
+            return;
+
+        tmp = g_array_index (heap, QofQueryMatch, pos);
+        g_array_index (heap, QofQueryMatch, pos) =
+            g_array_index (heap, QofQueryMatch, parent);
+        g_array_index (heap, QofQueryMatch, parent) = tmp;
+        pos = parent;
+    }
+}
+
+static void query_keep_top (QofQueryCB *qcb, gpointer object)
+{
+    QofQuery *q = qcb->query;
+    QofQueryMatch match;
+
+    match.object = object;
+    match.seq = qcb->count;
+
+    if (qcb->top->len < (guint) q->max_results)
+    {
+        g_array_append_val (qcb->top, match);
+        heap_sift_up (qcb->top, qcb->top->len - 1, q);
+    }
+    else if (q->max_results > 0 &&
+             match_cmp (&match, &g_array_index (qcb->top, QofQueryMatch, 0),
+                        q) > 0)
+    {
+        g_array_index (qcb->top, QofQueryMatch, 0) = match;
+        heap_sift_down (qcb->top, 0, q);
+    }
+}
+
+/* The kept matches, in sorted order */
+static GList * query_top_to_list (QofQueryCB *qcb)
+{
+    GList *list = NULL;
+    guint i;
+
+    g_array_sort_with_data (qcb->top, match_cmp, qcb->query);
+    for (i = qcb->top->len; i > 0; i--)
+        list = g_list_prepend (list,
+                               g_array_index (qcb->top, QofQueryMatch, i - 1).object);
+    return list;
+}
+
 static void check_item_cb (gpointer object, gpointer user_data)
 {
     QofQueryCB* ql = static_cast<QofQueryCB*>(user_data);
@@ -579,12 +965,217 @@ static void check_item_cb (gpointer object, gpointer user_data)
 
     if (check_object (ql->query, object))
     {
-        ql->list = g_list_prepend (ql->list, object);
+        if (ql->top)
+            query_keep_top (ql, object);
+        else
+            ql->list = g_list_prepend (ql->list, object);
         ql->count++;
     }
     return;
 }
 
+/* ==================================================================== */
+/* The query planner.  Instead of checking every object in the book,
+ * each OR-clause of the query can get its candidates from an index
+ * serving one of its terms; the candidates are then checked against
+ * the whole query as usual.
+ */
+
+/* Find the registered index which expects the fewest candidates for
+ * one of the terms of and_terms. */
+static gboolean
+query_plan_clause (const QofQuery *q, QofBook *book, GList *and_terms,
+                   QofQueryPlanStep *step)
+{
+    GList *and_ptr, *node;
+
+    step->index = NULL;
+    step->term = NULL;
+    step->estimate = -1;
+
+    for (and_ptr = and_terms; and_ptr; and_ptr = and_ptr->next)
+    {
+        const QofQueryTerm *qt = static_cast<QofQueryTerm*>(and_ptr->data);
+
+        /* Terms that can't be evaluated don't restrict anything. */
+        if (qt->invert || !qt->param_fcns || !qt->pred_fcn)
+            continue;
+
+        for (node = query_indexes; node; node = node->next)
+        {
+            QofQueryIndexDef *def = static_cast<QofQueryIndexDef*>(node->data);
+            gint64 estimate;
+
+            if (def->obj_type && g_strcmp0 (def->obj_type, q->search_for))
+                continue;
+            estimate = def->index->estimate (book, q->search_for,
+                                             qt->param_list, qt->pdata);
+            if (estimate < 0)
+                continue;
+            if (step->estimate < 0 || estimate < step->estimate)
+            {
+                step->index = def->index;
+                step->term = qt;
+                step->estimate = estimate;
+            }
+        }
+    }
+    return step->estimate >= 0;
+}
+
+/* Plan the query for book.  Returns the steps to take, one for each
+ * OR-clause, or NULL if the book has to be scanned: because one of
+ * the clauses can't be served by an index, or because the indexes
+ * would not find fewer candidates than there are objects.  The plan
+ * is described in plan_str. */
+static GArray *
+query_plan_book (const QofQuery *q, QofBook *book, GString *plan_str)
+{
+    QofCollection *col = qof_book_get_collection (book, q->search_for);
+    gint64 total = 0, n_objects = qof_collection_count (col);
+    GArray *plan;
+    GList *or_ptr;
+    guint i;
+
+    if (!q->terms || !query_indexes)
+    {
+        g_string_append_printf (plan_str, "scan %" G_GINT64_FORMAT " %s",
+                                n_objects, q->search_for);
+        return NULL;
+    }
+
+    plan = g_array_sized_new (FALSE, FALSE, sizeof (QofQueryPlanStep),
+                              g_list_length (q->terms));
+    for (or_ptr = q->terms; or_ptr; or_ptr = or_ptr->next)
+    {
+        QofQueryPlanStep step;
+
+        if (!query_plan_clause (q, book, static_cast<GList*>(or_ptr->data),
+                                &step))
+            break;
+        g_array_append_val (plan, step);
+        total += step.estimate;
+    }
+
+    if (or_ptr || total >= n_objects)
+    {
+        g_array_free (plan, TRUE);
+        g_string_append_printf (plan_str, "scan %" G_GINT64_FORMAT " %s",
+                                n_objects, q->search_for);
+        return NULL;
+    }
+
+    for (i = 0; i < plan->len; i++)
+    {
+        QofQueryPlanStep *step = &g_array_index (plan, QofQueryPlanStep, i);
+        g_string_append_printf (plan_str, "%sindex %s (%" G_GINT64_FORMAT
+                                " of %" G_GINT64_FORMAT " %s)",
+                                i ? " or " : "", step->index->name,
+                                step->estimate, n_objects, q->search_for);
+    }
+    return plan;
+}
+
+typedef struct
+{
+    QofQueryCB *   qcb;
+    GHashTable *   seen;
+} QofQueryIndexRun;
+
+static void index_item_cb (QofInstance *object, gpointer user_data)
+{
+    QofQueryIndexRun* run = static_cast<QofQueryIndexRun*>(user_data);
+
+    /* With several clauses an object can be a candidate more than once */
+    if (run->seen)
+    {
+        if (g_hash_table_lookup (run->seen, object))
+            return;
+        g_hash_table_insert (run->seen, object, object);
+    }
+    check_item_cb (object, run->qcb);
+}
+
+static void query_run_plan (QofQueryCB *qcb, QofBook *book, GArray *plan)
+{
+    QofQueryIndexRun run;
+    guint i;
+
+    run.qcb = qcb;
+    run.seen = NULL;
+    if (plan->len > 1)
+        run.seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    for (i = 0; i < plan->len; i++)
+    {
+        QofQueryPlanStep *step = &g_array_index (plan, QofQueryPlanStep, i);
+        step->index->foreach (book, qcb->query->search_for,
+                              step->term->param_list, step->term->pdata,
+                              index_item_cb, &run);
+    }
+
+    if (run.seen)
+        g_hash_table_destroy (run.seen);
+}
+
+/* Find objects by their GncGUID: "guid == one of a list" */
+static gboolean
+guid_index_get_guids (const QofQueryParamList *param_path,
+                      const QofQueryPredData *pdata, GList **guids)
+{
+    const query_guid_def *pd = (const query_guid_def *) pdata;
+
+    if (!param_path || param_path->next ||
+        g_strcmp0 (static_cast<char*>(param_path->data), QOF_PARAM_GUID) ||
+        g_strcmp0 (pdata->type_name, QOF_TYPE_GUID) ||
+        pdata->how != QOF_COMPARE_EQUAL || pd->options != QOF_GUID_MATCH_ANY)
+        return FALSE;
+    *guids = pd->guids;
+    return TRUE;
+}
+
+static gint64
+guid_index_estimate (QofBook *book, QofIdTypeConst search_for,
+                     const QofQueryParamList *param_path,
+                     const QofQueryPredData *pdata)
+{
+    GList *guids;
+
+    if (!guid_index_get_guids (param_path, pdata, &guids))
+        return -1;
+    return g_list_length (guids);
+}
+
+static void
+guid_index_foreach (QofBook *book, QofIdTypeConst search_for,
+                    const QofQueryParamList *param_path,
+                    const QofQueryPredData *pdata,
+                    QofInstanceForeachCB cb, gpointer user_data)
+{
+    QofCollection *col = qof_book_get_collection (book, search_for);
+    GHashTable *seen;
+    GList *guids, *node;
+
+    if (!guid_index_get_guids (param_path, pdata, &guids))
+        return;
+    seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (node = guids; node; node = node->next)
+    {
+        QofInstance *inst = qof_collection_lookup_entity (
+                                col, static_cast<GncGUID*>(node->data));
+        if (!inst || g_hash_table_lookup (seen, inst))
+            continue;
+        g_hash_table_insert (seen, inst, inst);
+        cb (inst, user_data);
+    }
+    g_hash_table_destroy (seen);
+}
+
+static const QofQueryIndex guid_index =
+{
+    "guid", guid_index_estimate, guid_index_foreach
+};
+
 static int param_list_cmp (const QofQueryParamList *l1, const QofQueryParamList *l2)
 {
     int ret;
@@ -709,6 +1300,7 @@ void qof_query_purge_terms (QofQuery *q, QofQueryParamList *param_list)
                     q->terms = g_list_remove_link (static_cast<GList*>(q->terms), _or_);
                     g_list_free_1 (_or_);
                     _or_ = q->terms;
+                    q->changed = 1;
                     break;
                 }
                 else
@@ -739,18 +1331,13 @@ static GList * qof_query_run_internal (QofQuery *q,
     g_return_val_if_fail (run_cb, NULL);
     ENTER (" q=%p", q);
 
-    /* XXX: Prioritize the query terms? */
-
     /* prepare the Query for processing */
     if (q->changed)
     {
         query_clear_compiles (q);
         compile_terms (q);
     }
-
-    /* Maybe log this sucker */
-    if (qof_log_check (log_module, QOF_LOG_DEBUG))
-        qof_query_print (q);
+    query_rank_steps (q);
 
     /* Now run the query over all the objects and save the results */
     {
@@ -758,55 +1345,49 @@ static GList * qof_query_run_internal (QofQuery *q,
 
         memset (&qcb, 0, sizeof (qcb));
         qcb.query = q;
+        if (q->max_results > -1)
+            qcb.top = g_array_sized_new (FALSE, FALSE, sizeof (QofQueryMatch),
+                                         MIN (q->max_results, 1024));
 
         /* Run the query callback */
         run_cb(&qcb, cb_arg);
 
-        matching_objects = qcb.list;
         object_count = qcb.count;
+        if (qcb.top)
+        {
+            matching_objects = query_top_to_list (&qcb);
+            g_array_free (qcb.top, TRUE);
+            object_count = MIN (object_count, q->max_results);
+        }
+        else
+        {
+            matching_objects = qcb.list;
+        }
     }
-    PINFO ("matching objects=%p count=%d", matching_objects, object_count);
 
-    /* There is no absolute need to reverse this list, since it's being
-     * sorted below. However, in the common case, we will be searching
-     * in a confined location where the objects are already in order,
-     * thus reversing will put us in the correct order we want and make
-     * the sorting go much faster.
-     */
-    matching_objects = g_list_reverse(matching_objects);
+    /* Maybe log this sucker, along with the plan it was run by */
+    if (qof_log_check (log_module, QOF_LOG_DEBUG))
+        qof_query_print (q);
 
-    /* Now sort the matching objects based on the search criteria */
-    if (q->primary_sort.comp_fcn || q->primary_sort.obj_cmp ||
-            (q->primary_sort.use_default && q->defaultSort))
-    {
-        matching_objects = g_list_sort_with_data(matching_objects, sort_func, q);
-    }
+    PINFO ("matching objects=%p count=%d", matching_objects, object_count);
 
-    /* Crop the list to limit the number of splits. */
-    if ((object_count > q->max_results) && (q->max_results > -1))
+    /* With max_results set the matches are already sorted and cropped
+     * by query_keep_top(). */
+    if (q->max_results < 0)
     {
-        if (q->max_results > 0)
-        {
-            GList *mptr;
+        /* There is no absolute need to reverse this list, since it's being
+         * sorted below. However, in the common case, we will be searching
+         * in a confined location where the objects are already in order,
+         * thus reversing will put us in the correct order we want and make
+         * the sorting go much faster.
+         */
+        matching_objects = g_list_reverse(matching_objects);
 
-            /* mptr is set to the first node of what will be the new list */
-            mptr = g_list_nth(matching_objects, object_count - q->max_results);
-            /* mptr should not be NULL, but let's be safe */
-            if (mptr != NULL)
-            {
-                if (mptr->prev != NULL) mptr->prev->next = NULL;
-                mptr->prev = NULL;
-            }
-            g_list_free(matching_objects);
-            matching_objects = mptr;
-        }
-        else
+        /* Now sort the matching objects based on the search criteria */
+        if (query_has_sort (q))
         {
-            /* q->max_results == 0 */
-            g_list_free(matching_objects);
-            matching_objects = NULL;
+            matching_objects = g_list_sort_with_data(matching_objects, sort_func, q);
         }
-        object_count = q->max_results;
     }
 
     q->changed = 0;
@@ -821,14 +1402,17 @@ static GList * qof_query_run_internal (QofQuery *q,
 static void qof_query_run_cb(QofQueryCB* qcb, gpointer cb_arg)
 {
     GList *node;
+    GString *plan_str;
 
     (void)cb_arg; /* unused */
     g_return_if_fail(qcb);
 
+    plan_str = g_string_new (NULL);
     for (node = qcb->query->books; node; node = node->next)
     {
         QofBook* book = static_cast<QofBook*>(node->data);
         QofBackend* be = book->backend;
+        GArray *plan;
 
         /* run the query in the backend */
         if (be)
@@ -842,14 +1426,462 @@ static void qof_query_run_cb(QofQueryCB* qcb, gpointer cb_arg)
             }
         }
 
-        /* And then iterate over all the objects */
-        qof_object_foreach (qcb->query->search_for, book,
-                            (QofInstanceForeachCB) check_item_cb, qcb);
+        /* And then iterate over all the objects, or only over the
+         * candidates found by the indexes */
+        if (node != qcb->query->books)
+            g_string_append (plan_str, "; ");
+        plan = query_plan_book (qcb->query, book, plan_str);
+        if (plan)
+        {
+            query_run_plan (qcb, book, plan);
+            g_array_free (plan, TRUE);
+        }
+        else
+            qof_object_foreach (qcb->query->search_for, book,
+                                (QofInstanceForeachCB) check_item_cb, qcb);
     }
+
+    g_free (qcb->query->plan);
+    qcb->query->plan = g_string_free (plan_str, FALSE);
+}
+
+/* ==================================================================== */
+/* Live queries.  The matches of the last run are kept in live_results,
+ * sorted like the results, and the event handler collects the objects
+ * which changed since in live_pending.  The next run only checks those
+ * again and moves them into or out of live_results.
+ */
+
+static void live_query_event_handler (QofInstance *ent, QofEventId event_type,
+                                      gpointer handler_data,
+                                      gpointer event_data);
+
+/* Note the types of the objects whose parameters path reads, starting
+ * from an object of type obj_type.  GUIDs never change, so reading one
+ * doesn't count. */
+static void
+live_query_add_path_types (GHashTable *types, QofIdTypeConst obj_type,
+                           GSList *param_fcns)
+{
+    GSList *node;
+
+    for (node = param_fcns; node; node = node->next)
+    {
+        const QofParam *param = static_cast<QofParam*>(node->data);
+
+        if (g_strcmp0 (param->param_name, QOF_PARAM_GUID))
+            g_hash_table_insert (types, (gpointer)obj_type, (gpointer)obj_type);
+        obj_type = param->param_type;
+    }
+}
+
+static void
+live_query_add_sort_types (GHashTable *types, const QofQuery *q,
+                           const QofQuerySort *sort)
+{
+    if (sort->use_default)
+        g_hash_table_insert (types, (gpointer)q->search_for,
+                             (gpointer)q->search_for);
+    live_query_add_path_types (types, q->search_for, sort->param_fcns);
+    /* Object compares read the last object on the path */
+    if (sort->obj_cmp && sort->param_fcns)
+    {
+        const QofParam *param = static_cast<QofParam*>(
+                                    g_slist_last (sort->param_fcns)->data);
+        g_hash_table_insert (types, (gpointer)param->param_type,
+                             (gpointer)param->param_type);
+    }
+}
+
+static void
+live_query_ref_init (QofQueryLiveRef *ref, gconstpointer object)
+{
+    ref->guid = *qof_instance_get_guid (object);
+    ref->col = qof_instance_get_collection (object);
+}
+
+/* Whether object is still the object ref was taken from */
+static gboolean
+live_query_ref_valid (const QofQueryLiveRef *ref, gconstpointer object)
+{
+    return ref->col &&
+           qof_collection_lookup_entity (ref->col, &ref->guid) == object;
+}
+
+static void
+live_query_remove (QofQuery *q, gpointer object)
+{
+    GSequenceIter *iter = static_cast<GSequenceIter*>(
+                              g_hash_table_lookup (q->live_iters, object));
+
+    if (!iter) return;
+    g_hash_table_remove (q->live_iters, object);
+    g_sequence_remove (iter);
+}
+
+static void
+live_query_insert (QofQuery *q, gpointer object)
+{
+    QofQueryLiveMatch *match = g_new (QofQueryLiveMatch, 1);
+    GSequenceIter *iter;
+
+    match->match.object = object;
+    match->match.seq = q->live_seq++;
+    live_query_ref_init (&match->ref, object);
+    iter = g_sequence_insert_sorted (q->live_results, match, match_cmp, q);
+    g_hash_table_insert (q->live_iters, object, iter);
+}
+
+static void
+live_query_unlisten (QofQuery *q)
+{
+    GHashTableIter iter;
+    gpointer value;
+
+    g_hash_table_iter_init (&iter, q->live_handlers);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
+        qof_event_unregister_handler (GPOINTER_TO_INT (value));
+    g_hash_table_remove_all (q->live_handlers);
+}
+
+/* Listen to the events on the objects which can change the results:
+ * the searched-for objects, the objects mapped to them by dependents
+ * functions, those whose parameters are read, and the books.  The
+ * dependents functions look at events the engine defines, so apart
+ * from the books' the events aren't filtered. */
+static void
+live_query_listen (QofQuery *q)
+{
+    GHashTable *types = g_hash_table_new (g_str_hash, g_str_equal);
+    GHashTableIter iter;
+    gpointer key;
+    GList *node;
+    gint id;
+
+    g_hash_table_insert (types, (gpointer)q->search_for,
+                         (gpointer)q->search_for);
+    for (node = query_dependents; node; node = node->next)
+    {
+        QofQueryDependentsDef *def =
+            static_cast<QofQueryDependentsDef*>(node->data);
+
+        if (!g_strcmp0 (def->search_for, q->search_for))
+            g_hash_table_insert (types, (gpointer)def->obj_type,
+                                 (gpointer)def->obj_type);
+    }
+    g_hash_table_iter_init (&iter, q->live_types);
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+        g_hash_table_insert (types, key, key);
+
+    live_query_unlisten (q);
+    g_hash_table_iter_init (&iter, types);
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+        id = qof_event_register_filtered_handler (
+                 static_cast<QofIdTypeConst>(key), 0,
+                 live_query_event_handler, q);
+        g_hash_table_insert (q->live_handlers,
+                             g_strdup (static_cast<gchar*>(key)),
+                             GINT_TO_POINTER (id));
+    }
+    if (!g_hash_table_lookup (types, QOF_ID_BOOK))
+    {
+        id = qof_event_register_filtered_handler (QOF_ID_BOOK,
+                 QOF_EVENT_MODIFY, live_query_event_handler, q);
+        g_hash_table_insert (q->live_handlers, g_strdup (QOF_ID_BOOK),
+                             GINT_TO_POINTER (id));
+    }
+    g_hash_table_destroy (types);
+}
+
+/* Whether events that could have changed the results were dropped
+ * while events were suspended, since the last run. */
+static gboolean
+live_query_missed_events (QofQuery *q)
+{
+    guint64 serial = qof_event_get_suppressed_serial (NULL);
+    gboolean missed = FALSE;
+    GHashTableIter iter;
+    gpointer key;
+
+    if (serial == q->live_serial)
+        return FALSE;
+    g_hash_table_iter_init (&iter, q->live_handlers);
+    while (!missed && g_hash_table_iter_next (&iter, &key, NULL))
+        missed = qof_event_get_suppressed_serial (
+                     static_cast<QofIdTypeConst>(key)) > q->live_serial;
+    q->live_serial = serial;
+    return missed;
+}
+
+/* Start over from the results of a full run */
+static void
+live_query_reset (QofQuery *q, GList *results)
+{
+    GList *node;
+    GList *or_ptr, *and_ptr;
+
+    g_hash_table_remove_all (q->live_pending);
+    g_hash_table_remove_all (q->live_iters);
+    if (q->live_results)
+        g_sequence_free (q->live_results);
+    q->live_results = g_sequence_new (g_free);
+    q->live_seq = 0;
+    q->live_stale = FALSE;
+
+    for (node = results; node; node = node->next)
+    {
+        QofQueryLiveMatch *match = g_new (QofQueryLiveMatch, 1);
+
+        match->match.object = node->data;
+        match->match.seq = q->live_seq++;
+        live_query_ref_init (&match->ref, node->data);
+        g_hash_table_insert (q->live_iters, node->data,
+                             g_sequence_append (q->live_results, match));
+    }
+
+    g_hash_table_remove_all (q->live_types);
+    for (or_ptr = q->terms; or_ptr; or_ptr = or_ptr->next)
+        for (and_ptr = static_cast<GList*>(or_ptr->data); and_ptr;
+                and_ptr = and_ptr->next)
+        {
+            QofQueryTerm *qt = static_cast<QofQueryTerm*>(and_ptr->data);
+            live_query_add_path_types (q->live_types, q->search_for,
+                                       qt->param_fcns);
+        }
+    live_query_add_sort_types (q->live_types, q, &q->primary_sort);
+    live_query_add_sort_types (q->live_types, q, &q->secondary_sort);
+    live_query_add_sort_types (q->live_types, q, &q->tertiary_sort);
+
+    /* The run kept only the last max_results matches */
+    q->live_max_results = q->max_results;
+    q->live_cropped = q->max_results > -1 &&
+                      g_sequence_get_length (q->live_results) >= q->max_results;
+    q->live_serial = qof_event_get_suppressed_serial (NULL);
+    live_query_listen (q);
+}
+
+typedef struct
+{
+    QofQuery *        query;
+    QofEventId        event_type;
+} QofQueryLiveEvent;
+
+static void
+live_query_changed (QofInstance *inst, gpointer user_data)
+{
+    QofQueryLiveEvent *ev = static_cast<QofQueryLiveEvent*>(user_data);
+    QofQuery *q = ev->query;
+    QofQueryLiveRef *ref;
+
+    /* The object is going away, so don't keep a pointer to it. */
+    if (ev->event_type == QOF_EVENT_DESTROY)
+    {
+        g_hash_table_remove (q->live_pending, inst);
+        live_query_remove (q, inst);
+        return;
+    }
+    ref = g_new (QofQueryLiveRef, 1);
+    live_query_ref_init (ref, inst);
+    g_hash_table_replace (q->live_pending, inst, ref);
+}
+
+static void
+live_query_event_handler (QofInstance *ent, QofEventId event_type,
+                          gpointer handler_data, gpointer event_data)
+{
+    QofQuery *q = static_cast<QofQuery*>(handler_data);
+    QofQueryLiveEvent ev;
+    QofIdTypeConst type;
+    GList *node;
+
+    if (!ent || q->live_stale || !q->live_results) return;
+
+    /* Changes to a whole book, like a bulk load, could be anything. */
+    if (QOF_IS_BOOK (ent))
+    {
+        if (g_list_find (q->books, ent))
+            q->live_stale = TRUE;
+        return;
+    }
+    if (!g_list_find (q->books, qof_instance_get_book (ent)))
+        return;
+
+    ev.query = q;
+    ev.event_type = event_type;
+    type = ent->e_type;
+    if (!g_strcmp0 (type, q->search_for))
+    {
+        live_query_changed (ent, &ev);
+        return;
+    }
+
+    for (node = query_dependents; node; node = node->next)
+    {
+        QofQueryDependentsDef *def =
+            static_cast<QofQueryDependentsDef*>(node->data);
+
+        if (!g_strcmp0 (def->search_for, q->search_for) &&
+                !g_strcmp0 (def->obj_type, type) &&
+                def->func (ent, event_type, event_data,
+                           live_query_changed, &ev))
+            return;
+    }
+
+    if (g_hash_table_lookup (q->live_types, type))
+        q->live_stale = TRUE;
+}
+
+static gboolean
+live_query_check_pending (gpointer key, gpointer value, gpointer user_data)
+{
+    QofQuery *q = static_cast<QofQuery*>(user_data);
+    QofQueryLiveRef *ref = static_cast<QofQueryLiveRef*>(value);
+
+    live_query_remove (q, key);
+    if (live_query_ref_valid (ref, key) && check_object (q, key))
+        live_query_insert (q, key);
+    return TRUE;
+}
+
+/* Drop the matches whose objects were freed without an event, before
+ * anything compares them.  Returns whether there were any. */
+static gboolean
+live_query_sweep (QofQuery *q)
+{
+    GSequenceIter *iter = g_sequence_get_begin_iter (q->live_results);
+    gboolean swept = FALSE;
+
+    while (!g_sequence_iter_is_end (iter))
+    {
+        QofQueryLiveMatch *match =
+            static_cast<QofQueryLiveMatch*>(g_sequence_get (iter));
+        GSequenceIter *next = g_sequence_iter_next (iter);
+
+        if (!live_query_ref_valid (&match->ref, match->match.object))
+        {
+            if (g_hash_table_lookup (q->live_iters, match->match.object) == iter)
+                g_hash_table_remove (q->live_iters, match->match.object);
+            g_sequence_remove (iter);
+            swept = TRUE;
+        }
+        iter = next;
+    }
+    return swept;
+}
+
+/* Keep only the last max_results matches, like a full run does */
+static void
+live_query_crop (QofQuery *q)
+{
+    gint n = g_sequence_get_length (q->live_results);
+
+    for (; q->max_results > -1 && n > q->max_results; n--)
+    {
+        GSequenceIter *iter = g_sequence_get_begin_iter (q->live_results);
+
+        g_hash_table_remove (q->live_iters, static_cast<QofQueryMatch*>(
+                                 g_sequence_get (iter))->object);
+        g_sequence_remove (iter);
+        q->live_cropped = TRUE;
+    }
+}
+
+/* The results of the live query, the matches in order */
+static GList *
+live_query_get_results (QofQuery *q)
+{
+    GSequenceIter *iter = g_sequence_get_begin_iter (q->live_results);
+    GList *list = NULL;
+
+    for (; !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter))
+        list = g_list_prepend (list, static_cast<QofQueryMatch*>(
+                                   g_sequence_get (iter))->object);
+    return g_list_reverse (list);
+}
+
+static GList *
+live_query_run (QofQuery *q)
+{
+    if (!q->changed && !q->live_stale && q->live_results &&
+            q->live_max_results == q->max_results &&
+            !live_query_missed_events (q))
+    {
+        gboolean swept = live_query_sweep (q);
+
+        if (!swept && g_hash_table_size (q->live_pending) == 0)
+            return q->results;
+        PINFO ("re-checking %d objects", g_hash_table_size (q->live_pending));
+        g_hash_table_foreach_remove (q->live_pending,
+                                     live_query_check_pending, q);
+
+        /* If one of the last max_results matches went, the match before
+         * them which takes its place isn't known without a full run. */
+        if (!q->live_cropped ||
+                (gint) g_sequence_get_length (q->live_results) >= q->max_results)
+        {
+            live_query_crop (q);
+            g_list_free (q->results);
+            q->results = live_query_get_results (q);
+            return q->results;
+        }
+    }
+
+    live_query_reset (q, qof_query_run_internal (q, qof_query_run_cb, NULL));
+    return q->results;
+}
+
+static void
+live_query_stop (QofQuery *q)
+{
+    if (!q->live_handlers) return;
+
+    live_query_unlisten (q);
+    g_hash_table_destroy (q->live_handlers);
+    q->live_handlers = NULL;
+    g_hash_table_destroy (q->live_pending);
+    g_hash_table_destroy (q->live_types);
+    g_hash_table_destroy (q->live_iters);
+    if (q->live_results)
+        g_sequence_free (q->live_results);
+    q->live_pending = NULL;
+    q->live_types = NULL;
+    q->live_iters = NULL;
+    q->live_results = NULL;
+}
+
+void qof_query_set_live (QofQuery *q, gboolean live)
+{
+    if (!q) return;
+    if (!live)
+    {
+        live_query_stop (q);
+        return;
+    }
+    if (q->live_handlers) return;
+
+    q->live_pending = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                      NULL, g_free);
+    q->live_types = g_hash_table_new (g_str_hash, g_str_equal);
+    q->live_iters = g_hash_table_new (g_direct_hash, g_direct_equal);
+    q->live_results = NULL;
+    q->live_stale = TRUE;
+    /* The handlers are registered by the first run, for the types it
+     * finds the query depends on. */
+    q->live_handlers = g_hash_table_new_full (g_str_hash, g_str_equal,
+                       g_free, NULL);
+}
+
+gboolean qof_query_is_live (const QofQuery *q)
+{
+    return q && q->live_handlers;
 }
 
 GList * qof_query_run (QofQuery *q)
 {
+    if (q && q->live_handlers)
+        return live_query_run (q);
+
     /* Just a wrapper */
     return qof_query_run_internal(q, qof_query_run_cb, NULL);
 }
@@ -860,6 +1892,9 @@ static void qof_query_run_subq_cb(QofQueryCB* qcb, gpointer cb_arg)
 
     g_return_if_fail(pq);
     g_list_foreach(qof_query_last_run(pq), check_item_cb, qcb);
+
+    g_free (qcb->query->plan);
+    qcb->query->plan = g_strdup ("check results of primary query");
 }
 
 GList *
@@ -1017,6 +2052,15 @@ QofQuery * qof_query_copy (QofQuery *q)
     copy->terms = copy_or_terms (q->terms);
     copy->books = g_list_copy (q->books);
     copy->results = g_list_copy (q->results);
+    copy->plan = g_strdup (q->plan);
+    copy->clauses = NULL;
+
+    /* The copy is not live */
+    copy->live_handlers = NULL;
+    copy->live_pending = NULL;
+    copy->live_types = NULL;
+    copy->live_results = NULL;
+    copy->live_iters = NULL;
 
     copy_sort (&(copy->primary_sort), &(q->primary_sort));
     copy_sort (&(copy->secondary_sort), &(q->secondary_sort));
@@ -1347,15 +2391,63 @@ void qof_query_init (void)
     ENTER (" ");
     qof_query_core_init ();
     qof_class_init ();
+    qof_query_register_index (NULL, &guid_index);
     LEAVE ("Completed initialization of QofQuery");
 }
 
 void qof_query_shutdown (void)
 {
+    g_list_free_full (query_indexes, g_free);
+    query_indexes = NULL;
+    g_list_free_full (query_dependents, g_free);
+    query_dependents = NULL;
     qof_class_shutdown ();
     qof_query_core_shutdown ();
 }
 
+void qof_query_register_index (QofIdTypeConst obj_type,
+                               const QofQueryIndex *index)
+{
+    QofQueryIndexDef *def;
+    GList *node;
+
+    g_return_if_fail (index && index->name);
+    g_return_if_fail (index->estimate && index->foreach);
+
+    for (node = query_indexes; node; node = node->next)
+    {
+        def = static_cast<QofQueryIndexDef*>(node->data);
+        if (def->index == index && !g_strcmp0 (def->obj_type, obj_type))
+            return;
+    }
+
+    def = g_new0 (QofQueryIndexDef, 1);
+    def->obj_type = obj_type;
+    def->index = index;
+    query_indexes = g_list_append (query_indexes, def);
+}
+
+void qof_query_register_dependents (QofIdTypeConst search_for,
+                                    QofIdTypeConst obj_type,
+                                    QofQueryDependentsFunc func)
+{
+    QofQueryDependentsDef *def;
+
+    g_return_if_fail (search_for && obj_type && func);
+
+    def = g_new0 (QofQueryDependentsDef, 1);
+    def->search_for = search_for;
+    def->obj_type = obj_type;
+    def->func = func;
+    query_dependents = g_list_append (query_dependents, def);
+}
+
+const char * qof_query_get_plan (const QofQuery *q)
+{
+    if (!q) return NULL;
+    return q->plan;
+}
+
 int qof_query_get_max_results (const QofQuery *q)
 {
     if (!q) return 0;
@@ -1395,6 +2487,13 @@ gboolean qof_query_term_is_inverted (const QofQueryTerm *qt)
     return qt->invert;
 }
 
+void qof_query_term_get_counts (const QofQueryTerm *qt, guint64 *evaluated,
+                                guint64 *passed)
+{
+    if (evaluated) *evaluated = qt ? qt->n_evaluated : 0;
+    if (passed) *passed = qt ? qt->n_passed : 0;
+}
+
 void qof_query_get_sorts (QofQuery *q, QofQuerySort **primary,
                           QofQuerySort **secondary, QofQuerySort **tertiary)
 {
@@ -1553,6 +2652,10 @@ qof_query_print (QofQuery * query)
     g_string_printf (str, "Maximum number of results: %d", maxResults);
     output = g_list_append (output, str);
 
+    str = g_string_new ("Plan of the last run: ");
+    g_string_append (str, query->plan ? query->plan : "(not run)");
+    output = g_list_append (output, str);
+
     qof_query_printOutput (output);
     LEAVE (" ");
 }
@@ -1674,6 +2777,7 @@ qof_query_printAndTerms (GList * terms, GList * output)
     QofQueryTerm *qt;
     QofQueryPredData *pd;
     QofQueryParamList *path;
+    GString *counts;
     GList *lst;
     gboolean invert;
 
@@ -1689,6 +2793,11 @@ qof_query_printAndTerms (GList * terms, GList * output)
                                                 g_string_new(" INVERT SENSE "));
         output = g_list_append (output, qof_query_printParamPath (path));
         output = qof_query_printPredData (pd, output);
+        counts = g_string_new (NULL);
+        g_string_printf (counts, "      Evaluated %" G_GUINT64_FORMAT
+                         " times, held %" G_GUINT64_FORMAT " times",
+                         qt->n_evaluated, qt->n_passed);
+        output = g_list_append (output, counts);
 //    output = g_list_append (output, g_string_new(" "));
     }
 
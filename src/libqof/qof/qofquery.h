@@ -76,6 +76,7 @@ probably optimize.
 
 #include "guid.h"
 #include "qofbook.h"
+#include "qofevent.h"
 #include "qofquerycore.h"
 #include "qofchoice.h"
 
@@ -127,6 +128,92 @@ void qof_query_init (void);
 void qof_query_shutdown (void);
 // @}
 
+/* --------------------------------------------------------- */
+/** \name Query Indexes
+ *  An object module can register indexes which find the objects
+ *  matching a query term without looking at every object in the book.
+ *  When every OR-clause of a query has a term that one of the indexes
+ *  can serve, and the indexes expect fewer candidates than there are
+ *  objects, the query only checks the candidates found by the indexes
+ *  instead of scanning the whole collection.  Inverted terms are never
+ *  served by an index.
+ *
+ *  Indexes need not be exact: the candidates are checked against all
+ *  of the terms of the query, so an index only has to find at least
+ *  every object that matches the term it serves.
+ */
+// @{
+typedef struct
+{
+    /** Name of the index, shown in the query plan. */
+    const char *name;
+    /** Estimate the number of candidates the index would find for
+     *  the term in the book, or return -1 if it can't serve the term. */
+    gint64 (*estimate) (QofBook *book, QofIdTypeConst search_for,
+                        const QofQueryParamList *param_path,
+                        const QofQueryPredData *pdata);
+    /** Call cb on every candidate in the book for the term, each only
+     *  once. */
+    void (*foreach) (QofBook *book, QofIdTypeConst search_for,
+                     const QofQueryParamList *param_path,
+                     const QofQueryPredData *pdata,
+                     QofInstanceForeachCB cb, gpointer user_data);
+} QofQueryIndex;
+
+/** Register an index for queries searching for objects of type
+ *  obj_type, or for queries of any type if obj_type is NULL.  The
+ *  index is not copied and must stay valid until qof_query_shutdown(). */
+void qof_query_register_index (QofIdTypeConst obj_type,
+                               const QofQueryIndex *index);
+// @}
+
+/* --------------------------------------------------------- */
+/** \name Live Queries
+ *  A live query keeps its results up to date from the engine events.
+ *  Instead of checking all of the objects again, qof_query_run() on a
+ *  live query only checks the objects that changed since the last
+ *  run, and moves them into or out of the sorted results.
+ *
+ *  An event on an object of the searched-for type marks that object
+ *  as changed.  Events on other objects are mapped to the searched-for
+ *  objects they affect by the functions registered with
+ *  qof_query_register_dependents(); for example a change of a
+ *  transaction affects all of its splits.  If there is no such
+ *  function for an event on an object whose parameters the query
+ *  looks at, the next run checks everything again.  So does a query
+ *  whose terms or sort changed, and one whose book was modified as a
+ *  whole, as at the end of a bulk load.
+ *
+ *  Events dropped while events are suspended can't be told apart, so
+ *  if any of them was on an object of one of those types the next run
+ *  checks everything again too.  Like any run, a live one keeps only
+ *  the last max_results matches; when one of those stops matching, the
+ *  next run is a full one to find the match that takes its place.
+ *
+ *  A live query must be destroyed before its books are.
+ */
+// @{
+
+/** Report the objects of the searched-for type affected by an event
+ *  on inst by calling cb on each of them.  Return FALSE if that can't
+ *  be told from this event. */
+typedef gboolean (*QofQueryDependentsFunc) (QofInstance *inst,
+        QofEventId event_type,
+        gpointer event_data,
+        QofInstanceForeachCB cb,
+        gpointer user_data);
+
+/** Register func to tell which objects of type search_for are affected
+ *  by events on objects of type obj_type. */
+void qof_query_register_dependents (QofIdTypeConst search_for,
+                                    QofIdTypeConst obj_type,
+                                    QofQueryDependentsFunc func);
+
+/** Make the query live, or stop it being live. */
+void qof_query_set_live (QofQuery *q, gboolean live);
+gboolean qof_query_is_live (const QofQuery *q);
+// @}
+
 /* --------------------------------------------------------- */
 /** \name Low-Level API Functions */
 // @{
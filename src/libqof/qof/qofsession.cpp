@@ -582,7 +582,13 @@ qof_session_load (QofSession *session,
 
         if (be->load)
         {
+            /* The objects loaded are made with new ids which are then
+             * replaced by the ones stored, so make those cheaply. */
+            GncGUIDGenerator generator = guid_get_generator ();
+
+            guid_init_with_generator (GNC_GUID_GENERATOR_RANDOM);
             be->load (be, newbook, LOAD_TYPE_INITIAL_LOAD);
+            guid_init_with_generator (generator);
             qof_session_push_error (session, qof_backend_get_error(be), NULL);
         }
     }
@@ -1150,7 +1150,6 @@ test_kvp_frame_to_string( Fixture *fixture, gconstpointer pData )
 static void
 test_kvp_frame_set_slot_path( Fixture *fixture, gconstpointer pData )
 {
-    GHashTable *frame_hash = NULL;
     KvpValue *input_value, *output_value;
 
     g_assert( fixture->frame );
@@ -1172,9 +1171,7 @@ test_kvp_frame_set_slot_path( Fixture *fixture, gconstpointer pData )
     g_assert( output_value );
     g_assert( input_value != output_value ); /* copied */
     g_assert_cmpint( kvp_value_compare( output_value, input_value ), == , 0 ); /* old value removed */
-    frame_hash = kvp_frame_get_hash( fixture->frame );
-    g_assert( frame_hash );
-    g_assert_cmpint( g_hash_table_size( frame_hash ), == , 1 ); /* be sure it was replaced */
+    g_assert_cmpint( kvp_frame_get_slot_count( fixture->frame ), == , 1 ); /* be sure it was replaced */
     kvp_value_delete( input_value );
 
     g_test_message( "Test when existing path elements are not frames" );
@@ -1182,7 +1179,7 @@ test_kvp_frame_set_slot_path( Fixture *fixture, gconstpointer pData )
     kvp_frame_set_slot_path( fixture->frame, input_value, "test", "test2", NULL );
     g_assert( kvp_frame_get_slot_path( fixture->frame, "test2", NULL ) == NULL );/* was not added */
     g_assert_cmpint( kvp_value_compare( output_value, kvp_frame_get_slot_path( fixture->frame, "test", NULL ) ), == , 0 ); /* nothing changed */
-    g_assert_cmpint( g_hash_table_size( frame_hash ), == , 1 ); /* didn't change */
+    g_assert_cmpint( kvp_frame_get_slot_count( fixture->frame ), == , 1 ); /* didn't change */
     kvp_value_delete( input_value );
 
     g_test_message( "Test frames are created along the path when needed" );
@@ -1195,7 +1192,7 @@ test_kvp_frame_set_slot_path( Fixture *fixture, gconstpointer pData )
     g_assert( output_value );
     g_assert( input_value != output_value ); /* copied */
     g_assert_cmpint( kvp_value_compare( output_value, input_value ), == , 0 );
-    g_assert_cmpint( g_hash_table_size( frame_hash ), == , 2 );
+    g_assert_cmpint( kvp_frame_get_slot_count( fixture->frame ), == , 2 );
     kvp_value_delete( input_value );
 }
 
@@ -1204,7 +1201,6 @@ test_kvp_frame_set_slot_path_gslist( Fixture *fixture, gconstpointer pData )
 {
     /* similar to previous test except path is passed as GSList*/
     GSList *path_list = NULL;
-    GHashTable *frame_hash = NULL;
     KvpValue *input_value, *output_value;
 
     g_assert( fixture->frame );
@@ -1227,9 +1223,7 @@ test_kvp_frame_set_slot_path_gslist( Fixture *fixture, gconstpointer pData )
     g_assert( output_value );
     g_assert( input_value != output_value ); /* copied */
     g_assert_cmpint( kvp_value_compare( output_value, input_value ), == , 0 ); /* old value removed */
-    frame_hash = kvp_frame_get_hash( fixture->frame );
-    g_assert( frame_hash );
-    g_assert_cmpint( g_hash_table_size( frame_hash ), == , 1 ); /* be sure it was replaced */
+    g_assert_cmpint( kvp_frame_get_slot_count( fixture->frame ), == , 1 ); /* be sure it was replaced */
     kvp_value_delete( input_value );
 
     g_test_message( "Test when existing path elements are not frames" );
@@ -1238,7 +1232,7 @@ test_kvp_frame_set_slot_path_gslist( Fixture *fixture, gconstpointer pData )
     kvp_frame_set_slot_path_gslist( fixture->frame, input_value, path_list );
     g_assert( kvp_frame_get_slot_path( fixture->frame, "test2", NULL ) == NULL );/* was not added */
     g_assert_cmpint( kvp_value_compare( output_value, kvp_frame_get_slot_path( fixture->frame, "test", NULL ) ), == , 0 ); /* nothing changed */
-    g_assert_cmpint( g_hash_table_size( frame_hash ), == , 1 ); /* didn't change */
+    g_assert_cmpint( kvp_frame_get_slot_count( fixture->frame ), == , 1 ); /* didn't change */
     kvp_value_delete( input_value );
 
     g_test_message( "Test frames are created along the path when needed" );
@@ -1253,7 +1247,7 @@ test_kvp_frame_set_slot_path_gslist( Fixture *fixture, gconstpointer pData )
     g_assert( output_value );
     g_assert( input_value != output_value ); /* copied */
     g_assert_cmpint( kvp_value_compare( output_value, input_value ), == , 0 );
-    g_assert_cmpint( g_hash_table_size( frame_hash ), == , 2 );
+    g_assert_cmpint( kvp_frame_get_slot_count( fixture->frame ), == , 2 );
     kvp_value_delete( input_value );
 
     g_slist_free( path_list );
@@ -1262,7 +1256,6 @@ test_kvp_frame_set_slot_path_gslist( Fixture *fixture, gconstpointer pData )
 static void
 test_kvp_frame_replace_slot_nc( Fixture *fixture, gconstpointer pData )
 {
-    GHashTable *frame_hash;
     KvpValue *orig_value, *orig_value2, *copy_value;
     /* test indirectly static function kvp_frame_replace_slot_nc */
     g_assert( fixture->frame );
@@ -1272,20 +1265,16 @@ test_kvp_frame_replace_slot_nc( Fixture *fixture, gconstpointer pData )
     orig_value = kvp_value_new_gint64( 2 );
     kvp_frame_set_slot( fixture->frame, "test", orig_value );
     g_assert( !kvp_frame_is_empty( fixture->frame ) );
-    frame_hash = kvp_frame_get_hash( fixture->frame );
-    g_assert( frame_hash );
-    g_assert_cmpint( g_hash_table_size( frame_hash ), == , 1 );
-    copy_value = g_hash_table_lookup( frame_hash, "test" );
+    g_assert_cmpint( kvp_frame_get_slot_count( fixture->frame ), == , 1 );
+    copy_value = kvp_frame_get_slot( fixture->frame, "test" );
     g_assert( orig_value != copy_value );
     g_assert_cmpint( kvp_value_compare( orig_value, copy_value ), == , 0 );
 
     g_test_message( "Test when value is replaced" );
     orig_value2 = kvp_value_new_gint64( 5 );
     kvp_frame_set_slot( fixture->frame, "test", orig_value2 );
-    frame_hash = kvp_frame_get_hash( fixture->frame );
-    g_assert( frame_hash );
-    g_assert_cmpint( g_hash_table_size( frame_hash ), == , 1 );
-    copy_value = g_hash_table_lookup( frame_hash, "test" );
+    g_assert_cmpint( kvp_frame_get_slot_count( fixture->frame ), == , 1 );
+    copy_value = kvp_frame_get_slot( fixture->frame, "test" );
     g_assert( orig_value2 != copy_value );
     g_assert_cmpint( kvp_value_compare( orig_value2, copy_value ), == , 0 );
     g_assert_cmpint( kvp_value_compare( orig_value, copy_value ), != , 0 );
@@ -1294,6 +1283,92 @@ test_kvp_frame_replace_slot_nc( Fixture *fixture, gconstpointer pData )
     kvp_value_delete( orig_value2 );
 }
 
+static void
+test_kvp_frame_many_slots( Fixture *fixture, gconstpointer pData )
+{
+    gchar key[16];
+    gint i;
+
+    g_test_message( "Test the frame keeps its slots when it grows past the small array" );
+    for ( i = 0; i < 100; i++ )
+    {
+        g_snprintf( key, sizeof( key ), "key%d", i );
+        kvp_frame_set_gint64( fixture->frame, key, i );
+    }
+    g_assert_cmpint( kvp_frame_get_slot_count( fixture->frame ), == , 100 );
+    for ( i = 0; i < 100; i++ )
+    {
+        g_snprintf( key, sizeof( key ), "key%d", i );
+        g_assert_cmpint( kvp_frame_get_gint64( fixture->frame, key ), == , i );
+    }
+
+    g_test_message( "Test removing every other slot leaves the rest reachable" );
+    for ( i = 0; i < 100; i += 2 )
+    {
+        g_snprintf( key, sizeof( key ), "key%d", i );
+        kvp_frame_set_slot_nc( fixture->frame, key, NULL );
+    }
+    g_assert_cmpint( kvp_frame_get_slot_count( fixture->frame ), == , 50 );
+    for ( i = 0; i < 100; i++ )
+    {
+        g_snprintf( key, sizeof( key ), "key%d", i );
+        if ( i % 2 )
+            g_assert_cmpint( kvp_frame_get_gint64( fixture->frame, key ), == , i );
+        else
+            g_assert( kvp_frame_get_slot( fixture->frame, key ) == NULL );
+    }
+}
+
+static void
+test_kvp_path( Fixture *fixture, gconstpointer pData )
+{
+    KvpPath *path, *path2;
+    KvpValue *value;
+
+    g_test_message( "Test empty paths are refused" );
+    g_assert( kvp_path_new_from_string( "//" ) == NULL );
+
+    g_test_message( "Test frames are created along the path" );
+    path = kvp_path_new_from_string( "/a//b/c/" );
+    g_assert( path );
+    g_assert( kvp_frame_get_value_by_path( fixture->frame, path ) == NULL );
+    g_assert( kvp_frame_set_value_by_path_nc( fixture->frame, path,
+              kvp_value_new_gint64( 7 ) ) );
+    g_assert_cmpint( kvp_frame_get_gint64( fixture->frame, "a/b/c" ), == , 7 );
+
+    g_test_message( "Test paths made either way find the same value" );
+    path2 = kvp_path_new( "a", "b", "c", NULL );
+    value = kvp_frame_get_value_by_path( fixture->frame, path2 );
+    g_assert( value );
+    g_assert_cmpint( kvp_value_get_gint64( value ), == , 7 );
+
+    g_test_message( "Test when existing path elements are not frames" );
+    kvp_path_free( path2 );
+    path2 = kvp_path_new( "a", "b", "c", "d", NULL );
+    value = kvp_value_new_gint64( 8 );
+    g_assert( kvp_frame_set_value_by_path_nc( fixture->frame, path2, value ) == NULL );
+    g_assert( kvp_frame_get_value_by_path( fixture->frame, path2 ) == NULL );
+    kvp_value_delete( value );
+
+    g_test_message( "Test a NULL value deletes the slot" );
+    kvp_frame_set_value_by_path_nc( fixture->frame, path, NULL );
+    g_assert( kvp_frame_get_value_by_path( fixture->frame, path ) == NULL );
+    g_assert( kvp_frame_get_frame( fixture->frame, "a/b" ) );
+
+    g_test_message( "Test a path outlives the keys of the frames" );
+    kvp_frame_set_gint64( fixture->frame, "a/b/c", 9 );
+    kvp_frame_delete( fixture->frame );
+    fixture->frame = kvp_frame_new();
+    g_assert( kvp_frame_get_value_by_path( fixture->frame, path ) == NULL );
+    kvp_frame_set_gint64( fixture->frame, "a/b/c", 10 );
+    value = kvp_frame_get_value_by_path( fixture->frame, path );
+    g_assert( value );
+    g_assert_cmpint( kvp_value_get_gint64( value ), == , 10 );
+
+    kvp_path_free( path );
+    kvp_path_free( path2 );
+}
+
 static void
 test_get_trailer_make( Fixture *fixture, gconstpointer pData )
 {
@@ -1712,6 +1787,8 @@ test_suite_kvp_frame( void )
     GNC_TEST_ADD( suitename, "kvp frame set slot path", Fixture, NULL, setup, test_kvp_frame_set_slot_path, teardown );
     GNC_TEST_ADD( suitename, "kvp frame set slot path gslist", Fixture, NULL, setup, test_kvp_frame_set_slot_path_gslist, teardown );
     GNC_TEST_ADD( suitename, "kvp frame replace slot nc", Fixture, NULL, setup, test_kvp_frame_replace_slot_nc, teardown );
+    GNC_TEST_ADD( suitename, "kvp frame many slots", Fixture, NULL, setup, test_kvp_frame_many_slots, teardown );
+    GNC_TEST_ADD( suitename, "kvp path", Fixture, NULL, setup, test_kvp_path, teardown );
     GNC_TEST_ADD( suitename, "get trailer make", Fixture, NULL, setup_static, test_get_trailer_make, teardown_static );
     GNC_TEST_ADD( suitename, "kvp value glist to string", Fixture, NULL, setup_static, test_kvp_value_glist_to_string, teardown_static );
     GNC_TEST_ADD( suitename, "get or make", Fixture, NULL, setup_static, test_get_or_make, teardown_static );
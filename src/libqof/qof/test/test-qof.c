@@ -26,6 +26,7 @@
 #include "qof.h"
 
 extern void test_suite_qofbook();
+extern void test_suite_qofevent();
 extern void test_suite_qofinstance();
 extern void test_suite_kvp_frame();
 extern void test_suite_qofobject();
@@ -44,6 +45,7 @@ main (int   argc,
     g_test_bug_base("https://bugzilla.gnome.org/show_bug.cgi?id="); /* init the bugzilla URL */
 
     test_suite_qofbook();
+    test_suite_qofevent();
     test_suite_qofinstance();
     test_suite_kvp_frame();
     test_suite_qofobject();
@@ -697,6 +697,46 @@ test_book_set_data_fin( void )
     g_assert( test_struct.called );
 }
 
+static void
+test_book_get_memory_stats( Fixture *fixture, gconstpointer pData )
+{
+    QofInstance *inst1 = g_object_new( QOF_TYPE_INSTANCE, NULL );
+    QofInstance *inst2 = g_object_new( QOF_TYPE_INSTANCE, NULL );
+    QofBookMemoryStats *stat;
+    GList *stats;
+    gsize bytes;
+
+    g_test_message( "Testing with empty book" );
+    qof_book_get_collection( fixture->book, "my_type" );
+    stats = qof_book_get_memory_stats( fixture->book );
+    g_assert( stats == NULL );
+
+    g_test_message( "Testing with two instances" );
+    qof_instance_init_data( inst1, "my_type", fixture->book );
+    qof_instance_init_data( inst2, "my_type", fixture->book );
+    stats = qof_book_get_memory_stats( fixture->book );
+    g_assert_cmpint( g_list_length( stats ), == , 1 );
+    stat = stats->data;
+    g_assert_cmpstr( stat->e_type, == , "my_type" );
+    g_assert_cmpuint( stat->count, == , 2 );
+    bytes = 2 * sizeof( QofInstance ) +
+            kvp_frame_get_memory_size( qof_instance_get_slots( inst1 ) ) +
+            kvp_frame_get_memory_size( qof_instance_get_slots( inst2 ) );
+    g_assert_cmpuint( stat->bytes, == , bytes );
+    g_list_free_full( stats, g_free );
+
+    g_test_message( "Testing with a slot" );
+    kvp_frame_set_string( qof_instance_get_slots( inst1 ), "notes",
+                          "some notes" );
+    stats = qof_book_get_memory_stats( fixture->book );
+    stat = stats->data;
+    g_assert_cmpuint( stat->bytes, >= , bytes + strlen( "some notes" ) + 1 );
+    g_list_free_full( stats, g_free );
+
+    g_object_unref( inst1 );
+    g_object_unref( inst2 );
+}
+
 static void
 test_book_mark_closed( Fixture *fixture, gconstpointer pData )
 {
@@ -767,6 +807,7 @@ test_suite_qofbook ( void )
     GNC_TEST_ADD( suitename, "get collection", Fixture, NULL, setup, test_book_get_collection, teardown );
     GNC_TEST_ADD( suitename, "foreach collection", Fixture, NULL, setup, test_book_foreach_collection, teardown );
     GNC_TEST_ADD_FUNC( suitename, "set data finalizers", test_book_set_data_fin );
+    GNC_TEST_ADD( suitename, "get memory stats", Fixture, NULL, setup, test_book_get_memory_stats, teardown );
     GNC_TEST_ADD( suitename, "mark closed", Fixture, NULL, setup, test_book_mark_closed, teardown );
     GNC_TEST_ADD_FUNC( suitename, "book new and destroy", test_book_new_destroy );
 }
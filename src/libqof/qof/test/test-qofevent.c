@@ -0,0 +1,161 @@
+/********************************************************************
+ * test-qofevent.c: GLib g_test test suite for qofevent.cpp.        *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+********************************************************************/
+#include "config.h"
+#include <glib.h>
+#include <unittest-support.h>
+#include "../qof.h"
+
+static const gchar *suitename = "/qof/qofevent";
+void test_suite_qofevent ( void );
+
+#define TYPE_A "event-test-a"
+#define TYPE_B "event-test-b"
+
+typedef struct
+{
+    QofBook *book;
+    QofInstance *inst_a;
+    QofInstance *inst_b;
+    GString *calls;
+    gint handler_id;
+} Fixture;
+
+static void
+setup( Fixture *fixture, gconstpointer pData )
+{
+    fixture->book = qof_book_new();
+    fixture->inst_a = g_object_new( QOF_TYPE_INSTANCE, NULL );
+    qof_instance_init_data( fixture->inst_a, TYPE_A, fixture->book );
+    fixture->inst_b = g_object_new( QOF_TYPE_INSTANCE, NULL );
+    qof_instance_init_data( fixture->inst_b, TYPE_B, fixture->book );
+    fixture->calls = g_string_new( NULL );
+}
+
+static void
+teardown( Fixture *fixture, gconstpointer pData )
+{
+    g_string_free( fixture->calls, TRUE );
+    g_object_unref( fixture->inst_a );
+    g_object_unref( fixture->inst_b );
+    qof_book_destroy( fixture->book );
+}
+
+/* Each handler notes its letter in fixture->calls */
+static void
+handler_any( QofInstance *ent, QofEventId event_type,
+             gpointer handler_data, gpointer event_data )
+{
+    g_string_append_c( ((Fixture*)handler_data)->calls, '*' );
+}
+
+static void
+handler_a( QofInstance *ent, QofEventId event_type,
+           gpointer handler_data, gpointer event_data )
+{
+    g_assert_cmpstr( ent->e_type, ==, TYPE_A );
+    g_string_append_c( ((Fixture*)handler_data)->calls, 'a' );
+}
+
+static void
+handler_b( QofInstance *ent, QofEventId event_type,
+           gpointer handler_data, gpointer event_data )
+{
+    g_assert_cmpstr( ent->e_type, ==, TYPE_B );
+    g_string_append_c( ((Fixture*)handler_data)->calls, 'b' );
+}
+
+static void
+handler_unregister( QofInstance *ent, QofEventId event_type,
+                    gpointer handler_data, gpointer event_data )
+{
+    Fixture *fixture = handler_data;
+
+    g_string_append_c( fixture->calls, 'u' );
+    qof_event_unregister_handler( fixture->handler_id );
+}
+
+static void
+test_qof_event_filtered_dispatch( Fixture *fixture, gconstpointer pData )
+{
+    gint id_any, id_a, id_b;
+    guint64 generated, invoked;
+
+    id_any = qof_event_register_handler( handler_any, fixture );
+    id_a = qof_event_register_filtered_handler( TYPE_A, QOF_EVENT_MODIFY,
+                                                handler_a, fixture );
+    id_b = qof_event_register_filtered_handler( TYPE_B, 0, handler_b,
+                                                fixture );
+    qof_event_reset_counts();
+
+    /* The newest handlers are still called first */
+    qof_event_gen( fixture->inst_a, QOF_EVENT_MODIFY, NULL );
+    g_assert_cmpstr( fixture->calls->str, ==, "a*" );
+    qof_event_gen( fixture->inst_a, QOF_EVENT_CREATE, NULL );
+    g_assert_cmpstr( fixture->calls->str, ==, "a**" );
+    qof_event_gen( fixture->inst_b, QOF_EVENT_DESTROY, NULL );
+    g_assert_cmpstr( fixture->calls->str, ==, "a**b*" );
+
+    qof_event_get_counts( &generated, &invoked );
+    g_assert_cmpuint( generated, ==, 3 );
+    g_assert_cmpuint( invoked, ==, 5 );
+
+    /* Suspended events are neither delivered nor counted */
+    qof_event_suspend();
+    qof_event_gen( fixture->inst_a, QOF_EVENT_MODIFY, NULL );
+    qof_event_resume();
+    qof_event_get_counts( &generated, &invoked );
+    g_assert_cmpuint( generated, ==, 3 );
+
+    qof_event_unregister_handler( id_a );
+    qof_event_gen( fixture->inst_a, QOF_EVENT_MODIFY, NULL );
+    g_assert_cmpstr( fixture->calls->str, ==, "a**b**" );
+
+    qof_event_unregister_handler( id_any );
+    qof_event_unregister_handler( id_b );
+    qof_event_gen( fixture->inst_b, QOF_EVENT_MODIFY, NULL );
+    g_assert_cmpstr( fixture->calls->str, ==, "a**b**" );
+}
+
+static void
+test_qof_event_unregister_in_handler( Fixture *fixture, gconstpointer pData )
+{
+    gint id_a;
+
+    id_a = qof_event_register_filtered_handler( TYPE_A, 0, handler_a,
+                                                fixture );
+    fixture->handler_id =
+        qof_event_register_filtered_handler( TYPE_A, 0, handler_unregister,
+                                             fixture );
+
+    qof_event_gen( fixture->inst_a, QOF_EVENT_MODIFY, NULL );
+    g_assert_cmpstr( fixture->calls->str, ==, "ua" );
+    qof_event_gen( fixture->inst_a, QOF_EVENT_MODIFY, NULL );
+    g_assert_cmpstr( fixture->calls->str, ==, "uaa" );
+
+    qof_event_unregister_handler( id_a );
+}
+
+void
+test_suite_qofevent ( void )
+{
+    GNC_TEST_ADD( suitename, "filtered dispatch", Fixture, NULL, setup, test_qof_event_filtered_dispatch, teardown );
+    GNC_TEST_ADD( suitename, "unregister in handler", Fixture, NULL, setup, test_qof_event_unregister_in_handler, teardown );
+}
@@ -63,6 +63,7 @@
 #include "Account.h"
 #include "gnc-commodity.h"
 #include "gnc-lot.h"
+#include "gnc-split-columns.h"
 #include "gnc-numeric.h"
 #include "gncCustomer.h"
 #include "gncCustomerP.h"